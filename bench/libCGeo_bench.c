@@ -0,0 +1,734 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Benchmark program timing the hot paths of libCGeo over a sweep of input sizes and distributions.
+ * Every case is run several times; the table printed to the terminal and the optional JSON report
+ * give the minimum, mean and percentile run times along with the throughput in points per second.
+ *
+ * Usage: libCGeo_bench [--min-size N] [--max-size N] [--max-set-size N] [--repeats N] [--min-time S]
+ *                      [--seed N] [--filter TEXT] [--distribution NAME] [--csv-path PATH] [--json PATH]
+ *                      [--simd scalar|sse2|avx2|avx512]
+ *
+ * Sizes go up by powers of ten from --min-size (default 1e2) to --max-size (default 1e6, pass 1e8 for
+ * the full sweep). Point set cases stop at --max-set-size (default 1e6), since every point of a set is
+ * a separate allocation. Passing --json - writes the report to stdout and the table to stderr.
+ * --simd pins the numeric kernels to one instruction set, by default the best one is used.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libCGeo/libCGeo.h"
+#include "libCGeo/libCGeo_config.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define BENCH_MAX_RUNS 1000
+
+
+//----------------------------------------------------------------
+// Timing and inputs
+//----------------------------------------------------------------
+
+
+static double bench_seconds(void){
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+#endif
+}
+
+
+typedef struct BenchDistribution {
+    const char* name;
+    CGDistribution_t distribution;
+} BenchDistribution_t;
+
+
+static const BenchDistribution_t distributions[] = {
+    {"uniform", CG_UNIFORM_SQUARE},
+    {"disk", CG_UNIFORM_DISK},
+    {"clustered", CG_GAUSSIAN_CLUSTERS},
+    {"circle", CG_CIRCLE},
+    {"collinear", CG_COLLINEAR},
+    {"duplicates", CG_DUPLICATES},
+    {"large", CG_LARGE_MAGNITUDE},
+};
+
+#define NUM_DISTRIBUTIONS (sizeof(distributions) / sizeof(distributions[0]))
+
+
+//----------------------------------------------------------------
+// Benchmarked operations
+//----------------------------------------------------------------
+
+
+/**
+ * Inputs shared by every case of one size and distribution. The point set is only built when
+ * the size is within --max-set-size, and the .csv file only once a CSV case needs it.
+ */
+typedef struct BenchInput {
+    CGPointArray_t* array;
+    CGPointSet_t* set;
+    CGContext_t* context;
+    const char* csv_path;
+    int csv_written;
+    size_t csv_bytes;
+} BenchInput_t;
+
+
+/**
+ * A benchmarked operation. It times only the call under test, leaving setup and cleanup out of
+ * the measured region, and stores the elapsed time in seconds.
+ */
+typedef CGError_t (*BenchFunction_t)(BenchInput_t* input, double* seconds);
+
+
+static CGError_t bench_hull(BenchInput_t* input, double* seconds, CGConvexHull_t method, CGCompute_t compute_type){
+    CGPointSet_t* output = init_point_set();
+    if(output == NULL) return CG_NO_MEMORY;
+    double start = bench_seconds();
+    CGError_t status = compute_convex_hull(input->set, output, method, compute_type);
+    *seconds = bench_seconds() - start;
+    free_point_set(output);
+    return status;
+}
+
+
+static CGError_t bench_graham_no_degeneracy(BenchInput_t* input, double* seconds){
+    return bench_hull(input, seconds, CG_GRAHAM_SCAN, CG_NO_DEGENERACY);
+}
+
+
+static CGError_t bench_graham_w_degeneracy(BenchInput_t* input, double* seconds){
+    return bench_hull(input, seconds, CG_GRAHAM_SCAN, CG_W_DEGENERACY);
+}
+
+
+static CGError_t bench_monotone_no_degeneracy(BenchInput_t* input, double* seconds){
+    return bench_hull(input, seconds, CG_MONOTONE_CHAIN, CG_NO_DEGENERACY);
+}
+
+
+static CGError_t bench_monotone_w_degeneracy(BenchInput_t* input, double* seconds){
+    return bench_hull(input, seconds, CG_MONOTONE_CHAIN, CG_W_DEGENERACY);
+}
+
+
+static CGError_t bench_monotone_array(BenchInput_t* input, double* seconds){
+    CGPointArray_t* output = init_point_array(0);
+    if(output == NULL) return CG_NO_MEMORY;
+    double start = bench_seconds();
+    CGError_t status = compute_monotone_chain(input->array, output, CG_NO_DEGENERACY);
+    *seconds = bench_seconds() - start;
+    free_point_array(output);
+    return status;
+}
+
+
+static CGError_t bench_monotone_array_ctx(BenchInput_t* input, double* seconds){
+    CGPointArray_t* output = init_point_array(0);
+    if(output == NULL) return CG_NO_MEMORY;
+    double start = bench_seconds();
+    CGError_t status = compute_monotone_chain_ctx(input->context, input->array, output, CG_NO_DEGENERACY);
+    *seconds = bench_seconds() - start;
+    free_point_array(output);
+    return status;
+}
+
+
+/* sort_point_set orders by sort_val, which the input set carries as the x coordinate. Copying into
+ * the output set is part of the call and so part of the measurement. */
+static CGError_t bench_sort_point_set(BenchInput_t* input, double* seconds){
+    CGPointSet_t* output = init_point_set();
+    if(output == NULL) return CG_NO_MEMORY;
+    double start = bench_seconds();
+    CGError_t status = sort_point_set(input->set, output);
+    *seconds = bench_seconds() - start;
+    free_point_set(output);
+    return status;
+}
+
+
+static CGError_t bench_csv_write(BenchInput_t* input, double* seconds){
+    double start = bench_seconds();
+    CGError_t status = csv_path_from_point_array(input->array, input->csv_path, CG_CSV_SHORTEST);
+    *seconds = bench_seconds() - start;
+    return status;
+}
+
+
+static CGError_t bench_csv_read(BenchInput_t* input, double* seconds){
+    CGPointArray_t* output = init_point_array(0);
+    if(output == NULL) return CG_NO_MEMORY;
+    double start = bench_seconds();
+    CGError_t status = point_array_from_csv_path(output, input->csv_path);
+    *seconds = bench_seconds() - start;
+    if(status == CG_SUCCESS && output->num_points != input->array->num_points) status = CG_INVALID_FILE;
+    free_point_array(output);
+    return status;
+}
+
+
+static CGError_t bench_csv_read_ctx(BenchInput_t* input, double* seconds){
+    CGPointArray_t* output = init_point_array(0);
+    if(output == NULL) return CG_NO_MEMORY;
+    double start = bench_seconds();
+    CGError_t status = point_array_from_csv_path_ctx(input->context, output, input->csv_path);
+    *seconds = bench_seconds() - start;
+    if(status == CG_SUCCESS && output->num_points != input->array->num_points) status = CG_INVALID_FILE;
+    free_point_array(output);
+    return status;
+}
+
+
+static CGError_t bench_bounding_box(BenchInput_t* input, double* seconds){
+    CGBoundingBox_t box;
+    double start = bench_seconds();
+    CGError_t status = compute_bounding_box(input->array, &box);
+    *seconds = bench_seconds() - start;
+    return status;
+}
+
+
+static CGError_t bench_bounding_box_ctx(BenchInput_t* input, double* seconds){
+    CGBoundingBox_t box;
+    double start = bench_seconds();
+    CGError_t status = compute_bounding_box_ctx(input->context, input->array, &box);
+    *seconds = bench_seconds() - start;
+    return status;
+}
+
+
+static CGError_t bench_point_stats(BenchInput_t* input, double* seconds){
+    CGPointStats_t stats;
+    double start = bench_seconds();
+    CGError_t status = compute_point_stats(input->array, &stats);
+    *seconds = bench_seconds() - start;
+    return status;
+}
+
+
+static CGError_t bench_point_stats_ctx(BenchInput_t* input, double* seconds){
+    CGPointStats_t stats;
+    double start = bench_seconds();
+    CGError_t status = compute_point_stats_ctx(input->context, input->array, &stats);
+    *seconds = bench_seconds() - start;
+    return status;
+}
+
+
+static CGError_t bench_dedup(BenchInput_t* input, double tolerance, double* seconds){
+    CGPointArray_t* output = init_point_array(0);
+    if(output == NULL) return CG_NO_MEMORY;
+    double start = bench_seconds();
+    CGError_t status = dedup_point_array(input->array, output, tolerance, NULL);
+    *seconds = bench_seconds() - start;
+    free_point_array(output);
+    return status;
+}
+
+
+static CGError_t bench_dedup_exact(BenchInput_t* input, double* seconds){
+    return bench_dedup(input, 0.0, seconds);
+}
+
+
+static CGError_t bench_dedup_grid(BenchInput_t* input, double* seconds){
+    return bench_dedup(input, 1e-6, seconds);
+}
+
+
+static CGError_t bench_kd_tree_build(BenchInput_t* input, double* seconds){
+    double start = bench_seconds();
+    CGKdTree_t* tree = init_kd_tree(input->array);
+    *seconds = bench_seconds() - start;
+    if(tree == NULL) return CG_NO_MEMORY;
+    free_kd_tree(tree);
+    return CG_SUCCESS;
+}
+
+
+/* Every point of the array is a query, answered with the tree built outside of the timing */
+static CGError_t bench_kd_tree_nearest_ctx(BenchInput_t* input, double* seconds){
+    CGKdTree_t* tree = init_kd_tree(input->array);
+    size_t* nearest = (size_t*) malloc(input->array->num_points * sizeof(size_t));
+    CGError_t status = CG_NO_MEMORY;
+    if(tree != NULL && nearest != NULL){
+        double start = bench_seconds();
+        status = kd_tree_nearest_batch_ctx(input->context, tree, input->array, nearest, NULL);
+        *seconds = bench_seconds() - start;
+    }
+    free(nearest);
+    if(tree != NULL) free_kd_tree(tree);
+    return status;
+}
+
+
+/* Compares doubles ascending, for qsort */
+static int compare_doubles(const void* a, const void* b){
+    double value_A = *(const double*) a, value_B = *(const double*) b;
+    return (value_A > value_B) - (value_A < value_B);
+}
+
+
+/*
+ * Cell size and radius reaching about eight other points from a typical point: the median distance of
+ * the eighth nearest neighbour over a sample, so clustered inputs do not report a quadratic number of pairs
+ */
+static double bench_grid_radius(CGPointArray_t* array){
+    double radius = 0;
+    size_t num_samples = 0, i;
+    double distances[256];
+    CGKdTree_t* tree = init_kd_tree(array);
+    if(tree != NULL && array->num_points > 8){
+        for(i = 0; i < 256; i++){
+            size_t neighbors[9];
+            double squared_distances[9];
+            size_t sample = (size_t) (((unsigned long long) i * 2654435761u) % array->num_points);
+            if(kd_tree_k_nearest(tree, array->xcoords[sample], array->ycoords[sample], 9, neighbors, squared_distances) == CG_SUCCESS)
+                distances[num_samples++] = sqrt(squared_distances[8]);
+        }
+        qsort(distances, num_samples, sizeof(double), compare_doubles);
+        radius = num_samples ? distances[num_samples / 2] : 0;
+    }
+    if(tree != NULL) free_kd_tree(tree);
+    // mostly duplicated points have no spread to measure; any small radius will do
+    return radius > 0 ? radius : 1e-3;
+}
+
+
+static CGError_t bench_grid_build(BenchInput_t* input, double* seconds){
+    double radius = bench_grid_radius(input->array);
+    double start = bench_seconds();
+    CGPointGrid_t* grid = init_point_grid(input->array, radius);
+    *seconds = bench_seconds() - start;
+    if(grid == NULL) return CG_NO_MEMORY;
+    free_point_grid(grid);
+    return CG_SUCCESS;
+}
+
+
+static CGError_t bench_grid_pairs_ctx(BenchInput_t* input, double* seconds){
+    double radius = bench_grid_radius(input->array);
+    CGPointGrid_t* grid = init_point_grid(input->array, radius);
+    if(grid == NULL) return CG_NO_MEMORY;
+    size_t* pairs = NULL;
+    size_t num_pairs;
+    double start = bench_seconds();
+    CGError_t status = point_grid_pairs_within_ctx(input->context, grid, radius, &pairs, &num_pairs);
+    *seconds = bench_seconds() - start;
+    free_buffer(pairs);
+    free_point_grid(grid);
+    return status;
+}
+
+
+static CGError_t bench_rtree_build(BenchInput_t* input, double* seconds){
+    double start = bench_seconds();
+    CGRTree_t* tree = init_point_array_rtree(input->array);
+    *seconds = bench_seconds() - start;
+    if(tree == NULL) return CG_NO_MEMORY;
+    free_rtree(tree);
+    return CG_SUCCESS;
+}
+
+
+/* A window around every point of the array, sized like the grid radius, searched with the tree built outside of the timing */
+static CGError_t bench_rtree_query_ctx(BenchInput_t* input, double* seconds){
+    size_t num_points = input->array->num_points, i;
+    double half_size = bench_grid_radius(input->array);
+    CGRTree_t* tree = init_point_array_rtree(input->array);
+    CGBoundingBox_t* windows = (CGBoundingBox_t*) malloc((num_points ? num_points : 1) * sizeof(CGBoundingBox_t));
+    size_t* offsets = (size_t*) malloc((num_points + 1) * sizeof(size_t));
+    size_t* items = NULL;
+    CGError_t status = CG_NO_MEMORY;
+    if(tree != NULL && windows != NULL && offsets != NULL){
+        for(i = 0; i < num_points; i++){
+            windows[i].min_x = input->array->xcoords[i] - half_size;
+            windows[i].max_x = input->array->xcoords[i] + half_size;
+            windows[i].min_y = input->array->ycoords[i] - half_size;
+            windows[i].max_y = input->array->ycoords[i] + half_size;
+        }
+        double start = bench_seconds();
+        status = rtree_query_batch_ctx(input->context, tree, windows, num_points, &items, offsets);
+        *seconds = bench_seconds() - start;
+    }
+    free_buffer(items);
+    free(windows);
+    free(offsets);
+    if(tree != NULL) free_rtree(tree);
+    return status;
+}
+
+
+typedef enum BenchInputKind {
+    BENCH_ARRAY,        /**< Reads the point array */
+    BENCH_SET,          /**< Reads the point set, limited by --max-set-size */
+    BENCH_CSV,          /**< Reads or rewrites the .csv file written from the point array */
+} BenchInputKind_t;
+
+
+typedef struct BenchCase {
+    const char* name;
+    BenchInputKind_t kind;
+    BenchFunction_t run;
+} BenchCase_t;
+
+
+static const BenchCase_t cases[] = {
+    {"hull/graham/no_degeneracy", BENCH_SET, bench_graham_no_degeneracy},
+    {"hull/graham/w_degeneracy", BENCH_SET, bench_graham_w_degeneracy},
+    {"hull/monotone/no_degeneracy", BENCH_SET, bench_monotone_no_degeneracy},
+    {"hull/monotone/w_degeneracy", BENCH_SET, bench_monotone_w_degeneracy},
+    {"hull/monotone_array", BENCH_ARRAY, bench_monotone_array},
+    {"hull/monotone_array_ctx", BENCH_ARRAY, bench_monotone_array_ctx},
+    {"sort/point_set", BENCH_SET, bench_sort_point_set},
+    {"csv/write", BENCH_CSV, bench_csv_write},
+    {"csv/read", BENCH_CSV, bench_csv_read},
+    {"csv/read_ctx", BENCH_CSV, bench_csv_read_ctx},
+    {"query/bounding_box", BENCH_ARRAY, bench_bounding_box},
+    {"query/bounding_box_ctx", BENCH_ARRAY, bench_bounding_box_ctx},
+    {"query/point_stats", BENCH_ARRAY, bench_point_stats},
+    {"query/point_stats_ctx", BENCH_ARRAY, bench_point_stats_ctx},
+    {"dedup/exact", BENCH_ARRAY, bench_dedup_exact},
+    {"dedup/grid", BENCH_ARRAY, bench_dedup_grid},
+    {"spatial/kd_tree_build", BENCH_ARRAY, bench_kd_tree_build},
+    {"spatial/kd_tree_nearest_ctx", BENCH_ARRAY, bench_kd_tree_nearest_ctx},
+    {"spatial/grid_build", BENCH_ARRAY, bench_grid_build},
+    {"spatial/grid_pairs_ctx", BENCH_ARRAY, bench_grid_pairs_ctx},
+    {"spatial/rtree_build", BENCH_ARRAY, bench_rtree_build},
+    {"spatial/rtree_query_ctx", BENCH_ARRAY, bench_rtree_query_ctx},
+};
+
+#define NUM_CASES (sizeof(cases) / sizeof(cases[0]))
+
+
+//----------------------------------------------------------------
+// Statistics and reporting
+//----------------------------------------------------------------
+
+
+typedef struct BenchOptions {
+    size_t min_size;
+    size_t max_size;
+    size_t max_set_size;
+    int repeats;
+    double min_time;
+    unsigned long long seed;
+    const char* filter;
+    const char* distribution;
+    const char* csv_path;
+    const char* json_path;
+    const char* simd;
+} BenchOptions_t;
+
+
+typedef struct BenchResult {
+    int runs;
+    double min;
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+} BenchResult_t;
+
+
+static int compare_seconds(const void* a, const void* b){
+    double da = *(const double*) a;
+    double db = *(const double*) b;
+    return (da > db) - (da < db);
+}
+
+
+/* Nearest-rank percentile of sorted run times. */
+static double percentile(const double* sorted, int count, double percent){
+    int rank = (int) ceil(percent / 100.0 * count);
+    if(rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+
+/**
+ * Runs a case at least --repeats times, and further until --min-time seconds have been measured,
+ * so that small inputs still give stable percentiles.
+ */
+static CGError_t run_case(const BenchCase_t* bench_case, BenchInput_t* input, const BenchOptions_t* options, BenchResult_t* result){
+    double times[BENCH_MAX_RUNS];
+    double total = 0.0;
+    int runs = 0;
+    while(runs < BENCH_MAX_RUNS && (runs < options->repeats || total < options->min_time)){
+        CGError_t status = bench_case->run(input, &times[runs]);
+        if(status != CG_SUCCESS) return status;
+        total += times[runs];
+        runs++;
+    }
+    qsort(times, runs, sizeof(double), compare_seconds);
+    result->runs = runs;
+    result->min = times[0];
+    result->mean = total / runs;
+    result->p50 = percentile(times, runs, 50.0);
+    result->p90 = percentile(times, runs, 90.0);
+    result->p99 = percentile(times, runs, 99.0);
+    return CG_SUCCESS;
+}
+
+
+static void write_json_result(FILE* fp, int first, const char* name, const char* distribution, size_t size,
+                              const BenchResult_t* result, size_t bytes){
+    fprintf(fp, "%s\n    {\"benchmark\": \"%s\", \"distribution\": \"%s\", \"size\": %zu, \"runs\": %d, ",
+            first ? "" : ",", name, distribution, size, result->runs);
+    fprintf(fp, "\"min_s\": %.9g, \"mean_s\": %.9g, \"p50_s\": %.9g, \"p90_s\": %.9g, \"p99_s\": %.9g, ",
+            result->min, result->mean, result->p50, result->p90, result->p99);
+    fprintf(fp, "\"points_per_s\": %.6g", (double) size / result->p50);
+    if(bytes > 0) fprintf(fp, ", \"bytes_per_s\": %.6g", (double) bytes / result->p50);
+    fprintf(fp, "}");
+}
+
+
+//----------------------------------------------------------------
+// Driver
+//----------------------------------------------------------------
+
+
+static CGError_t build_input(BenchInput_t* input, const BenchDistribution_t* distribution, size_t size, const BenchOptions_t* options){
+    input->array = init_point_array(0);
+    if(input->array == NULL) return CG_NO_MEMORY;
+    CGError_t status = generate_point_array_ctx(input->context, input->array, size, distribution->distribution, options->seed);
+    if(status != CG_SUCCESS) return status;
+    if(size <= options->max_set_size){
+        input->set = init_point_set();
+        if(input->set == NULL) return CG_NO_MEMORY;
+        status = point_set_from_point_array(input->array, input->set);
+        if(status != CG_SUCCESS) return status;
+        CGPointNode_t* current = input->set->head;
+        while(current != NULL){
+            current->point->sort_val = current->point->xcoord;
+            current = current->next;
+        }
+    }
+    return CG_SUCCESS;
+}
+
+
+static void free_input(BenchInput_t* input){
+    if(input->array != NULL) free_point_array(input->array);
+    if(input->set != NULL) free_point_set(input->set);
+    if(input->csv_written) remove(input->csv_path);
+    input->array = NULL;
+    input->set = NULL;
+    input->csv_written = 0;
+}
+
+
+static CGError_t write_csv_input(BenchInput_t* input){
+    CGError_t status = csv_path_from_point_array(input->array, input->csv_path, CG_CSV_SHORTEST);
+    if(status != CG_SUCCESS) return status;
+    input->csv_written = 1;
+    FILE* fp = fopen(input->csv_path, "rb");
+    if(fp == NULL) return CG_INVALID_FILE;
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fclose(fp);
+    input->csv_bytes = length > 0 ? (size_t) length : 0;
+    return CG_SUCCESS;
+}
+
+
+static size_t parse_size(const char* text){
+    return (size_t) strtod(text, NULL);
+}
+
+
+static const char* simd_names[] = {"scalar", "sse2", "avx2", "avx512"};
+
+
+static void print_usage(const char* program){
+    fprintf(stderr, "Usage: %s [--min-size N] [--max-size N] [--max-set-size N] [--repeats N] [--min-time S]\n"
+                    "       [--seed N] [--filter TEXT] [--distribution NAME] [--csv-path PATH] [--json PATH]\n"
+                    "       [--simd scalar|sse2|avx2|avx512]\n", program);
+}
+
+
+static int parse_options(int argc, char** argv, BenchOptions_t* options){
+    options->min_size = 100;
+    options->max_size = 1000000;
+    options->max_set_size = 1000000;
+    options->repeats = 5;
+    options->min_time = 0.25;
+    options->seed = 42;
+    options->filter = NULL;
+    options->distribution = NULL;
+    options->csv_path = "libCGeo_bench.csv";
+    options->json_path = NULL;
+    options->simd = NULL;
+
+    for(int i = 1; i < argc; i++){
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if(value == NULL){
+            print_usage(argv[0]);
+            return -1;
+        }
+        if(strcmp(arg, "--min-size") == 0) options->min_size = parse_size(value);
+        else if(strcmp(arg, "--max-size") == 0) options->max_size = parse_size(value);
+        else if(strcmp(arg, "--max-set-size") == 0) options->max_set_size = parse_size(value);
+        else if(strcmp(arg, "--repeats") == 0) options->repeats = atoi(value);
+        else if(strcmp(arg, "--min-time") == 0) options->min_time = atof(value);
+        else if(strcmp(arg, "--seed") == 0) options->seed = strtoull(value, NULL, 10);
+        else if(strcmp(arg, "--filter") == 0) options->filter = value;
+        else if(strcmp(arg, "--distribution") == 0) options->distribution = value;
+        else if(strcmp(arg, "--csv-path") == 0) options->csv_path = value;
+        else if(strcmp(arg, "--json") == 0) options->json_path = value;
+        else if(strcmp(arg, "--simd") == 0) options->simd = value;
+        else{
+            print_usage(argv[0]);
+            return -1;
+        }
+        i++;
+    }
+    if(options->min_size < 1 || options->max_size < options->min_size || options->repeats < 1 || options->repeats > BENCH_MAX_RUNS){
+        print_usage(argv[0]);
+        return -1;
+    }
+    return 0;
+}
+
+
+int main(int argc, char** argv){
+
+    BenchOptions_t options;
+    if(parse_options(argc, argv, &options) != 0){
+        print_cg_error(CG_INVALID_INPUT, "main");
+        return -1;
+    }
+
+    if(options.simd != NULL){
+        int level = 0;
+        while(level < 4 && strcmp(options.simd, simd_names[level]) != 0) level++;
+        if(level == 4 || set_simd_level((CGSimdLevel_t) level) != CG_SUCCESS){
+            fprintf(stderr, "Instruction set %s is not supported here\n", options.simd);
+            print_cg_error(CG_INVALID_INPUT, "main");
+            return -1;
+        }
+    }
+
+    FILE* json = NULL;
+    FILE* table = stdout;
+    if(options.json_path != NULL){
+        if(strcmp(options.json_path, "-") == 0){
+            json = stdout;
+            table = stderr;
+        }
+        else json = fopen(options.json_path, "w");
+        if(json == NULL){
+            print_cg_error(CG_INVALID_FILE, "main");
+            return -1;
+        }
+    }
+
+    CGContext_t* context = init_context(NULL);
+    if(context == NULL){
+        print_cg_error(CG_NO_MEMORY, "main");
+        return -1;
+    }
+
+    if(json != NULL){
+        fprintf(json, "{\n  \"library\": \"libCGeo\",\n  \"version\": \"%s\",\n  \"threads\": %d,\n  \"simd\": \"%s\",\n",
+                LIBCGEO_VERSION_STR, get_context_num_threads(context), simd_names[get_simd_level()]);
+        fprintf(json, "  \"seed\": %llu,\n  \"repeats\": %d,\n  \"results\": [", options.seed, options.repeats);
+    }
+    fprintf(table, "%-30s %-10s %10s %5s %12s %12s %12s %14s\n",
+            "benchmark", "dist", "size", "runs", "p50 (ms)", "p90 (ms)", "p99 (ms)", "Mpoints/s");
+
+    int first = 1;
+    int failures = 0;
+    for(size_t size = options.min_size; size <= options.max_size; size *= 10){
+        for(size_t d = 0; d < NUM_DISTRIBUTIONS; d++){
+            const BenchDistribution_t* distribution = &distributions[d];
+            if(options.distribution != NULL && strcmp(options.distribution, distribution->name) != 0) continue;
+
+            BenchInput_t input = {NULL, NULL, context, options.csv_path, 0, 0};
+            CGError_t status = build_input(&input, distribution, size, &options);
+            if(status != CG_SUCCESS){
+                print_cg_error(status, "build_input");
+                free_input(&input);
+                failures++;
+                continue;
+            }
+
+            for(size_t c = 0; c < NUM_CASES; c++){
+                const BenchCase_t* bench_case = &cases[c];
+                if(options.filter != NULL && strstr(bench_case->name, options.filter) == NULL) continue;
+                if(bench_case->kind == BENCH_SET && input.set == NULL) continue;
+                if(bench_case->kind == BENCH_CSV && !input.csv_written){
+                    status = write_csv_input(&input);
+                    if(status != CG_SUCCESS){
+                        print_cg_error(status, "write_csv_input");
+                        failures++;
+                        continue;
+                    }
+                }
+
+                BenchResult_t result;
+                status = run_case(bench_case, &input, &options, &result);
+                if(status != CG_SUCCESS){
+                    fprintf(table, "%-30s %-10s %10zu failed:\n", bench_case->name, distribution->name, size);
+                    print_cg_error(status, bench_case->name);
+                    failures++;
+                    continue;
+                }
+                fprintf(table, "%-30s %-10s %10zu %5d %12.4f %12.4f %12.4f %14.3f\n",
+                        bench_case->name, distribution->name, size, result.runs,
+                        result.p50 * 1e3, result.p90 * 1e3, result.p99 * 1e3, (double) size / result.p50 * 1e-6);
+                fflush(table);
+                if(json != NULL){
+                    size_t bytes = (bench_case->kind == BENCH_CSV) ? input.csv_bytes : 0;
+                    write_json_result(json, first, bench_case->name, distribution->name, size, &result, bytes);
+                    first = 0;
+                }
+            }
+            free_input(&input);
+        }
+    }
+
+    if(json != NULL){
+        fprintf(json, "\n  ]\n}\n");
+        if(json != stdout) fclose(json);
+    }
+    free_context(context);
+    return failures == 0 ? 0 : 1;
+}
@@ -53,6 +53,14 @@ extern "C" {
 #include <stdlib.h>
 #include <ctype.h>
 
+// Allocation functions, define these before including csplit to use a different allocator
+#ifndef CSPLIT_CALLOC
+#define CSPLIT_CALLOC(count, size) calloc(count, size)
+#endif
+#ifndef CSPLIT_FREE
+#define CSPLIT_FREE(pointer) free(pointer)
+#endif
+
 #ifdef _MSC_VER
 # define _CSPLIT_FUNC static __inline
 #elif !defined __STDC_VERSION__ || __STDC_VERSION__ < 199901L
@@ -162,7 +170,7 @@ CSplitError_t rcsplit(CSplitList_t* output_list, char* input_str, char* token);
  */
 _CSPLIT_FUNC
 CSplitList_t* csplit_init_list(){
-    CSplitList_t* list = (CSplitList_t*) calloc(1, sizeof(CSplitList_t));
+    CSplitList_t* list = (CSplitList_t*) CSPLIT_CALLOC(1, sizeof(CSplitList_t));
     list->num_elems = 0;
     return list;
 }
@@ -179,11 +187,11 @@ void csplit_clear_list(CSplitList_t* list){
     CSplitFragment_t* current_fragment = list->head;
     while(current_fragment != NULL){
         CSplitFragment_t* temp = current_fragment->next;
-        free(current_fragment->text);
-        free(current_fragment);
+        CSPLIT_FREE(current_fragment->text);
+        CSPLIT_FREE(current_fragment);
         current_fragment = temp;
     }
-    free(list);
+    CSPLIT_FREE(list);
 }
 
 
@@ -213,8 +221,8 @@ CSplitError_t csplit_push_to_list(CSplitList_t* list, CSplitFragment_t* fragment
             fragment->prev = list->tail;
             list->tail = fragment;
         }
-        // allocate fragment text field
-        fragment->text = (char*) calloc(1, buff_size);
+        // allocate fragment text field, with room for the terminator
+        fragment->text = (char*) CSPLIT_CALLOC(1, buff_size + 1);
     }
     return CSPLIT_SUCCESS;
 }
@@ -346,7 +354,7 @@ char* csplit_strip(char* input_str){
             end--;
 
         size_t buff_size = end - start + 1;
-        output_str = (char*) calloc(1, buff_size + 1);
+        output_str = (char*) CSPLIT_CALLOC(1, buff_size + 1);
         strncpy(output_str, start, buff_size);
     }
     return output_str;
@@ -368,7 +376,7 @@ char* csplit_remove_whitespace(char* input_str){
         output_str = NULL;
     else{
         int len = strlen(input_str);
-        output_str = (char*) calloc(1, len);
+        output_str = (char*) CSPLIT_CALLOC(1, len);
         int counter = 0;
         int output_counter = 0;
         // read through but don't copy whitespace
@@ -449,7 +457,7 @@ CSplitError_t csplit_rstr(CSplitList_t* list, char* input_str, char* token, int
     char* last_location = input_str + in_len;
     while(counter >= 0 && num_splits >= max_splits){
         current_location = arr[counter - 1] + token_len;
-        CSplitFragment_t* fragment = (CSplitFragment_t*) calloc(1, sizeof(CSplitFragment_t));
+        CSplitFragment_t* fragment = (CSplitFragment_t*) CSPLIT_CALLOC(1, sizeof(CSplitFragment_t));
         size_t req_buff_size;
         if(num_splits == max_splits || counter == 0){
             req_buff_size = in_len - strlen(last_location);
@@ -490,7 +498,7 @@ CSplitError_t csplit_str(CSplitList_t* list, char* input_str, char* token, int m
     char* next_location;
 
     while(current_location != NULL && num_splits <= max_splits){
-        CSplitFragment_t* fragment = (CSplitFragment_t*) calloc(1, sizeof(CSplitFragment_t));
+        CSplitFragment_t* fragment = (CSplitFragment_t*) CSPLIT_CALLOC(1, sizeof(CSplitFragment_t));
         next_location = strstr(current_location, token);
         size_t req_buff_size;
         if(next_location == NULL || (num_splits == max_splits))
@@ -25,6 +25,14 @@
 /**
  * This is the main header file for libCGeo. It contains all definitions of data structures used by all of the
  * library, in addition to all function definitions for the library.
+ *
+ * Inputs passed as const pointers are only read, and algorithms keep their working state in
+ * per-call scratch memory. Any number of threads may therefore run hulls, conversions, queries
+ * and sorts into their own output sets on one shared point set or array without locking, as long
+ * as no thread modifies it at the same time. compute_point_angles and sort_point_set are the
+ * exceptions, they take the set as writable and may write into it; sort_point_set_into sorts a
+ * shared set into an output set instead. A set's hull cache is locked internally, so sharing a set
+ * with caching enabled is safe as well.
  */
 
 
@@ -78,6 +86,10 @@ typedef enum CG_ERROR {
     CG_INVALID_INPUT        = -3,   /**< Invalid or null input */
     CG_NO_FILE              = -4,   /**< File pointer received by funciton is NULL */
     CG_UNIMPLEMENTED        = -5,   /**< Function is not yet implemented */
+    CG_NO_MEMORY            = -6,   /**< Memory allocation failed */
+    CG_INVALID_FILE         = -7,   /**< File contents are not in the expected format */
+    CG_TIMEOUT              = -8,   /**< Result not available before the timeout */
+    CG_CANCELLED            = -9,   /**< Operation stopped because cancellation was requested */
 } CGError_t;
 
 
@@ -98,15 +110,90 @@ typedef enum CG_DESC_TYPE {
  */
 typedef enum CG_CONVEX_HULL {
     CG_GRAHAM_SCAN,     /**< Compute convex hull with Graham Scan */
+    CG_MONOTONE_CHAIN,  /**< Compute convex hull with Andrew's Monotone Chain */
 } CGConvexHull_t;
 
 
+/**
+ * Enum for selecting how coordinates are written by the .csv writers.
+ * @ingroup file
+ */
+typedef enum CG_CSV_FORMAT {
+    CG_CSV_SHORTEST,    /**< Shortest representation that reads back to the same double */
+    CG_CSV_FIXED_6,     /**< Six decimal places, identical to printf's %lf */
+} CGCsvFormat_t;
+
+
+/**
+ * Enum of the Well-Known Binary geometry types supported by the WKB readers and writers.
+ * Values match the type codes used in the encoding.
+ * @ingroup file
+ */
+typedef enum CG_WKB_TYPE {
+    CG_WKB_POINT        = 1,    /**< Single point */
+    CG_WKB_LINESTRING   = 2,    /**< Sequence of points */
+    CG_WKB_POLYGON      = 3,    /**< Closed rings, the first one being the exterior */
+    CG_WKB_MULTIPOINT   = 4,    /**< Collection of points */
+} CGWkbType_t;
+
+
+/**
+ * Enum of the WKB byte orders. Values match the byte order flag used in the encoding.
+ * @ingroup file
+ */
+typedef enum CG_WKB_BYTE_ORDER {
+    CG_WKB_BIG_ENDIAN       = 0,    /**< XDR, most significant byte first */
+    CG_WKB_LITTLE_ENDIAN    = 1,    /**< NDR, least significant byte first */
+} CGWkbByteOrder_t;
+
+
 typedef enum CG_COMPUTE_TYPE {
     CG_NO_DEGENERACY,   /**< Compute without accounting for degeneracy */
     CG_W_DEGENERACY,    /**< Compute while taking degenracies into account */
 } CGCompute_t;
 
 
+/**
+ * Enum of the distributions drawn from by the point generators.
+ * @ingroup generate
+ */
+typedef enum CG_DISTRIBUTION {
+    CG_UNIFORM_SQUARE,      /**< Uniform in the square [-1, 1) x [-1, 1) */
+    CG_UNIFORM_DISK,        /**< Uniform in the unit disk */
+    CG_GAUSSIAN_CLUSTERS,   /**< Tight normal clusters around 16 centers in the square */
+    CG_CIRCLE,              /**< On the unit circle, so every point is on the hull */
+    CG_COLLINEAR,           /**< Exactly on one line, every turn between points is inline */
+    CG_DUPLICATES,          /**< Around 64 copies of each of a few distinct points in the square */
+    CG_LARGE_MAGNITUDE,     /**< Uniform in a small square far from the origin, near 1e12 */
+} CGDistribution_t;
+
+
+/**
+ * Enum of the algorithm phases timed by the instrumentation.
+ * @ingroup instrument
+ */
+typedef enum CG_PHASE {
+    CG_PHASE_ANGLES,        /**< Computing angles and other sort keys */
+    CG_PHASE_SORT,          /**< Sorting points */
+    CG_PHASE_SCAN,          /**< Building hull chains with a stack */
+    CG_PHASE_DEGENERACY,    /**< Removing duplicate and colinear points */
+    CG_PHASE_PARSE,         /**< Parsing text input */
+    CG_NUM_PHASES,          /**< Number of phases, not a phase */
+} CGPhase_t;
+
+
+/**
+ * Enum of the instruction sets the numeric kernels are built for.
+ * @ingroup simd
+ */
+typedef enum CG_SIMD_LEVEL {
+    CG_SIMD_SCALAR  = 0,    /**< Plain C, on any processor */
+    CG_SIMD_SSE2    = 1,    /**< 128-bit SSE2 */
+    CG_SIMD_AVX2    = 2,    /**< 256-bit AVX2 */
+    CG_SIMD_AVX512  = 3,    /**< 512-bit AVX-512 F and BW */
+} CGSimdLevel_t;
+
+
 //----------------------------------------------------------------
 // Data Structures
 //----------------------------------------------------------------
@@ -125,6 +212,16 @@ typedef struct CG_Point {
 } CGPoint_t;
 
 
+/**
+ * Struct for a point holding only its coordinates, half the size of CGPoint_t.
+ * Algorithms working on arrays of these keep any sort keys in arrays of their own.
+ */
+typedef struct CG_Coord {
+    double xcoord;          /**< Double x-coordinate */
+    double ycoord;          /**< Double y-coordinate */
+} CGCoord_t;
+
+
 /**
  * Struct representing a node containing a point in a doubly linked list.
  * Contains pointers to previous and next point node elements
@@ -144,39 +241,355 @@ typedef struct CG_PointSet {
     CGPointNode_t* head;        /**< Pointer to head node of Linked list of points */
     CGPointNode_t* tail;        /**< Pointer to the tail node of Linked list of points */
     int num_points;             /**< Count of number of points */
+    struct CG_HullCache* hull_cache;    /**< Last hull computed for the set, NULL unless enabled with enable_hull_cache */
 } CGPointSet_t;
 
 
+/**
+ * Struct for storing a set of points contiguously.
+ * Coordinates are kept in two parallel arrays (one per axis) so that bulk loaders and
+ * numeric kernels can stream over them without chasing per-point allocations.
+ * Arrays that share their coordinates (with other arrays, views or a mapped binary point file)
+ * are read-only and report a capacity of 0; growing them, or make_point_array_writable, copies the
+ * coordinates into heap storage first.
+ */
+typedef struct CG_PointArray {
+    double* xcoords;            /**< Array of x-coordinates */
+    double* ycoords;            /**< Array of y-coordinates */
+    size_t num_points;          /**< Count of number of points stored */
+    size_t capacity;            /**< Number of points that fit without reallocating */
+    void* storage;              /**< Owner of the coordinates if not heap allocated, otherwise NULL */
+} CGPointArray_t;
+
+
+/**
+ * Struct for a view of selected points of a shared point array, in an order of its own.
+ * Sorting, filtering and hulls on views only rearrange indices; the coordinates are never copied.
+ */
+typedef struct CG_PointView {
+    CGPointArray_t* points;     /**< Read-only array sharing the coordinates of the viewed array */
+    size_t* indices;            /**< Positions in points, in view order */
+    size_t num_indices;         /**< Number of points in the view */
+} CGPointView_t;
+
+
+/**
+ * Callback deciding whether filter_point_view keeps a point. Returns non-zero to keep it.
+ */
+typedef int (*CGPointFilter_t)(double xcoord, double ycoord, void* user_data);
+
+
+/**
+ * Struct for an axis aligned bounding box.
+ */
+typedef struct CG_BoundingBox {
+    double min_x;               /**< Smallest x-coordinate */
+    double min_y;               /**< Smallest y-coordinate */
+    double max_x;               /**< Largest x-coordinate */
+    double max_y;               /**< Largest y-coordinate */
+} CGBoundingBox_t;
+
+
+/**
+ * Struct of summary statistics of a set of points, filled in by compute_point_stats.
+ * The lowest point has the smallest y-coordinate, ties going to the smallest x-coordinate and then
+ * to the first position; the highest point mirrors it with the largest coordinates.
+ * @ingroup stats
+ */
+typedef struct CG_PointStats {
+    size_t num_points;              /**< Number of points summarized */
+    CGBoundingBox_t bounding_box;   /**< Smallest and largest coordinate on each axis */
+    CGCoord_t lowest;               /**< Lowest point, as find_lowest_point_in_set picks it */
+    CGCoord_t highest;              /**< Highest point */
+    size_t lowest_index;            /**< Position of the lowest point in the input */
+    size_t highest_index;           /**< Position of the highest point in the input */
+    CGCoord_t mean;                 /**< Centroid of the points */
+    double covariance[2][2];        /**< Population covariance matrix, index 0 for x and 1 for y */
+} CGPointStats_t;
+
+
+/**
+ * Opaque struct for a static k-d tree over a point array.
+ * @ingroup kdtree
+ */
+typedef struct CG_KdTree CGKdTree_t;
+
+
+/**
+ * Opaque struct for a hashed uniform grid over a point array.
+ * @ingroup grid
+ */
+typedef struct CG_PointGrid CGPointGrid_t;
+
+
+/**
+ * Opaque struct for a packed R-tree over bounding boxes.
+ * @ingroup rtree
+ */
+typedef struct CG_RTree CGRTree_t;
+
+
+/**
+ * Callback run by rtree_query for every item found, with its position in the indexed input.
+ * Returns non-zero to end the search.
+ * @ingroup rtree
+ */
+typedef int (*CGRTreeVisitor_t)(size_t item, void* user_data);
+
+
+/**
+ * Struct of settings for writing compressed point archives.
+ * @ingroup file
+ */
+typedef struct CG_ArchiveOptions {
+    double precision;           /**< Quantization step, coordinates are restored to within half of it */
+    int morton_order;           /**< If set, points are reordered along a Morton curve before encoding */
+    size_t block_size;          /**< Points per independently decodable block, 0 for the default */
+} CGArchiveOptions_t;
+
+
+/**
+ * Struct describing a geometry read by the WKB readers.
+ * Polygon rings are appended to the point container one after the other, without the closing
+ * point that repeats the start of each ring.
+ * @ingroup file
+ */
+typedef struct CG_WkbInfo {
+    CGWkbType_t type;           /**< Type of the geometry that was read */
+    size_t num_bytes;           /**< Number of bytes the geometry occupied */
+    size_t num_rings;           /**< Number of polygon rings, 0 for other types */
+    size_t* ring_sizes;         /**< Points per polygon ring, allocated by the reader and released with free_buffer */
+} CGWkbInfo_t;
+
+
+/**
+ * Opaque struct for reading points from a file in fixed-size batches with bounded memory use.
+ */
+typedef struct CG_PointStream CGPointStream_t;
+
+
+/**
+ * Callback that receives each batch of a point stream. Returning anything other than
+ * CG_SUCCESS stops the iteration and is passed back to the caller.
+ */
+typedef CGError_t (*CGBatchCallback_t)(CGPointArray_t* batch, void* user_data);
+
+
+/**
+ * Struct of callbacks used for every allocation libCGeo makes. Each callback receives user_data,
+ * and free is never passed NULL. Memory must be aligned as malloc aligns it.
+ * @ingroup memory
+ */
+typedef struct CG_Allocator {
+    void* (*alloc)(size_t size, void* user_data);                   /**< Allocate size bytes */
+    void* (*realloc)(void* pointer, size_t size, void* user_data);  /**< Resize an allocation, keeping its contents */
+    void  (*free)(void* pointer, void* user_data);                  /**< Release an allocation */
+    void* user_data;                                                /**< Context passed to the callbacks */
+} CGAllocator_t;
+
+
+/**
+ * Opaque struct holding a worker pool, scratch memory and settings shared by the _ctx functions.
+ * @ingroup context
+ */
+typedef struct CG_Context CGContext_t;
+
+
+/**
+ * Struct of settings for init_context. Fields left at zero take their default.
+ * @ingroup context
+ */
+typedef struct CG_ContextOptions {
+    int num_threads;                /**< Threads working on a call including the caller, default one per processor */
+    size_t parallel_min_points;     /**< Minimum points per thread before point algorithms split work, default 65536 */
+    size_t parallel_min_bytes;      /**< Minimum input bytes per thread before parsers split work, default 65536 */
+    size_t scratch_size;            /**< Initial size of each scratch arena in bytes, default 1 MiB */
+    const CGAllocator_t* allocator; /**< Allocator for the pool and all scratch memory of _ctx calls, default the global allocator */
+} CGContextOptions_t;
+
+
+/**
+ * Opaque struct for an algorithm running in the background on a context's worker pool.
+ * @ingroup async
+ */
+typedef struct CG_Task CGTask_t;
+
+
+/**
+ * Callback run on the worker thread once a task's result is final, with the result status.
+ * It must not wait on or free the task.
+ * @ingroup async
+ */
+typedef void (*CGTaskCallback_t)(CGTask_t* task, CGError_t status, void* user_data);
+
+
+/**
+ * Struct of the counters and phase timers of one thread, filled in by get_thread_stats.
+ * @ingroup instrument
+ */
+typedef struct CG_Stats {
+    unsigned long long orientation_tests;           /**< Turn direction tests between three points */
+    unsigned long long comparisons;                 /**< Comparisons made while sorting */
+    unsigned long long allocations;                 /**< Allocations and reallocations through the library allocator */
+    unsigned long long allocated_bytes;             /**< Bytes requested by those allocations */
+    unsigned long long phase_calls[CG_NUM_PHASES];  /**< Number of timed runs of each phase */
+    double phase_seconds[CG_NUM_PHASES];            /**< Total seconds spent in each phase */
+} CGStats_t;
+
+
 //----------------------------------------------------------------
 // Function Definitions - Common
 //----------------------------------------------------------------
 
 
+// Selecting the allocator
+CGError_t       set_allocator(const CGAllocator_t* allocator);
+CGAllocator_t   get_allocator(void);
+void            free_buffer(void* buffer);
+
+// Library contexts
+CGContext_t*    init_context(const CGContextOptions_t* options);
+CGError_t       free_context(CGContext_t* context);
+int             get_context_num_threads(const CGContext_t* context);
+
+// Asynchronous task handles
+int             poll_task(CGTask_t* task);
+CGError_t       wait_task(CGTask_t* task, double timeout_seconds);
+double          get_task_progress(CGTask_t* task);
+CGError_t       cancel_task(CGTask_t* task);
+CGError_t       free_task(CGTask_t* task);
+
+// instrumentation
+CGError_t       get_thread_stats(CGStats_t* stats);
+CGError_t       reset_thread_stats(void);
+
+// instruction set selection
+CGSimdLevel_t   get_simd_level(void);
+CGSimdLevel_t   get_supported_simd_level(void);
+CGError_t       set_simd_level(CGSimdLevel_t level);
+
 // Basic point set operations
 CGPointSet_t*   init_point_set();
 CGError_t       add_coords_to_set(CGPointSet_t* point_set, double xCoord, double yCoord);
 CGError_t       add_point_to_set(CGPointSet_t* point_set, CGPoint_t* point);
-CGPoint_t*      get_point_at_index(CGPointSet_t* point_set, int index);
+CGPoint_t*      get_point_at_index(const CGPointSet_t* point_set, int index);
 CGError_t       free_point_set(CGPointSet_t* point_set);
-CGError_t       copy_point_set(CGPointSet_t* source, CGPointSet_t* destination);
+CGError_t       copy_point_set(const CGPointSet_t* source, CGPointSet_t* destination);
+CGError_t       coords_from_point_set(const CGPointSet_t* point_set, CGCoord_t* coords);
+CGError_t       point_set_from_coords(const CGCoord_t* coords, size_t num_coords, CGPointSet_t* point_set);
+
+// Contiguous point array operations
+CGPointArray_t* init_point_array(size_t capacity);
+CGError_t       reserve_point_array(CGPointArray_t* point_array, size_t capacity);
+CGError_t       add_coords_to_array(CGPointArray_t* point_array, double xCoord, double yCoord);
+CGError_t       free_point_array(CGPointArray_t* point_array);
+CGPointArray_t* share_point_array(CGPointArray_t* point_array);
+CGError_t       make_point_array_writable(CGPointArray_t* point_array);
+CGError_t       point_array_from_point_set(const CGPointSet_t* point_set, CGPointArray_t* point_array);
+CGError_t       point_set_from_point_array(const CGPointArray_t* point_array, CGPointSet_t* point_set);
+CGError_t       compute_bounding_box(const CGPointArray_t* point_array, CGBoundingBox_t* bounding_box);
+CGError_t       compute_bounding_box_ctx(CGContext_t* context, const CGPointArray_t* point_array, CGBoundingBox_t* bounding_box);
+
+// Summary statistics
+CGError_t       compute_point_stats(const CGPointArray_t* point_array, CGPointStats_t* stats);
+CGError_t       compute_point_stats_ctx(CGContext_t* context, const CGPointArray_t* point_array, CGPointStats_t* stats);
+CGError_t       compute_point_set_stats(const CGPointSet_t* point_set, CGPointStats_t* stats);
+
+// Index views of shared point arrays
+CGPointView_t*  init_point_view(CGPointArray_t* point_array);
+CGPointView_t*  copy_point_view(const CGPointView_t* point_view);
+CGError_t       free_point_view(CGPointView_t* point_view);
+CGError_t       sort_point_view(CGPointView_t* point_view, const double* keys);
+CGError_t       filter_point_view(CGPointView_t* point_view, CGPointFilter_t filter, void* user_data);
+CGError_t       point_array_from_point_view(const CGPointView_t* point_view, CGPointArray_t* point_array);
+
+// Removing duplicate points
+CGError_t       dedup_point_array(const CGPointArray_t* input_array, CGPointArray_t* output_array, double tolerance, size_t* kept_indices);
+CGError_t       dedup_point_view(CGPointView_t* point_view, double tolerance);
+
+// k-d trees
+CGKdTree_t*     init_kd_tree(CGPointArray_t* point_array);
+CGError_t       free_kd_tree(CGKdTree_t* tree);
+CGError_t       kd_tree_nearest(const CGKdTree_t* tree, double xcoord, double ycoord, size_t* index, double* squared_distance);
+CGError_t       kd_tree_k_nearest(const CGKdTree_t* tree, double xcoord, double ycoord, size_t k, size_t* indices, double* squared_distances);
+CGError_t       kd_tree_radius(const CGKdTree_t* tree, double xcoord, double ycoord, double radius, CGPointView_t* output_view);
+CGError_t       kd_tree_nearest_batch_ctx(CGContext_t* context, const CGKdTree_t* tree, const CGPointArray_t* queries,
+                                          size_t* indices, double* squared_distances);
+CGError_t       kd_tree_k_nearest_batch_ctx(CGContext_t* context, const CGKdTree_t* tree, const CGPointArray_t* queries, size_t k,
+                                            size_t* indices, double* squared_distances);
+CGError_t       kd_tree_radius_batch_ctx(CGContext_t* context, const CGKdTree_t* tree, const CGPointArray_t* queries, double radius,
+                                         size_t** indices, size_t* offsets);
+
+// uniform grids
+CGPointGrid_t*  init_point_grid(CGPointArray_t* point_array, double cell_size);
+CGError_t       update_point_grid(CGPointGrid_t* grid, CGPointArray_t* point_array);
+CGError_t       free_point_grid(CGPointGrid_t* grid);
+CGError_t       point_grid_radius(const CGPointGrid_t* grid, double xcoord, double ycoord, double radius, CGPointView_t* output_view);
+CGError_t       point_grid_pairs_within(const CGPointGrid_t* grid, double radius, size_t** pairs, size_t* num_pairs);
+CGError_t       point_grid_pairs_within_ctx(CGContext_t* context, const CGPointGrid_t* grid, double radius,
+                                            size_t** pairs, size_t* num_pairs);
+
+// packed R-trees
+CGRTree_t*      init_rtree(const CGBoundingBox_t* boxes, size_t num_boxes);
+CGRTree_t*      init_point_array_rtree(const CGPointArray_t* point_array);
+CGRTree_t*      init_point_set_rtree(const CGPointSet_t* point_set);
+CGError_t       free_rtree(CGRTree_t* tree);
+CGError_t       rtree_query(const CGRTree_t* tree, const CGBoundingBox_t* window, CGRTreeVisitor_t visitor, void* user_data);
+CGError_t       rtree_query_batch_ctx(CGContext_t* context, const CGRTree_t* tree, const CGBoundingBox_t* windows, size_t num_windows,
+                                      size_t** items, size_t* offsets);
 
 // reading / writing .csv files
 CGError_t       point_set_from_csv_file(CGPointSet_t* point_set, FILE* file_pointer);
-CGError_t       csv_file_from_point_set(CGPointSet_t* point_set, FILE* file_pointer);
+CGError_t       csv_file_from_point_set(const CGPointSet_t* point_set, FILE* file_pointer);
+CGError_t       point_array_from_csv_path(CGPointArray_t* point_array, const char* file_path);
+CGError_t       point_array_from_csv_path_parallel(CGPointArray_t* point_array, const char* file_path, int num_threads);
+CGError_t       point_array_from_csv_path_ctx(CGContext_t* context, CGPointArray_t* point_array, const char* file_path);
+CGError_t       csv_file_from_point_array(const CGPointArray_t* point_array, FILE* file_pointer, CGCsvFormat_t format);
+CGError_t       csv_path_from_point_array(const CGPointArray_t* point_array, const char* file_path, CGCsvFormat_t format);
+
+// reading / writing binary point files
+CGError_t       binary_file_from_point_set(const CGPointSet_t* point_set, const char* file_path);
+CGError_t       binary_file_from_point_array(const CGPointArray_t* point_array, const char* file_path);
+CGError_t       point_set_from_binary_file(CGPointSet_t* point_set, const char* file_path);
+CGError_t       map_point_array_from_binary_file(const char* file_path, CGPointArray_t** point_array, CGBoundingBox_t* bounding_box);
+
+// reading / writing compressed point archives
+CGError_t       archive_file_from_point_set(const CGPointSet_t* point_set, const char* file_path, const CGArchiveOptions_t* options);
+CGError_t       archive_file_from_point_array(const CGPointArray_t* point_array, const char* file_path, const CGArchiveOptions_t* options);
+CGError_t       point_set_from_archive_file(CGPointSet_t* point_set, const char* file_path);
+CGError_t       point_array_from_archive_file(CGPointArray_t* point_array, const char* file_path);
+
+// reading / writing Well-Known Binary geometries
+CGError_t       point_array_from_wkb(const unsigned char* data, size_t size, CGPointArray_t* point_array, CGWkbInfo_t* info);
+CGError_t       point_set_from_wkb(const unsigned char* data, size_t size, CGPointSet_t* point_set, CGWkbInfo_t* info);
+CGError_t       wkb_from_point_array(const CGPointArray_t* point_array, CGWkbType_t type, CGWkbByteOrder_t byte_order,
+                                     unsigned char** data, size_t* size);
+CGError_t       wkb_from_point_set(const CGPointSet_t* point_set, CGWkbType_t type, CGWkbByteOrder_t byte_order,
+                                   unsigned char** data, size_t* size);
+
+// streaming .csv files and point archives in batches
+CGPointStream_t* open_csv_point_stream(const char* file_path, size_t batch_size);
+CGPointStream_t* open_archive_point_stream(const char* file_path);
+CGError_t       next_point_batch(CGPointStream_t* stream, CGPointArray_t* batch);
+CGError_t       for_each_point_batch(CGPointStream_t* stream, CGBatchCallback_t callback, void* user_data);
+CGError_t       close_point_stream(CGPointStream_t* stream);
+CGError_t       compute_bounding_box_stream(CGPointStream_t* stream, CGBoundingBox_t* bounding_box);
 
 // sorting points (uses merge-sort)
 CGError_t       sort_point_set(CGPointSet_t* point_set, CGPointSet_t* output_point_set);
+CGError_t       sort_point_set_into(const CGPointSet_t* point_set, CGPointSet_t* output_point_set);
 CGError_t       sort_points(CGPointNode_t** phead);
 void            split_lists(CGPointNode_t* head, CGPointNode_t** left_list, CGPointNode_t** right_list);
 CGPointNode_t*  merge_halves(CGPointNode_t* left_list, CGPointNode_t* right_list);
+CGError_t       sort_coords_by_keys(CGCoord_t* coords, double* keys, size_t num_coords);
 
 // Point operations and calculations
-double          distance_between(CGPoint_t* point_A, CGPoint_t* point_B);
-CGPoint_t*      find_lowest_point_in_set(CGPointSet_t* point_set);
-double          angle_between(CGPoint_t* initial_point, CGPoint_t* end_point);
+double          distance_between(const CGPoint_t* point_A, const CGPoint_t* point_B);
+CGPoint_t*      find_lowest_point_in_set(const CGPointSet_t* point_set);
+double          angle_between(const CGPoint_t* initial_point, const CGPoint_t* end_point);
 
 // Other calculations
-CGTurn_t        find_turn_type(CGPoint_t* point_A, CGPoint_t* point_B, CGPoint_t* point_C);
+CGTurn_t        find_turn_type(const CGPoint_t* point_A, const CGPoint_t* point_B, const CGPoint_t* point_C);
 
 
 //----------------------------------------------------------------
@@ -188,27 +601,52 @@ CGTurn_t        find_turn_type(CGPoint_t* point_A, CGPoint_t* point_B, CGPoint_t
 void            print_cg_error(CGError_t error, const char* function_name);
 
 // point printing
-void            print_point_to_file(CGPoint_t* point, FILE* fp, CGDescDetail_t desc_detail);
-void            print_points(CGPointSet_t* point_set);
-void            print_points_to_file(CGPointSet_t* point_set, FILE* fp, CGDescDetail_t desc_detail);
+void            print_point_to_file(const CGPoint_t* point, FILE* fp, CGDescDetail_t desc_detail);
+void            print_points(const CGPointSet_t* point_set);
+void            print_points_to_file(const CGPointSet_t* point_set, FILE* fp, CGDescDetail_t desc_detail);
 
 // point set comparisons
-int             compare_point_sets(CGPointSet_t* point_set_A, CGPointSet_t* point_set_B);
-int             compare_points(CGPoint_t* point_A, CGPoint_t* point_B);
+int             compare_point_sets(const CGPointSet_t* point_set_A, const CGPointSet_t* point_set_B);
+int             compare_points(const CGPoint_t* point_A, const CGPoint_t* point_B);
 
 // random point generation for testing (ints only)
 CGError_t       generate_random_point_set(CGPointSet_t* point_set, int num_points);
 
 
+//----------------------------------------------------------------
+// Function Definitions - Point Generation
+//----------------------------------------------------------------
+
+
+CGError_t       generate_point_array(CGPointArray_t* point_array, size_t num_points, CGDistribution_t distribution, unsigned long long seed);
+CGError_t       generate_point_array_ctx(CGContext_t* context, CGPointArray_t* point_array, size_t num_points,
+                                         CGDistribution_t distribution, unsigned long long seed);
+
+
 //----------------------------------------------------------------
 // Function Definitions - Convex Hull
 //----------------------------------------------------------------
 
 
 CGError_t       compute_point_angles(CGPointSet_t* point_set);
-CGError_t       compute_graham_scan(CGPointSet_t* input_set, CGPointSet_t* output_set, CGCompute_t compute_type);
-CGError_t       remove_colinear_degeneracies(CGPointSet_t* input_set, CGPointSet_t* output_set);
-CGError_t       compute_convex_hull(CGPointSet_t* point_set, CGPointSet_t* output_set, CGConvexHull_t convex_hull_method, CGCompute_t compute_type);
+CGError_t       compute_graham_scan(const CGPointSet_t* input_set, CGPointSet_t* output_set, CGCompute_t compute_type);
+CGError_t       remove_colinear_degeneracies(const CGPointSet_t* input_set, CGPointSet_t* output_set);
+CGError_t       compute_convex_hull(const CGPointSet_t* point_set, CGPointSet_t* output_set, CGConvexHull_t convex_hull_method, CGCompute_t compute_type);
+CGError_t       enable_hull_cache(CGPointSet_t* point_set);
+CGError_t       invalidate_hull_cache(CGPointSet_t* point_set);
+CGError_t       compute_monotone_chain(const CGPointArray_t* input_array, CGPointArray_t* output_array, CGCompute_t compute_type);
+CGError_t       compute_convex_hull_ctx(CGContext_t* context, const CGPointSet_t* point_set, CGPointSet_t* output_set,
+                                        CGConvexHull_t convex_hull_method, CGCompute_t compute_type);
+CGError_t       compute_monotone_chain_ctx(CGContext_t* context, const CGPointArray_t* input_array, CGPointArray_t* output_array,
+                                           CGCompute_t compute_type);
+CGTask_t*       compute_convex_hull_async(CGContext_t* context, const CGPointSet_t* point_set, CGPointSet_t* output_set,
+                                          CGConvexHull_t convex_hull_method, CGCompute_t compute_type,
+                                          CGTaskCallback_t callback, void* user_data);
+CGTask_t*       compute_monotone_chain_async(CGContext_t* context, const CGPointArray_t* input_array, CGPointArray_t* output_array,
+                                             CGCompute_t compute_type, CGTaskCallback_t callback, void* user_data);
+CGError_t       compute_monotone_chain_view(const CGPointView_t* input_view, CGPointView_t* output_view, CGCompute_t compute_type);
+CGError_t       compute_convex_hull_stream(CGPointStream_t* stream, CGPointArray_t* output_array, CGCompute_t compute_type);
+CGError_t       compute_convex_hull_csv_path(const char* file_path, CGPointArray_t* output_array, CGCompute_t compute_type, int num_threads);
 
 
 //----------------------------------------------------------------
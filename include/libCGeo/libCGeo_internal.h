@@ -0,0 +1,481 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Internal header for libCGeo. Contains helpers shared between library source files that
+ * are not part of the public API. Not installed alongside libCGeo.h.
+ */
+
+
+#ifndef LIBCGEO_INTERNAL_H
+#define LIBCGEO_INTERNAL_H
+
+
+#include "libCGeo/libCGeo.h"
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Buffer size that fits any double formatted by the .csv writers
+#define CG_MAX_FORMATTED_DOUBLE 352
+
+// Byte order of the build target, used by the SWAR parsing code and the binary formats
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define CG_LITTLE_ENDIAN 1
+#endif
+#elif defined(_WIN32) || defined(__x86_64__) || defined(__i386__)
+#define CG_LITTLE_ENDIAN 1
+#endif
+
+
+//----------------------------------------------------------------
+// Instrumentation
+//----------------------------------------------------------------
+
+
+/*
+ * Counters and phase timers, compiled in only when CGEO_INSTRUMENT is defined. Otherwise every
+ * macro expands to nothing, so the hot paths carry no trace of them.
+ * CG_COUNT adds to a counter of the calling thread's CGStats_t. CG_PHASE_START starts a lap timer,
+ * and each CG_PHASE_LAP charges the time since the previous lap to a phase.
+ */
+#ifdef CGEO_INSTRUMENT
+#ifdef _MSC_VER
+#define CG_THREAD_LOCAL __declspec(thread)
+#else
+#define CG_THREAD_LOCAL __thread
+#endif
+extern CG_THREAD_LOCAL CGStats_t cg_thread_stats;
+void cg_record_phase(CGPhase_t phase, double* lap_start);
+#define CG_COUNT(counter, amount)   (cg_thread_stats.counter += (amount))
+#define CG_PHASE_START(timer)       double timer = cg_time_seconds()
+#define CG_PHASE_LAP(timer, phase)  cg_record_phase(phase, &timer)
+#else
+#define CG_COUNT(counter, amount)   ((void) 0)
+#define CG_PHASE_START(timer)       ((void) 0)
+#define CG_PHASE_LAP(timer, phase)  ((void) 0)
+#endif
+
+
+//----------------------------------------------------------------
+// Bit manipulation helpers
+//----------------------------------------------------------------
+
+
+/** @internal Count trailing zero bits of a non-zero 64-bit word */
+static inline int cg_ctz64(uint64_t word){
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return (int) index;
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+
+/** @internal Count leading zero bits of a non-zero 64-bit word */
+static inline int cg_clz64(uint64_t word){
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, word);
+    return 63 - (int) index;
+#else
+    return __builtin_clzll(word);
+#endif
+}
+
+
+/**
+ * Struct holding an unsigned 128-bit value split in two halves.
+ * @internal
+ */
+typedef struct CG_Uint128 {
+    uint64_t high;              /**< Upper 64 bits */
+    uint64_t low;               /**< Lower 64 bits */
+} CGUint128_t;
+
+
+/** @internal Full 64x64 -> 128 bit multiplication */
+static inline CGUint128_t cg_full_multiplication(uint64_t a, uint64_t b){
+    CGUint128_t result;
+#ifdef __SIZEOF_INT128__
+    __uint128_t product = (__uint128_t) a * b;
+    result.high = (uint64_t) (product >> 64);
+    result.low = (uint64_t) product;
+#else
+    uint64_t a_lo = (uint32_t) a, a_hi = a >> 32;
+    uint64_t b_lo = (uint32_t) b, b_hi = b >> 32;
+    uint64_t p0 = a_lo * b_lo;
+    uint64_t p1 = a_lo * b_hi;
+    uint64_t p2 = a_hi * b_lo;
+    uint64_t p3 = a_hi * b_hi;
+    uint64_t middle = p1 + (p0 >> 32) + (uint32_t) p2;
+    result.high = p3 + (middle >> 32) + (p2 >> 32);
+    result.low = (middle << 32) | (uint32_t) p0;
+#endif
+    return result;
+}
+
+
+/** @internal Reverse the byte order of a 64-bit word */
+static inline uint64_t cg_byteswap64(uint64_t word){
+#ifdef _MSC_VER
+    return _byteswap_uint64(word);
+#else
+    return __builtin_bswap64(word);
+#endif
+}
+
+
+/** @internal Reverse the byte order of a 32-bit word */
+static inline uint32_t cg_byteswap32(uint32_t word){
+#ifdef _MSC_VER
+    return _byteswap_ulong(word);
+#else
+    return __builtin_bswap32(word);
+#endif
+}
+
+
+/** @internal Count set bits in a 64-bit word */
+static inline int cg_popcount64(uint64_t word){
+#ifdef _MSC_VER
+    return (int) __popcnt64(word);
+#else
+    return __builtin_popcountll(word);
+#endif
+}
+
+
+/** @internal Spreads the lower 32 bits of value to the even bit positions, to interleave into Morton codes */
+static inline uint64_t cg_spread_bits(uint64_t value){
+    value &= 0xffffffffull;
+    value = (value | (value << 16)) & 0x0000ffff0000ffffull;
+    value = (value | (value << 8)) & 0x00ff00ff00ff00ffull;
+    value = (value | (value << 4)) & 0x0f0f0f0f0f0f0f0full;
+    value = (value | (value << 2)) & 0x3333333333333333ull;
+    value = (value | (value << 1)) & 0x5555555555555555ull;
+    return value;
+}
+
+
+/** @internal Mixes the bits of a grid cell, given by its column and row, into a hash */
+static inline size_t cg_hash_cell(double cell_x, double cell_y){
+    uint64_t bits_x, bits_y;
+    memcpy(&bits_x, &cell_x, sizeof(uint64_t));
+    memcpy(&bits_y, &cell_y, sizeof(uint64_t));
+    uint64_t hash = bits_x * 0x9E3779B97F4A7C15ULL ^ (bits_y + 0x632BE59BD9B4E019ULL);
+    hash ^= hash >> 32;
+    hash *= 0xD6E8FEB86659FD93ULL;
+    hash ^= hash >> 32;
+    return (size_t) hash;
+}
+
+
+/** @internal Atomically adds one to a reference count, returns the new count */
+static inline size_t cg_atomic_increment(volatile size_t* count){
+#if defined(_MSC_VER) && defined(_WIN64)
+    return (size_t) _InterlockedIncrement64((volatile __int64*) count);
+#elif defined(_MSC_VER)
+    return (size_t) _InterlockedIncrement((volatile long*) count);
+#else
+    return __atomic_add_fetch(count, 1, __ATOMIC_ACQ_REL);
+#endif
+}
+
+
+/** @internal Atomically subtracts one from a reference count, returns the new count */
+static inline size_t cg_atomic_decrement(volatile size_t* count){
+#if defined(_MSC_VER) && defined(_WIN64)
+    return (size_t) _InterlockedDecrement64((volatile __int64*) count);
+#elif defined(_MSC_VER)
+    return (size_t) _InterlockedDecrement((volatile long*) count);
+#else
+    return __atomic_sub_fetch(count, 1, __ATOMIC_ACQ_REL);
+#endif
+}
+
+
+/** @internal Atomically replaces a counter */
+static inline void cg_atomic_store(volatile size_t* count, size_t value){
+#if defined(_MSC_VER) && defined(_WIN64)
+    _InterlockedExchange64((volatile __int64*) count, (__int64) value);
+#elif defined(_MSC_VER)
+    _InterlockedExchange((volatile long*) count, (long) value);
+#else
+    __atomic_store_n(count, value, __ATOMIC_RELEASE);
+#endif
+}
+
+
+/** @internal Reads a reference count */
+static inline size_t cg_atomic_load(volatile size_t* count){
+#ifdef _MSC_VER
+    return *count;
+#else
+    return __atomic_load_n(count, __ATOMIC_ACQUIRE);
+#endif
+}
+
+
+//----------------------------------------------------------------
+// Data Structures - Internal
+//----------------------------------------------------------------
+
+
+/**
+ * Struct wrapping a native thread handle.
+ * @internal
+ */
+typedef struct CG_Thread {
+    void* handle;               /**< Platform specific thread handle */
+    void* (*function)(void*);   /**< Function run by the thread */
+    void* argument;             /**< Argument passed to function */
+} CGThread_t;
+
+
+/**
+ * Struct wrapping a native mutex.
+ * @internal
+ */
+typedef struct CG_Mutex {
+    void* handle;               /**< Platform specific mutex */
+} CGMutex_t;
+
+
+/**
+ * Struct wrapping a native condition variable.
+ * @internal
+ */
+typedef struct CG_Condition {
+    void* handle;               /**< Platform specific condition variable */
+} CGCondition_t;
+
+
+/**
+ * Struct describing a read-only memory mapping of a whole file.
+ * @internal
+ */
+typedef struct CG_FileMap {
+    const char* data;           /**< Start of the mapped file contents, NULL for empty files */
+    size_t size;                /**< Size of the mapping in bytes */
+    void* handle;               /**< Platform specific mapping handle */
+} CGFileMap_t;
+
+
+/**
+ * Struct holding the decoded header of a compressed point archive.
+ * @internal
+ */
+typedef struct CG_ArchiveHeader {
+    uint64_t num_points;        /**< Total number of points in the archive */
+    uint32_t flags;             /**< Encoding flags, see point_archive.c */
+    uint32_t block_size;        /**< Maximum number of points per block */
+    double precision;           /**< Quantization step */
+    double origin_x;            /**< x-coordinate that quantizes to zero */
+    double origin_y;            /**< y-coordinate that quantizes to zero */
+} CGArchiveHeader_t;
+
+
+/**
+ * Struct for coordinates shared between point arrays and views, pointed to by their storage field.
+ * The coordinates are released when the last user lets go of them.
+ * @internal
+ */
+typedef struct CG_SharedStorage {
+    volatile size_t ref_count;  /**< Number of arrays and views using the coordinates */
+    CGFileMap_t file_map;       /**< Mapping holding the coordinates, data is NULL if they are on the heap */
+    double* xcoords;            /**< Heap allocated x-coordinates, NULL for mappings */
+    double* ycoords;            /**< Heap allocated y-coordinates, NULL for mappings */
+    size_t capacity;            /**< Number of points the heap blocks can hold */
+} CGSharedStorage_t;
+
+
+/**
+ * Struct for scratch memory handed out by a context. Allocations are bumped out of blocks that
+ * are kept when the arena is returned, so repeated calls stop allocating.
+ * @internal
+ */
+typedef struct CG_Arena {
+    struct CG_ArenaBlock* block;        /**< Newest block, NULL before the first allocation */
+    const CGAllocator_t* allocator;     /**< Allocator of the owning context */
+    size_t block_size;                  /**< Size of the first block */
+    struct CG_Arena* next;              /**< Next arena in the context's free list */
+} CGArena_t;
+
+typedef struct CG_ArenaBlock CGArenaBlock_t;
+
+
+/**
+ * Struct through which long running operations report progress and learn about cancellation.
+ * All fields are accessed atomically.
+ * @internal
+ */
+typedef struct CG_Progress {
+    volatile size_t completed;          /**< Units of work finished */
+    volatile size_t total;              /**< Units of work in the operation, 0 until known */
+    volatile size_t cancelled;          /**< Non-zero once cancellation was requested */
+} CGProgress_t;
+
+
+// Number of interleaved accumulators of the summary kernel, the widest vector holds this many doubles
+#define CG_SUMMARY_LANES 8
+
+
+/**
+ * Struct of the partial results of the summary kernel. Point i of a slice goes to lane i % CG_SUMMARY_LANES,
+ * so every instruction set adds up the same points in the same order. Sums are of the coordinates minus
+ * a shift, and the extreme points record their position in the slice, -1 while a lane is empty.
+ * @internal
+ */
+typedef struct CG_SummaryLanes {
+    double min_x[CG_SUMMARY_LANES];         /**< Smallest x-coordinate */
+    double max_x[CG_SUMMARY_LANES];         /**< Largest x-coordinate */
+    double low_x[CG_SUMMARY_LANES];         /**< x-coordinate of the lowest point */
+    double low_y[CG_SUMMARY_LANES];         /**< y-coordinate of the lowest point */
+    double low_index[CG_SUMMARY_LANES];     /**< Position of the lowest point */
+    double high_x[CG_SUMMARY_LANES];        /**< x-coordinate of the highest point */
+    double high_y[CG_SUMMARY_LANES];        /**< y-coordinate of the highest point */
+    double high_index[CG_SUMMARY_LANES];    /**< Position of the highest point */
+    double sum_x[CG_SUMMARY_LANES];         /**< Sum of shifted x-coordinates */
+    double sum_y[CG_SUMMARY_LANES];         /**< Sum of shifted y-coordinates */
+    double sum_xx[CG_SUMMARY_LANES];        /**< Sum of squared shifted x-coordinates */
+    double sum_yy[CG_SUMMARY_LANES];        /**< Sum of squared shifted y-coordinates */
+    double sum_xy[CG_SUMMARY_LANES];        /**< Sum of products of shifted coordinates */
+} CGSummaryLanes_t;
+
+
+/**
+ * Struct of the numeric kernels of one instruction set, see cg_kernels.
+ * @internal
+ */
+typedef struct CG_Kernels {
+    /** Classifies 64 bytes into bitmaps of their newlines and commas */
+    void (*find_structurals)(const char* block, uint64_t* newlines, uint64_t* commas);
+    /** Bounding box of at least one point */
+    void (*bounding_box)(const double* xcoords, const double* ycoords, size_t num_points, CGBoundingBox_t* bounding_box);
+    /** Squared distance of every coordinate from origin */
+    void (*squared_distances)(const CGCoord_t* coords, size_t num_coords, const CGCoord_t* origin, double* distances);
+    /** Twice the signed area of a, b and every point, positive to the left of a to b, and zero unless the sign is certain */
+    void (*orientations)(const double* xcoords, const double* ycoords, size_t num_points,
+                         const CGCoord_t* a, const CGCoord_t* b, double* orientations);
+    /** Extremes and shifted coordinate sums of points, in lanes */
+    void (*summarize)(const double* xcoords, const double* ycoords, size_t num_points, const CGCoord_t* shift,
+                      CGSummaryLanes_t* lanes);
+} CGKernels_t;
+
+
+/**
+ * Function run by cg_context_parallel_for once per task, with scratch memory private to the task.
+ * @internal
+ */
+typedef void (*CGTaskFunction_t)(void* argument, size_t task_index, CGArena_t* arena);
+
+
+//----------------------------------------------------------------
+// Function Definitions - Internal
+//----------------------------------------------------------------
+
+
+// allocation through the active allocator
+void*           cg_malloc(size_t size);
+void*           cg_calloc(size_t count, size_t size);
+void*           cg_realloc(void* pointer, size_t size);
+void            cg_free(void* pointer);
+
+// point array storage
+void            cg_release_point_array_storage(CGPointArray_t* point_array);
+
+// point set hull caches
+void            cg_free_hull_cache(struct CG_HullCache* hull_cache);
+
+// convex hulls over blocks of points
+CGError_t       cg_merge_hull_batch(CGPointArray_t* batch, CGPointArray_t** hull, CGPointArray_t** scratch,
+                                    CGCompute_t compute_type);
+CGError_t       cg_finish_merged_hull(CGPointArray_t* merged, size_t num_points, CGPointArray_t* output_array,
+                                      CGCompute_t compute_type);
+
+// threading
+int             cg_num_cpus(void);
+CGError_t       cg_thread_create(CGThread_t* thread, void* (*function)(void*), void* argument);
+void            cg_thread_join(CGThread_t* thread);
+CGError_t       cg_mutex_init(CGMutex_t* mutex);
+void            cg_mutex_destroy(CGMutex_t* mutex);
+void            cg_mutex_lock(CGMutex_t* mutex);
+void            cg_mutex_unlock(CGMutex_t* mutex);
+CGError_t       cg_condition_init(CGCondition_t* condition);
+void            cg_condition_destroy(CGCondition_t* condition);
+void            cg_condition_wait(CGCondition_t* condition, CGMutex_t* mutex);
+int             cg_condition_timed_wait(CGCondition_t* condition, CGMutex_t* mutex, double timeout_seconds);
+void            cg_condition_signal(CGCondition_t* condition);
+void            cg_condition_broadcast(CGCondition_t* condition);
+double          cg_time_seconds(void);
+
+// context worker pools and scratch memory
+void*           cg_arena_alloc(CGArena_t* arena, size_t size);
+CGArena_t*      cg_context_acquire_arena(CGContext_t* context);
+void            cg_context_release_arena(CGContext_t* context, CGArena_t* arena);
+void*           cg_context_realloc(CGContext_t* context, void* pointer, size_t size);
+void            cg_context_free(CGContext_t* context, void* pointer);
+CGError_t       cg_context_parallel_for(CGContext_t* context, size_t num_tasks, CGTaskFunction_t function, void* argument);
+size_t          cg_context_point_tasks(const CGContext_t* context, size_t num_points, size_t tasks_per_thread);
+CGError_t       cg_context_submit(CGContext_t* context, void (*function)(void*), void* argument);
+
+// hull algorithms reporting progress and checking for cancellation
+CGError_t       cg_monotone_chain_ctx(CGContext_t* context, const CGPointArray_t* input_array, CGPointArray_t* output_array,
+                                      CGCompute_t compute_type, CGProgress_t* progress);
+CGError_t       cg_convex_hull_ctx(CGContext_t* context, const CGPointSet_t* point_set, CGPointSet_t* output_set,
+                                   CGConvexHull_t convex_hull_method, CGCompute_t compute_type, CGProgress_t* progress);
+size_t          cg_context_byte_tasks(const CGContext_t* context, size_t num_bytes);
+
+// memory mapping files
+CGError_t       cg_map_file(const char* file_path, CGFileMap_t* file_map);
+void            cg_unmap_file(CGFileMap_t* file_map);
+
+// numeric kernels of the active instruction set
+const CGKernels_t* cg_kernels(void);
+
+// allocation free csv parsing
+const char*     cg_parse_double(const char* begin, const char* end, double* value);
+void            cg_find_structurals(const char* block, uint64_t* newlines, uint64_t* commas);
+size_t          cg_count_csv_lines(const char* begin, const char* end);
+CGError_t       cg_parse_csv_block(const char* begin, const char* end, CGPointArray_t* point_array);
+CGError_t       cg_parse_csv_lines(const char* begin, const char* end, CGPointArray_t* point_array,
+                                   size_t max_points, const char** resume);
+
+// decoding compressed point archives
+CGError_t       cg_read_archive_header(const char* data, size_t size, CGArchiveHeader_t* header, const char** first_block);
+CGError_t       cg_decode_archive_block(const char* begin, const char* end, const CGArchiveHeader_t* header,
+                                        CGPointArray_t* point_array, const char** next_block);
+
+// allocation free number formatting
+size_t          cg_format_double_shortest(double value, char* out);
+size_t          cg_format_double_fixed6(double value, char* out);
+
+
+#endif
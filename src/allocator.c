@@ -0,0 +1,174 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing the allocator every libCGeo allocation goes through. By default it
+ * forwards to malloc, realloc and free; set_allocator routes the library to arenas, pools or
+ * bump allocators instead.
+ *
+ * @defgroup memory Memory Allocation
+ * @brief Replace the allocator used for all memory owned by libCGeo.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+
+//----------------------------------------------------------------
+// Default allocator
+//----------------------------------------------------------------
+
+
+/** @internal Allocation callback of the default allocator */
+static void* default_alloc(size_t size, void* user_data){
+    (void) user_data;
+    return malloc(size);
+}
+
+
+/** @internal Reallocation callback of the default allocator */
+static void* default_realloc(void* pointer, size_t size, void* user_data){
+    (void) user_data;
+    return realloc(pointer, size);
+}
+
+
+/** @internal Free callback of the default allocator */
+static void default_free(void* pointer, void* user_data){
+    (void) user_data;
+    free(pointer);
+}
+
+
+static const CGAllocator_t default_allocator = {default_alloc, default_realloc, default_free, NULL};
+
+static CGAllocator_t global_allocator = {default_alloc, default_realloc, default_free, NULL};
+
+
+//----------------------------------------------------------------
+// Functions - Selecting the allocator
+//----------------------------------------------------------------
+
+
+/**
+ * Function that replaces the allocator used by libCGeo. Memory is released through whichever
+ * allocator is active when it is freed, not the one that allocated it, so the allocator must only
+ * be changed while no libCGeo allocations are live and no other thread is calling into the library.
+ * @ingroup memory
+ * @param allocator Allocator to copy, or NULL to restore malloc, realloc and free.
+ * @return INVALID_INPUT if one of the callbacks is NULL, otherwise SUCCESS.
+ */
+CGError_t set_allocator(const CGAllocator_t* allocator){
+    if(allocator == NULL){
+        global_allocator = default_allocator;
+        return CG_SUCCESS;
+    }
+    else if(allocator->alloc == NULL || allocator->realloc == NULL || allocator->free == NULL)
+        return CG_INVALID_INPUT;
+    global_allocator = *allocator;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that returns the allocator currently used by libCGeo.
+ * @ingroup memory
+ * @return Copy of the active allocator.
+ */
+CGAllocator_t get_allocator(void){
+    return global_allocator;
+}
+
+
+/**
+ * Function that releases a buffer allocated by libCGeo and handed to the caller, such as the
+ * encodings produced by wkb_from_point_array.
+ * @ingroup memory
+ * @param buffer Buffer to release, may be NULL
+ */
+void free_buffer(void* buffer){
+    cg_free(buffer);
+}
+
+
+//----------------------------------------------------------------
+// Functions - Internal allocation
+//----------------------------------------------------------------
+
+
+/**
+ * Function that allocates memory with the active allocator.
+ * @internal
+ * @param size Number of bytes, 0 is treated as 1 so that NULL always means failure
+ * @return Allocated memory or NULL.
+ */
+void* cg_malloc(size_t size){
+    CG_COUNT(allocations, 1);
+    CG_COUNT(allocated_bytes, size);
+    return global_allocator.alloc(size ? size : 1, global_allocator.user_data);
+}
+
+
+/**
+ * Function that allocates zeroed memory for an array with the active allocator.
+ * @internal
+ * @param count Number of elements
+ * @param size Size of one element
+ * @return Allocated memory or NULL, also if count * size overflows.
+ */
+void* cg_calloc(size_t count, size_t size){
+    if(size != 0 && count > (size_t) -1 / size)
+        return NULL;
+    void* memory = cg_malloc(count * size);
+    if(memory != NULL)
+        memset(memory, 0, count * size);
+    return memory;
+}
+
+
+/**
+ * Function that resizes memory with the active allocator.
+ * @internal
+ * @param pointer Memory to resize, NULL allocates new memory
+ * @param size New size in bytes
+ * @return Resized memory or NULL, in which case pointer is still valid.
+ */
+void* cg_realloc(void* pointer, size_t size){
+    if(pointer == NULL)
+        return cg_malloc(size);
+    CG_COUNT(allocations, 1);
+    CG_COUNT(allocated_bytes, size);
+    return global_allocator.realloc(pointer, size ? size : 1, global_allocator.user_data);
+}
+
+
+/**
+ * Function that releases memory with the active allocator. The callback never sees NULL.
+ * @internal
+ * @param pointer Memory to release, may be NULL
+ */
+void cg_free(void* pointer){
+    if(pointer != NULL)
+        global_allocator.free(pointer, global_allocator.user_data);
+}
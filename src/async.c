@@ -0,0 +1,307 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing asynchronous variants of the long running algorithms. Each call queues
+ * the work on the worker pool of a context and returns a task handle at once. The handle can be
+ * polled, waited on with a timeout, asked for progress and cancelled, and an optional callback
+ * runs when the result is final.
+ *
+ * @defgroup async Asynchronous Tasks
+ * @brief Run algorithms in the background on a context's worker pool.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+
+//----------------------------------------------------------------
+// Data Structures - Tasks
+//----------------------------------------------------------------
+
+
+/**
+ * Struct holding an asynchronous task. It is shared by the caller's handle and the worker
+ * running it, and freed when both have let go.
+ */
+struct CG_Task {
+    volatile size_t ref_count;          /**< Holders of the task, the caller and the queued job */
+    CGProgress_t progress;              /**< Progress and cancellation shared with the algorithm */
+    CGMutex_t lock;                     /**< Protects done */
+    CGCondition_t finished;             /**< Broadcast once done is set */
+    int done;                           /**< Non-zero once status is final and the callback returned */
+    CGError_t status;                   /**< Result of the algorithm */
+    CGTaskCallback_t callback;          /**< Called on the worker when the result is final, may be NULL */
+    void* user_data;                    /**< Passed to the callback */
+
+    CGError_t (*run)(CGTask_t* task);   /**< Runs the algorithm with the fields below */
+    CGContext_t* context;               /**< Context the task runs in */
+    const void* input;                  /**< Input point set or array */
+    void* output;                       /**< Output point set or array */
+    CGConvexHull_t convex_hull_method;  /**< Hull algorithm for point set inputs */
+    CGCompute_t compute_type;           /**< Degeneracy handling */
+};
+
+
+//----------------------------------------------------------------
+// Functions - Running tasks
+//----------------------------------------------------------------
+
+
+/** @internal Drops one reference to a task, freeing it with the last one */
+static void release_task(CGTask_t* task){
+    if(cg_atomic_decrement(&task->ref_count) > 0)
+        return;
+    cg_condition_destroy(&task->finished);
+    cg_mutex_destroy(&task->lock);
+    cg_free(task);
+}
+
+
+/**
+ * Job function that runs a task on a worker, publishes its result and releases the worker's
+ * reference. Tasks cancelled before they start never run their algorithm.
+ * @internal
+ */
+static void run_task(void* argument){
+    CGTask_t* task = (CGTask_t*) argument;
+    CGError_t status = CG_CANCELLED;
+    if(!cg_atomic_load(&task->progress.cancelled))
+        status = task->run(task);
+    task->status = status;
+    if(task->callback != NULL)
+        task->callback(task, status, task->user_data);
+
+    cg_mutex_lock(&task->lock);
+    task->done = 1;
+    cg_condition_broadcast(&task->finished);
+    cg_mutex_unlock(&task->lock);
+    release_task(task);
+}
+
+
+/**
+ * Helper that allocates a task and queues it on the context's workers.
+ * @internal
+ * @return Task handle, or NULL if allocation or queueing fails.
+ */
+static CGTask_t* submit_task(CGContext_t* context, CGError_t (*run)(CGTask_t*), const void* input, void* output,
+                             CGConvexHull_t convex_hull_method, CGCompute_t compute_type,
+                             CGTaskCallback_t callback, void* user_data){
+    if(context == NULL || input == NULL || output == NULL)
+        return NULL;
+    CGTask_t* task = (CGTask_t*) cg_calloc(1, sizeof(CGTask_t));
+    if(task == NULL)
+        return NULL;
+    if(cg_mutex_init(&task->lock) != CG_SUCCESS){
+        cg_free(task);
+        return NULL;
+    }
+    if(cg_condition_init(&task->finished) != CG_SUCCESS){
+        cg_mutex_destroy(&task->lock);
+        cg_free(task);
+        return NULL;
+    }
+    task->ref_count = 2;
+    task->callback = callback;
+    task->user_data = user_data;
+    task->run = run;
+    task->context = context;
+    task->input = input;
+    task->output = output;
+    task->convex_hull_method = convex_hull_method;
+    task->compute_type = compute_type;
+    if(cg_context_submit(context, run_task, task) != CG_SUCCESS){
+        task->ref_count = 1;
+        release_task(task);
+        return NULL;
+    }
+    return task;
+}
+
+
+/** @internal Runs compute_convex_hull_ctx for a task */
+static CGError_t run_convex_hull(CGTask_t* task){
+    return cg_convex_hull_ctx(task->context, (const CGPointSet_t*) task->input, (CGPointSet_t*) task->output,
+                              task->convex_hull_method, task->compute_type, &task->progress);
+}
+
+
+/** @internal Runs compute_monotone_chain_ctx for a task */
+static CGError_t run_monotone_chain(CGTask_t* task){
+    return cg_monotone_chain_ctx(task->context, (const CGPointArray_t*) task->input, (CGPointArray_t*) task->output,
+                                 task->compute_type, &task->progress);
+}
+
+
+//----------------------------------------------------------------
+// Functions - Starting tasks
+//----------------------------------------------------------------
+
+
+/**
+ * Function that starts computing the convex hull of a point set in the background, see
+ * compute_convex_hull_ctx. The input must not be modified and the output not be touched until
+ * the task is done or freed; a running Graham scan cannot be cancelled, so freeing waits for it.
+ * @ingroup async
+ * @param context Context whose workers run the task
+ * @param point_set Initialized point set to perform convex hull on.
+ * @param output_set Initialized point set the hull is appended to.
+ * @param convex_hull_method Which convex hull algorithm to perform
+ * @param compute_type Toggle for computing with or without degeneracy
+ * @param callback Function called on the worker once the result is final, may be NULL
+ * @param user_data Passed to the callback
+ * @return Task handle to be freed with free_task, or NULL if the task could not be started.
+ */
+CGTask_t* compute_convex_hull_async(CGContext_t* context, const CGPointSet_t* point_set, CGPointSet_t* output_set,
+                                    CGConvexHull_t convex_hull_method, CGCompute_t compute_type,
+                                    CGTaskCallback_t callback, void* user_data){
+    return submit_task(context, run_convex_hull, point_set, output_set, convex_hull_method, compute_type, callback, user_data);
+}
+
+
+/**
+ * Function that starts computing the convex hull of a point array in the background, see
+ * compute_monotone_chain_ctx. The output array is only written once the hull can no longer be
+ * cancelled, so a cancelled task leaves it unchanged. The input must not be modified and the output
+ * not be touched until the task is done or freed.
+ * @ingroup async
+ * @param context Context whose workers run the task
+ * @param input_array Point array for which to find the convex hull.
+ * @param output_array Initialized point array the hull is appended to.
+ * @param compute_type Toggle for computing with or without degeneracy
+ * @param callback Function called on the worker once the result is final, may be NULL
+ * @param user_data Passed to the callback
+ * @return Task handle to be freed with free_task, or NULL if the task could not be started.
+ */
+CGTask_t* compute_monotone_chain_async(CGContext_t* context, const CGPointArray_t* input_array, CGPointArray_t* output_array,
+                                       CGCompute_t compute_type, CGTaskCallback_t callback, void* user_data){
+    return submit_task(context, run_monotone_chain, input_array, output_array, CG_MONOTONE_CHAIN, compute_type, callback, user_data);
+}
+
+
+//----------------------------------------------------------------
+// Functions - Task handles
+//----------------------------------------------------------------
+
+
+/**
+ * Function that checks whether a task is done, without blocking.
+ * @ingroup async
+ * @param task Task to check
+ * @return 1 if the result is final and the callback has returned, otherwise 0.
+ */
+int poll_task(CGTask_t* task){
+    if(task == NULL)
+        return 0;
+    cg_mutex_lock(&task->lock);
+    int done = task->done;
+    cg_mutex_unlock(&task->lock);
+    return done;
+}
+
+
+/**
+ * Function that waits for a task to be done.
+ * @ingroup async
+ * @param task Task to wait for
+ * @param timeout_seconds Longest time to wait, negative to wait as long as it takes
+ * @return INVALID_INPUT if task is NULL, TIMEOUT if the task is not done in time, otherwise the
+ *      result of the task, CANCELLED if it was cancelled.
+ */
+CGError_t wait_task(CGTask_t* task, double timeout_seconds){
+    if(task == NULL)
+        return CG_INVALID_INPUT;
+    double deadline = cg_time_seconds() + timeout_seconds;
+    cg_mutex_lock(&task->lock);
+    while(!task->done){
+        if(timeout_seconds < 0)
+            cg_condition_wait(&task->finished, &task->lock);
+        else{
+            double remaining = deadline - cg_time_seconds();
+            if(remaining <= 0)
+                break;
+            cg_condition_timed_wait(&task->finished, &task->lock, remaining);
+        }
+    }
+    CGError_t status = task->done ? task->status : CG_TIMEOUT;
+    cg_mutex_unlock(&task->lock);
+    return status;
+}
+
+
+/**
+ * Function that estimates how much of a task is done.
+ * @ingroup async
+ * @param task Task to query
+ * @return Fraction between 0 and 1, 1 once the task is done.
+ */
+double get_task_progress(CGTask_t* task){
+    if(task == NULL)
+        return 0.0;
+    if(poll_task(task))
+        return 1.0;
+    size_t total = cg_atomic_load(&task->progress.total);
+    size_t completed = cg_atomic_load(&task->progress.completed);
+    if(total == 0)
+        return 0.0;
+    return completed >= total ? 1.0 : (double) completed / (double) total;
+}
+
+
+/**
+ * Function that asks a task to stop. Cancellation is cooperative: the algorithm stops at its next
+ * check and the task finishes with CANCELLED, unless its result was already final.
+ * @ingroup async
+ * @param task Task to cancel
+ * @return INVALID_INPUT if task is NULL, otherwise SUCCESS.
+ */
+CGError_t cancel_task(CGTask_t* task){
+    if(task == NULL)
+        return CG_INVALID_INPUT;
+    cg_atomic_store(&task->progress.cancelled, 1);
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that releases a task handle. A task that is not done yet is cancelled, and the call
+ * waits for its worker to finish with it, since an algorithm past its last cancellation check
+ * still writes its output; its callback still runs. Once this returns the task no longer touches
+ * its input or output, so both may be freed. Tasks must be freed before the context they run in,
+ * and not from their own callback.
+ * @ingroup async
+ * @param task Task to free
+ * @return INVALID_INPUT if task is NULL, otherwise SUCCESS.
+ */
+CGError_t free_task(CGTask_t* task){
+    if(task == NULL)
+        return CG_INVALID_INPUT;
+    if(!poll_task(task)){
+        cancel_task(task);
+        wait_task(task, -1.0);
+    }
+    release_task(task);
+    return CG_SUCCESS;
+}
@@ -0,0 +1,314 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing the reader and writer for the native binary point file format.
+ *
+ * A file starts with a 128 byte header, followed by the block of x-coordinates and the block of
+ * y-coordinates, each starting at a multiple of 64 bytes:
+ *
+ *  offset  size  field
+ *  0       8     magic "CGEOPTS\0"
+ *  8       4     format version, currently 1
+ *  12      4     byte order marker 0x01020304 in the writer's byte order
+ *  16      4     coordinate type, 1 for IEEE 754 doubles
+ *  20      4     block alignment in bytes
+ *  24      8     number of points
+ *  32      32    bounding box as min x, min y, max x, max y
+ *  64      8     offset of the x-coordinate block
+ *  72      8     offset of the y-coordinate block
+ *  80      48    reserved, zero
+ *
+ * Files in the reader's byte order are mapped and used in place, so opening one costs the same
+ * regardless of its size.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+#define BINARY_MAGIC            "CGEOPTS"
+#define BINARY_VERSION          1
+#define BINARY_BYTE_ORDER_MARK  0x01020304u
+#define BINARY_COORD_DOUBLE     1
+#define BINARY_ALIGNMENT        64
+#define BINARY_HEADER_SIZE      128
+
+
+/**
+ * Struct mirroring the on-disk header. Every field is naturally aligned, so the in-memory layout
+ * matches the file layout.
+ * @internal
+ */
+typedef struct CG_BinaryHeader {
+    char magic[8];              /**< "CGEOPTS\0" */
+    uint32_t version;           /**< Format version */
+    uint32_t byte_order;        /**< BINARY_BYTE_ORDER_MARK as written */
+    uint32_t coord_type;        /**< Coordinate encoding */
+    uint32_t alignment;         /**< Alignment of the coordinate blocks */
+    uint64_t num_points;        /**< Number of points */
+    double bounding_box[4];     /**< min x, min y, max x, max y */
+    uint64_t xcoords_offset;    /**< Offset of the x-coordinate block */
+    uint64_t ycoords_offset;    /**< Offset of the y-coordinate block */
+    uint8_t reserved[48];       /**< Reserved, zero */
+} CGBinaryHeader_t;
+
+
+/** @internal Rounds offset up to the block alignment */
+static inline uint64_t align_offset(uint64_t offset){
+    return (offset + BINARY_ALIGNMENT - 1) & ~((uint64_t) BINARY_ALIGNMENT - 1);
+}
+
+
+/** @internal Swaps the byte order of a double */
+static inline double byteswap_double(double value){
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits = cg_byteswap64(bits);
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Writing binary point files
+//----------------------------------------------------------------
+
+
+/** @internal Writes zero bytes until the file position reaches offset */
+static int pad_to(FILE* file_pointer, uint64_t position, uint64_t offset){
+    static const char zeros[BINARY_ALIGNMENT] = {0};
+    return fwrite(zeros, 1, (size_t) (offset - position), file_pointer) == (size_t) (offset - position);
+}
+
+
+/**
+ * Function for writing a point array to a binary point file.
+ * @ingroup file
+ * @param point_array Point array to write into the file
+ * @param file_path Path of the file to create or overwrite
+ * @return NO_FILE if the file cannot be opened, INVALID_INPUT if writing fails, otherwise SUCCESS.
+ */
+CGError_t binary_file_from_point_array(const CGPointArray_t* point_array, const char* file_path){
+    if(point_array == NULL || file_path == NULL)
+        return CG_INVALID_INPUT;
+
+    CGBinaryHeader_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.byte_order = BINARY_BYTE_ORDER_MARK;
+    header.coord_type = BINARY_COORD_DOUBLE;
+    header.alignment = BINARY_ALIGNMENT;
+    header.num_points = point_array->num_points;
+    CGBoundingBox_t bounding_box;
+    if(compute_bounding_box(point_array, &bounding_box) == CG_SUCCESS){
+        header.bounding_box[0] = bounding_box.min_x;
+        header.bounding_box[1] = bounding_box.min_y;
+        header.bounding_box[2] = bounding_box.max_x;
+        header.bounding_box[3] = bounding_box.max_y;
+    }
+    uint64_t block_size = (uint64_t) point_array->num_points * sizeof(double);
+    header.xcoords_offset = BINARY_HEADER_SIZE;
+    header.ycoords_offset = align_offset(header.xcoords_offset + block_size);
+
+    FILE* file_pointer = fopen(file_path, "wb");
+    if(file_pointer == NULL)
+        return CG_NO_FILE;
+    int ok = fwrite(&header, sizeof(header), 1, file_pointer) == 1;
+    ok = ok && fwrite(point_array->xcoords, sizeof(double), point_array->num_points, file_pointer) == point_array->num_points;
+    ok = ok && pad_to(file_pointer, header.xcoords_offset + block_size, header.ycoords_offset);
+    ok = ok && fwrite(point_array->ycoords, sizeof(double), point_array->num_points, file_pointer) == point_array->num_points;
+    ok = (fclose(file_pointer) == 0) && ok;
+    return ok ? CG_SUCCESS : CG_INVALID_INPUT;
+}
+
+
+/**
+ * Function for writing a point set to a binary point file.
+ * @ingroup file
+ * @param point_set Point set to write into the file
+ * @param file_path Path of the file to create or overwrite
+ * @return NO_FILE if the file cannot be opened, INVALID_INPUT if writing fails, otherwise SUCCESS.
+ */
+CGError_t binary_file_from_point_set(const CGPointSet_t* point_set, const char* file_path){
+    if(point_set == NULL || file_path == NULL)
+        return CG_INVALID_INPUT;
+    CGPointArray_t* point_array = init_point_array(point_set->num_points);
+    if(point_array == NULL)
+        return CG_NO_MEMORY;
+    CGError_t status = point_array_from_point_set(point_set, point_array);
+    if(status == CG_SUCCESS)
+        status = binary_file_from_point_array(point_array, file_path);
+    free_point_array(point_array);
+    return status;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Reading binary point files
+//----------------------------------------------------------------
+
+
+/**
+ * Helper that checks a mapped file holds a valid header and that the blocks it describes fit in the file.
+ * @internal
+ * @param file_map Mapped file
+ * @param header Output header, converted to native byte order
+ * @param swapped Set if the file was written with the opposite byte order
+ * @return INVALID_FILE or INVALID_TYPE if the file cannot be read, otherwise SUCCESS.
+ */
+static CGError_t read_header(CGFileMap_t* file_map, CGBinaryHeader_t* header, int* swapped){
+    if(file_map->size < BINARY_HEADER_SIZE)
+        return CG_INVALID_FILE;
+    memcpy(header, file_map->data, sizeof(CGBinaryHeader_t));
+    if(memcmp(header->magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0)
+        return CG_INVALID_FILE;
+
+    *swapped = header->byte_order != BINARY_BYTE_ORDER_MARK;
+    if(*swapped){
+        if(cg_byteswap32(header->byte_order) != BINARY_BYTE_ORDER_MARK)
+            return CG_INVALID_FILE;
+        header->version = cg_byteswap32(header->version);
+        header->coord_type = cg_byteswap32(header->coord_type);
+        header->alignment = cg_byteswap32(header->alignment);
+        header->num_points = cg_byteswap64(header->num_points);
+        header->xcoords_offset = cg_byteswap64(header->xcoords_offset);
+        header->ycoords_offset = cg_byteswap64(header->ycoords_offset);
+        int i;
+        for(i = 0; i < 4; i++)
+            header->bounding_box[i] = byteswap_double(header->bounding_box[i]);
+    }
+    if(header->version != BINARY_VERSION)
+        return CG_INVALID_FILE;
+    else if(header->coord_type != BINARY_COORD_DOUBLE)
+        return CG_INVALID_TYPE;
+
+    // the blocks must be aligned for doubles and lie inside the file
+    uint64_t block_size = header->num_points * sizeof(double);
+    if(header->num_points > file_map->size / sizeof(double) ||
+       header->xcoords_offset % sizeof(double) != 0 || header->ycoords_offset % sizeof(double) != 0 ||
+       header->xcoords_offset > file_map->size || file_map->size - header->xcoords_offset < block_size ||
+       header->ycoords_offset > file_map->size || file_map->size - header->ycoords_offset < block_size)
+        return CG_INVALID_FILE;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that opens a binary point file as a point array. Files in native byte order are
+ * memory-mapped and the array points straight into the mapping, so no coordinates are read or
+ * copied up front. Such arrays are read-only until they are grown or made writable with
+ * make_point_array_writable. Files in the other byte order
+ * are copied and converted. The array must be released with free_point_array.
+ * @ingroup file
+ * @param file_path Path to the binary point file
+ * @param point_array Output pointer that receives the new point array
+ * @param bounding_box If not NULL, receives the bounding box stored in the header
+ * @return NO_FILE if the file cannot be mapped, INVALID_FILE or INVALID_TYPE if it cannot be read,
+ *      NO_MEMORY if allocation fails, otherwise SUCCESS.
+ */
+CGError_t map_point_array_from_binary_file(const char* file_path, CGPointArray_t** point_array, CGBoundingBox_t* bounding_box){
+    if(file_path == NULL || point_array == NULL)
+        return CG_INVALID_INPUT;
+    *point_array = NULL;
+
+    CGSharedStorage_t* storage = (CGSharedStorage_t*) cg_calloc(1, sizeof(CGSharedStorage_t));
+    CGPointArray_t* result = init_point_array(0);
+    if(storage == NULL || result == NULL){
+        cg_free(storage);
+        free_point_array(result);
+        return CG_NO_MEMORY;
+    }
+    CGFileMap_t* file_map = &storage->file_map;
+
+    CGBinaryHeader_t header;
+    int swapped = 0;
+    CGError_t status = cg_map_file(file_path, file_map);
+    if(status == CG_SUCCESS)
+        status = read_header(file_map, &header, &swapped);
+    if(status != CG_SUCCESS){
+        cg_unmap_file(file_map);
+        cg_free(storage);
+        free_point_array(result);
+        return status;
+    }
+
+    const double* xcoords = (const double*) (file_map->data + header.xcoords_offset);
+    const double* ycoords = (const double*) (file_map->data + header.ycoords_offset);
+    size_t num_points = (size_t) header.num_points;
+    if(!swapped){
+        cg_free(result->xcoords);
+        cg_free(result->ycoords);
+        storage->ref_count = 1;
+        result->xcoords = (double*) xcoords;
+        result->ycoords = (double*) ycoords;
+        result->num_points = num_points;
+        result->capacity = 0;
+        result->storage = storage;
+    }
+    else{
+        status = reserve_point_array(result, num_points);
+        size_t i;
+        for(i = 0; status == CG_SUCCESS && i < num_points; i++){
+            result->xcoords[i] = byteswap_double(xcoords[i]);
+            result->ycoords[i] = byteswap_double(ycoords[i]);
+        }
+        result->num_points = (status == CG_SUCCESS) ? num_points : 0;
+        cg_unmap_file(file_map);
+        cg_free(storage);
+        if(status != CG_SUCCESS){
+            free_point_array(result);
+            return status;
+        }
+    }
+
+    if(bounding_box != NULL){
+        bounding_box->min_x = header.bounding_box[0];
+        bounding_box->min_y = header.bounding_box[1];
+        bounding_box->max_x = header.bounding_box[2];
+        bounding_box->max_y = header.bounding_box[3];
+    }
+    *point_array = result;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that reads a binary point file into a point set.
+ * @ingroup file
+ * @param point_set Initialized point set to which the points are appended
+ * @param file_path Path to the binary point file
+ * @return Status of map_point_array_from_binary_file or of adding the points.
+ */
+CGError_t point_set_from_binary_file(CGPointSet_t* point_set, const char* file_path){
+    if(point_set == NULL || file_path == NULL)
+        return CG_INVALID_INPUT;
+    CGPointArray_t* point_array;
+    CGError_t status = map_point_array_from_binary_file(file_path, &point_array, NULL);
+    if(status != CG_SUCCESS)
+        return status;
+    status = point_set_from_point_array(point_array, point_set);
+    free_point_array(point_array);
+    return status;
+}
@@ -0,0 +1,593 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing library contexts. A context owns a pool of worker threads that is started
+ * once and reused by every call made through it, scratch arenas that keep their memory between
+ * calls, the thresholds deciding when work is worth splitting, and the allocator for all of this and
+ * for the scratch buffers of calls made through it. The _ctx variants of the algorithms take a context
+ * and run their parallel parts on its pool; only the buffers they hand back to the caller come from the
+ * global allocator, so they can be released with free_buffer.
+ *
+ * @defgroup context Contexts
+ * @brief Worker pools, scratch memory and tuning shared by the _ctx entry points.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+// Default thresholds below which work is not split between threads
+#define DEFAULT_PARALLEL_MIN_POINTS (1 << 16)
+#define DEFAULT_PARALLEL_MIN_BYTES  (1 << 16)
+
+// Default size of the first block of a scratch arena
+#define DEFAULT_SCRATCH_SIZE        (1 << 20)
+
+// Alignment of every arena allocation, one cache line
+#define ARENA_ALIGNMENT             64
+
+
+//----------------------------------------------------------------
+// Data Structures - Contexts
+//----------------------------------------------------------------
+
+
+/**
+ * Struct for one block of memory owned by an arena. Allocations follow the header.
+ * @internal
+ */
+struct CG_ArenaBlock {
+    struct CG_ArenaBlock* previous; /**< Block that filled up before this one */
+    unsigned char* data;            /**< Aligned start of the usable memory */
+    size_t capacity;                /**< Usable bytes in the block */
+    size_t used;                    /**< Bytes handed out so far */
+};
+
+
+/**
+ * Struct for a unit of work on the worker queue. A job may be picked up by several workers,
+ * which then all run function(argument).
+ * @internal
+ */
+typedef struct CG_Job {
+    void (*function)(void* argument);   /**< Work to run */
+    void* argument;                     /**< Argument passed to function */
+    size_t num_claims;                  /**< Number of workers that may still pick up the job */
+    size_t num_running;                 /**< Number of workers currently running the job */
+    int owned;                          /**< Non-zero if the job is freed by the worker that ran it */
+    struct CG_Job* next;                /**< Next job in the queue */
+} CGJob_t;
+
+
+/**
+ * Struct for a set of tasks run by cg_context_parallel_for. Threads claim task indices until
+ * none are left.
+ * @internal
+ */
+typedef struct CG_TaskBatch {
+    CGContext_t* context;               /**< Context the tasks run in */
+    CGTaskFunction_t function;          /**< Function run once per task */
+    void* argument;                     /**< Argument passed to function */
+    size_t num_tasks;                   /**< Number of tasks */
+    volatile size_t next_task;          /**< Number of tasks claimed so far */
+} CGTaskBatch_t;
+
+
+/**
+ * Struct holding a library context.
+ */
+struct CG_Context {
+    CGAllocator_t allocator;            /**< Allocator for memory owned by the context */
+    int num_threads;                    /**< Threads working on a call, including the calling thread */
+    size_t parallel_min_points;         /**< Minimum points per task */
+    size_t parallel_min_bytes;          /**< Minimum input bytes per task */
+    size_t scratch_size;                /**< Size of the first block of each arena */
+
+    CGMutex_t lock;                     /**< Protects everything below */
+    CGCondition_t work_ready;           /**< Signalled when jobs are queued or the pool stops */
+    CGCondition_t job_done;             /**< Broadcast when a worker finishes a shared job */
+    CGThread_t* workers;                /**< Worker threads, started on first use */
+    int num_workers;                    /**< Number of started workers */
+    int started;                        /**< Non-zero once starting the workers was attempted */
+    int stopping;                       /**< Non-zero while the context is being freed */
+    CGJob_t* queue_head;                /**< First queued job */
+    CGJob_t* queue_tail;                /**< Last queued job */
+    CGArena_t* free_arenas;             /**< Arenas not used by any thread */
+};
+
+
+//----------------------------------------------------------------
+// Functions - Context owned memory
+//----------------------------------------------------------------
+
+
+/** @internal Allocates memory with the context's allocator */
+static void* context_alloc(const CGAllocator_t* allocator, size_t size){
+    return allocator->alloc(size ? size : 1, allocator->user_data);
+}
+
+
+/** @internal Releases memory allocated by context_alloc */
+static void context_free(const CGAllocator_t* allocator, void* pointer){
+    if(pointer != NULL)
+        allocator->free(pointer, allocator->user_data);
+}
+
+
+/**
+ * Function that resizes memory with the allocator of a context. Meant for scratch buffers of a _ctx
+ * call that grow on a worker and outlive their task, such as per-task results joined once the tasks
+ * are done. Without a context the global allocator is used, so helpers can serve both kinds of call.
+ * @internal
+ * @param context Context whose allocator to use, or NULL
+ * @param pointer Memory from this function to resize, NULL allocates new memory
+ * @param size New size in bytes
+ * @return Resized memory or NULL, in which case pointer is still valid.
+ */
+void* cg_context_realloc(CGContext_t* context, void* pointer, size_t size){
+    if(context == NULL)
+        return cg_realloc(pointer, size);
+    else if(pointer == NULL)
+        return context_alloc(&context->allocator, size);
+    return context->allocator.realloc(pointer, size ? size : 1, context->allocator.user_data);
+}
+
+
+/**
+ * Function that releases memory from cg_context_realloc.
+ * @internal
+ * @param context Context the memory was allocated with, or NULL
+ * @param pointer Memory to release, may be NULL
+ */
+void cg_context_free(CGContext_t* context, void* pointer){
+    if(context == NULL)
+        cg_free(pointer);
+    else
+        context_free(&context->allocator, pointer);
+}
+
+
+/**
+ * Function that allocates scratch memory from an arena. The memory stays valid until the arena
+ * is released back to its context, there is no way to free single allocations.
+ * @internal
+ * @param arena Arena to allocate from
+ * @param size Number of bytes
+ * @return Memory aligned to a cache line, or NULL if a new block cannot be allocated.
+ */
+void* cg_arena_alloc(CGArena_t* arena, size_t size){
+    if(arena == NULL)
+        return NULL;
+    size = (size + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1);
+    CGArenaBlock_t* block = arena->block;
+    if(block == NULL || block->capacity - block->used < size){
+        // blocks at least double, so a reused arena settles on one block large enough for every call
+        size_t capacity = block != NULL ? 2 * block->capacity : arena->block_size;
+        if(capacity < size)
+            capacity = size;
+        unsigned char* memory = (unsigned char*) context_alloc(arena->allocator, sizeof(CGArenaBlock_t) + ARENA_ALIGNMENT + capacity);
+        if(memory == NULL)
+            return NULL;
+        block = (CGArenaBlock_t*) memory;
+        uintptr_t data = (uintptr_t) (memory + sizeof(CGArenaBlock_t));
+        block->data = (unsigned char*) ((data + ARENA_ALIGNMENT - 1) & ~((uintptr_t) ARENA_ALIGNMENT - 1));
+        block->capacity = capacity;
+        block->used = 0;
+        block->previous = arena->block;
+        arena->block = block;
+    }
+    void* memory = block->data + block->used;
+    block->used += size;
+    return memory;
+}
+
+
+/**
+ * Function that hands out an arena no other thread is using, creating one if needed.
+ * @internal
+ * @param context Context owning the arena
+ * @return Empty arena, or NULL if allocation fails.
+ */
+CGArena_t* cg_context_acquire_arena(CGContext_t* context){
+    cg_mutex_lock(&context->lock);
+    CGArena_t* arena = context->free_arenas;
+    if(arena != NULL)
+        context->free_arenas = arena->next;
+    cg_mutex_unlock(&context->lock);
+    if(arena != NULL)
+        return arena;
+
+    arena = (CGArena_t*) context_alloc(&context->allocator, sizeof(CGArena_t));
+    if(arena == NULL)
+        return NULL;
+    arena->block = NULL;
+    arena->allocator = &context->allocator;
+    arena->block_size = context->scratch_size;
+    arena->next = NULL;
+    return arena;
+}
+
+
+/**
+ * Function that empties an arena and returns it to its context. Only the newest, largest block
+ * is kept so the next user can allocate without touching the allocator.
+ * @internal
+ * @param context Context owning the arena
+ * @param arena Arena from cg_context_acquire_arena, may be NULL
+ */
+void cg_context_release_arena(CGContext_t* context, CGArena_t* arena){
+    if(arena == NULL)
+        return;
+    CGArenaBlock_t* block = arena->block;
+    if(block != NULL){
+        CGArenaBlock_t* previous = block->previous;
+        while(previous != NULL){
+            CGArenaBlock_t* next = previous->previous;
+            context_free(arena->allocator, previous);
+            previous = next;
+        }
+        block->previous = NULL;
+        block->used = 0;
+    }
+    cg_mutex_lock(&context->lock);
+    arena->next = context->free_arenas;
+    context->free_arenas = arena;
+    cg_mutex_unlock(&context->lock);
+}
+
+
+//----------------------------------------------------------------
+// Functions - Worker pool
+//----------------------------------------------------------------
+
+
+/**
+ * Thread entry point of the workers. Runs queued jobs until the context is freed and the queue
+ * is empty.
+ * @internal
+ */
+static void* worker_main(void* argument){
+    CGContext_t* context = (CGContext_t*) argument;
+    cg_mutex_lock(&context->lock);
+    while(1){
+        CGJob_t* job = context->queue_head;
+        if(job == NULL){
+            if(context->stopping)
+                break;
+            cg_condition_wait(&context->work_ready, &context->lock);
+            continue;
+        }
+        if(--job->num_claims == 0){
+            context->queue_head = job->next;
+            if(context->queue_head == NULL)
+                context->queue_tail = NULL;
+        }
+        job->num_running++;
+        cg_mutex_unlock(&context->lock);
+        job->function(job->argument);
+        cg_mutex_lock(&context->lock);
+        job->num_running--;
+        if(job->owned)
+            context_free(&context->allocator, job);
+        else
+            cg_condition_broadcast(&context->job_done);
+    }
+    cg_mutex_unlock(&context->lock);
+    return NULL;
+}
+
+
+/**
+ * Helper that starts the worker threads the first time they are needed. There is one worker less
+ * than the context has threads, as the caller helps, but at least one so submitted jobs can run
+ * in the background. Called with the lock held.
+ * @internal
+ */
+static void start_workers(CGContext_t* context){
+    context->started = 1;
+    int max_workers = context->num_threads > 1 ? context->num_threads - 1 : 1;
+    context->workers = (CGThread_t*) context_alloc(&context->allocator, (size_t) max_workers * sizeof(CGThread_t));
+    if(context->workers == NULL)
+        return;
+    // fewer workers than requested only costs parallelism
+    while(context->num_workers < max_workers){
+        if(cg_thread_create(&context->workers[context->num_workers], worker_main, context) != CG_SUCCESS)
+            break;
+        context->num_workers++;
+    }
+}
+
+
+/**
+ * Helper that adds a job to the end of the queue and wakes enough workers for it. Called with the lock held.
+ * @internal
+ */
+static void enqueue_job(CGContext_t* context, CGJob_t* job){
+    job->next = NULL;
+    if(context->queue_tail == NULL)
+        context->queue_head = job;
+    else
+        context->queue_tail->next = job;
+    context->queue_tail = job;
+    if(job->num_claims == 1)
+        cg_condition_signal(&context->work_ready);
+    else
+        cg_condition_broadcast(&context->work_ready);
+}
+
+
+/**
+ * Helper that removes a job from the queue if no worker has claimed all of it yet. Called with the lock held.
+ * @internal
+ */
+static void dequeue_job(CGContext_t* context, CGJob_t* job){
+    CGJob_t* previous = NULL;
+    CGJob_t* current = context->queue_head;
+    while(current != NULL && current != job){
+        previous = current;
+        current = current->next;
+    }
+    if(current == NULL)
+        return;
+    if(previous == NULL)
+        context->queue_head = job->next;
+    else
+        previous->next = job->next;
+    if(context->queue_tail == job)
+        context->queue_tail = previous;
+    job->num_claims = 0;
+}
+
+
+/**
+ * Job function that claims and runs tasks of a batch until none are left. Each task gets an
+ * arena of its own.
+ * @internal
+ */
+static void run_batch(void* argument){
+    CGTaskBatch_t* batch = (CGTaskBatch_t*) argument;
+    size_t task_index;
+    while((task_index = cg_atomic_increment(&batch->next_task) - 1) < batch->num_tasks){
+        CGArena_t* arena = cg_context_acquire_arena(batch->context);
+        batch->function(batch->argument, task_index, arena);
+        cg_context_release_arena(batch->context, arena);
+    }
+}
+
+
+/**
+ * Function that runs function(argument, i, arena) for every i below num_tasks and waits for all
+ * of them. The calling thread works on the tasks as well, so calls nested inside tasks and calls
+ * on a busy pool always make progress. Tasks must tolerate a NULL arena when memory is short.
+ * @internal
+ * @param context Context whose workers help with the tasks
+ * @param num_tasks Number of tasks
+ * @param function Function run once per task
+ * @param argument Argument passed to every task
+ * @return INVALID_INPUT if context or function is NULL, otherwise SUCCESS. Tasks report their own errors.
+ */
+CGError_t cg_context_parallel_for(CGContext_t* context, size_t num_tasks, CGTaskFunction_t function, void* argument){
+    if(context == NULL || function == NULL)
+        return CG_INVALID_INPUT;
+
+    CGTaskBatch_t batch;
+    batch.context = context;
+    batch.function = function;
+    batch.argument = argument;
+    batch.num_tasks = num_tasks;
+    batch.next_task = 0;
+
+    CGJob_t job;
+    job.function = run_batch;
+    job.argument = &batch;
+    job.num_claims = 0;
+    job.num_running = 0;
+    job.owned = 0;
+    int queued = 0;
+    if(num_tasks > 1 && context->num_threads > 1){
+        cg_mutex_lock(&context->lock);
+        if(!context->started)
+            start_workers(context);
+        job.num_claims = num_tasks - 1 < (size_t) context->num_workers ? num_tasks - 1 : (size_t) context->num_workers;
+        if(job.num_claims > 0){
+            enqueue_job(context, &job);
+            queued = 1;
+        }
+        cg_mutex_unlock(&context->lock);
+    }
+
+    run_batch(&batch);
+
+    // the batch lives on this stack, so no worker may still pick it up or be running it
+    if(queued){
+        cg_mutex_lock(&context->lock);
+        dequeue_job(context, &job);
+        while(job.num_running > 0)
+            cg_condition_wait(&context->job_done, &context->lock);
+        cg_mutex_unlock(&context->lock);
+    }
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that queues a job to run in the background on one of the context's workers. The
+ * caller does not wait for it; free_context finishes every queued job before returning.
+ * @internal
+ * @param context Context whose workers run the job
+ * @param function Job to run
+ * @param argument Argument passed to function
+ * @return NO_MEMORY if the job cannot be allocated or no worker could be started, otherwise SUCCESS.
+ */
+CGError_t cg_context_submit(CGContext_t* context, void (*function)(void*), void* argument){
+    if(context == NULL || function == NULL)
+        return CG_INVALID_INPUT;
+    CGJob_t* job = (CGJob_t*) context_alloc(&context->allocator, sizeof(CGJob_t));
+    if(job == NULL)
+        return CG_NO_MEMORY;
+    job->function = function;
+    job->argument = argument;
+    job->num_claims = 1;
+    job->num_running = 0;
+    job->owned = 1;
+
+    cg_mutex_lock(&context->lock);
+    if(!context->started)
+        start_workers(context);
+    if(context->num_workers == 0){
+        cg_mutex_unlock(&context->lock);
+        context_free(&context->allocator, job);
+        return CG_NO_MEMORY;
+    }
+    enqueue_job(context, job);
+    cg_mutex_unlock(&context->lock);
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that finds how many tasks to split work over so that each gets at least the context's
+ * minimum number of points.
+ * @internal
+ * @param context Context the work runs in
+ * @param num_points Number of points to process
+ * @param tasks_per_thread Tasks to allow per thread, more than 1 gives finer grained progress
+ * @return Number of tasks, between 1 and tasks_per_thread times the number of threads of the context.
+ */
+size_t cg_context_point_tasks(const CGContext_t* context, size_t num_points, size_t tasks_per_thread){
+    size_t num_tasks = num_points / context->parallel_min_points;
+    if(num_tasks > (size_t) context->num_threads * tasks_per_thread)
+        num_tasks = (size_t) context->num_threads * tasks_per_thread;
+    return num_tasks > 0 ? num_tasks : 1;
+}
+
+
+/**
+ * Function that finds how many tasks to split work over so that each gets at least the context's
+ * minimum number of input bytes.
+ * @internal
+ * @param context Context the work runs in
+ * @param num_bytes Number of bytes to process
+ * @return Number of tasks, between 1 and the number of threads of the context.
+ */
+size_t cg_context_byte_tasks(const CGContext_t* context, size_t num_bytes){
+    size_t num_tasks = num_bytes / context->parallel_min_bytes;
+    if(num_tasks > (size_t) context->num_threads)
+        num_tasks = (size_t) context->num_threads;
+    return num_tasks > 0 ? num_tasks : 1;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Init and free contexts
+//----------------------------------------------------------------
+
+
+/**
+ * Function that creates a library context. Worker threads are started the first time a call
+ * through the context has enough work to split, and live until the context is freed. A context
+ * may be used by several threads at once.
+ * @ingroup context
+ * @param options Settings for the context, or NULL for the defaults. Zero fields also take their default.
+ * @return Allocated context to be freed with free_context, or NULL if allocation fails.
+ */
+CGContext_t* init_context(const CGContextOptions_t* options){
+    CGAllocator_t allocator = get_allocator();
+    if(options != NULL && options->allocator != NULL){
+        if(options->allocator->alloc == NULL || options->allocator->realloc == NULL || options->allocator->free == NULL)
+            return NULL;
+        allocator = *options->allocator;
+    }
+    CGContext_t* context = (CGContext_t*) context_alloc(&allocator, sizeof(CGContext_t));
+    if(context == NULL)
+        return NULL;
+    memset(context, 0, sizeof(CGContext_t));
+    context->allocator = allocator;
+    context->num_threads = (options != NULL && options->num_threads > 0) ? options->num_threads : cg_num_cpus();
+    context->parallel_min_points = (options != NULL && options->parallel_min_points > 0) ? options->parallel_min_points : DEFAULT_PARALLEL_MIN_POINTS;
+    context->parallel_min_bytes = (options != NULL && options->parallel_min_bytes > 0) ? options->parallel_min_bytes : DEFAULT_PARALLEL_MIN_BYTES;
+    context->scratch_size = (options != NULL && options->scratch_size > 0) ? options->scratch_size : DEFAULT_SCRATCH_SIZE;
+
+    if(cg_mutex_init(&context->lock) != CG_SUCCESS){
+        context_free(&allocator, context);
+        return NULL;
+    }
+    if(cg_condition_init(&context->work_ready) != CG_SUCCESS || cg_condition_init(&context->job_done) != CG_SUCCESS){
+        cg_condition_destroy(&context->work_ready);
+        cg_mutex_destroy(&context->lock);
+        context_free(&allocator, context);
+        return NULL;
+    }
+    return context;
+}
+
+
+/**
+ * Function that frees a context. Jobs already queued are finished first, then the workers are
+ * joined and the scratch memory is released. No call through the context may be running.
+ * @ingroup context
+ * @param context Context to free
+ * @return INVALID_INPUT if context is NULL, otherwise SUCCESS.
+ */
+CGError_t free_context(CGContext_t* context){
+    if(context == NULL)
+        return CG_INVALID_INPUT;
+    cg_mutex_lock(&context->lock);
+    context->stopping = 1;
+    cg_condition_broadcast(&context->work_ready);
+    cg_mutex_unlock(&context->lock);
+    int i;
+    for(i = 0; i < context->num_workers; i++)
+        cg_thread_join(&context->workers[i]);
+    context_free(&context->allocator, context->workers);
+
+    while(context->free_arenas != NULL){
+        CGArena_t* arena = context->free_arenas;
+        context->free_arenas = arena->next;
+        CGArenaBlock_t* block = arena->block;
+        while(block != NULL){
+            CGArenaBlock_t* previous = block->previous;
+            context_free(&context->allocator, block);
+            block = previous;
+        }
+        context_free(&context->allocator, arena);
+    }
+    cg_condition_destroy(&context->job_done);
+    cg_condition_destroy(&context->work_ready);
+    cg_mutex_destroy(&context->lock);
+    CGAllocator_t allocator = context->allocator;
+    context_free(&allocator, context);
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that returns the number of threads a context splits work over, including the caller.
+ * @ingroup context
+ * @param context Context to query
+ * @return Number of threads, or 0 if context is NULL.
+ */
+int get_context_num_threads(const CGContext_t* context){
+    return context != NULL ? context->num_threads : 0;
+}
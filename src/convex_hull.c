@@ -31,11 +31,19 @@
  */
 
 
-#include "libCGeo/libCGeo.h"
+#include "libCGeo/libCGeo_internal.h"
+
+// Inputs smaller than this are hulled without filtering out interior points first
+#define HULL_FILTER_MIN_POINTS 64
+
+// Number of points whose orientations are computed at once by the interior point filter
+#define HULL_FILTER_BLOCK 256
 
 
 /**
  * Function that computes the angle of each point with the lowest point in the set.
+ * The angles are written into the sort_val of each point, so this must not be called on a set
+ * other threads are reading. The hull algorithms keep their angles in scratch arrays instead.
  * @ingroup chull
  * @param point_set Point set for which to compute angles
  * @return INVALID_INPUT if input is null or angle cannot be computed, 
@@ -47,6 +55,7 @@ CGError_t compute_point_angles(CGPointSet_t* point_set){
     else if(point_set->num_points == 0 || point_set->head == NULL)
         return CG_POINTS_TOO_FEW;
     else{
+        CG_PHASE_START(timer);
         CGPoint_t* lowest_point = find_lowest_point_in_set(point_set);
         // angles in radians between 0 and pi, lowest point gets -1
         lowest_point->sort_val = -1;
@@ -60,7 +69,9 @@ CGError_t compute_point_angles(CGPointSet_t* point_set){
                 current_node->point->sort_val = angle;
                 current_node->point->sort_val_desc = "angle with lowest point";
             }
+            current_node = current_node->next;
         }
+        CG_PHASE_LAP(timer, CG_PHASE_ANGLES);
         return CG_SUCCESS;
     }
 }
@@ -76,17 +87,18 @@ CGError_t compute_point_angles(CGPointSet_t* point_set){
  * @param output_set Initialized but empty point set that will contain the convex hull without colinear degeneracies
  * @return NULL if error encountered, otherwise point_set with colinear points removed.
  */
-CGError_t remove_colinear_degeneracies(CGPointSet_t* input_set, CGPointSet_t* output_set){
+CGError_t remove_colinear_degeneracies(const CGPointSet_t* input_set, CGPointSet_t* output_set){
     CGError_t status = CG_SUCCESS;
     if (input_set == NULL || output_set == NULL) status = CG_INVALID_INPUT;
     else if(input_set->num_points < 3) {
         status = CG_POINTS_TOO_FEW;
     }
     else{
+        CG_PHASE_START(timer);
         CGPointNode_t* input_node_A = input_set->head;
         CGPointNode_t* input_node_B = input_node_A->next;
         CGPointNode_t* input_node_C = input_node_B->next;
-        add_point_to_set(output_set, input_node_A->point);
+        add_coords_to_set(output_set, input_node_A->point->xcoord, input_node_A->point->ycoord);
         while(input_node_C != NULL){
             CGTurn_t turn_type = find_turn_type(input_node_A->point, input_node_B->point, input_node_C->point);
             if(turn_type != CG_TURN_INLINE){
@@ -102,113 +114,880 @@ CGError_t remove_colinear_degeneracies(CGPointSet_t* input_set, CGPointSet_t* ou
             if(input_node_C == NULL){
                 CGTurn_t wrap_around = find_turn_type(input_node_A->point, input_node_B->point, input_set->head->point);
                 if(wrap_around != CG_TURN_INLINE){
-                    add_point_to_set(output_set, input_node_B->point);
+                    add_coords_to_set(output_set, input_node_B->point->xcoord, input_node_B->point->ycoord);
                 }
             }
         }
+        CG_PHASE_LAP(timer, CG_PHASE_DEGENERACY);
     }
     return status;
 }
 
 
+/**
+ * Helper that orders coordinates by x-coordinate, breaking ties by y-coordinate.
+ * @internal
+ */
+static int compare_coords_xy(const void* coord_A, const void* coord_B){
+    const CGCoord_t* a = (const CGCoord_t*) coord_A;
+    const CGCoord_t* b = (const CGCoord_t*) coord_B;
+    CG_COUNT(comparisons, 1);
+    if(a->xcoord != b->xcoord)
+        return a->xcoord < b->xcoord ? -1 : 1;
+    if(a->ycoord != b->ycoord)
+        return a->ycoord < b->ycoord ? -1 : 1;
+    return 0;
+}
+
+
+/**
+ * Helper returning twice the signed area of the triangle a, b, c. Positive for a left turn.
+ * @internal
+ */
+static inline double cross_product(const CGCoord_t* a, const CGCoord_t* b, const CGCoord_t* c){
+    CG_COUNT(orientation_tests, 1);
+    return (b->xcoord - a->xcoord) * (c->ycoord - a->ycoord) - (b->ycoord - a->ycoord) * (c->xcoord - a->xcoord);
+}
+
+
 /**
  * Function that computes the convex hull using the graham scan approach.
- * First, compute angle each point makes with lowest point. Then sort by said angles.
+ * First, move the lowest point to the front and sort the others by the angle they make with it.
  * Then, initialze a stack of points, and only add to the stack if the three top points
- * make a left turn. Finally, remove the degeneracies caused by 3-point colinear.
+ * make a left turn. Collinear points are popped as well when degeneracies are handled.
+ * The scan works on a compact copy of the coordinates with the angles kept in a separate
+ * array, so the input points are not modified.
  * @ingroup chull
  * @param point_set Point set for which to find convex hull.
+ * @param output_set Initialized point set the hull is appended to, counter-clockwise from the lowest point.
  * @param compute_type Flag to toggle between handling degeneracies or not.
- * @return NULL if invalid inputs or error, otherwise CGPointSet_t with convex hull.
+ * @return INVALID_INPUT if either set is NULL, POINTS_TOO_FEW for less than 3 points,
+ *      NO_MEMORY if scratch space cannot be allocated, otherwise SUCCESS.
  */
-CGError_t compute_graham_scan(CGPointSet_t* point_set, CGPointSet_t* output_set, CGCompute_t compute_type){
+CGError_t compute_graham_scan(const CGPointSet_t* point_set, CGPointSet_t* output_set, CGCompute_t compute_type){
     // basic error checking
     if(point_set == NULL || output_set == NULL)
         return CG_INVALID_INPUT;
     else if(point_set->num_points < 3 || point_set->head == NULL)
         return CG_POINTS_TOO_FEW;
 
-    // find angles w.r.t. lowest point
-    CGError_t status;
-    status = compute_point_angles(point_set);
-    if(status != CG_SUCCESS)
-        return status;
-
-    CGPointSet_t* p_scratch = init_point_set();
+    size_t num_coords = (size_t) point_set->num_points;
+    CGCoord_t* coords = (CGCoord_t*) cg_malloc(num_coords * sizeof(CGCoord_t));
+    CGCoord_t* stack = (CGCoord_t*) cg_malloc(num_coords * sizeof(CGCoord_t));
+    double* keys = (double*) cg_malloc(num_coords * sizeof(double));
+    CGError_t status = (coords != NULL && stack != NULL && keys != NULL) ? CG_SUCCESS : CG_NO_MEMORY;
+    if(status == CG_SUCCESS)
+        status = coords_from_point_set(point_set, coords);
 
-    // sort the points into a temp set
-    status = sort_point_set(point_set, p_scratch);
-    if(status != CG_SUCCESS){
-        free_point_set(p_scratch);
-        return status;
+    // move the lowest point to the front and drop copies of it, they have no angle
+    CG_PHASE_START(timer);
+    size_t i, lowest = 0;
+    for(i = 1; status == CG_SUCCESS && i < num_coords; i++){
+        if(coords[i].ycoord < coords[lowest].ycoord ||
+           (coords[i].ycoord == coords[lowest].ycoord && coords[i].xcoord < coords[lowest].xcoord))
+            lowest = i;
+    }
+    if(status == CG_SUCCESS){
+        CGCoord_t temp = coords[0];
+        coords[0] = coords[lowest];
+        coords[lowest] = temp;
+        size_t kept = 1;
+        for(i = 1; i < num_coords; i++){
+            if(coords[i].xcoord != coords[0].xcoord || coords[i].ycoord != coords[0].ycoord)
+                coords[kept++] = coords[i];
+        }
+        num_coords = kept;
     }
+    CG_PHASE_LAP(timer, CG_PHASE_DEGENERACY);
+    const CGCoord_t origin = (status == CG_SUCCESS) ? coords[0] : (CGCoord_t) {0, 0};
 
-    CGPointNode_t* p_stack = p_scratch->head;
+    // sort by angle with the lowest point, nearer points first on equal angles
+    if(status == CG_SUCCESS)
+        cg_kernels()->squared_distances(coords + 1, num_coords - 1, &origin, keys + 1);
+    CG_PHASE_LAP(timer, CG_PHASE_ANGLES);
+    if(status == CG_SUCCESS)
+        status = sort_coords_by_keys(coords + 1, keys + 1, num_coords - 1);
+    CG_PHASE_LAP(timer, CG_PHASE_SORT);
+    for(i = 1; status == CG_SUCCESS && i < num_coords; i++)
+        keys[i] = atan2(coords[i].ycoord - origin.ycoord, coords[i].xcoord - origin.xcoord);
+    CG_PHASE_LAP(timer, CG_PHASE_ANGLES);
+    if(status == CG_SUCCESS)
+        status = sort_coords_by_keys(coords + 1, keys + 1, num_coords - 1);
+    CG_PHASE_LAP(timer, CG_PHASE_SORT);
 
-    // allocate a stack to keep track of the points we want.
-    CGPoint_t* stack = (CGPoint_t*) malloc(p_scratch->num_points * sizeof(CGPoint_t));
+    // exact duplicates now sit next to each other, keep one of each
+    if(status == CG_SUCCESS){
+        size_t kept = 1;
+        for(i = 1; i < num_coords; i++){
+            if(coords[i].xcoord != coords[kept - 1].xcoord || coords[i].ycoord != coords[kept - 1].ycoord)
+                coords[kept++] = coords[i];
+        }
+        num_coords = kept;
+    }
 
-    // initialize the stack
-    stack[0] = *(p_stack->point);
-    stack[1] = *(p_stack->next->point);
-    stack[2] = *(p_stack->next->next->point);
-    p_stack = p_stack->next->next->next;
+    // points on the closing edge are visited farthest first when they are kept
+    if(status == CG_SUCCESS && compute_type == CG_NO_DEGENERACY && num_coords > 2){
+        size_t first = num_coords - 1;
+        while(first > 1 && cross_product(&origin, &coords[num_coords - 1], &coords[first - 1]) == 0)
+            first--;
+        size_t last = num_coords - 1;
+        while(first > 1 && first < last){
+            CGCoord_t temp = coords[first];
+            coords[first] = coords[last];
+            coords[last] = temp;
+            first++;
+            last--;
+        }
+    }
+    CG_PHASE_LAP(timer, CG_PHASE_DEGENERACY);
 
     // Main Graham scan algorithm loop
-    int stack_counter = 2;
-    while(p_stack != NULL){
+    size_t stack_size = 0;
+    for(i = 0; status == CG_SUCCESS && i < num_coords; i++){
         // until we find a left turn, continue to step back through the stack
-        while(find_turn_type(&stack[stack_counter - 1], &stack[stack_counter], p_stack->point) == CG_TURN_RIGHT){
-            stack_counter--;
+        while(stack_size >= 2){
+            double turn = cross_product(&stack[stack_size - 2], &stack[stack_size - 1], &coords[i]);
+            if(turn > 0 || (turn == 0 && compute_type == CG_NO_DEGENERACY))
+                break;
+            stack_size--;
         }
-        // when we find a left turn, increment the stack, and insert the point into it.
-        stack_counter++;
-        stack[stack_counter] = *(p_stack->point);
-        p_stack = p_stack->next;
+        stack[stack_size++] = coords[i];
     }
+    CG_PHASE_LAP(timer, CG_PHASE_SCAN);
 
     // write all of the points in the stack into the output set
-    int i;
-    for(i = 0; i< stack_counter + 1; i++){
-        add_point_to_set(output_set, &stack[i]);
-    }
+    if(status == CG_SUCCESS)
+        status = point_set_from_coords(stack, stack_size, output_set);
 
     // free memory
-    free(stack);
-    free_point_set(p_scratch);
+    cg_free(coords);
+    cg_free(stack);
+    cg_free(keys);
+    return status;
+}
 
-    // if we account for degeneracy, run the remove degeneracy function
-    if(compute_type == CG_W_DEGENERACY){
-        CGPointSet_t* p_no_degeneracy = init_point_set();
-        status = remove_colinear_degeneracies(output_set, p_no_degeneracy);
-        if(status == CG_SUCCESS){
-            CGPointSet_t* temp = output_set;
-            output_set = p_no_degeneracy;
-            free_point_set(output_set);
+
+/** @internal Sort element of compute_monotone_chain_view, the coordinates come first so compare_coords_xy applies */
+typedef struct CG_IndexedCoord {
+    CGCoord_t coord;
+    size_t index;
+} CGIndexedCoord_t;
+
+
+/** @internal Returns the coordinates of the sort element at a position */
+static inline const CGCoord_t* element_at(const unsigned char* elements, size_t stride, size_t position){
+    return (const CGCoord_t*) (elements + position * stride);
+}
+
+
+/**
+ * Helper that copies the points of an array that may lie on its hull into compact coordinates.
+ * Points strictly inside the quadrilateral of the leftmost, lowest, rightmost and highest points
+ * cannot be on the hull and are skipped (the Akl-Toussaint heuristic), which for most inputs
+ * leaves only a small fraction of the points to sort. The orientation kernel only reports a turn
+ * when its sign is certain, so a point on the hull or one of its edges is never skipped.
+ * @internal
+ * @param xcoords X-coordinates of the points
+ * @param ycoords Y-coordinates of the points
+ * @param num_points Number of points
+ * @param coords Space for num_points coordinates, receives the candidates in input order
+ * @return Number of candidates written to coords.
+ */
+static size_t gather_hull_candidates(const double* xcoords, const double* ycoords, size_t num_points, CGCoord_t* coords){
+    size_t i;
+    if(num_points < HULL_FILTER_MIN_POINTS){
+        for(i = 0; i < num_points; i++){
+            coords[i].xcoord = xcoords[i];
+            coords[i].ycoord = ycoords[i];
+        }
+        return num_points;
+    }
+
+    // corners in counter-clockwise order: leftmost, lowest, rightmost, highest
+    size_t extremes[4] = {0, 0, 0, 0};
+    for(i = 1; i < num_points; i++){
+        if(xcoords[i] < xcoords[extremes[0]]) extremes[0] = i;
+        if(ycoords[i] < ycoords[extremes[1]]) extremes[1] = i;
+        if(xcoords[i] > xcoords[extremes[2]]) extremes[2] = i;
+        if(ycoords[i] > ycoords[extremes[3]]) extremes[3] = i;
+    }
+    CGCoord_t corners[4];
+    int edge;
+    for(edge = 0; edge < 4; edge++){
+        corners[edge].xcoord = xcoords[extremes[edge]];
+        corners[edge].ycoord = ycoords[extremes[edge]];
+    }
+
+    const CGKernels_t* kernels = cg_kernels();
+    double orientations[4][HULL_FILTER_BLOCK];
+    size_t num_candidates = 0, block;
+    for(block = 0; block < num_points; block += HULL_FILTER_BLOCK){
+        size_t block_size = num_points - block < HULL_FILTER_BLOCK ? num_points - block : HULL_FILTER_BLOCK;
+        for(edge = 0; edge < 4; edge++)
+            kernels->orientations(xcoords + block, ycoords + block, block_size, &corners[edge], &corners[(edge + 1) % 4], orientations[edge]);
+        for(i = 0; i < block_size; i++){
+            if(orientations[0][i] > 0 && orientations[1][i] > 0 && orientations[2][i] > 0 && orientations[3][i] > 0)
+                continue;
+            coords[num_candidates].xcoord = xcoords[block + i];
+            coords[num_candidates].ycoord = ycoords[block + i];
+            num_candidates++;
+        }
+    }
+    return num_candidates;
+}
+
+
+/**
+ * Function holding the body of Andrew's monotone chain algorithm. The sort elements start with a
+ * CGCoord_t and may carry more data after it, so the same code serves arrays and views.
+ * @internal
+ * @param elements Sort elements, sorted and de-duplicated in place
+ * @param stride Size in bytes of one element
+ * @param num_elements Number of elements
+ * @param hull Space for 2 * num_elements + 1 positions, receives the hull as positions into elements
+ * @param start Receives the position in hull of the lowest point, where the output starts
+ * @param compute_type Degeneracy handling
+ * @return Number of points on the hull.
+ */
+static size_t monotone_chain_positions(unsigned char* elements, size_t stride, size_t num_elements, size_t* hull, size_t* start, CGCompute_t compute_type){
+    CG_PHASE_START(timer);
+    qsort(elements, num_elements, stride, compare_coords_xy);
+    CG_PHASE_LAP(timer, CG_PHASE_SORT);
+
+    // drop exact duplicates, they make every turn look inline
+    size_t i, num_unique = 1;
+    for(i = 1; i < num_elements; i++){
+        if(compare_coords_xy(element_at(elements, stride, i), element_at(elements, stride, num_unique - 1)) != 0){
+            if(i != num_unique)
+                memcpy(elements + num_unique * stride, elements + i * stride, stride);
+            num_unique++;
         }
     }
+    CG_PHASE_LAP(timer, CG_PHASE_DEGENERACY);
+
+    size_t hull_size = 0;
+    if(num_unique < 3){
+        for(i = 0; i < num_unique; i++)
+            hull[hull_size++] = i;
+    }
+    else{
+        // with degeneracy handling colinear points are popped as well as right turns
+        int keep_colinear = (compute_type == CG_NO_DEGENERACY);
+        for(i = 0; i < num_unique; i++){
+            while(hull_size >= 2){
+                double turn = cross_product(element_at(elements, stride, hull[hull_size - 2]), element_at(elements, stride, hull[hull_size - 1]), element_at(elements, stride, i));
+                if(turn > 0 || (keep_colinear && turn == 0))
+                    break;
+                hull_size--;
+            }
+            hull[hull_size++] = i;
+        }
+        size_t lower_size = hull_size;
+        for(i = num_unique - 1; i-- > 0;){
+            while(hull_size > lower_size){
+                double turn = cross_product(element_at(elements, stride, hull[hull_size - 2]), element_at(elements, stride, hull[hull_size - 1]), element_at(elements, stride, i));
+                if(turn > 0 || (keep_colinear && turn == 0))
+                    break;
+                hull_size--;
+            }
+            hull[hull_size++] = i;
+        }
+        // the last point repeats the first
+        hull_size--;
+        // if every point is on both chains the input is colinear, keep only one chain
+        if(lower_size == num_unique && hull_size == 2 * num_unique - 2)
+            hull_size = num_unique;
+    }
+
+    // the output starts at the lowest point
+    *start = 0;
+    for(i = 1; i < hull_size; i++){
+        const CGCoord_t* point = element_at(elements, stride, hull[i]);
+        const CGCoord_t* lowest = element_at(elements, stride, hull[*start]);
+        if(point->ycoord < lowest->ycoord || (point->ycoord == lowest->ycoord && point->xcoord < lowest->xcoord))
+            *start = i;
+    }
+    CG_PHASE_LAP(timer, CG_PHASE_SCAN);
+    return hull_size;
+}
 
+
+/**
+ * Function that computes the convex hull of a point array with Andrew's monotone chain algorithm.
+ * Points are sorted by x (then y), exact duplicates are dropped, and the lower and upper hulls
+ * are built with a stack each. The hull is appended to output_array counter-clockwise, starting
+ * from the lowest point (smallest y, then smallest x), the same order as compute_graham_scan.
+ * @ingroup chull
+ * @param input_array Point array for which to find the convex hull.
+ * @param output_array Initialized point array the hull is appended to.
+ * @param compute_type CG_W_DEGENERACY drops points lying on hull edges, CG_NO_DEGENERACY keeps them.
+ * @return INVALID_INPUT if either array is NULL, POINTS_TOO_FEW for less than 3 points,
+ *      NO_MEMORY if scratch space cannot be allocated, otherwise SUCCESS.
+ */
+CGError_t compute_monotone_chain(const CGPointArray_t* input_array, CGPointArray_t* output_array, CGCompute_t compute_type){
+    if(input_array == NULL || output_array == NULL)
+        return CG_INVALID_INPUT;
+    else if(input_array->num_points < 3)
+        return CG_POINTS_TOO_FEW;
+
+    size_t num_points = input_array->num_points;
+    CGCoord_t* sorted = (CGCoord_t*) cg_malloc(num_points * sizeof(CGCoord_t));
+    size_t* hull = (size_t*) cg_malloc((2 * num_points + 1) * sizeof(size_t));
+    if(sorted == NULL || hull == NULL){
+        cg_free(sorted);
+        cg_free(hull);
+        return CG_NO_MEMORY;
+    }
+
+    size_t i;
+    size_t num_candidates = gather_hull_candidates(input_array->xcoords, input_array->ycoords, num_points, sorted);
+    size_t start;
+    size_t hull_size = monotone_chain_positions((unsigned char*) sorted, sizeof(CGCoord_t), num_candidates, hull, &start, compute_type);
+
+    CGError_t status = reserve_point_array(output_array, output_array->num_points + hull_size);
+    for(i = 0; i < hull_size && status == CG_SUCCESS; i++){
+        const CGCoord_t* point = &sorted[hull[(start + i) % hull_size]];
+        status = add_coords_to_array(output_array, point->xcoord, point->ycoord);
+    }
+
+    cg_free(sorted);
+    cg_free(hull);
     return status;
 }
 
 
 /**
- * Function that switches on all of the convex hull functions.
+ * Function that computes the convex hull of the points of a view with Andrew's monotone chain
+ * algorithm. Only indices are produced: the hull is appended to output_view as indices into the
+ * shared array, in the order compute_monotone_chain would write the points.
  * @ingroup chull
- * @param point_set Initialized point set to perform convex hull on.
- * @param output_set Unallocated pointer to point set, where computed hull will be placed.
- * @param convex_hull_method Which convex hull algorithm to perform
- * @param compute_type Toggle for computing with or without degeneracy
- * @return UNIMPLEMENTED if invalid chull method, INVALID_INPUT if failure, SUCCESS otherwise
+ * @param input_view View of the points for which to find the convex hull.
+ * @param output_view View of the same point array the hull indices are appended to.
+ * @param compute_type CG_W_DEGENERACY drops points lying on hull edges, CG_NO_DEGENERACY keeps them.
+ * @return INVALID_INPUT if either view is NULL or they view different arrays, POINTS_TOO_FEW for
+ *      less than 3 points, NO_MEMORY if scratch space cannot be allocated, otherwise SUCCESS.
+ */
+CGError_t compute_monotone_chain_view(const CGPointView_t* input_view, CGPointView_t* output_view, CGCompute_t compute_type){
+    if(input_view == NULL || output_view == NULL || input_view->points->xcoords != output_view->points->xcoords)
+        return CG_INVALID_INPUT;
+    else if(input_view->num_indices < 3)
+        return CG_POINTS_TOO_FEW;
+
+    size_t num_points = input_view->num_indices;
+    const CGPointArray_t* points = input_view->points;
+    CGIndexedCoord_t* sorted = (CGIndexedCoord_t*) cg_malloc(num_points * sizeof(CGIndexedCoord_t));
+    size_t* hull = (size_t*) cg_malloc((2 * num_points + 1) * sizeof(size_t));
+    if(sorted == NULL || hull == NULL){
+        cg_free(sorted);
+        cg_free(hull);
+        return CG_NO_MEMORY;
+    }
+
+    size_t i;
+    for(i = 0; i < num_points; i++){
+        size_t index = input_view->indices[i];
+        sorted[i].coord.xcoord = points->xcoords[index];
+        sorted[i].coord.ycoord = points->ycoords[index];
+        sorted[i].index = index;
+    }
+    size_t start;
+    size_t hull_size = monotone_chain_positions((unsigned char*) sorted, sizeof(CGIndexedCoord_t), num_points, hull, &start, compute_type);
+
+    CGError_t status = CG_SUCCESS;
+    size_t* indices = (size_t*) cg_realloc(output_view->indices, (output_view->num_indices + hull_size + 1) * sizeof(size_t));
+    if(indices == NULL)
+        status = CG_NO_MEMORY;
+    else{
+        output_view->indices = indices;
+        for(i = 0; i < hull_size; i++)
+            indices[output_view->num_indices++] = sorted[hull[(start + i) % hull_size]].index;
+    }
+
+    cg_free(sorted);
+    cg_free(hull);
+    return status;
+}
+
+
+/**
+ * Struct describing the slice of the input hulled by one task of compute_monotone_chain_ctx.
+ * @internal
+ */
+typedef struct CG_HullChunk {
+    const CGPointArray_t* input_array;  /**< Array the slice is taken from */
+    size_t begin;                       /**< Index of the first point of the slice */
+    size_t num_points;                  /**< Number of points in the slice */
+    CGCoord_t* coords;                  /**< Window of the shared buffer, receives the hull of the slice */
+    size_t hull_size;                   /**< Number of hull points written to coords */
+    CGCompute_t compute_type;           /**< Degeneracy handling */
+    CGProgress_t* progress;             /**< Progress of the whole hull, may be NULL */
+    CGError_t status;                   /**< Result of the task */
+} CGHullChunk_t;
+
+
+/**
+ * Task that replaces a slice of the points with its own hull. Every point on the hull of the
+ * whole input is on the hull of its slice, so only these points go on to the final pass.
+ * @internal
+ */
+static void hull_chunk_task(void* argument, size_t task_index, CGArena_t* arena){
+    CGHullChunk_t* chunk = (CGHullChunk_t*) argument + task_index;
+    if(chunk->progress != NULL && cg_atomic_load(&chunk->progress->cancelled)){
+        chunk->status = CG_CANCELLED;
+        return;
+    }
+    size_t num_points = chunk->num_points;
+    size_t* hull = (size_t*) cg_arena_alloc(arena, (2 * num_points + 1) * sizeof(size_t));
+    CGCoord_t* hull_coords = (CGCoord_t*) cg_arena_alloc(arena, num_points * sizeof(CGCoord_t));
+    if(hull == NULL || hull_coords == NULL){
+        chunk->status = CG_NO_MEMORY;
+        return;
+    }
+    size_t i;
+    size_t num_candidates = gather_hull_candidates(chunk->input_array->xcoords + chunk->begin,
+                                                   chunk->input_array->ycoords + chunk->begin, num_points, chunk->coords);
+    size_t start;
+    size_t hull_size = monotone_chain_positions((unsigned char*) chunk->coords, sizeof(CGCoord_t), num_candidates, hull, &start, chunk->compute_type);
+    for(i = 0; i < hull_size; i++)
+        hull_coords[i] = chunk->coords[hull[i]];
+    memcpy(chunk->coords, hull_coords, hull_size * sizeof(CGCoord_t));
+    chunk->hull_size = hull_size;
+    chunk->status = CG_SUCCESS;
+    if(chunk->progress != NULL)
+        cg_atomic_increment(&chunk->progress->completed);
+}
+
+
+/**
+ * Function that computes the convex hull of a point array with Andrew's monotone chain algorithm
+ * on the worker pool of a context, see compute_monotone_chain_ctx. With a progress struct the
+ * input is cut into more slices than there are threads, each slice counts as a unit of progress,
+ * and cancellation is checked before every slice and before the final pass. The output array is
+ * only written once nothing can cancel the hull any more.
+ * @internal
+ * @param context Context providing the worker pool and scratch memory
+ * @param input_array Point array for which to find the convex hull.
+ * @param output_array Initialized point array the hull is appended to.
+ * @param compute_type Degeneracy handling
+ * @param progress Progress to report and cancellation flag to check, may be NULL
+ * @return As compute_monotone_chain_ctx, or CANCELLED if cancellation was requested.
+ */
+CGError_t cg_monotone_chain_ctx(CGContext_t* context, const CGPointArray_t* input_array, CGPointArray_t* output_array,
+                                CGCompute_t compute_type, CGProgress_t* progress){
+    if(context == NULL || input_array == NULL || output_array == NULL)
+        return CG_INVALID_INPUT;
+    else if(input_array->num_points < 3)
+        return CG_POINTS_TOO_FEW;
+
+    size_t num_points = input_array->num_points;
+    size_t num_chunks = cg_context_point_tasks(context, num_points, progress != NULL ? 8 : 1);
+    if(progress != NULL)
+        cg_atomic_store(&progress->total, num_chunks + 1);
+    CGArena_t* arena = cg_context_acquire_arena(context);
+    CGCoord_t* coords = (CGCoord_t*) cg_arena_alloc(arena, num_points * sizeof(CGCoord_t));
+    CGHullChunk_t* chunks = (CGHullChunk_t*) cg_arena_alloc(arena, num_chunks * sizeof(CGHullChunk_t));
+    if(coords == NULL || chunks == NULL){
+        cg_context_release_arena(context, arena);
+        return CG_NO_MEMORY;
+    }
+
+    CGError_t status = CG_SUCCESS;
+    size_t i, num_candidates = 0;
+    if(num_chunks == 1){
+        num_candidates = gather_hull_candidates(input_array->xcoords, input_array->ycoords, num_points, coords);
+        if(progress != NULL)
+            cg_atomic_increment(&progress->completed);
+    }
+    else{
+        for(i = 0; i < num_chunks; i++){
+            chunks[i].input_array = input_array;
+            chunks[i].begin = num_points / num_chunks * i;
+            chunks[i].num_points = (i == num_chunks - 1 ? num_points : num_points / num_chunks * (i + 1)) - chunks[i].begin;
+            chunks[i].coords = coords + chunks[i].begin;
+            chunks[i].compute_type = compute_type;
+            chunks[i].progress = progress;
+            chunks[i].status = CG_NO_MEMORY;
+        }
+        cg_context_parallel_for(context, num_chunks, hull_chunk_task, chunks);
+        // gather the slice hulls at the front of the buffer
+        for(i = 0; i < num_chunks && status == CG_SUCCESS; i++){
+            status = chunks[i].status;
+            memmove(coords + num_candidates, chunks[i].coords, chunks[i].hull_size * sizeof(CGCoord_t));
+            num_candidates += chunks[i].hull_size;
+        }
+    }
+
+    size_t* hull = (size_t*) cg_arena_alloc(arena, (2 * num_candidates + 1) * sizeof(size_t));
+    if(status == CG_SUCCESS && hull == NULL)
+        status = CG_NO_MEMORY;
+    if(status == CG_SUCCESS && progress != NULL && cg_atomic_load(&progress->cancelled))
+        status = CG_CANCELLED;
+    if(status == CG_SUCCESS){
+        size_t start;
+        size_t hull_size = monotone_chain_positions((unsigned char*) coords, sizeof(CGCoord_t), num_candidates, hull, &start, compute_type);
+        status = reserve_point_array(output_array, output_array->num_points + hull_size);
+        for(i = 0; i < hull_size && status == CG_SUCCESS; i++){
+            const CGCoord_t* point = &coords[hull[(start + i) % hull_size]];
+            status = add_coords_to_array(output_array, point->xcoord, point->ycoord);
+        }
+        if(progress != NULL)
+            cg_atomic_increment(&progress->completed);
+    }
+
+    cg_context_release_arena(context, arena);
+    return status;
+}
+
+
+/**
+ * Function that computes the convex hull of a point array with Andrew's monotone chain algorithm
+ * on the worker pool of a context. Above the context's threshold the input is split into slices
+ * that are hulled in parallel, and the hull of the slice hulls is the hull of the input. Scratch
+ * memory comes from the context's arenas. The output is identical to compute_monotone_chain.
+ * @ingroup chull
+ * @param context Context providing the worker pool and scratch memory
+ * @param input_array Point array for which to find the convex hull.
+ * @param output_array Initialized point array the hull is appended to.
+ * @param compute_type CG_W_DEGENERACY drops points lying on hull edges, CG_NO_DEGENERACY keeps them.
+ * @return INVALID_INPUT if a param is NULL, POINTS_TOO_FEW for less than 3 points,
+ *      NO_MEMORY if scratch space cannot be allocated, otherwise SUCCESS.
+ */
+CGError_t compute_monotone_chain_ctx(CGContext_t* context, const CGPointArray_t* input_array, CGPointArray_t* output_array, CGCompute_t compute_type){
+    return cg_monotone_chain_ctx(context, input_array, output_array, compute_type, NULL);
+}
+
+
+/**
+ * Function that merges a batch of points into a running hull. The hull is appended to the batch
+ * and the hull of the combined points replaces it; until 3 points have been seen they are all kept.
+ * Used by the algorithms that consume points one block at a time.
+ * @internal
+ * @param batch New points, the running hull is appended to it
+ * @param hull Running hull, swapped with scratch on success
+ * @param scratch Array reused to build the new hull
+ * @param compute_type Degeneracy handling passed to compute_monotone_chain
+ * @return NO_MEMORY if an array cannot be grown, otherwise SUCCESS.
+ */
+CGError_t cg_merge_hull_batch(CGPointArray_t* batch, CGPointArray_t** hull, CGPointArray_t** scratch, CGCompute_t compute_type){
+    size_t i;
+    CGError_t status = reserve_point_array(batch, batch->num_points + (*hull)->num_points);
+    for(i = 0; status == CG_SUCCESS && i < (*hull)->num_points; i++)
+        status = add_coords_to_array(batch, (*hull)->xcoords[i], (*hull)->ycoords[i]);
+    if(status != CG_SUCCESS)
+        return status;
+    (*scratch)->num_points = 0;
+    if(batch->num_points < 3){
+        // not enough points for a hull yet, carry them all over
+        for(i = 0; status == CG_SUCCESS && i < batch->num_points; i++)
+            status = add_coords_to_array(*scratch, batch->xcoords[i], batch->ycoords[i]);
+    }
+    else
+        status = compute_monotone_chain(batch, *scratch, compute_type);
+    if(status != CG_SUCCESS)
+        return status;
+    CGPointArray_t* temp = *hull;
+    *hull = *scratch;
+    *scratch = temp;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that computes the final hull from the merged hulls of the blocks of a block-wise algorithm.
+ * Points that are collinear or identical leave hulls of fewer than 3 points, which compute_monotone_chain
+ * would reject, so these are padded with copies of one of their points first. Duplicates do not change
+ * the hull, so the result is the one compute_monotone_chain gives on all the points at once.
+ * @internal
+ * @param merged Points of the merged hulls, may be padded
+ * @param num_points Number of points the blocks held together
+ * @param output_array Array the hull is appended to
+ * @param compute_type Degeneracy handling passed to compute_monotone_chain
+ * @return POINTS_TOO_FEW if the blocks held less than 3 points, NO_MEMORY if an array cannot be grown,
+ *      otherwise SUCCESS.
+ */
+CGError_t cg_finish_merged_hull(CGPointArray_t* merged, size_t num_points, CGPointArray_t* output_array, CGCompute_t compute_type){
+    if(num_points < 3 || merged->num_points == 0)
+        return CG_POINTS_TOO_FEW;
+    CGError_t status = CG_SUCCESS;
+    while(status == CG_SUCCESS && merged->num_points < 3)
+        status = add_coords_to_array(merged, merged->xcoords[0], merged->ycoords[0]);
+    if(status != CG_SUCCESS)
+        return status;
+    return compute_monotone_chain(merged, output_array, compute_type);
+}
+
+
+/**
+ * Helper computing the monotone chain hull of a point set through point arrays, on the context's
+ * pool if one is given. On a context the copy of the input is taken from its scratch memory.
+ * @internal
  */
-CGError_t compute_convex_hull(CGPointSet_t* point_set, CGPointSet_t* output_set, CGConvexHull_t convex_hull_method, CGCompute_t compute_type){
+static CGError_t monotone_chain_point_set(CGContext_t* context, const CGPointSet_t* point_set, CGPointSet_t* output_set,
+                                          CGCompute_t compute_type, CGProgress_t* progress){
+    if(point_set == NULL || output_set == NULL)
+        return CG_INVALID_INPUT;
     CGError_t status;
+    CGArena_t* arena = NULL;
+    CGPointArray_t scratch_array = {NULL, NULL, 0, 0, NULL};
+    CGPointArray_t* input_array = &scratch_array;
+    if(context != NULL){
+        arena = cg_context_acquire_arena(context);
+        size_t allocated = point_set->num_points ? point_set->num_points : 1;
+        scratch_array.xcoords = (double*) cg_arena_alloc(arena, allocated * sizeof(double));
+        scratch_array.ycoords = (double*) cg_arena_alloc(arena, allocated * sizeof(double));
+        scratch_array.capacity = point_set->num_points;
+        if(scratch_array.xcoords == NULL || scratch_array.ycoords == NULL)
+            input_array = NULL;
+    }
+    else
+        input_array = init_point_array(point_set->num_points);
+    CGPointArray_t* output_array = init_point_array(0);
+    if(input_array == NULL || output_array == NULL)
+        status = CG_NO_MEMORY;
+    else
+        status = point_array_from_point_set(point_set, input_array);
+    if(status == CG_SUCCESS && context != NULL)
+        status = cg_monotone_chain_ctx(context, input_array, output_array, compute_type, progress);
+    else if(status == CG_SUCCESS)
+        status = compute_monotone_chain(input_array, output_array, compute_type);
+    if(status == CG_SUCCESS)
+        status = point_set_from_point_array(output_array, output_set);
+    if(context != NULL)
+        cg_context_release_arena(context, arena);
+    else
+        free_point_array(input_array);
+    free_point_array(output_array);
+    return status;
+}
+
+
+/**
+ * Helper that runs the requested hull algorithm, without looking at the set's hull cache.
+ * @internal
+ */
+static CGError_t convex_hull_uncached(const CGPointSet_t* point_set, CGPointSet_t* output_set, CGConvexHull_t convex_hull_method, CGCompute_t compute_type){
     switch(convex_hull_method){
         case CG_GRAHAM_SCAN:
-            status = compute_graham_scan(point_set, output_set, compute_type);
-            break;
+            return compute_graham_scan(point_set, output_set, compute_type);
+        case CG_MONOTONE_CHAIN:
+            return monotone_chain_point_set(NULL, point_set, output_set, compute_type, NULL);
         default:
             return CG_UNIMPLEMENTED;
     }
+}
+
+
+//----------------------------------------------------------------
+// Functions - Hull caches
+//----------------------------------------------------------------
+
+
+/**
+ * Struct holding the last hull computed for a point set.
+ * @internal
+ */
+struct CG_HullCache {
+    CGMutex_t lock;                     /**< Serializes hulls of the set, which may be shared between threads */
+    CGPointArray_t* hull;               /**< Cached hull, NULL if there is none */
+    CGConvexHull_t convex_hull_method;  /**< Algorithm the hull was computed with */
+    CGCompute_t compute_type;           /**< Degeneracy handling the hull was computed with */
+    int num_covered;                    /**< Number of points of the set the hull accounts for */
+    const CGPointNode_t* last_covered;  /**< Last node of the set the hull accounts for */
+};
+
+
+/**
+ * Function that makes compute_convex_hull cache the hull of a point set. While only points are
+ * appended, a repeated hull with the same settings copies the cached one, and after appends the
+ * hull is recomputed from the cached hull and the new points only. Callers that change points
+ * of the set in place must call invalidate_hull_cache.
+ * @ingroup chull
+ * @param point_set Initialized point set
+ * @return INVALID_INPUT if point_set is NULL, NO_MEMORY if allocation fails, otherwise SUCCESS.
+ */
+CGError_t enable_hull_cache(CGPointSet_t* point_set){
+    if(point_set == NULL)
+        return CG_INVALID_INPUT;
+    else if(point_set->hull_cache != NULL)
+        return CG_SUCCESS;
+    struct CG_HullCache* hull_cache = (struct CG_HullCache*) cg_calloc(1, sizeof(struct CG_HullCache));
+    if(hull_cache == NULL)
+        return CG_NO_MEMORY;
+    if(cg_mutex_init(&hull_cache->lock) != CG_SUCCESS){
+        cg_free(hull_cache);
+        return CG_NO_MEMORY;
+    }
+    point_set->hull_cache = hull_cache;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that drops the cached hull of a point set, so the next hull is computed from scratch.
+ * @ingroup chull
+ * @param point_set Initialized point set
+ * @return INVALID_INPUT if point_set is NULL, otherwise SUCCESS.
+ */
+CGError_t invalidate_hull_cache(CGPointSet_t* point_set){
+    if(point_set == NULL)
+        return CG_INVALID_INPUT;
+    struct CG_HullCache* hull_cache = point_set->hull_cache;
+    if(hull_cache != NULL){
+        cg_mutex_lock(&hull_cache->lock);
+        free_point_array(hull_cache->hull);
+        hull_cache->hull = NULL;
+        cg_mutex_unlock(&hull_cache->lock);
+    }
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that frees a hull cache, called when its point set is freed.
+ * @internal
+ * @param hull_cache Cache to free, may be NULL
+ */
+void cg_free_hull_cache(struct CG_HullCache* hull_cache){
+    if(hull_cache == NULL)
+        return;
+    free_point_array(hull_cache->hull);
+    cg_mutex_destroy(&hull_cache->lock);
+    cg_free(hull_cache);
+}
+
+
+/**
+ * Helper that brings the cached hull of a set up to date. Points appended since the hull was
+ * computed are hulled together with the cached hull, which gives the hull of the whole set.
+ * Called with the cache locked.
+ * @internal
+ */
+static CGError_t update_hull_cache(const CGPointSet_t* point_set, struct CG_HullCache* hull_cache,
+                                   CGConvexHull_t convex_hull_method, CGCompute_t compute_type){
+    const CGPointNode_t* first_new = point_set->head;
+    CGPointSet_t* candidates = NULL;
+    int num_new = point_set->num_points;
+    if(hull_cache->hull != NULL && hull_cache->convex_hull_method == convex_hull_method &&
+       hull_cache->compute_type == compute_type && hull_cache->last_covered != NULL){
+        if(hull_cache->num_covered == point_set->num_points)
+            return CG_SUCCESS;
+        first_new = hull_cache->last_covered->next;
+        num_new = point_set->num_points - hull_cache->num_covered;
+        candidates = init_point_set();
+        if(candidates == NULL)
+            return CG_NO_MEMORY;
+        point_set_from_point_array(hull_cache->hull, candidates);
+    }
+
+    CGError_t status = CG_SUCCESS;
+    CGPointSet_t* hull_set = init_point_set();
+    if(hull_set == NULL)
+        status = CG_NO_MEMORY;
+    else if(candidates == NULL)
+        status = convex_hull_uncached(point_set, hull_set, convex_hull_method, compute_type);
+    else{
+        // only appends are tracked, anything else makes the new point count disagree
+        const CGPointNode_t* current_node = first_new;
+        int num_seen = 0;
+        for(; current_node != NULL && status == CG_SUCCESS; current_node = current_node->next, num_seen++)
+            status = add_coords_to_set(candidates, current_node->point->xcoord, current_node->point->ycoord);
+        if(status == CG_SUCCESS && num_seen != num_new)
+            status = convex_hull_uncached(point_set, hull_set, convex_hull_method, compute_type);
+        else if(status == CG_SUCCESS)
+            status = convex_hull_uncached(candidates, hull_set, convex_hull_method, compute_type);
+    }
+
+    if(status == CG_SUCCESS){
+        CGPointArray_t* hull = init_point_array((size_t) hull_set->num_points);
+        status = (hull == NULL) ? CG_NO_MEMORY : point_array_from_point_set(hull_set, hull);
+        if(status == CG_SUCCESS){
+            free_point_array(hull_cache->hull);
+            hull_cache->hull = hull;
+            hull_cache->convex_hull_method = convex_hull_method;
+            hull_cache->compute_type = compute_type;
+            hull_cache->num_covered = point_set->num_points;
+            hull_cache->last_covered = point_set->tail;
+        }
+        else
+            free_point_array(hull);
+    }
+    if(candidates != NULL)
+        free_point_set(candidates);
+    if(hull_set != NULL)
+        free_point_set(hull_set);
     return status;
 }
+
+
+/**
+ * Function that switches on all of the convex hull functions. Sets with a hull cache (see
+ * enable_hull_cache) reuse or update their cached hull instead of starting over.
+ * @ingroup chull
+ * @param point_set Initialized point set to perform convex hull on.
+ * @param output_set Unallocated pointer to point set, where computed hull will be placed.
+ * @param convex_hull_method Which convex hull algorithm to perform
+ * @param compute_type Toggle for computing with or without degeneracy
+ * @return UNIMPLEMENTED if invalid chull method, INVALID_INPUT if failure, SUCCESS otherwise
+ */
+CGError_t compute_convex_hull(const CGPointSet_t* point_set, CGPointSet_t* output_set, CGConvexHull_t convex_hull_method, CGCompute_t compute_type){
+    if(point_set == NULL || output_set == NULL || point_set->hull_cache == NULL || point_set->num_points < 3)
+        return convex_hull_uncached(point_set, output_set, convex_hull_method, compute_type);
+    else if(convex_hull_method != CG_GRAHAM_SCAN && convex_hull_method != CG_MONOTONE_CHAIN)
+        return CG_UNIMPLEMENTED;
+
+    struct CG_HullCache* hull_cache = point_set->hull_cache;
+    cg_mutex_lock(&hull_cache->lock);
+    CGError_t status = update_hull_cache(point_set, hull_cache, convex_hull_method, compute_type);
+    if(status == CG_SUCCESS)
+        status = point_set_from_point_array(hull_cache->hull, output_set);
+    cg_mutex_unlock(&hull_cache->lock);
+    return status;
+}
+
+
+/**
+ * Function that switches on all of the convex hull functions on the worker pool of a context,
+ * see compute_convex_hull_ctx. Algorithms without parallel slices report a single unit of
+ * progress and can only be cancelled before they start.
+ * @internal
+ * @param context Context providing the worker pool and scratch memory
+ * @param point_set Initialized point set to perform convex hull on.
+ * @param output_set Initialized point set the hull is appended to.
+ * @param convex_hull_method Which convex hull algorithm to perform
+ * @param compute_type Toggle for computing with or without degeneracy
+ * @param progress Progress to report and cancellation flag to check, may be NULL
+ * @return As compute_convex_hull_ctx, or CANCELLED if cancellation was requested.
+ */
+CGError_t cg_convex_hull_ctx(CGContext_t* context, const CGPointSet_t* point_set, CGPointSet_t* output_set,
+                             CGConvexHull_t convex_hull_method, CGCompute_t compute_type, CGProgress_t* progress){
+    if(context == NULL)
+        return CG_INVALID_INPUT;
+    else if(convex_hull_method == CG_MONOTONE_CHAIN)
+        return monotone_chain_point_set(context, point_set, output_set, compute_type, progress);
+    if(progress != NULL){
+        cg_atomic_store(&progress->total, 1);
+        if(cg_atomic_load(&progress->cancelled))
+            return CG_CANCELLED;
+    }
+    CGError_t status = compute_convex_hull(point_set, output_set, convex_hull_method, compute_type);
+    if(progress != NULL)
+        cg_atomic_increment(&progress->completed);
+    return status;
+}
+
+
+/**
+ * Function that switches on all of the convex hull functions, running them on the worker pool of
+ * a context where the algorithm supports it. The Graham scan always runs on the calling thread.
+ * @ingroup chull
+ * @param context Context providing the worker pool and scratch memory
+ * @param point_set Initialized point set to perform convex hull on.
+ * @param output_set Initialized point set the hull is appended to.
+ * @param convex_hull_method Which convex hull algorithm to perform
+ * @param compute_type Toggle for computing with or without degeneracy
+ * @return UNIMPLEMENTED if invalid chull method, INVALID_INPUT if failure, SUCCESS otherwise
+ */
+CGError_t compute_convex_hull_ctx(CGContext_t* context, const CGPointSet_t* point_set, CGPointSet_t* output_set,
+                                  CGConvexHull_t convex_hull_method, CGCompute_t compute_type){
+    return cg_convex_hull_ctx(context, point_set, output_set, convex_hull_method, compute_type, NULL);
+}
@@ -0,0 +1,425 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing the bulk .csv loaders. Unlike point_set_from_csv_file, these scan the
+ * file contents in place and write straight into a contiguous point array, without allocating
+ * anything per line. Newlines and commas are located 64 bytes at a time as bitmaps (in the style
+ * of simdjson), and numbers are converted with the parser in fast_float.c.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+// Number of bytes classified at once by the structural scanner
+#define STRUCTURAL_BLOCK 64
+
+// Number of bytes whose structural offsets are collected before parsing lines
+#define STRUCTURAL_WINDOW 4096
+
+// Smallest chunk of a file worth handing to a separate thread
+#define PARALLEL_MIN_CHUNK (1 << 16)
+
+
+/**
+ * Struct describing the part of a mapped file parsed by one task of the parallel loader.
+ * @internal
+ */
+typedef struct CG_CsvChunk {
+    const char* begin;          /**< First byte of the chunk, always at the start of a line */
+    const char* end;            /**< One past the last byte of the chunk */
+    size_t num_lines;           /**< Number of lines in the chunk, an upper bound on its points */
+    CGPointArray_t points;      /**< Window of the output array the chunk is parsed into */
+} CGCsvChunk_t;
+
+
+//----------------------------------------------------------------
+// Functions - Structural scanning
+//----------------------------------------------------------------
+
+
+/**
+ * Function that classifies a 64-byte block, setting bit i of newlines / commas when byte i of
+ * the block is a newline / comma. Uses the widest compares the processor has, see cg_kernels.
+ * @internal
+ * @param block Pointer to 64 readable bytes
+ * @param newlines Output bitmap of newline positions
+ * @param commas Output bitmap of comma positions
+ */
+void cg_find_structurals(const char* block, uint64_t* newlines, uint64_t* commas){
+    cg_kernels()->find_structurals(block, newlines, commas);
+}
+
+
+/**
+ * Helper that classifies a block of fewer than 64 bytes by padding it into a local buffer.
+ * @internal
+ */
+static void find_structurals_partial(const CGKernels_t* kernels, const char* block, size_t length, uint64_t* newlines, uint64_t* commas){
+    char padded[STRUCTURAL_BLOCK];
+    memset(padded, ' ', STRUCTURAL_BLOCK);
+    memcpy(padded, block, length);
+    kernels->find_structurals(padded, newlines, commas);
+}
+
+
+/**
+ * Function that counts the number of lines in a buffer, including a final unterminated line.
+ * Used to size the output array before parsing.
+ * @internal
+ * @param begin Start of the buffer
+ * @param end One past the end of the buffer
+ * @return Number of lines in the buffer
+ */
+size_t cg_count_csv_lines(const char* begin, const char* end){
+    size_t num_lines = 0;
+    size_t length = (size_t) (end - begin);
+    size_t offset;
+    uint64_t newlines, commas;
+    const CGKernels_t* kernels = cg_kernels();
+    for(offset = 0; offset + STRUCTURAL_BLOCK <= length; offset += STRUCTURAL_BLOCK){
+        kernels->find_structurals(begin + offset, &newlines, &commas);
+        num_lines += (size_t) cg_popcount64(newlines);
+    }
+    if(offset < length){
+        find_structurals_partial(kernels, begin + offset, length - offset, &newlines, &commas);
+        num_lines += (size_t) cg_popcount64(newlines);
+    }
+    if(length > 0 && end[-1] != '\n')
+        num_lines++;
+    return num_lines;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Line parsing
+//----------------------------------------------------------------
+
+
+/**
+ * Helper that skips spaces, tabs and carriage returns.
+ * @internal
+ */
+static inline const char* skip_blanks(const char* p, const char* end){
+    while(p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    return p;
+}
+
+
+/**
+ * Helper that parses a field that must contain exactly one number, surrounded by optional blanks.
+ * @internal
+ * @return 1 if the field is a valid number, otherwise 0
+ */
+static inline int parse_field(const char* begin, const char* end, double* value){
+    const char* p = cg_parse_double(skip_blanks(begin, end), end, value);
+    return p != NULL && skip_blanks(p, end) == end;
+}
+
+
+/**
+ * Helper that parses one line given the location of its comma, appending the point if valid.
+ * @internal
+ */
+static inline CGError_t parse_line(const char* begin, const char* comma, int num_commas, const char* end,
+                                   CGPointArray_t* point_array){
+    double xcoord, ycoord;
+    if(num_commas != 1 || !parse_field(begin, comma, &xcoord) || !parse_field(comma + 1, end, &ycoord))
+        return CG_SUCCESS;
+    if(point_array->num_points < point_array->capacity){
+        point_array->xcoords[point_array->num_points] = xcoord;
+        point_array->ycoords[point_array->num_points] = ycoord;
+        point_array->num_points++;
+        return CG_SUCCESS;
+    }
+    return add_coords_to_array(point_array, xcoord, ycoord);
+}
+
+
+/**
+ * Function that parses "x,y" lines from a buffer and appends the points to a point array, stopping
+ * early once the array holds max_points points. Lines that do not contain exactly two numeric
+ * fields (blank lines, headers) are skipped.
+ *
+ * The buffer is processed in windows: first the positions of all newlines and commas in the
+ * window are collected from the structural bitmaps, then lines are parsed between them. Line
+ * state carries over between windows, so lines may straddle window boundaries.
+ * @internal
+ * @param begin Start of the buffer
+ * @param end One past the end of the buffer. A final line without a newline is parsed too.
+ * @param point_array Initialized point array. Should be reserved in advance to avoid growing.
+ * @param max_points Number of points in point_array at which parsing stops
+ * @param resume If not NULL, receives the start of the first line that was not parsed
+ * @return NO_MEMORY if the array had to grow and could not, otherwise SUCCESS.
+ */
+CGError_t cg_parse_csv_lines(const char* begin, const char* end, CGPointArray_t* point_array,
+                             size_t max_points, const char** resume){
+    uint16_t structurals[STRUCTURAL_WINDOW];
+    const char* line_start = begin;
+    const char* comma = NULL;
+    int num_commas = 0;
+    const char* window = begin;
+    const CGKernels_t* kernels = cg_kernels();
+
+    if(resume != NULL)
+        *resume = end;
+    if(point_array->num_points >= max_points){
+        if(resume != NULL)
+            *resume = begin;
+        return CG_SUCCESS;
+    }
+
+    while(window < end){
+        size_t window_length = (size_t) (end - window);
+        if(window_length > STRUCTURAL_WINDOW)
+            window_length = STRUCTURAL_WINDOW;
+
+        // stage 1: collect structural character offsets within the window
+        size_t num_structurals = 0;
+        size_t offset;
+        for(offset = 0; offset < window_length; offset += STRUCTURAL_BLOCK){
+            uint64_t newlines, commas;
+            if(window_length - offset >= STRUCTURAL_BLOCK)
+                kernels->find_structurals(window + offset, &newlines, &commas);
+            else
+                find_structurals_partial(kernels, window + offset, window_length - offset, &newlines, &commas);
+            uint64_t structural_mask = newlines | commas;
+            while(structural_mask != 0){
+                structurals[num_structurals++] = (uint16_t) (offset + cg_ctz64(structural_mask));
+                structural_mask &= structural_mask - 1;
+            }
+        }
+
+        // stage 2: walk the structurals and parse complete lines
+        size_t i;
+        for(i = 0; i < num_structurals; i++){
+            const char* structural = window + structurals[i];
+            if(*structural == ','){
+                if(num_commas == 0)
+                    comma = structural;
+                num_commas++;
+            }
+            else{
+                if(parse_line(line_start, comma, num_commas, structural, point_array) != CG_SUCCESS)
+                    return CG_NO_MEMORY;
+                line_start = structural + 1;
+                num_commas = 0;
+                if(point_array->num_points >= max_points){
+                    if(resume != NULL)
+                        *resume = line_start;
+                    return CG_SUCCESS;
+                }
+            }
+        }
+        window += window_length;
+    }
+
+    if(line_start < end && parse_line(line_start, comma, num_commas, end, point_array) != CG_SUCCESS)
+        return CG_NO_MEMORY;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that parses every "x,y" line in a buffer and appends the points to a point array.
+ * @internal
+ * @param begin Start of the buffer
+ * @param end One past the end of the buffer
+ * @param point_array Initialized point array. Should be reserved in advance to avoid growing.
+ * @return NO_MEMORY if the array had to grow and could not, otherwise SUCCESS.
+ */
+CGError_t cg_parse_csv_block(const char* begin, const char* end, CGPointArray_t* point_array){
+    CG_PHASE_START(timer);
+    CGError_t status = cg_parse_csv_lines(begin, end, point_array, SIZE_MAX, NULL);
+    CG_PHASE_LAP(timer, CG_PHASE_PARSE);
+    return status;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Bulk loaders
+//----------------------------------------------------------------
+
+
+/**
+ * Function that reads point information from a comma separated values file given by path.
+ * The file is memory-mapped and parsed in place; the point array is grown once up front
+ * to the number of lines in the file, so no memory is allocated per line.
+ * @ingroup file
+ * @param point_array Initialized point array into which the points are appended.
+ * @param file_path Path to the .csv file
+ * @return NO_FILE if the file cannot be mapped, NO_MEMORY if the array cannot be grown, otherwise SUCCESS.
+ */
+CGError_t point_array_from_csv_path(CGPointArray_t* point_array, const char* file_path){
+    if(point_array == NULL || file_path == NULL)
+        return CG_INVALID_INPUT;
+
+    CGFileMap_t file_map;
+    CGError_t status = cg_map_file(file_path, &file_map);
+    if(status != CG_SUCCESS || file_map.data == NULL)
+        return status;
+
+    const char* end = file_map.data + file_map.size;
+    size_t num_lines = cg_count_csv_lines(file_map.data, end);
+    status = reserve_point_array(point_array, point_array->num_points + num_lines);
+    if(status == CG_SUCCESS)
+        status = cg_parse_csv_block(file_map.data, end, point_array);
+
+    cg_unmap_file(&file_map);
+    return status;
+}
+
+
+/**
+ * Task that counts the lines of one chunk of a mapped file.
+ * @internal
+ */
+static void count_csv_chunk(void* argument, size_t task_index, CGArena_t* arena){
+    (void) arena;
+    CGCsvChunk_t* chunk = (CGCsvChunk_t*) argument + task_index;
+    chunk->num_lines = cg_count_csv_lines(chunk->begin, chunk->end);
+}
+
+
+/**
+ * Task that parses one chunk of a mapped file into its window of the output array. The window
+ * holds a point per line, so parsing never grows it.
+ * @internal
+ */
+static void parse_csv_chunk(void* argument, size_t task_index, CGArena_t* arena){
+    (void) arena;
+    CGCsvChunk_t* chunk = (CGCsvChunk_t*) argument + task_index;
+    cg_parse_csv_block(chunk->begin, chunk->end, &chunk->points);
+}
+
+
+/**
+ * Function that reads point information from a comma separated values file given by path,
+ * parsing it on the worker pool of a context. The mapped file is split at newline boundaries into
+ * chunks of at least the context's minimum size. Lines are counted per chunk, the array is grown
+ * once, and every chunk is parsed straight into its own window of the array; windows are closed
+ * up afterwards if invalid lines were skipped. The result is identical to point_array_from_csv_path.
+ * @ingroup file
+ * @param context Context providing the worker pool
+ * @param point_array Initialized point array into which the points are appended.
+ * @param file_path Path to the .csv file
+ * @return NO_FILE if the file cannot be mapped, NO_MEMORY if allocation fails, otherwise SUCCESS.
+ */
+CGError_t point_array_from_csv_path_ctx(CGContext_t* context, CGPointArray_t* point_array, const char* file_path){
+    if(context == NULL || point_array == NULL || file_path == NULL)
+        return CG_INVALID_INPUT;
+
+    CGFileMap_t file_map;
+    CGError_t status = cg_map_file(file_path, &file_map);
+    if(status != CG_SUCCESS || file_map.data == NULL)
+        return status;
+
+    size_t num_chunks = cg_context_byte_tasks(context, file_map.size);
+    CGArena_t* arena = cg_context_acquire_arena(context);
+    CGCsvChunk_t* chunks = (CGCsvChunk_t*) cg_arena_alloc(arena, num_chunks * sizeof(CGCsvChunk_t));
+    if(chunks == NULL){
+        cg_context_release_arena(context, arena);
+        cg_unmap_file(&file_map);
+        return CG_NO_MEMORY;
+    }
+
+    // split at the first newline after each evenly spaced offset
+    const char* end = file_map.data + file_map.size;
+    const char* chunk_begin = file_map.data;
+    size_t i;
+    for(i = 0; i < num_chunks; i++){
+        const char* chunk_end = end;
+        if(i < num_chunks - 1){
+            chunk_end = file_map.data + (file_map.size / num_chunks) * (i + 1);
+            if(chunk_end < chunk_begin)
+                chunk_end = chunk_begin;
+            const char* newline = (const char*) memchr(chunk_end, '\n', (size_t) (end - chunk_end));
+            chunk_end = (newline == NULL) ? end : newline + 1;
+        }
+        chunks[i].begin = chunk_begin;
+        chunks[i].end = chunk_end;
+        chunk_begin = chunk_end;
+    }
+
+    cg_context_parallel_for(context, num_chunks, count_csv_chunk, chunks);
+    size_t total_lines = 0;
+    for(i = 0; i < num_chunks; i++)
+        total_lines += chunks[i].num_lines;
+    status = reserve_point_array(point_array, point_array->num_points + total_lines);
+
+    if(status == CG_SUCCESS){
+        size_t offset = point_array->num_points;
+        for(i = 0; i < num_chunks; i++){
+            chunks[i].points.xcoords = point_array->xcoords + offset;
+            chunks[i].points.ycoords = point_array->ycoords + offset;
+            chunks[i].points.num_points = 0;
+            chunks[i].points.capacity = chunks[i].num_lines;
+            chunks[i].points.storage = NULL;
+            offset += chunks[i].num_lines;
+        }
+        cg_context_parallel_for(context, num_chunks, parse_csv_chunk, chunks);
+
+        // close the gaps left by lines that held no point
+        for(i = 0; i < num_chunks; i++){
+            size_t num_points = chunks[i].points.num_points;
+            double* xcoords = point_array->xcoords + point_array->num_points;
+            if(chunks[i].points.xcoords != xcoords){
+                memmove(xcoords, chunks[i].points.xcoords, num_points * sizeof(double));
+                memmove(point_array->ycoords + point_array->num_points, chunks[i].points.ycoords, num_points * sizeof(double));
+            }
+            point_array->num_points += num_points;
+        }
+    }
+
+    cg_context_release_arena(context, arena);
+    cg_unmap_file(&file_map);
+    return status;
+}
+
+
+/**
+ * Function that reads point information from a comma separated values file given by path,
+ * parsing it with several threads. Runs point_array_from_csv_path_ctx on a context created for
+ * the call; callers loading many files should keep a context instead.
+ * @ingroup file
+ * @param point_array Initialized point array into which the points are appended.
+ * @param file_path Path to the .csv file
+ * @param num_threads Number of threads to use. If less than 1, one thread per processor is used.
+ * @return NO_FILE if the file cannot be mapped, NO_MEMORY if allocation fails, otherwise SUCCESS.
+ */
+CGError_t point_array_from_csv_path_parallel(CGPointArray_t* point_array, const char* file_path, int num_threads){
+    if(point_array == NULL || file_path == NULL)
+        return CG_INVALID_INPUT;
+    CGContextOptions_t options;
+    memset(&options, 0, sizeof(options));
+    options.num_threads = num_threads;
+    options.parallel_min_bytes = PARALLEL_MIN_CHUNK;
+    CGContext_t* context = init_context(&options);
+    if(context == NULL)
+        return CG_NO_MEMORY;
+    CGError_t status = point_array_from_csv_path_ctx(context, point_array, file_path);
+    free_context(context);
+    return status;
+}
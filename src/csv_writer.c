@@ -0,0 +1,563 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing the buffered .csv writers. Points are formatted into a large buffer
+ * without going through printf, and the buffer is written out in large blocks.
+ *
+ * Two number formats are supported: the shortest representation that parses back to the same
+ * double (computed with the Ryu algorithm), and a fixed six decimal format that is byte for byte
+ * identical to printf's %lf.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+#include "ryu_tables.h"
+
+// Size of the output buffer of the writers
+#define WRITE_BUFFER_SIZE (1 << 20)
+
+// Room kept free in the buffer for one formatted point
+#define MAX_FORMATTED_POINT (2 * CG_MAX_FORMATTED_DOUBLE + 2)
+
+// IEEE 754 binary64 parameters
+#define DOUBLE_MANTISSA_BITS    52
+#define DOUBLE_EXPONENT_BITS    11
+#define DOUBLE_BIAS             1023
+
+// Largest decimal point position for which shortest output is written without an exponent
+#define MAX_FIXED_NOTATION      21
+#define MIN_FIXED_NOTATION      -5
+
+
+/** @internal Pairs of decimal digits 00 to 99 */
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+
+/**
+ * Struct holding the state of a buffered writer.
+ * @internal
+ */
+typedef struct CG_CsvWriter {
+    FILE* file;                 /**< File being written */
+    char* buffer;               /**< Output buffer of WRITE_BUFFER_SIZE bytes */
+    size_t used;                /**< Number of bytes in the buffer */
+    CGCsvFormat_t format;       /**< Number format */
+    CGError_t status;           /**< First write error encountered */
+} CGCsvWriter_t;
+
+
+//----------------------------------------------------------------
+// Functions - Integer formatting
+//----------------------------------------------------------------
+
+
+/** @internal Number of decimal digits of a value below 10^17 */
+static inline int decimal_length17(uint64_t value){
+    int length = 1;
+    while(value >= 10){
+        value /= 10;
+        length++;
+    }
+    return length;
+}
+
+
+/** @internal Writes value as exactly length decimal digits, zero padded */
+static inline void write_digits(uint64_t value, int length, char* out){
+    int position = length;
+    while(position >= 2){
+        uint32_t pair = (uint32_t) (value % 100);
+        value /= 100;
+        position -= 2;
+        memcpy(out + position, digit_pairs + 2 * pair, 2);
+    }
+    if(position == 1)
+        out[0] = (char) ('0' + value % 10);
+}
+
+
+/** @internal Writes value in decimal without padding, returns number of characters */
+static inline size_t write_uint64(uint64_t value, char* out){
+    int length = 1;
+    uint64_t remaining = value;
+    while(remaining >= 10){
+        remaining /= 10;
+        length++;
+    }
+    write_digits(value, length, out);
+    return (size_t) length;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Ryu shortest round-trip formatting
+//----------------------------------------------------------------
+
+
+/** @internal Returns e == 0 ? 1 : ceil(log2(5^e)) for 0 <= e <= 3528 */
+static inline int32_t pow5_bits(int32_t e){
+    return (int32_t) (((uint32_t) e * 1217359) >> 19) + 1;
+}
+
+
+/** @internal Returns floor(log10(2^e)) for 0 <= e <= 1650 */
+static inline uint32_t log10_pow2(int32_t e){
+    return ((uint32_t) e * 78913) >> 18;
+}
+
+
+/** @internal Returns floor(log10(5^e)) for 0 <= e <= 2620 */
+static inline uint32_t log10_pow5(int32_t e){
+    return ((uint32_t) e * 732923) >> 20;
+}
+
+
+/** @internal Returns the exponent of the largest power of five dividing value */
+static inline uint32_t pow5_factor(uint64_t value){
+    uint32_t count = 0;
+    while(value % 5 == 0){
+        value /= 5;
+        count++;
+    }
+    return count;
+}
+
+
+/** @internal Returns (m * mul) >> j for a 125-bit mul stored as (low, high) and 64 < j < 128 */
+static inline uint64_t mul_shift64(uint64_t m, const uint64_t* mul, int32_t j){
+    CGUint128_t low_product = cg_full_multiplication(m, mul[0]);
+    CGUint128_t high_product = cg_full_multiplication(m, mul[1]);
+    uint64_t sum_low = high_product.low + low_product.high;
+    uint64_t sum_high = high_product.high + (sum_low < high_product.low);
+    int shift = j - 64;
+    return (sum_high << (64 - shift)) | (sum_low >> shift);
+}
+
+
+/**
+ * Function that finds the shortest decimal mantissa and exponent that round-trip to the given
+ * finite, non-zero double, following Ulf Adams' Ryu algorithm.
+ * @internal
+ * @param ieee_mantissa Explicit mantissa bits of the double
+ * @param ieee_exponent Biased exponent bits of the double
+ * @param exponent Output decimal exponent
+ * @return Decimal mantissa
+ */
+static uint64_t shortest_decimal(uint64_t ieee_mantissa, uint32_t ieee_exponent, int32_t* exponent){
+    int32_t e2;
+    uint64_t m2;
+    if(ieee_exponent == 0){
+        e2 = 1 - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS - 2;
+        m2 = ieee_mantissa;
+    }
+    else{
+        e2 = (int32_t) ieee_exponent - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS - 2;
+        m2 = (((uint64_t) 1) << DOUBLE_MANTISSA_BITS) | ieee_mantissa;
+    }
+    const int accept_bounds = (m2 & 1) == 0;
+
+    // the interval of valid representations is [mm, mp] around mv, all scaled by 4
+    const uint64_t mv = 4 * m2;
+    const uint32_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+
+    uint64_t vr, vp, vm;
+    int32_t e10;
+    int vm_trailing_zeros = 0;
+    int vr_trailing_zeros = 0;
+    if(e2 >= 0){
+        const uint32_t q = log10_pow2(e2) - (e2 > 3);
+        e10 = (int32_t) q;
+        const int32_t k = CG_POW5_INV_BITCOUNT + pow5_bits((int32_t) q) - 1;
+        const int32_t i = -e2 + (int32_t) q + k;
+        vr = mul_shift64(4 * m2, cg_pow5_inv_split[q], i);
+        vp = mul_shift64(4 * m2 + 2, cg_pow5_inv_split[q], i);
+        vm = mul_shift64(4 * m2 - 1 - mm_shift, cg_pow5_inv_split[q], i);
+        if(q <= 21){
+            // only one of mp, mv and mm can be a multiple of 5, if any
+            if(mv % 5 == 0)
+                vr_trailing_zeros = pow5_factor(mv) >= q;
+            else if(accept_bounds)
+                vm_trailing_zeros = pow5_factor(mv - 1 - mm_shift) >= q;
+            else
+                vp -= pow5_factor(mv + 2) >= q;
+        }
+    }
+    else{
+        const uint32_t q = log10_pow5(-e2) - (-e2 > 1);
+        e10 = (int32_t) q + e2;
+        const int32_t i = -e2 - (int32_t) q;
+        const int32_t k = pow5_bits(i) - CG_POW5_BITCOUNT;
+        const int32_t j = (int32_t) q - k;
+        vr = mul_shift64(4 * m2, cg_pow5_split[i], j);
+        vp = mul_shift64(4 * m2 + 2, cg_pow5_split[i], j);
+        vm = mul_shift64(4 * m2 - 1 - mm_shift, cg_pow5_split[i], j);
+        if(q <= 1){
+            // mv = 4 * m2 always has at least two trailing zero bits
+            vr_trailing_zeros = 1;
+            if(accept_bounds)
+                vm_trailing_zeros = mm_shift == 1;
+            else
+                --vp;
+        }
+        else if(q < 63){
+            vr_trailing_zeros = (mv & ((((uint64_t) 1) << q) - 1)) == 0;
+        }
+    }
+
+    // remove digits while the interval still contains a shorter representation
+    int32_t removed = 0;
+    uint64_t output;
+    if(vm_trailing_zeros || vr_trailing_zeros){
+        uint32_t last_removed_digit = 0;
+        while(vp / 10 > vm / 10){
+            vm_trailing_zeros &= vm % 10 == 0;
+            vr_trailing_zeros &= last_removed_digit == 0;
+            last_removed_digit = (uint32_t) (vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if(vm_trailing_zeros){
+            while(vm % 10 == 0){
+                vr_trailing_zeros &= last_removed_digit == 0;
+                last_removed_digit = (uint32_t) (vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        // round to even if the exact number is .....50..0
+        if(vr_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0)
+            last_removed_digit = 4;
+        output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed_digit >= 5);
+    }
+    else{
+        int round_up = 0;
+        if(vp / 100 > vm / 100){
+            round_up = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        while(vp / 10 > vm / 10){
+            round_up = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || round_up);
+    }
+    *exponent = e10 + removed;
+    return output;
+}
+
+
+/**
+ * Function that writes the shortest decimal string that parses back to exactly the same double.
+ * Values with a decimal point position between -5 and 21 are written in plain notation,
+ * others in scientific notation.
+ * @internal
+ * @param value Double to format
+ * @param out Buffer of at least CG_MAX_FORMATTED_DOUBLE characters. Not null-terminated.
+ * @return Number of characters written
+ */
+size_t cg_format_double_shortest(double value, char* out){
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const int negative = (int) (bits >> 63);
+    const uint64_t ieee_mantissa = bits & ((((uint64_t) 1) << DOUBLE_MANTISSA_BITS) - 1);
+    const uint32_t ieee_exponent = (uint32_t) ((bits >> DOUBLE_MANTISSA_BITS) & ((1u << DOUBLE_EXPONENT_BITS) - 1));
+
+    size_t length = 0;
+    if(ieee_exponent == ((1u << DOUBLE_EXPONENT_BITS) - 1)){
+        if(ieee_mantissa != 0){
+            memcpy(out, "nan", 3);
+            return 3;
+        }
+        if(negative)
+            out[length++] = '-';
+        memcpy(out + length, "inf", 3);
+        return length + 3;
+    }
+    if(negative)
+        out[length++] = '-';
+    if(ieee_exponent == 0 && ieee_mantissa == 0){
+        out[length++] = '0';
+        return length;
+    }
+
+    int32_t exponent;
+    uint64_t digits = shortest_decimal(ieee_mantissa, ieee_exponent, &exponent);
+    int num_digits = decimal_length17(digits);
+    int point = num_digits + exponent;
+
+    if(point > 0 && point <= MAX_FIXED_NOTATION){
+        if(exponent >= 0){
+            write_digits(digits, num_digits, out + length);
+            length += (size_t) num_digits;
+            memset(out + length, '0', (size_t) exponent);
+            length += (size_t) exponent;
+        }
+        else{
+            // write all digits shifted by one, then move the integer part in front of the point
+            write_digits(digits, num_digits, out + length + 1);
+            memmove(out + length, out + length + 1, (size_t) point);
+            out[length + (size_t) point] = '.';
+            length += (size_t) num_digits + 1;
+        }
+    }
+    else if(point <= 0 && point > MIN_FIXED_NOTATION){
+        out[length++] = '0';
+        out[length++] = '.';
+        memset(out + length, '0', (size_t) -point);
+        length += (size_t) -point;
+        write_digits(digits, num_digits, out + length);
+        length += (size_t) num_digits;
+    }
+    else{
+        write_digits(digits, num_digits, out + length + 1);
+        out[length] = out[length + 1];
+        length++;
+        if(num_digits > 1){
+            out[length] = '.';
+            length += (size_t) num_digits;
+        }
+        int scientific_exponent = point - 1;
+        out[length++] = 'e';
+        out[length++] = scientific_exponent < 0 ? '-' : '+';
+        length += write_uint64((uint64_t) (scientific_exponent < 0 ? -scientific_exponent : scientific_exponent), out + length);
+    }
+    return length;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Fixed six decimal formatting
+//----------------------------------------------------------------
+
+
+/**
+ * Function that writes a double with six decimals, identical to printf's %lf. The value is
+ * scaled by 10^6 and rounded half to even in exact 128-bit integer arithmetic; values too large
+ * for that, and builds without 128-bit integers, fall back to snprintf.
+ * @internal
+ * @param value Double to format
+ * @param out Buffer of at least CG_MAX_FORMATTED_DOUBLE characters. Not null-terminated.
+ * @return Number of characters written
+ */
+size_t cg_format_double_fixed6(double value, char* out){
+#ifdef __SIZEOF_INT128__
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint64_t ieee_mantissa = bits & ((((uint64_t) 1) << DOUBLE_MANTISSA_BITS) - 1);
+    const uint32_t ieee_exponent = (uint32_t) ((bits >> DOUBLE_MANTISSA_BITS) & ((1u << DOUBLE_EXPONENT_BITS) - 1));
+
+    if(ieee_exponent != ((1u << DOUBLE_EXPONENT_BITS) - 1)){
+        uint64_t m2;
+        int32_t e2;
+        if(ieee_exponent == 0){
+            m2 = ieee_mantissa;
+            e2 = 1 - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS;
+        }
+        else{
+            m2 = (((uint64_t) 1) << DOUBLE_MANTISSA_BITS) | ieee_mantissa;
+            e2 = (int32_t) ieee_exponent - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS;
+        }
+
+        // m2 * 10^6 < 2^73, so shifting left by up to 54 bits still fits
+        __uint128_t scaled = (__uint128_t) m2 * 1000000;
+        int fits = 1;
+        if(e2 >= 0){
+            if(e2 <= 54)
+                scaled <<= e2;
+            else
+                fits = 0;
+        }
+        else if(-e2 >= 128){
+            scaled = 0;
+        }
+        else{
+            int shift = -e2;
+            __uint128_t remainder = scaled & ((((__uint128_t) 1) << shift) - 1);
+            __uint128_t half = ((__uint128_t) 1) << (shift - 1);
+            scaled >>= shift;
+            if(remainder > half || (remainder == half && (scaled & 1)))
+                scaled++;
+        }
+
+        if(fits){
+            size_t length = 0;
+            if(bits >> 63)
+                out[length++] = '-';
+            __uint128_t integer_part = scaled / 1000000;
+            uint64_t fraction = (uint64_t) (scaled % 1000000);
+            if((integer_part >> 64) == 0){
+                length += write_uint64((uint64_t) integer_part, out + length);
+            }
+            else{
+                char reversed[40];
+                int num_digits = 0;
+                while(integer_part != 0){
+                    reversed[num_digits++] = (char) ('0' + (int) (integer_part % 10));
+                    integer_part /= 10;
+                }
+                while(num_digits > 0)
+                    out[length++] = reversed[--num_digits];
+            }
+            out[length++] = '.';
+            write_digits(fraction, 6, out + length);
+            return length + 6;
+        }
+    }
+#endif
+    return (size_t) snprintf(out, CG_MAX_FORMATTED_DOUBLE, "%lf", value);
+}
+
+
+//----------------------------------------------------------------
+// Functions - Buffered writing
+//----------------------------------------------------------------
+
+
+/** @internal Writes the buffer contents to the file */
+static void flush_writer(CGCsvWriter_t* writer){
+    if(writer->used > 0 && writer->status == CG_SUCCESS){
+        if(fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used)
+            writer->status = CG_INVALID_INPUT;
+    }
+    writer->used = 0;
+}
+
+
+/** @internal Appends one "x,y" line to the buffer, flushing first if it might not fit */
+static inline void write_point(CGCsvWriter_t* writer, double xcoord, double ycoord){
+    if(WRITE_BUFFER_SIZE - writer->used < MAX_FORMATTED_POINT)
+        flush_writer(writer);
+    char* out = writer->buffer + writer->used;
+    size_t length;
+    if(writer->format == CG_CSV_SHORTEST){
+        length = cg_format_double_shortest(xcoord, out);
+        out[length++] = ',';
+        length += cg_format_double_shortest(ycoord, out + length);
+    }
+    else{
+        length = cg_format_double_fixed6(xcoord, out);
+        out[length++] = ',';
+        length += cg_format_double_fixed6(ycoord, out + length);
+    }
+    out[length++] = '\n';
+    writer->used += length;
+}
+
+
+/** @internal Sets up a writer with a freshly allocated buffer */
+static CGError_t init_writer(CGCsvWriter_t* writer, FILE* file_pointer, CGCsvFormat_t format){
+    writer->file = file_pointer;
+    writer->used = 0;
+    writer->format = format;
+    writer->status = CG_SUCCESS;
+    writer->buffer = (char*) cg_malloc(WRITE_BUFFER_SIZE);
+    return writer->buffer == NULL ? CG_NO_MEMORY : CG_SUCCESS;
+}
+
+
+/** @internal Flushes and releases a writer, returning its final status */
+static CGError_t finish_writer(CGCsvWriter_t* writer){
+    flush_writer(writer);
+    cg_free(writer->buffer);
+    return writer->status;
+}
+
+
+/**
+ * Function for writing a point array to a .csv file through a large output buffer.
+ * @ingroup file
+ * @param point_array Point array to write into the file
+ * @param file_pointer File pointer of file to write into.
+ * @param format CG_CSV_SHORTEST for shortest round-trip numbers, CG_CSV_FIXED_6 for %lf compatible output
+ * @return INVALID_INPUT if either is null or can't write to file, NO_MEMORY if the buffer cannot be allocated, otherwise success.
+ */
+CGError_t csv_file_from_point_array(const CGPointArray_t* point_array, FILE* file_pointer, CGCsvFormat_t format){
+    if(point_array == NULL || file_pointer == NULL)
+        return CG_INVALID_INPUT;
+    CGCsvWriter_t writer;
+    if(init_writer(&writer, file_pointer, format) != CG_SUCCESS)
+        return CG_NO_MEMORY;
+    size_t i;
+    for(i = 0; i < point_array->num_points; i++)
+        write_point(&writer, point_array->xcoords[i], point_array->ycoords[i]);
+    return finish_writer(&writer);
+}
+
+
+/**
+ * Function for writing a point array to a .csv file given by path.
+ * @ingroup file
+ * @param point_array Point array to write into the file
+ * @param file_path Path of the file to create or overwrite
+ * @param format CG_CSV_SHORTEST for shortest round-trip numbers, CG_CSV_FIXED_6 for %lf compatible output
+ * @return NO_FILE if the file cannot be opened, otherwise the status of csv_file_from_point_array.
+ */
+CGError_t csv_path_from_point_array(const CGPointArray_t* point_array, const char* file_path, CGCsvFormat_t format){
+    if(point_array == NULL || file_path == NULL)
+        return CG_INVALID_INPUT;
+    FILE* file_pointer = fopen(file_path, "wb");
+    if(file_pointer == NULL)
+        return CG_NO_FILE;
+    CGError_t status = csv_file_from_point_array(point_array, file_pointer, format);
+    if(fclose(file_pointer) != 0 && status == CG_SUCCESS)
+        status = CG_INVALID_INPUT;
+    return status;
+}
+
+
+/**
+ * Function for writing a point set to a .csv file. Output is identical to printing every point
+ * with "%lf,%lf\n", but is formatted into a large buffer instead of calling fprintf per point.
+ * @ingroup file
+ * @param point_set Point set to write into the file
+ * @param file_pointer File pointer of file to write into.
+ * @return INVALID_INPUT if either is null or can't write to file, otherwise success.
+ */
+CGError_t csv_file_from_point_set(const CGPointSet_t* point_set, FILE* file_pointer){
+    if(point_set == NULL || file_pointer == NULL)
+        return CG_INVALID_INPUT;
+    CGCsvWriter_t writer;
+    if(init_writer(&writer, file_pointer, CG_CSV_FIXED_6) != CG_SUCCESS)
+        return CG_NO_MEMORY;
+    CGPointNode_t* current_node = point_set->head;
+    while(current_node != NULL){
+        write_point(&writer, current_node->point->xcoord, current_node->point->ycoord);
+        current_node = current_node->next;
+    }
+    return finish_writer(&writer);
+}
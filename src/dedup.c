@@ -0,0 +1,277 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing the removal of duplicate and near duplicate points in expected linear time.
+ * Points are snapped to a grid with cells twice as wide as the tolerance and the cells of kept points
+ * are stored in an open addressing hash table, so each point is checked against the few kept points
+ * of its own and the neighbouring cells instead of against every other point. Two points are duplicates
+ * when compare_points would call them equal with the tolerance in place of FLOAT_TOLERANCE, and of a
+ * group of duplicates the first one is kept.
+ *
+ * @defgroup dedup Duplicate Removal
+ * @brief Hash based removal of exact and near duplicate points.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+// Points between locating a point's cells and looking them up, to hide the latency of the table
+#define DEDUP_LOOKAHEAD 8
+
+// Distance from the middle of a cell, as a fraction of its width, within which both neighbours are searched
+#define DEDUP_MARGIN 1e-6
+
+
+/**
+ * Struct for one slot of the hash table, holding the grid cell of a kept point.
+ * @internal
+ */
+typedef struct CG_DedupSlot {
+    double cell_x;          /**< Cell column, or the x-coordinate itself without a tolerance */
+    double cell_y;          /**< Cell row, or the y-coordinate itself without a tolerance */
+    size_t index;           /**< Position of the kept point plus one, 0 for an empty slot */
+} CGDedupSlot_t;
+
+
+/**
+ * Struct for the hash table of kept points.
+ * @internal
+ */
+typedef struct CG_DedupTable {
+    CGDedupSlot_t* slots;   /**< Slots, a power of two of them */
+    size_t mask;            /**< Number of slots minus one */
+} CGDedupTable_t;
+
+
+//----------------------------------------------------------------
+// Functions - Hash table
+//----------------------------------------------------------------
+
+
+/**
+ * Function that looks for a kept point in one cell that duplicates a point.
+ * @internal
+ * @param table Hash table of kept points
+ * @param points Coordinates the kept positions refer to
+ * @param cell_x Column of the cell
+ * @param cell_y Row of the cell
+ * @param xcoord x-coordinate of the point
+ * @param ycoord y-coordinate of the point
+ * @param tolerance Largest difference per axis between duplicates
+ * @return 1 if a duplicate was found, 0 otherwise.
+ */
+static int find_duplicate(const CGDedupTable_t* table, const CGPointArray_t* points, double cell_x, double cell_y,
+                          double xcoord, double ycoord, double tolerance){
+    size_t slot = cg_hash_cell(cell_x, cell_y) & table->mask;
+    while(table->slots[slot].index != 0){
+        const CGDedupSlot_t* entry = &table->slots[slot];
+        // a cell holds up to four points further than the tolerance apart
+        if(entry->cell_x == cell_x && entry->cell_y == cell_y){
+            size_t index = entry->index - 1;
+            if(fabs(points->xcoords[index] - xcoord) <= tolerance && fabs(points->ycoords[index] - ycoord) <= tolerance)
+                return 1;
+        }
+        slot = (slot + 1) & table->mask;
+    }
+    return 0;
+}
+
+
+/** @internal Adds a kept point to the hash table */
+static void insert_point(CGDedupTable_t* table, double cell_x, double cell_y, size_t index){
+    size_t slot = cg_hash_cell(cell_x, cell_y) & table->mask;
+    while(table->slots[slot].index != 0)
+        slot = (slot + 1) & table->mask;
+    table->slots[slot].cell_x = cell_x;
+    table->slots[slot].cell_y = cell_y;
+    table->slots[slot].index = index + 1;
+}
+
+
+/**
+ * Struct for the grid cell of a point and the neighbouring cells a duplicate of it can lie in.
+ * @internal
+ */
+typedef struct CG_DedupCell {
+    double cell_x;          /**< Column of the point's cell */
+    double cell_y;          /**< Row of the point's cell */
+    int first_x;            /**< First column offset to search, -1 or 0 */
+    int last_x;             /**< Last column offset to search, 0 or 1 */
+    int first_y;            /**< First row offset to search, -1 or 0 */
+    int last_y;             /**< Last row offset to search, 0 or 1 */
+} CGDedupCell_t;
+
+
+/** @internal Narrows the offsets to search on one axis to the side of the cell a coordinate is nearer */
+static inline void nearer_side(double position, double cell, int* first, int* last){
+    double fraction = position - cell;
+    // a margin either side of the middle keeps rounding from hiding a duplicate across the far edge
+    *first = fraction < 0.5 + DEDUP_MARGIN ? -1 : 0;
+    *last = fraction > 0.5 - DEDUP_MARGIN ? 1 : 0;
+}
+
+
+/** @internal Finds the cell of a point and starts loading the slots it will be looked up in */
+static inline void locate_cell(const CGDedupTable_t* table, double xcoord, double ycoord, double cell_size, CGDedupCell_t* cell){
+    if(cell_size == 0){
+        // adding zero turns -0.0 into 0.0, so both land in the same slot
+        cell->cell_x = xcoord + 0.0;
+        cell->cell_y = ycoord + 0.0;
+        cell->first_x = cell->last_x = cell->first_y = cell->last_y = 0;
+    }
+    else{
+        double position_x = xcoord / cell_size, position_y = ycoord / cell_size;
+        cell->cell_x = floor(position_x) + 0.0;
+        cell->cell_y = floor(position_y) + 0.0;
+        nearer_side(position_x, cell->cell_x, &cell->first_x, &cell->last_x);
+        nearer_side(position_y, cell->cell_y, &cell->first_y, &cell->last_y);
+    }
+#if defined(__GNUC__)
+    int offset_x, offset_y;
+    for(offset_x = cell->first_x; offset_x <= cell->last_x; offset_x++)
+        for(offset_y = cell->first_y; offset_y <= cell->last_y; offset_y++)
+            __builtin_prefetch(&table->slots[cg_hash_cell(cell->cell_x + offset_x, cell->cell_y + offset_y) & table->mask]);
+#else
+    (void) table;
+#endif
+}
+
+
+/**
+ * Function that removes the duplicates from a list of positions in a point array, keeping the order of the rest.
+ * @internal
+ * @param points Point array the positions refer to
+ * @param indices Positions to deduplicate, compacted in place
+ * @param num_indices Number of positions, updated to the number kept
+ * @param tolerance Largest difference per axis between duplicates, 0 for exact duplicates only
+ * @return NO_MEMORY if the hash table cannot be allocated, otherwise SUCCESS.
+ */
+static CGError_t dedup_indices(const CGPointArray_t* points, size_t* indices, size_t* num_indices, double tolerance){
+    CG_PHASE_START(timer);
+    size_t num_slots = 16;
+    while(num_slots < 2 * *num_indices)
+        num_slots *= 2;
+    CGDedupTable_t table;
+    table.slots = (CGDedupSlot_t*) cg_calloc(num_slots, sizeof(CGDedupSlot_t));
+    if(table.slots == NULL)
+        return CG_NO_MEMORY;
+    table.mask = num_slots - 1;
+
+    // with cells twice the tolerance wide a duplicate is in the point's cell or on its nearer side,
+    // four cells at most; cells are located a few points ahead so their slots are loaded in time
+    double cell_size = 2 * tolerance;
+    CGDedupCell_t cells[DEDUP_LOOKAHEAD];
+    size_t i, num_points = *num_indices, num_kept = 0;
+    for(i = 0; i < num_points && i < DEDUP_LOOKAHEAD; i++)
+        locate_cell(&table, points->xcoords[indices[i]], points->ycoords[indices[i]], cell_size, &cells[i]);
+    for(i = 0; i < num_points; i++){
+        size_t index = indices[i];
+        double xcoord = points->xcoords[index], ycoord = points->ycoords[index];
+        CGDedupCell_t cell = cells[i % DEDUP_LOOKAHEAD];
+        if(i + DEDUP_LOOKAHEAD < num_points){
+            size_t ahead = indices[i + DEDUP_LOOKAHEAD];
+            locate_cell(&table, points->xcoords[ahead], points->ycoords[ahead], cell_size, &cells[i % DEDUP_LOOKAHEAD]);
+        }
+        // the point's own cell is the likeliest to hold a duplicate
+        int duplicate = find_duplicate(&table, points, cell.cell_x, cell.cell_y, xcoord, ycoord, tolerance);
+        int offset_x, offset_y;
+        for(offset_x = cell.first_x; offset_x <= cell.last_x && !duplicate; offset_x++)
+            for(offset_y = cell.first_y; offset_y <= cell.last_y && !duplicate; offset_y++)
+                if(offset_x != 0 || offset_y != 0)
+                    duplicate = find_duplicate(&table, points, cell.cell_x + offset_x, cell.cell_y + offset_y, xcoord, ycoord, tolerance);
+        if(!duplicate){
+            insert_point(&table, cell.cell_x, cell.cell_y, index);
+            // kept positions only move down, so the lookahead never reads one that was overwritten
+            indices[num_kept++] = index;
+        }
+    }
+    *num_indices = num_kept;
+    cg_free(table.slots);
+    CG_PHASE_LAP(timer, CG_PHASE_DEGENERACY);
+    return CG_SUCCESS;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Removing duplicates
+//----------------------------------------------------------------
+
+
+/**
+ * Function that copies the points of a point array to another, leaving out duplicates.
+ * Of every group of duplicates the first point is kept, and kept points stay in input order.
+ * @ingroup dedup
+ * @param input_array Point array to deduplicate
+ * @param output_array Initialized point array the kept points are appended to
+ * @param tolerance Largest difference per axis between duplicates, 0 to remove exact duplicates only
+ * @param kept_indices NULL, or space for input_array->num_points positions that receives the position
+ *      of each kept point in the input, as many as were appended
+ * @return INVALID_INPUT if an array is NULL or the tolerance is negative or not a number,
+ *      NO_MEMORY if allocation fails, otherwise SUCCESS.
+ */
+CGError_t dedup_point_array(const CGPointArray_t* input_array, CGPointArray_t* output_array, double tolerance, size_t* kept_indices){
+    if(input_array == NULL || output_array == NULL || !(tolerance >= 0))
+        return CG_INVALID_INPUT;
+    size_t num_points = input_array->num_points;
+    size_t* indices = kept_indices;
+    if(indices == NULL){
+        indices = (size_t*) cg_malloc((num_points ? num_points : 1) * sizeof(size_t));
+        if(indices == NULL)
+            return CG_NO_MEMORY;
+    }
+    size_t i, num_kept = num_points;
+    for(i = 0; i < num_points; i++)
+        indices[i] = i;
+    CGError_t status = dedup_indices(input_array, indices, &num_kept, tolerance);
+    if(status == CG_SUCCESS)
+        status = reserve_point_array(output_array, output_array->num_points + num_kept);
+    if(status == CG_SUCCESS){
+        for(i = 0; i < num_kept; i++){
+            output_array->xcoords[output_array->num_points + i] = input_array->xcoords[indices[i]];
+            output_array->ycoords[output_array->num_points + i] = input_array->ycoords[indices[i]];
+        }
+        output_array->num_points += num_kept;
+    }
+    if(indices != kept_indices)
+        cg_free(indices);
+    return status;
+}
+
+
+/**
+ * Function that removes duplicates from a view, keeping the first point of every group in view order.
+ * The remaining indices are the kept points, so deduplicating a view before compute_monotone_chain_view
+ * shrinks the hull's sort without copying any coordinates.
+ * @ingroup dedup
+ * @param point_view View to deduplicate
+ * @param tolerance Largest difference per axis between duplicates, 0 to remove exact duplicates only
+ * @return INVALID_INPUT if point_view is NULL or the tolerance is negative or not a number,
+ *      NO_MEMORY if allocation fails, otherwise SUCCESS.
+ */
+CGError_t dedup_point_view(CGPointView_t* point_view, double tolerance){
+    if(point_view == NULL || !(tolerance >= 0))
+        return CG_INVALID_INPUT;
+    return dedup_indices(point_view->points, point_view->indices, &point_view->num_indices, tolerance);
+}
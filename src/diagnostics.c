@@ -54,7 +54,11 @@ static const CGErrorMessage_t error_messages[] = {
     {CG_POINTS_TOO_FEW,     "Not enough points"},
     {CG_INVALID_INPUT,      "Invalid input"},
     {CG_NO_FILE,            "File cannot be opened, or does not exist"},
-    {CG_UNIMPLEMENTED,      "Function has not yet been implemented"}
+    {CG_UNIMPLEMENTED,      "Function has not yet been implemented"},
+    {CG_NO_MEMORY,          "Memory allocation failed"},
+    {CG_INVALID_FILE,       "File is not in the expected format"},
+    {CG_TIMEOUT,            "Timed out waiting for a result"},
+    {CG_CANCELLED,          "Operation was cancelled"}
 };
 
 
@@ -67,7 +71,7 @@ static const CGErrorMessage_t error_messages[] = {
  */
 void print_cg_error(CGError_t error, const char* function_name){
     FILE* stream = stderr;
-    const char* error_message;
+    const char* error_message = NULL;
     int i;
     for(i = 0; i < (int) sizeof(error_messages) / sizeof(error_messages[0]); i++){
         if(error_messages[i].error == error){
@@ -104,7 +108,7 @@ void print_point(CGPoint_t* point){
  * @param desc_detail Flag specifying how much point information to print.
  * @return void
  */
-void print_point_to_file(CGPoint_t* point, FILE* fp, CGDescDetail_t desc_detail){
+void print_point_to_file(const CGPoint_t* point, FILE* fp, CGDescDetail_t desc_detail){
     const char* function_name = "print_point_to_file";
     switch(desc_detail){
         case CG_MIN:
@@ -129,7 +133,7 @@ void print_point_to_file(CGPoint_t* point, FILE* fp, CGDescDetail_t desc_detail)
  * @param point_set Input set of points
  * @return void
  */
-void print_points(CGPointSet_t* point_set){
+void print_points(const CGPointSet_t* point_set){
     print_points_to_file(point_set, stdout, CG_MIN);
 }
 
@@ -141,7 +145,7 @@ void print_points(CGPointSet_t* point_set){
  * @param fp File pointer of file in which to write
  * @return void
  */
-void print_points_to_file(CGPointSet_t* point_set, FILE* fp, CGDescDetail_t desc_detail){
+void print_points_to_file(const CGPointSet_t* point_set, FILE* fp, CGDescDetail_t desc_detail){
     const char* function_name = "print_points_to_file";
 
     // if stream NULL print to error
@@ -168,6 +172,8 @@ void print_points_to_file(CGPointSet_t* point_set, FILE* fp, CGDescDetail_t desc
 
 /**
  * Function used to generate random point sets for testing purposes.
+ * Coordinates are integers in [-100, 100) and the generator is reseeded from the clock on each call;
+ * generate_point_array gives reproducible inputs in other distributions.
  * @ingroup diag
  * @param point_set Initialized, but empty point set which will be filled with random data.
  * @param type Type of points to be written into the point set
@@ -194,7 +200,7 @@ CGError_t generate_random_point_set(CGPointSet_t* point_set, int num_points){
  * @param point_B Second point to compare
  * @return 0 if the two points are the same, otherwise -1
  */
-int compare_points(CGPoint_t* point_A, CGPoint_t* point_B){
+int compare_points(const CGPoint_t* point_A, const CGPoint_t* point_B){
     if(fabs(point_A->xcoord - point_B->xcoord) > FLOAT_TOLERANCE)
         return -1;
     else if(fabs(point_A->ycoord - point_B->ycoord) > FLOAT_TOLERANCE)
@@ -210,7 +216,7 @@ int compare_points(CGPoint_t* point_A, CGPoint_t* point_B){
  * param point_set_B Second point set to compare.
  * return 0 if they are the same, -1 if they are not.
  */
-int compare_point_sets(CGPointSet_t* point_set_A, CGPointSet_t* point_set_B){
+int compare_point_sets(const CGPointSet_t* point_set_A, const CGPointSet_t* point_set_B){
     if(point_set_A == NULL || point_set_B == NULL)
         return -1;
     else{
@@ -0,0 +1,300 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing the allocation free decimal to double conversion used by the bulk
+ * loaders. Numbers with at most 19 significant digits are converted with the Clinger fast path
+ * or the Eisel-Lemire algorithm, both of which are correctly rounded, so results are
+ * bit-identical to strtod. Longer inputs fall back to strtod on a heap copy of any length, with the
+ * decimal point written the way the current locale expects it.
+ */
+
+
+#include <float.h>
+#include <locale.h>
+#include "libCGeo/libCGeo_internal.h"
+#include "fast_float_tables.h"
+
+// Most decimal digits that are guaranteed to fit in a 64-bit mantissa
+#define MAX_FAST_DIGITS 19
+
+// IEEE 754 binary64 parameters
+#define MANTISSA_EXPLICIT_BITS      52
+#define MINIMUM_EXPONENT            -1023
+#define INFINITE_POWER              0x7FF
+#define MIN_EXPONENT_ROUND_TO_EVEN  -4
+#define MAX_EXPONENT_ROUND_TO_EVEN  23
+#define MAX_EXPONENT_FAST_PATH      22
+#define MAX_MANTISSA_FAST_PATH      (((uint64_t) 2) << MANTISSA_EXPLICIT_BITS)
+
+
+/** @internal Exact powers of ten representable as doubles */
+static const double exact_powers_of_ten[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+//----------------------------------------------------------------
+// Functions - Arithmetic helpers
+//----------------------------------------------------------------
+
+
+#ifdef CG_LITTLE_ENDIAN
+/** @internal Checks if eight bytes loaded little-endian are all ASCII digits */
+static inline int is_eight_digits(uint64_t value){
+    return !(((value + 0x4646464646464646ULL) | (value - 0x3030303030303030ULL)) & 0x8080808080808080ULL);
+}
+
+
+/** @internal Converts eight ASCII digits loaded little-endian into their integer value (SWAR) */
+static inline uint32_t parse_eight_digits(uint64_t value){
+    const uint64_t mask = 0x000000FF000000FFULL;
+    const uint64_t mul1 = 0x000F424000000064ULL;    // 100 + (1000000 << 32)
+    const uint64_t mul2 = 0x0000271000000001ULL;    // 1 + (10000 << 32)
+    value -= 0x3030303030303030ULL;
+    value = (value * 10) + (value >> 8);
+    value = (((value & mask) * mul1) + (((value >> 16) & mask) * mul2)) >> 32;
+    return (uint32_t) value;
+}
+#endif
+
+
+/** @internal Accumulates a run of digits into mantissa, eight at a time where possible */
+static inline const char* parse_digits(const char* p, const char* end, uint64_t* mantissa){
+    uint64_t w = *mantissa;
+#ifdef CG_LITTLE_ENDIAN
+    while(end - p >= 8){
+        uint64_t chunk;
+        memcpy(&chunk, p, sizeof(chunk));
+        if(!is_eight_digits(chunk))
+            break;
+        w = w * 100000000ULL + parse_eight_digits(chunk);
+        p += 8;
+    }
+#endif
+    while(p < end && *p >= '0' && *p <= '9'){
+        w = w * 10 + (uint64_t) (*p - '0');
+        p++;
+    }
+    *mantissa = w;
+    return p;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Eisel-Lemire
+//----------------------------------------------------------------
+
+
+/**
+ * Function that computes the binary64 encoding of w * 10^q, correctly rounded, for w with at
+ * most 19 decimal digits.
+ * @internal
+ * @param q Decimal exponent
+ * @param w Decimal mantissa
+ * @return Bit pattern of the (positive) resulting double
+ */
+static uint64_t eisel_lemire(int64_t q, uint64_t w){
+    if(w == 0 || q < CG_SMALLEST_POWER_OF_FIVE)
+        return 0;
+    else if(q > CG_LARGEST_POWER_OF_FIVE)
+        return ((uint64_t) INFINITE_POWER) << MANTISSA_EXPLICIT_BITS;
+
+    int leading_zeros = cg_clz64(w);
+    w <<= leading_zeros;
+
+    // 128-bit approximation of w * 5^q, refined with the low half of the table entry when needed
+    const int index = 2 * (int) (q - CG_SMALLEST_POWER_OF_FIVE);
+    CGUint128_t product = cg_full_multiplication(w, cg_power_of_five_128[index]);
+    const uint64_t precision_mask = 0xFFFFFFFFFFFFFFFFULL >> (MANTISSA_EXPLICIT_BITS + 3);
+    if((product.high & precision_mask) == precision_mask){
+        CGUint128_t second_product = cg_full_multiplication(w, cg_power_of_five_128[index + 1]);
+        product.low += second_product.high;
+        if(second_product.high > product.low)
+            product.high++;
+    }
+
+    int upper_bit = (int) (product.high >> 63);
+    int shift = upper_bit + 64 - MANTISSA_EXPLICIT_BITS - 3;
+    uint64_t mantissa = product.high >> shift;
+    // floor(log2(10^q)) + 63, using 217706 / 2^16 ~ log2(10)
+    int32_t binary_power = (int32_t) (((217706 * q) >> 16) + 63);
+    int32_t power2 = binary_power + upper_bit - leading_zeros - MINIMUM_EXPONENT;
+
+    // subnormal results
+    if(power2 <= 0){
+        if(-power2 + 1 >= 64)
+            return 0;
+        mantissa >>= -power2 + 1;
+        mantissa += (mantissa & 1);
+        mantissa >>= 1;
+        power2 = (mantissa < (((uint64_t) 1) << MANTISSA_EXPLICIT_BITS)) ? 0 : 1;
+        return mantissa | (((uint64_t) power2) << MANTISSA_EXPLICIT_BITS);
+    }
+
+    // exact halfway cases round to even
+    if(product.low <= 1 && q >= MIN_EXPONENT_ROUND_TO_EVEN && q <= MAX_EXPONENT_ROUND_TO_EVEN &&
+       (mantissa & 3) == 1){
+        if((mantissa << shift) == product.high)
+            mantissa &= ~((uint64_t) 1);
+    }
+
+    mantissa += (mantissa & 1);
+    mantissa >>= 1;
+    if(mantissa >= (((uint64_t) 2) << MANTISSA_EXPLICIT_BITS)){
+        mantissa = ((uint64_t) 1) << MANTISSA_EXPLICIT_BITS;
+        power2++;
+    }
+    mantissa &= ~(((uint64_t) 1) << MANTISSA_EXPLICIT_BITS);
+    if(power2 >= INFINITE_POWER)
+        return ((uint64_t) INFINITE_POWER) << MANTISSA_EXPLICIT_BITS;
+    return mantissa | (((uint64_t) power2) << MANTISSA_EXPLICIT_BITS);
+}
+
+
+//----------------------------------------------------------------
+// Functions - Number parsing
+//----------------------------------------------------------------
+
+
+/**
+ * Function that converts a number with too many significant digits for the fast paths with strtod.
+ * The token is copied to the heap whatever its length, and its decimal point is replaced with the one
+ * of the current locale, so a host program that sets a comma decimal locale still reads it correctly.
+ * @internal
+ * @param begin First character of the number, already checked against the accepted syntax
+ * @param length Number of characters in the number
+ * @param value Output for the parsed number
+ * @return NO_MEMORY if the copy cannot be allocated, otherwise SUCCESS.
+ */
+static CGError_t parse_long_number(const char* begin, size_t length, double* value){
+    const char* decimal_point = localeconv()->decimal_point;
+    if(decimal_point == NULL || *decimal_point == '\0')
+        decimal_point = ".";
+    size_t point_length = strlen(decimal_point);
+    char* buffer = (char*) cg_malloc(length + point_length + 1);
+    if(buffer == NULL)
+        return CG_NO_MEMORY;
+    size_t i, written = 0;
+    for(i = 0; i < length; i++){
+        if(begin[i] == '.'){
+            memcpy(buffer + written, decimal_point, point_length);
+            written += point_length;
+        }
+        else
+            buffer[written++] = begin[i];
+    }
+    buffer[written] = '\0';
+    *value = strtod(buffer, NULL);
+    cg_free(buffer);
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that parses a decimal floating point number from a bounded, non null-terminated buffer.
+ * Accepts an optional sign, digits with an optional decimal point, and an optional exponent.
+ * The result is bit-identical to strtod for the same characters.
+ * @internal
+ * @param begin First character of the number
+ * @param end One past the last readable character
+ * @param value Output for the parsed number
+ * @return Pointer one past the parsed number, or NULL if no valid number starts at begin.
+ */
+const char* cg_parse_double(const char* begin, const char* end, double* value){
+    const char* p = begin;
+    int negative = 0;
+    if(p < end && (*p == '-' || *p == '+')){
+        negative = (*p == '-');
+        p++;
+    }
+
+    const char* digits_start = p;
+    uint64_t mantissa = 0;
+    p = parse_digits(p, end, &mantissa);
+    int64_t digit_count = p - digits_start;
+    int64_t exponent = 0;
+    if(p < end && *p == '.'){
+        p++;
+        const char* fraction_start = p;
+        p = parse_digits(p, end, &mantissa);
+        exponent = fraction_start - p;
+        digit_count += p - fraction_start;
+    }
+    if(digit_count == 0)
+        return NULL;
+    const char* mantissa_end = p;
+
+    if(p < end && (*p == 'e' || *p == 'E')){
+        const char* q = p + 1;
+        int negative_exponent = 0;
+        if(q < end && (*q == '-' || *q == '+')){
+            negative_exponent = (*q == '-');
+            q++;
+        }
+        if(q < end && *q >= '0' && *q <= '9'){
+            int64_t exponent_value = 0;
+            while(q < end && *q >= '0' && *q <= '9'){
+                // saturate, anything this large is already zero or infinity
+                if(exponent_value < 0x10000)
+                    exponent_value = exponent_value * 10 + (*q - '0');
+                q++;
+            }
+            exponent += negative_exponent ? -exponent_value : exponent_value;
+            p = q;
+        }
+    }
+
+    // leading zeros do not count against the digit budget
+    if(digit_count > MAX_FAST_DIGITS){
+        const char* start = digits_start;
+        while(start < mantissa_end && (*start == '0' || *start == '.')){
+            if(*start == '0')
+                digit_count--;
+            start++;
+        }
+    }
+
+    if(digit_count > MAX_FAST_DIGITS)
+        return parse_long_number(begin, (size_t) (p - begin), value) == CG_SUCCESS ? p : NULL;
+
+    double result;
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    if(exponent >= -MAX_EXPONENT_FAST_PATH && exponent <= MAX_EXPONENT_FAST_PATH && mantissa <= MAX_MANTISSA_FAST_PATH){
+        // both operands are exact, so a single IEEE operation rounds correctly
+        result = (double) mantissa;
+        if(exponent < 0)
+            result /= exact_powers_of_ten[-exponent];
+        else
+            result *= exact_powers_of_ten[exponent];
+        *value = negative ? -result : result;
+        return p;
+    }
+#endif
+    uint64_t bits = eisel_lemire(exponent, mantissa);
+    memcpy(&result, &bits, sizeof(result));
+    *value = negative ? -result : result;
+    return p;
+}
@@ -0,0 +1,129 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing the platform specific code used to memory-map input files
+ * for the bulk loaders.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+/**
+ * Function that maps a whole file read-only into memory.
+ * Empty files succeed with a NULL data pointer and size 0.
+ * @internal
+ * @param file_path Path to the file to map
+ * @param file_map Struct that receives the mapping
+ * @return NO_FILE if the file cannot be opened or mapped, otherwise SUCCESS.
+ */
+CGError_t cg_map_file(const char* file_path, CGFileMap_t* file_map){
+    if(file_path == NULL || file_map == NULL)
+        return CG_INVALID_INPUT;
+    file_map->data = NULL;
+    file_map->size = 0;
+    file_map->handle = NULL;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(file == INVALID_HANDLE_VALUE)
+        return CG_NO_FILE;
+    LARGE_INTEGER file_size;
+    if(!GetFileSizeEx(file, &file_size)){
+        CloseHandle(file);
+        return CG_NO_FILE;
+    }
+    if(file_size.QuadPart == 0){
+        CloseHandle(file);
+        return CG_SUCCESS;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if(mapping == NULL)
+        return CG_NO_FILE;
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(data == NULL){
+        CloseHandle(mapping);
+        return CG_NO_FILE;
+    }
+    file_map->data = (const char*) data;
+    file_map->size = (size_t) file_size.QuadPart;
+    file_map->handle = mapping;
+#else
+    int fd = open(file_path, O_RDONLY);
+    if(fd < 0)
+        return CG_NO_FILE;
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0){
+        close(fd);
+        return CG_NO_FILE;
+    }
+    if(file_stat.st_size == 0){
+        close(fd);
+        return CG_SUCCESS;
+    }
+    void* data = mmap(NULL, (size_t) file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if(data == MAP_FAILED)
+        return CG_NO_FILE;
+#ifdef MADV_SEQUENTIAL
+    madvise(data, (size_t) file_stat.st_size, MADV_SEQUENTIAL);
+#endif
+    file_map->data = (const char*) data;
+    file_map->size = (size_t) file_stat.st_size;
+#endif
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that releases a mapping created by cg_map_file.
+ * @internal
+ * @param file_map Mapping to release
+ */
+void cg_unmap_file(CGFileMap_t* file_map){
+    if(file_map == NULL || file_map->data == NULL)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile((LPCVOID) file_map->data);
+    CloseHandle((HANDLE) file_map->handle);
+#else
+    munmap((void*) file_map->data, file_map->size);
+#endif
+    file_map->data = NULL;
+    file_map->size = 0;
+    file_map->handle = NULL;
+}
@@ -0,0 +1,336 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing the pipelined .csv file to convex hull driver. The calling thread reads
+ * the file in blocks that end on line boundaries while worker threads parse the blocks and merge
+ * them into per-thread partial hulls, which are combined once the whole file has been read.
+ * Reading, parsing and hull computation overlap, so the wall time approaches the slowest stage
+ * rather than the sum of all three.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+// Bytes read per block. Blocks grow if a single line does not fit.
+#define PIPELINE_BLOCK_SIZE (1 << 22)
+
+// Blocks in flight beyond one per worker, so reading can run ahead of parsing
+#define PIPELINE_EXTRA_BLOCKS 2
+
+
+/**
+ * Struct for a block of complete .csv lines passed from the reader to the workers.
+ * @internal
+ */
+typedef struct CG_PipelineBlock {
+    char* data;                         /**< Buffer holding the lines */
+    size_t size;                        /**< Number of bytes of complete lines */
+    size_t capacity;                    /**< Size of the buffer */
+    struct CG_PipelineBlock* next;      /**< Next block in the queue or free list */
+} CGPipelineBlock_t;
+
+
+/**
+ * Struct holding the state shared by the reader and the workers.
+ * @internal
+ */
+typedef struct CG_Pipeline {
+    CGMutex_t mutex;                    /**< Guards every field below */
+    CGCondition_t block_ready;          /**< Signalled when a block is queued or reading ends */
+    CGCondition_t block_free;           /**< Signalled when a block is returned or a worker fails */
+    CGPipelineBlock_t* queue_head;      /**< Oldest block waiting to be parsed */
+    CGPipelineBlock_t* queue_tail;      /**< Newest block waiting to be parsed */
+    CGPipelineBlock_t* free_blocks;     /**< Blocks available to the reader */
+    int end_of_input;                   /**< Set once the last block has been queued */
+    CGError_t status;                   /**< First error of any stage */
+    CGCompute_t compute_type;           /**< Degeneracy handling of the hull */
+} CGPipeline_t;
+
+
+/**
+ * Struct holding the state of one worker thread.
+ * @internal
+ */
+typedef struct CG_PipelineWorker {
+    CGPipeline_t* pipeline;             /**< Shared pipeline state */
+    CGThread_t thread;                  /**< Thread running the worker */
+    CGPointArray_t* batch;              /**< Points of the block being processed */
+    CGPointArray_t* hull;               /**< Hull of all blocks processed by this worker */
+    CGPointArray_t* scratch;            /**< Array reused to build the next hull */
+    size_t num_points;                  /**< Points of all blocks processed by this worker */
+} CGPipelineWorker_t;
+
+
+//----------------------------------------------------------------
+// Functions - Pipeline stages
+//----------------------------------------------------------------
+
+
+/** @internal Records the first error and wakes every stage so they can stop */
+static void fail_pipeline(CGPipeline_t* pipeline, CGError_t status){
+    if(pipeline->status == CG_SUCCESS)
+        pipeline->status = status;
+    cg_condition_broadcast(&pipeline->block_ready);
+    cg_condition_broadcast(&pipeline->block_free);
+}
+
+
+/** @internal Worker entry point that parses queued blocks and merges them into its hull */
+static void* pipeline_worker(void* argument){
+    CGPipelineWorker_t* worker = (CGPipelineWorker_t*) argument;
+    CGPipeline_t* pipeline = worker->pipeline;
+    cg_mutex_lock(&pipeline->mutex);
+    while(1){
+        while(pipeline->queue_head == NULL && !pipeline->end_of_input && pipeline->status == CG_SUCCESS)
+            cg_condition_wait(&pipeline->block_ready, &pipeline->mutex);
+        if(pipeline->queue_head == NULL || pipeline->status != CG_SUCCESS)
+            break;
+        CGPipelineBlock_t* block = pipeline->queue_head;
+        pipeline->queue_head = block->next;
+        if(pipeline->queue_head == NULL)
+            pipeline->queue_tail = NULL;
+        cg_mutex_unlock(&pipeline->mutex);
+
+        worker->batch->num_points = 0;
+        CGError_t status = cg_parse_csv_block(block->data, block->data + block->size, worker->batch);
+        worker->num_points += worker->batch->num_points;
+        if(status == CG_SUCCESS)
+            status = cg_merge_hull_batch(worker->batch, &worker->hull, &worker->scratch, pipeline->compute_type);
+
+        cg_mutex_lock(&pipeline->mutex);
+        block->next = pipeline->free_blocks;
+        pipeline->free_blocks = block;
+        cg_condition_signal(&pipeline->block_free);
+        if(status != CG_SUCCESS)
+            fail_pipeline(pipeline, status);
+    }
+    cg_mutex_unlock(&pipeline->mutex);
+    return NULL;
+}
+
+
+/** @internal Position after the last newline in [begin, end), or begin if there is none */
+static const char* after_last_newline(const char* begin, const char* end){
+    while(end > begin && end[-1] != '\n')
+        end--;
+    return end;
+}
+
+
+/**
+ * Helper that fills a block with the carried over partial line and then the next bytes of the
+ * file, reading on until the block contains at least one complete line or the file ends.
+ * @internal
+ * @return NO_MEMORY if the block cannot be grown, otherwise SUCCESS.
+ */
+static CGError_t fill_block(CGPipelineBlock_t* block, FILE* file_pointer, char** carry, size_t* carry_size, int* end_of_file){
+    if(block->capacity < *carry_size + PIPELINE_BLOCK_SIZE / 2){
+        size_t capacity = block->capacity ? block->capacity : PIPELINE_BLOCK_SIZE;
+        while(capacity < *carry_size + PIPELINE_BLOCK_SIZE / 2)
+            capacity *= 2;
+        char* data = (char*) cg_realloc(block->data, capacity);
+        if(data == NULL)
+            return CG_NO_MEMORY;
+        block->data = data;
+        block->capacity = capacity;
+    }
+    if(*carry_size > 0)
+        memcpy(block->data, *carry, *carry_size);
+    size_t used = *carry_size;
+    while(1){
+        size_t requested = block->capacity - used;
+        size_t num_read = fread(block->data + used, 1, requested, file_pointer);
+        const char* line_end = after_last_newline(block->data + used, block->data + used + num_read);
+        used += num_read;
+        if(num_read < requested){
+            *end_of_file = 1;
+            break;
+        }
+        else if(line_end != block->data + used - num_read)
+            break;
+        // a single line fills the block, grow it and keep reading
+        char* data = (char*) cg_realloc(block->data, 2 * block->capacity);
+        if(data == NULL)
+            return CG_NO_MEMORY;
+        block->data = data;
+        block->capacity *= 2;
+    }
+
+    // keep the trailing partial line for the next block
+    block->size = *end_of_file ? used : (size_t) (after_last_newline(block->data, block->data + used) - block->data);
+    *carry_size = used - block->size;
+    char* new_carry = (char*) cg_realloc(*carry, *carry_size ? *carry_size : 1);
+    if(new_carry == NULL)
+        return CG_NO_MEMORY;
+    *carry = new_carry;
+    memcpy(*carry, block->data + block->size, *carry_size);
+    return CG_SUCCESS;
+}
+
+
+/** @internal Reader stage run on the calling thread, queues blocks until the file ends or a stage fails */
+static void read_blocks(CGPipeline_t* pipeline, FILE* file_pointer){
+    char* carry = NULL;
+    size_t carry_size = 0;
+    int end_of_file = 0;
+    cg_mutex_lock(&pipeline->mutex);
+    while(!end_of_file && pipeline->status == CG_SUCCESS){
+        while(pipeline->free_blocks == NULL && pipeline->status == CG_SUCCESS)
+            cg_condition_wait(&pipeline->block_free, &pipeline->mutex);
+        if(pipeline->status != CG_SUCCESS)
+            break;
+        CGPipelineBlock_t* block = pipeline->free_blocks;
+        pipeline->free_blocks = block->next;
+        cg_mutex_unlock(&pipeline->mutex);
+
+        CGError_t status = fill_block(block, file_pointer, &carry, &carry_size, &end_of_file);
+        if(status == CG_SUCCESS && ferror(file_pointer))
+            status = CG_NO_FILE;
+
+        cg_mutex_lock(&pipeline->mutex);
+        block->next = NULL;
+        if(status != CG_SUCCESS || block->size == 0){
+            block->next = pipeline->free_blocks;
+            pipeline->free_blocks = block;
+            if(status != CG_SUCCESS)
+                fail_pipeline(pipeline, status);
+        }
+        else{
+            if(pipeline->queue_tail != NULL)
+                pipeline->queue_tail->next = block;
+            else
+                pipeline->queue_head = block;
+            pipeline->queue_tail = block;
+            cg_condition_signal(&pipeline->block_ready);
+        }
+    }
+    pipeline->end_of_input = 1;
+    cg_condition_broadcast(&pipeline->block_ready);
+    cg_mutex_unlock(&pipeline->mutex);
+    cg_free(carry);
+}
+
+
+//----------------------------------------------------------------
+// Functions - Pipelined convex hull
+//----------------------------------------------------------------
+
+
+/**
+ * Function that computes the convex hull of the points in a .csv file, overlapping reading the
+ * file with parsing and hull computation. The calling thread reads the file while worker threads
+ * parse blocks of lines and merge them into partial hulls, which are combined at the end. Lines are
+ * parsed as by point_array_from_csv_path. The result is the same as loading the file and calling
+ * compute_monotone_chain, while memory use stays bounded by a few blocks per thread.
+ * @ingroup chull
+ * @param file_path Path to the .csv file
+ * @param output_array Initialized point array the hull is appended to
+ * @param compute_type Flag to toggle between handling degeneracies or not.
+ * @param num_threads Number of worker threads, or 0 to use one per processor
+ * @return NO_FILE if the file cannot be read, POINTS_TOO_FEW if it has less than 3 points,
+ *      NO_MEMORY if allocation fails, otherwise SUCCESS.
+ */
+CGError_t compute_convex_hull_csv_path(const char* file_path, CGPointArray_t* output_array, CGCompute_t compute_type, int num_threads){
+    if(file_path == NULL || output_array == NULL || num_threads < 0)
+        return CG_INVALID_INPUT;
+    if(num_threads == 0)
+        num_threads = cg_num_cpus();
+    FILE* file_pointer = fopen(file_path, "rb");
+    if(file_pointer == NULL)
+        return CG_NO_FILE;
+
+    CGPipeline_t pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.compute_type = compute_type;
+    int num_blocks = num_threads + PIPELINE_EXTRA_BLOCKS;
+    CGPipelineBlock_t* blocks = (CGPipelineBlock_t*) cg_calloc((size_t) num_blocks, sizeof(CGPipelineBlock_t));
+    CGPipelineWorker_t* workers = (CGPipelineWorker_t*) cg_calloc((size_t) num_threads, sizeof(CGPipelineWorker_t));
+    CGError_t status = (blocks != NULL && workers != NULL) ? CG_SUCCESS : CG_NO_MEMORY;
+    if(status == CG_SUCCESS)
+        status = cg_mutex_init(&pipeline.mutex);
+    if(status == CG_SUCCESS)
+        status = cg_condition_init(&pipeline.block_ready);
+    if(status == CG_SUCCESS)
+        status = cg_condition_init(&pipeline.block_free);
+    int i;
+    for(i = 0; status == CG_SUCCESS && i < num_blocks; i++){
+        blocks[i].next = pipeline.free_blocks;
+        pipeline.free_blocks = &blocks[i];
+    }
+
+    // start the workers, the reader runs on this thread
+    int num_started = 0;
+    for(i = 0; status == CG_SUCCESS && i < num_threads; i++){
+        workers[i].pipeline = &pipeline;
+        workers[i].batch = init_point_array(0);
+        workers[i].hull = init_point_array(0);
+        workers[i].scratch = init_point_array(0);
+        if(workers[i].batch == NULL || workers[i].hull == NULL || workers[i].scratch == NULL)
+            status = CG_NO_MEMORY;
+        else if((status = cg_thread_create(&workers[i].thread, pipeline_worker, &workers[i])) == CG_SUCCESS)
+            num_started++;
+    }
+    if(status == CG_SUCCESS)
+        read_blocks(&pipeline, file_pointer);
+    else if(num_started > 0){
+        cg_mutex_lock(&pipeline.mutex);
+        fail_pipeline(&pipeline, status);
+        cg_mutex_unlock(&pipeline.mutex);
+    }
+    for(i = 0; i < num_started; i++)
+        cg_thread_join(&workers[i].thread);
+    fclose(file_pointer);
+    if(status == CG_SUCCESS)
+        status = pipeline.status;
+
+    // combine the partial hulls of all workers
+    CGPointArray_t* merged = init_point_array(0);
+    if(status == CG_SUCCESS && merged == NULL)
+        status = CG_NO_MEMORY;
+    size_t num_points = 0;
+    for(i = 0; status == CG_SUCCESS && i < num_threads; i++){
+        size_t k;
+        num_points += workers[i].num_points;
+        for(k = 0; status == CG_SUCCESS && k < workers[i].hull->num_points; k++)
+            status = add_coords_to_array(merged, workers[i].hull->xcoords[k], workers[i].hull->ycoords[k]);
+    }
+    if(status == CG_SUCCESS)
+        status = cg_finish_merged_hull(merged, num_points, output_array, compute_type);
+    free_point_array(merged);
+
+    for(i = 0; workers != NULL && i < num_threads; i++){
+        free_point_array(workers[i].batch);
+        free_point_array(workers[i].hull);
+        free_point_array(workers[i].scratch);
+    }
+    for(i = 0; blocks != NULL && i < num_blocks; i++)
+        cg_free(blocks[i].data);
+    cg_condition_destroy(&pipeline.block_free);
+    cg_condition_destroy(&pipeline.block_ready);
+    cg_mutex_destroy(&pipeline.mutex);
+    cg_free(workers);
+    cg_free(blocks);
+    return status;
+}
@@ -0,0 +1,93 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing the optional instrumentation of the library. Built with CGEO_INSTRUMENT
+ * defined (the CGEO_INSTRUMENT CMake option), the algorithms count orientation tests, sort
+ * comparisons and allocations, and time their phases, into counters private to each thread.
+ * Without it the counting macros compile to nothing and get_thread_stats reports UNIMPLEMENTED.
+ *
+ * @defgroup instrument Instrumentation
+ * @brief Per-thread operation counters and phase timers.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+
+#ifdef CGEO_INSTRUMENT
+
+/** @internal Counters of the calling thread */
+CG_THREAD_LOCAL CGStats_t cg_thread_stats;
+
+
+/**
+ * Function that charges the time since the last lap of a timer to a phase, and starts the next lap.
+ * @internal
+ * @param phase Phase that ran since the last lap
+ * @param lap_start Start of the lap, set to the current time
+ */
+void cg_record_phase(CGPhase_t phase, double* lap_start){
+    double now = cg_time_seconds();
+    cg_thread_stats.phase_seconds[phase] += now - *lap_start;
+    cg_thread_stats.phase_calls[phase]++;
+    *lap_start = now;
+}
+
+#endif
+
+
+/**
+ * Function that copies the counters of the calling thread. Work a context runs on its worker
+ * threads is counted on those threads, so only the serial parts of _ctx calls show up here.
+ * @ingroup instrument
+ * @param stats Receives the counters, zeroed when instrumentation is compiled out
+ * @return INVALID_INPUT if stats is NULL, UNIMPLEMENTED if the library was built without CGEO_INSTRUMENT, otherwise SUCCESS.
+ */
+CGError_t get_thread_stats(CGStats_t* stats){
+    if(stats == NULL)
+        return CG_INVALID_INPUT;
+#ifdef CGEO_INSTRUMENT
+    *stats = cg_thread_stats;
+    return CG_SUCCESS;
+#else
+    memset(stats, 0, sizeof(CGStats_t));
+    return CG_UNIMPLEMENTED;
+#endif
+}
+
+
+/**
+ * Function that sets the counters of the calling thread back to zero.
+ * @ingroup instrument
+ * @return UNIMPLEMENTED if the library was built without CGEO_INSTRUMENT, otherwise SUCCESS.
+ */
+CGError_t reset_thread_stats(void){
+#ifdef CGEO_INSTRUMENT
+    memset(&cg_thread_stats, 0, sizeof(CGStats_t));
+    return CG_SUCCESS;
+#else
+    return CG_UNIMPLEMENTED;
+#endif
+}
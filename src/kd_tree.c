@@ -0,0 +1,697 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing a static k-d tree over a point array for nearest neighbour, k nearest
+ * neighbour and radius queries. The tree is built once by splitting at the median of the wider axis,
+ * into a flat array of nodes in depth first order, with a copy of the coordinates reordered so every
+ * subtree's points are contiguous. Queries compare squared distances, and ties between equally near
+ * points go to the smaller position in the array, so results do not depend on the shape of the tree.
+ *
+ * @defgroup kdtree K-d Trees
+ * @brief Static k-d trees for nearest neighbour and radius queries.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+// Most points kept in a leaf, above this nodes are split
+#define KD_LEAF_SIZE 8
+
+// Points a query costs about as much as visiting, to decide when batches are worth splitting
+#define KD_QUERY_COST 64
+
+// Indices a result buffer starts out with
+#define KD_INITIAL_RESULTS 64
+
+
+/**
+ * Struct for a node of a k-d tree. The left child follows its parent in the node array.
+ * @internal
+ */
+typedef struct CG_KdNode {
+    double split;           /**< Coordinate of the splitting line, left points are at most and right ones at least this */
+    size_t begin;           /**< First point of the subtree, in tree order */
+    size_t end;             /**< One past the last point of the subtree */
+    size_t right;           /**< Position of the right child, 0 for a leaf */
+    int axis;               /**< 0 to split on x, 1 on y */
+} CGKdNode_t;
+
+
+/**
+ * Struct for a k-d tree.
+ * @internal
+ */
+struct CG_KdTree {
+    CGPointArray_t* points;     /**< Share of the indexed array, positions in results refer to it */
+    double* xcoords;            /**< x-coordinates in tree order */
+    double* ycoords;            /**< y-coordinates in tree order */
+    size_t* indices;            /**< Position in points of each point in tree order */
+    CGKdNode_t* nodes;          /**< Nodes, the root first */
+    size_t num_nodes;           /**< Number of nodes */
+    size_t num_points;          /**< Number of points indexed */
+};
+
+
+/**
+ * Struct for a growing list of positions found by radius queries.
+ * @internal
+ */
+typedef struct CG_IndexBuffer {
+    size_t* data;               /**< Positions found */
+    size_t count;               /**< Number of positions found */
+    size_t capacity;            /**< Positions that fit in data */
+    int failed;                 /**< Set if growing the buffer failed */
+    CGContext_t* context;       /**< Context whose allocator grows the buffer, NULL for the global allocator */
+} CGIndexBuffer_t;
+
+
+//----------------------------------------------------------------
+// Functions - Building trees
+//----------------------------------------------------------------
+
+
+/** @internal Number of nodes of a subtree over num_points points */
+static size_t count_nodes(size_t num_points){
+    if(num_points <= KD_LEAF_SIZE)
+        return 1;
+    return 1 + count_nodes(num_points / 2) + count_nodes(num_points - num_points / 2);
+}
+
+
+/** @internal Swaps two points in tree order */
+static inline void swap_points(CGKdTree_t* tree, size_t a, size_t b){
+    double xcoord = tree->xcoords[a], ycoord = tree->ycoords[a];
+    size_t index = tree->indices[a];
+    tree->xcoords[a] = tree->xcoords[b];
+    tree->ycoords[a] = tree->ycoords[b];
+    tree->indices[a] = tree->indices[b];
+    tree->xcoords[b] = xcoord;
+    tree->ycoords[b] = ycoord;
+    tree->indices[b] = index;
+}
+
+
+/**
+ * Function that moves the point of rank k along an axis to position k, with no greater coordinate
+ * before it and no smaller one after it, using Wirth's selection in expected linear time.
+ * @internal
+ * @param tree Tree whose points are reordered
+ * @param begin First point of the range
+ * @param end One past the last point of the range
+ * @param k Position to fill, within the range
+ * @param axis 0 to select on x, 1 on y
+ */
+static void select_point(CGKdTree_t* tree, size_t begin, size_t end, size_t k, int axis){
+    double* keys = axis == 0 ? tree->xcoords : tree->ycoords;
+    size_t left = begin, right = end - 1;
+    while(left < right){
+        // median of three guards against sorted and reverse sorted ranges
+        size_t middle = left + (right - left) / 2;
+        if(keys[middle] < keys[left]) swap_points(tree, middle, left);
+        if(keys[right] < keys[left]) swap_points(tree, right, left);
+        if(keys[right] < keys[middle]) swap_points(tree, right, middle);
+        double pivot = keys[middle];
+        size_t i = left, j = right;
+        // stopping on equal keys splits runs of duplicates evenly
+        while(i <= j){
+            while(keys[i] < pivot) i++;
+            while(pivot < keys[j]) j--;
+            if(i <= j){
+                swap_points(tree, i, j);
+                i++;
+                if(j == 0) break;
+                j--;
+            }
+        }
+        if(j < k) left = i;
+        if(k < i) right = j;
+    }
+}
+
+
+/**
+ * Function that builds the subtree over a range of points, splitting the wider axis at its median.
+ * @internal
+ * @param tree Tree being built, with room for every node
+ * @param begin First point of the range
+ * @param end One past the last point of the range
+ * @return Position of the subtree's root in the node array.
+ */
+static size_t build_node(CGKdTree_t* tree, size_t begin, size_t end){
+    size_t node = tree->num_nodes++;
+    CGKdNode_t* kd_node = &tree->nodes[node];
+    kd_node->begin = begin;
+    kd_node->end = end;
+    kd_node->right = 0;
+    kd_node->axis = 0;
+    kd_node->split = 0;
+    if(end - begin <= KD_LEAF_SIZE)
+        return node;
+
+    CGBoundingBox_t box;
+    cg_kernels()->bounding_box(tree->xcoords + begin, tree->ycoords + begin, end - begin, &box);
+    int axis = box.max_x - box.min_x >= box.max_y - box.min_y ? 0 : 1;
+    size_t middle = begin + (end - begin) / 2;
+    select_point(tree, begin, end, middle, axis);
+    kd_node->axis = axis;
+    kd_node->split = axis == 0 ? tree->xcoords[middle] : tree->ycoords[middle];
+    build_node(tree, begin, middle);
+    size_t right = build_node(tree, middle, end);
+    tree->nodes[node].right = right;
+    return node;
+}
+
+
+/**
+ * Function that builds a k-d tree over the points of a point array in O(n log n) time.
+ * The tree shares the array's coordinates like a view does, and keeps a reordered copy of them,
+ * so it stays valid whatever happens to the array afterwards.
+ * @ingroup kdtree
+ * @param point_array Point array to index
+ * @return Allocated tree to be freed with free_kd_tree, or NULL if point_array is NULL or allocation fails.
+ */
+CGKdTree_t* init_kd_tree(CGPointArray_t* point_array){
+    if(point_array == NULL)
+        return NULL;
+    CGKdTree_t* tree = (CGKdTree_t*) cg_calloc(1, sizeof(CGKdTree_t));
+    if(tree == NULL)
+        return NULL;
+    size_t num_points = point_array->num_points;
+    size_t num_nodes = count_nodes(num_points);
+    size_t allocated = num_points ? num_points : 1;
+    tree->points = share_point_array(point_array);
+    tree->xcoords = (double*) cg_malloc(allocated * sizeof(double));
+    tree->ycoords = (double*) cg_malloc(allocated * sizeof(double));
+    tree->indices = (size_t*) cg_malloc(allocated * sizeof(size_t));
+    tree->nodes = (CGKdNode_t*) cg_malloc(num_nodes * sizeof(CGKdNode_t));
+    if(tree->points == NULL || tree->xcoords == NULL || tree->ycoords == NULL || tree->indices == NULL || tree->nodes == NULL){
+        free_kd_tree(tree);
+        return NULL;
+    }
+    if(num_points > 0){
+        memcpy(tree->xcoords, point_array->xcoords, num_points * sizeof(double));
+        memcpy(tree->ycoords, point_array->ycoords, num_points * sizeof(double));
+    }
+    size_t i;
+    for(i = 0; i < num_points; i++)
+        tree->indices[i] = i;
+    tree->num_points = num_points;
+    build_node(tree, 0, num_points);
+    return tree;
+}
+
+
+/**
+ * Function that frees a k-d tree, releasing the shared coordinates if it was their last user.
+ * @ingroup kdtree
+ * @param tree Tree to free
+ * @return INVALID_INPUT if tree is NULL, otherwise SUCCESS.
+ */
+CGError_t free_kd_tree(CGKdTree_t* tree){
+    if(tree == NULL)
+        return CG_INVALID_INPUT;
+    if(tree->points != NULL)
+        free_point_array(tree->points);
+    cg_free(tree->xcoords);
+    cg_free(tree->ycoords);
+    cg_free(tree->indices);
+    cg_free(tree->nodes);
+    cg_free(tree);
+    return CG_SUCCESS;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Searching trees
+//----------------------------------------------------------------
+
+
+/** @internal Whether a point at distance_A and position index_A comes before one at distance_B and index_B */
+static inline int is_nearer(double distance_A, size_t index_A, double distance_B, size_t index_B){
+    return distance_A < distance_B || (distance_A == distance_B && index_A < index_B);
+}
+
+
+/** @internal Finds the nearest point of a subtree, updating the nearest one found so far */
+static void nearest_in_node(const CGKdTree_t* tree, size_t node, double xcoord, double ycoord, size_t* best_index, double* best_distance){
+    const CGKdNode_t* kd_node = &tree->nodes[node];
+    if(kd_node->right == 0){
+        size_t i;
+        for(i = kd_node->begin; i < kd_node->end; i++){
+            double delta_x = tree->xcoords[i] - xcoord, delta_y = tree->ycoords[i] - ycoord;
+            double distance = delta_x * delta_x + delta_y * delta_y;
+            if(is_nearer(distance, tree->indices[i], *best_distance, *best_index)){
+                *best_distance = distance;
+                *best_index = tree->indices[i];
+            }
+        }
+        return;
+    }
+    double offset = (kd_node->axis == 0 ? xcoord : ycoord) - kd_node->split;
+    size_t near_child = offset < 0 ? node + 1 : kd_node->right;
+    size_t far_child = offset < 0 ? kd_node->right : node + 1;
+    nearest_in_node(tree, near_child, xcoord, ycoord, best_index, best_distance);
+    // points on the splitting line can sit on either side, so equal distances are searched too
+    if(offset * offset <= *best_distance)
+        nearest_in_node(tree, far_child, xcoord, ycoord, best_index, best_distance);
+}
+
+
+/**
+ * Struct for the k nearest points found so far, kept as a max-heap in the caller's output arrays.
+ * @internal
+ */
+typedef struct CG_NeighborHeap {
+    size_t* indices;            /**< Positions of the points, the farthest first */
+    double* distances;          /**< Squared distances of the points */
+    size_t count;               /**< Number of points held */
+    size_t capacity;            /**< Number of neighbours wanted */
+} CGNeighborHeap_t;
+
+
+/** @internal Restores the heap order below a slot */
+static void sift_down(CGNeighborHeap_t* heap, size_t slot){
+    while(1){
+        size_t child = 2 * slot + 1;
+        if(child >= heap->count)
+            return;
+        if(child + 1 < heap->count && is_nearer(heap->distances[child], heap->indices[child], heap->distances[child + 1], heap->indices[child + 1]))
+            child++;
+        if(!is_nearer(heap->distances[slot], heap->indices[slot], heap->distances[child], heap->indices[child]))
+            return;
+        double distance = heap->distances[slot];
+        size_t index = heap->indices[slot];
+        heap->distances[slot] = heap->distances[child];
+        heap->indices[slot] = heap->indices[child];
+        heap->distances[child] = distance;
+        heap->indices[child] = index;
+        slot = child;
+    }
+}
+
+
+/** @internal Offers a point to the heap, which keeps it if it is among the nearest so far */
+static void offer_neighbor(CGNeighborHeap_t* heap, double distance, size_t index){
+    if(heap->count < heap->capacity){
+        size_t slot = heap->count++;
+        while(slot > 0){
+            size_t parent = (slot - 1) / 2;
+            if(!is_nearer(heap->distances[parent], heap->indices[parent], distance, index))
+                break;
+            heap->distances[slot] = heap->distances[parent];
+            heap->indices[slot] = heap->indices[parent];
+            slot = parent;
+        }
+        heap->distances[slot] = distance;
+        heap->indices[slot] = index;
+    }
+    else if(is_nearer(distance, index, heap->distances[0], heap->indices[0])){
+        heap->distances[0] = distance;
+        heap->indices[0] = index;
+        sift_down(heap, 0);
+    }
+}
+
+
+/** @internal Offers every point of a subtree that can be among the k nearest to the heap */
+static void k_nearest_in_node(const CGKdTree_t* tree, size_t node, double xcoord, double ycoord, CGNeighborHeap_t* heap){
+    const CGKdNode_t* kd_node = &tree->nodes[node];
+    if(kd_node->right == 0){
+        size_t i;
+        for(i = kd_node->begin; i < kd_node->end; i++){
+            double delta_x = tree->xcoords[i] - xcoord, delta_y = tree->ycoords[i] - ycoord;
+            offer_neighbor(heap, delta_x * delta_x + delta_y * delta_y, tree->indices[i]);
+        }
+        return;
+    }
+    double offset = (kd_node->axis == 0 ? xcoord : ycoord) - kd_node->split;
+    size_t near_child = offset < 0 ? node + 1 : kd_node->right;
+    size_t far_child = offset < 0 ? kd_node->right : node + 1;
+    k_nearest_in_node(tree, near_child, xcoord, ycoord, heap);
+    if(heap->count < heap->capacity || offset * offset <= heap->distances[0])
+        k_nearest_in_node(tree, far_child, xcoord, ycoord, heap);
+}
+
+
+/** @internal Appends a position to a result buffer, growing it as needed */
+static void append_index(CGIndexBuffer_t* buffer, size_t index){
+    if(buffer->count == buffer->capacity){
+        size_t capacity = buffer->capacity ? 2 * buffer->capacity : KD_INITIAL_RESULTS;
+        size_t* data = (size_t*) cg_context_realloc(buffer->context, buffer->data, capacity * sizeof(size_t));
+        if(data == NULL){
+            buffer->failed = 1;
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    buffer->data[buffer->count++] = index;
+}
+
+
+/** @internal Appends every point of a subtree within a squared radius of a point */
+static void radius_in_node(const CGKdTree_t* tree, size_t node, double xcoord, double ycoord, double squared_radius, CGIndexBuffer_t* buffer){
+    const CGKdNode_t* kd_node = &tree->nodes[node];
+    if(kd_node->right == 0){
+        size_t i;
+        for(i = kd_node->begin; i < kd_node->end; i++){
+            double delta_x = tree->xcoords[i] - xcoord, delta_y = tree->ycoords[i] - ycoord;
+            if(delta_x * delta_x + delta_y * delta_y <= squared_radius)
+                append_index(buffer, tree->indices[i]);
+        }
+        return;
+    }
+    double offset = (kd_node->axis == 0 ? xcoord : ycoord) - kd_node->split;
+    if(offset <= 0 || offset * offset <= squared_radius)
+        radius_in_node(tree, node + 1, xcoord, ycoord, squared_radius, buffer);
+    if(offset >= 0 || offset * offset <= squared_radius)
+        radius_in_node(tree, kd_node->right, xcoord, ycoord, squared_radius, buffer);
+}
+
+
+/**
+ * Function that finds the point of a tree nearest to a location.
+ * @ingroup kdtree
+ * @param tree Tree to search
+ * @param xcoord x-coordinate of the location
+ * @param ycoord y-coordinate of the location
+ * @param index Output position of the nearest point in the indexed array, the smallest one on ties
+ * @param squared_distance NULL, or output squared distance of the nearest point
+ * @return INVALID_INPUT if tree or index is NULL, POINTS_TOO_FEW if the tree is empty, otherwise SUCCESS.
+ */
+CGError_t kd_tree_nearest(const CGKdTree_t* tree, double xcoord, double ycoord, size_t* index, double* squared_distance){
+    if(tree == NULL || index == NULL)
+        return CG_INVALID_INPUT;
+    else if(tree->num_points == 0)
+        return CG_POINTS_TOO_FEW;
+    double best_distance = HUGE_VAL;
+    *index = (size_t) -1;
+    nearest_in_node(tree, 0, xcoord, ycoord, index, &best_distance);
+    if(squared_distance != NULL)
+        *squared_distance = best_distance;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that finds the k points of a tree nearest to a location, nearest first.
+ * @ingroup kdtree
+ * @param tree Tree to search
+ * @param xcoord x-coordinate of the location
+ * @param ycoord y-coordinate of the location
+ * @param k Number of points to find
+ * @param indices Output positions of the k nearest points in the indexed array, ties ordered by position
+ * @param squared_distances Output squared distances of the k nearest points
+ * @return INVALID_INPUT if a pointer is NULL or k is 0, POINTS_TOO_FEW if the tree has fewer than k points,
+ *      otherwise SUCCESS.
+ */
+CGError_t kd_tree_k_nearest(const CGKdTree_t* tree, double xcoord, double ycoord, size_t k, size_t* indices, double* squared_distances){
+    if(tree == NULL || indices == NULL || squared_distances == NULL || k == 0)
+        return CG_INVALID_INPUT;
+    else if(tree->num_points < k)
+        return CG_POINTS_TOO_FEW;
+    CGNeighborHeap_t heap = {indices, squared_distances, 0, k};
+    k_nearest_in_node(tree, 0, xcoord, ycoord, &heap);
+    // taking the farthest off the top of the heap leaves the points sorted nearest first
+    while(heap.count > 1){
+        size_t last = --heap.count;
+        double distance = heap.distances[0];
+        size_t index = heap.indices[0];
+        heap.distances[0] = heap.distances[last];
+        heap.indices[0] = heap.indices[last];
+        heap.distances[last] = distance;
+        heap.indices[last] = index;
+        sift_down(&heap, 0);
+    }
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that finds every point of a tree within a radius of a location, the boundary included.
+ * @ingroup kdtree
+ * @param tree Tree to search
+ * @param xcoord x-coordinate of the location
+ * @param ycoord y-coordinate of the location
+ * @param radius Largest distance of a point found
+ * @param output_view View of the indexed array, the positions of the points found are appended to it
+ *      in no particular order
+ * @return INVALID_INPUT if a pointer is NULL, the radius is negative or the view is of another array,
+ *      NO_MEMORY if the view cannot be grown, otherwise SUCCESS.
+ */
+CGError_t kd_tree_radius(const CGKdTree_t* tree, double xcoord, double ycoord, double radius, CGPointView_t* output_view){
+    if(tree == NULL || output_view == NULL || !(radius >= 0) || output_view->points->xcoords != tree->points->xcoords)
+        return CG_INVALID_INPUT;
+    if(tree->num_points == 0)
+        return CG_SUCCESS;
+    CGIndexBuffer_t buffer = {NULL, 0, 0, 0, NULL};
+    radius_in_node(tree, 0, xcoord, ycoord, radius * radius, &buffer);
+    CGError_t status = buffer.failed ? CG_NO_MEMORY : CG_SUCCESS;
+    if(status == CG_SUCCESS && buffer.count > 0){
+        size_t* indices = (size_t*) cg_realloc(output_view->indices, (output_view->num_indices + buffer.count) * sizeof(size_t));
+        if(indices == NULL)
+            status = CG_NO_MEMORY;
+        else{
+            output_view->indices = indices;
+            memcpy(indices + output_view->num_indices, buffer.data, buffer.count * sizeof(size_t));
+            output_view->num_indices += buffer.count;
+        }
+    }
+    cg_free(buffer.data);
+    return status;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Batched queries
+//----------------------------------------------------------------
+
+
+/**
+ * Struct describing the slice of queries answered by one task of a batched query.
+ * @internal
+ */
+typedef struct CG_KdQueryChunk {
+    const CGKdTree_t* tree;             /**< Tree to search */
+    const CGPointArray_t* queries;      /**< Query locations */
+    size_t begin;                       /**< First query of the slice */
+    size_t end;                         /**< One past the last query of the slice */
+    size_t k;                           /**< Neighbours per query of k nearest queries */
+    double radius;                      /**< Radius of radius queries */
+    size_t* indices;                    /**< Output positions, k per query */
+    double* squared_distances;          /**< Output squared distances, k per query */
+    size_t* counts;                     /**< Output number of points found by each radius query */
+    CGIndexBuffer_t found;              /**< Points found by the slice's radius queries */
+} CGKdQueryChunk_t;
+
+
+/** @internal Task answering one slice of nearest or k nearest queries */
+static void k_nearest_chunk_task(void* argument, size_t task_index, CGArena_t* arena){
+    (void) arena;
+    CGKdQueryChunk_t* chunk = (CGKdQueryChunk_t*) argument + task_index;
+    size_t i;
+    for(i = chunk->begin; i < chunk->end; i++){
+        double xcoord = chunk->queries->xcoords[i], ycoord = chunk->queries->ycoords[i];
+        if(chunk->k == 0)
+            kd_tree_nearest(chunk->tree, xcoord, ycoord, chunk->indices + i,
+                            chunk->squared_distances != NULL ? chunk->squared_distances + i : NULL);
+        else
+            kd_tree_k_nearest(chunk->tree, xcoord, ycoord, chunk->k, chunk->indices + i * chunk->k, chunk->squared_distances + i * chunk->k);
+    }
+}
+
+
+/** @internal Task answering one slice of radius queries */
+static void radius_chunk_task(void* argument, size_t task_index, CGArena_t* arena){
+    (void) arena;
+    CGKdQueryChunk_t* chunk = (CGKdQueryChunk_t*) argument + task_index;
+    double squared_radius = chunk->radius * chunk->radius;
+    size_t i;
+    for(i = chunk->begin; i < chunk->end && !chunk->found.failed; i++){
+        size_t before = chunk->found.count;
+        radius_in_node(chunk->tree, 0, chunk->queries->xcoords[i], chunk->queries->ycoords[i], squared_radius, &chunk->found);
+        chunk->counts[i] = chunk->found.count - before;
+    }
+}
+
+
+/**
+ * Function that splits a batch of queries into slices for the worker pool of a context.
+ * @internal
+ * @param context Context providing the worker pool
+ * @param arena Arena the slices are allocated from
+ * @param tree Tree to search
+ * @param queries Query locations
+ * @param num_chunks Output number of slices
+ * @return Slices with their tree and query ranges set and every other field zeroed, NULL if allocation fails.
+ */
+static CGKdQueryChunk_t* split_queries(CGContext_t* context, CGArena_t* arena, const CGKdTree_t* tree,
+                                       const CGPointArray_t* queries, size_t* num_chunks){
+    size_t num_queries = queries->num_points;
+    *num_chunks = cg_context_point_tasks(context, num_queries * KD_QUERY_COST, 4);
+    CGKdQueryChunk_t* chunks = (CGKdQueryChunk_t*) cg_arena_alloc(arena, *num_chunks * sizeof(CGKdQueryChunk_t));
+    if(chunks == NULL)
+        return NULL;
+    memset(chunks, 0, *num_chunks * sizeof(CGKdQueryChunk_t));
+    size_t i;
+    for(i = 0; i < *num_chunks; i++){
+        chunks[i].tree = tree;
+        chunks[i].queries = queries;
+        chunks[i].begin = num_queries / *num_chunks * i;
+        chunks[i].end = (i == *num_chunks - 1) ? num_queries : num_queries / *num_chunks * (i + 1);
+    }
+    return chunks;
+}
+
+
+/** @internal Runs nearest (k of 0) or k nearest queries for a batch on a context */
+static CGError_t k_nearest_batch(CGContext_t* context, const CGKdTree_t* tree, const CGPointArray_t* queries, size_t k,
+                                 size_t* indices, double* squared_distances){
+    CGArena_t* arena = cg_context_acquire_arena(context);
+    size_t num_chunks, i;
+    CGKdQueryChunk_t* chunks = split_queries(context, arena, tree, queries, &num_chunks);
+    if(chunks == NULL){
+        cg_context_release_arena(context, arena);
+        return CG_NO_MEMORY;
+    }
+    for(i = 0; i < num_chunks; i++){
+        chunks[i].k = k;
+        chunks[i].indices = indices;
+        chunks[i].squared_distances = squared_distances;
+    }
+    cg_context_parallel_for(context, num_chunks, k_nearest_chunk_task, chunks);
+    cg_context_release_arena(context, arena);
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that finds the nearest point of a tree to every location of a batch, on the worker pool of a context.
+ * @ingroup kdtree
+ * @param context Context providing the worker pool
+ * @param tree Tree to search
+ * @param queries Query locations
+ * @param indices Output position of the nearest point to each query, one per query
+ * @param squared_distances NULL, or output squared distance of each nearest point
+ * @return INVALID_INPUT if a required param is NULL, POINTS_TOO_FEW if the tree is empty,
+ *      NO_MEMORY if scratch space cannot be allocated, otherwise SUCCESS.
+ */
+CGError_t kd_tree_nearest_batch_ctx(CGContext_t* context, const CGKdTree_t* tree, const CGPointArray_t* queries,
+                                    size_t* indices, double* squared_distances){
+    if(context == NULL || tree == NULL || queries == NULL || indices == NULL)
+        return CG_INVALID_INPUT;
+    else if(tree->num_points == 0)
+        return CG_POINTS_TOO_FEW;
+    return k_nearest_batch(context, tree, queries, 0, indices, squared_distances);
+}
+
+
+/**
+ * Function that finds the k nearest points of a tree to every location of a batch, on the worker pool of a context.
+ * @ingroup kdtree
+ * @param context Context providing the worker pool
+ * @param tree Tree to search
+ * @param queries Query locations
+ * @param k Number of points to find per query
+ * @param indices Output positions, k per query in query order, each query's nearest first
+ * @param squared_distances Output squared distances, laid out like indices
+ * @return INVALID_INPUT if a param is NULL or k is 0, POINTS_TOO_FEW if the tree has fewer than k points,
+ *      NO_MEMORY if scratch space cannot be allocated, otherwise SUCCESS.
+ */
+CGError_t kd_tree_k_nearest_batch_ctx(CGContext_t* context, const CGKdTree_t* tree, const CGPointArray_t* queries, size_t k,
+                                      size_t* indices, double* squared_distances){
+    if(context == NULL || tree == NULL || queries == NULL || indices == NULL || squared_distances == NULL || k == 0)
+        return CG_INVALID_INPUT;
+    else if(tree->num_points < k)
+        return CG_POINTS_TOO_FEW;
+    return k_nearest_batch(context, tree, queries, k, indices, squared_distances);
+}
+
+
+/**
+ * Function that finds the points of a tree within a radius of every location of a batch, on the worker
+ * pool of a context. Results are returned in compressed rows: the points found for query i are
+ * (*indices)[offsets[i]] up to (*indices)[offsets[i + 1]], in no particular order.
+ * @ingroup kdtree
+ * @param context Context providing the worker pool
+ * @param tree Tree to search
+ * @param queries Query locations
+ * @param radius Largest distance of a point found
+ * @param indices Output positions of the points found, allocated by the library and released with free_buffer
+ * @param offsets Output start of each query's points in indices, with room for one more entry than there are queries
+ * @return INVALID_INPUT if a param is NULL or the radius is negative, NO_MEMORY if allocation fails, otherwise SUCCESS.
+ */
+CGError_t kd_tree_radius_batch_ctx(CGContext_t* context, const CGKdTree_t* tree, const CGPointArray_t* queries, double radius,
+                                   size_t** indices, size_t* offsets){
+    if(context == NULL || tree == NULL || queries == NULL || indices == NULL || offsets == NULL || !(radius >= 0))
+        return CG_INVALID_INPUT;
+    size_t num_queries = queries->num_points;
+    size_t i;
+    *indices = NULL;
+    if(tree->num_points == 0){
+        for(i = 0; i <= num_queries; i++)
+            offsets[i] = 0;
+        return CG_SUCCESS;
+    }
+
+    CGArena_t* arena = cg_context_acquire_arena(context);
+    size_t num_chunks;
+    CGKdQueryChunk_t* chunks = split_queries(context, arena, tree, queries, &num_chunks);
+    if(chunks == NULL){
+        cg_context_release_arena(context, arena);
+        return CG_NO_MEMORY;
+    }
+    for(i = 0; i < num_chunks; i++){
+        chunks[i].radius = radius;
+        chunks[i].counts = offsets + 1;
+        chunks[i].found.context = context;
+    }
+    cg_context_parallel_for(context, num_chunks, radius_chunk_task, chunks);
+
+    // each slice found its points in a buffer of its own, which are joined in query order
+    CGError_t status = CG_SUCCESS;
+    size_t total = 0;
+    for(i = 0; i < num_chunks; i++){
+        if(chunks[i].found.failed)
+            status = CG_NO_MEMORY;
+        total += chunks[i].found.count;
+    }
+    if(status == CG_SUCCESS){
+        *indices = (size_t*) cg_malloc((total ? total : 1) * sizeof(size_t));
+        if(*indices == NULL)
+            status = CG_NO_MEMORY;
+    }
+    if(status == CG_SUCCESS){
+        offsets[0] = 0;
+        for(i = 0; i < num_queries; i++)
+            offsets[i + 1] += offsets[i];
+        for(i = 0; i < num_chunks; i++)
+            memcpy(*indices + offsets[chunks[i].begin], chunks[i].found.data, chunks[i].found.count * sizeof(size_t));
+    }
+    for(i = 0; i < num_chunks; i++)
+        cg_context_free(context, chunks[i].found.data);
+    cg_context_release_arena(context, arena);
+    return status;
+}
@@ -33,9 +33,11 @@
  */
 
 
-// libCGeo includes
+// libCGeo includes, csplit allocates through the libCGeo allocator
+#include "libCGeo/libCGeo_internal.h"
+#define CSPLIT_CALLOC(count, size) cg_calloc(count, size)
+#define CSPLIT_FREE(pointer) cg_free(pointer)
 #include "csplit.h"
-#include "libCGeo/libCGeo.h"
 
 // Maximum number of characters read per line in .csv files
 #define LINE_BUFFER 256
@@ -52,27 +54,39 @@
  * @return pointer to allocated point set.
  */
 CGPointSet_t* init_point_set(){
-    CGPointSet_t* point_set = (CGPointSet_t*) calloc(1, sizeof(CGPointSet_t));
+    CGPointSet_t* point_set = (CGPointSet_t*) cg_calloc(1, sizeof(CGPointSet_t));
     point_set->num_points = 0;
     return point_set;
 }
 
 
 CGError_t add_coords_to_set(CGPointSet_t* point_set, double xCoord, double yCoord){
-    CGPoint_t* point = malloc(sizeof(CGPoint_t));
+    CGPoint_t* point = cg_calloc(1, sizeof(CGPoint_t));
+    if(point == NULL)
+        return CG_NO_MEMORY;
     point->xcoord = xCoord;
     point->ycoord = yCoord;
     CGError_t err = add_point_to_set(point_set, point);
     if(err != CG_SUCCESS)
-        free(point);
+        cg_free(point);
     return err;
 }
 
 
+/**
+ * Function that appends a point to a point set. The set takes ownership of the point, which must
+ * be allocated with the libCGeo allocator (see set_allocator).
+ * @ingroup pttypes
+ * @param point_set Initialized point set
+ * @param point Point to append
+ * @return INVALID_INPUT if either param is NULL, NO_MEMORY if the list node cannot be allocated, otherwise SUCCESS.
+ */
 CGError_t add_point_to_set(CGPointSet_t* point_set, CGPoint_t* point){
     if(point_set == NULL || point == NULL) return CG_INVALID_INPUT;
     else {
-        CGPointNode_t* pnode = (CGPointNode_t*) malloc(sizeof(CGPointNode_t));
+        CGPointNode_t* pnode = (CGPointNode_t*) cg_calloc(1, sizeof(CGPointNode_t));
+        if(pnode == NULL)
+            return CG_NO_MEMORY;
         pnode->point = point;
         if(point_set->head == NULL){
             point_set->head = pnode;
@@ -89,7 +103,7 @@ CGError_t add_point_to_set(CGPointSet_t* point_set, CGPoint_t* point){
 }
 
 
-CGPoint_t* get_point_at_index(CGPointSet_t* point_set, int index){
+CGPoint_t* get_point_at_index(const CGPointSet_t* point_set, int index){
     if(point_set->num_points <= index)
         return NULL;
     CGPointNode_t* current_node = point_set->head;
@@ -118,13 +132,14 @@ CGError_t free_point_set(CGPointSet_t* point_set){
     else{
         CGPointNode_t* current = point_set->head;
         while(current != NULL){
-            free(current->point);
+            cg_free(current->point);
             CGPointNode_t* temp = current->next;
-            free(current);
+            cg_free(current);
             current = temp;
         }
     }
-    free(point_set);
+    cg_free_hull_cache(point_set->hull_cache);
+    cg_free(point_set);
     return status;
 }
 
@@ -136,13 +151,13 @@ CGError_t free_point_set(CGPointSet_t* point_set){
  * @param out_point_set Initialized output point set (must have same num_points as input set)
  * @return CG_INVALID_INPUT if either param is Null or invalid, otherwise CG_SUCCESS
  */
-CGError_t copy_point_set(CGPointSet_t* in_point_set, CGPointSet_t* out_point_set){
+CGError_t copy_point_set(const CGPointSet_t* in_point_set, CGPointSet_t* out_point_set){
     if(in_point_set == NULL || out_point_set == NULL)
         return CG_INVALID_INPUT;
     else{
         CGPointNode_t* current_node = in_point_set->head;
         while(current_node != NULL){
-            CGPoint_t* point = malloc(sizeof(CGPoint_t));
+            CGPoint_t* point = cg_malloc(sizeof(CGPoint_t));
             memcpy((void*) point, (void*) current_node->point, sizeof(CGPoint_t));
             add_point_to_set(out_point_set, point);
             current_node = current_node->next;
@@ -152,6 +167,47 @@ CGError_t copy_point_set(CGPointSet_t* in_point_set, CGPointSet_t* out_point_set
 }
 
 
+/**
+ * Function that copies the coordinates of a point set into a compact coordinate array.
+ * @ingroup pttypes
+ * @param point_set Point set to copy
+ * @param coords Array with room for point_set->num_points coordinates
+ * @return CG_INVALID_INPUT if either param is NULL, otherwise CG_SUCCESS
+ */
+CGError_t coords_from_point_set(const CGPointSet_t* point_set, CGCoord_t* coords){
+    if(point_set == NULL || (coords == NULL && point_set->num_points > 0))
+        return CG_INVALID_INPUT;
+    CGPointNode_t* current_node = point_set->head;
+    size_t i = 0;
+    while(current_node != NULL){
+        coords[i].xcoord = current_node->point->xcoord;
+        coords[i].ycoord = current_node->point->ycoord;
+        current_node = current_node->next;
+        i++;
+    }
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that appends compact coordinates to a point set.
+ * @ingroup pttypes
+ * @param coords Array of coordinates
+ * @param num_coords Number of coordinates in the array
+ * @param point_set Initialized point set
+ * @return CG_INVALID_INPUT if either param is NULL, CG_NO_MEMORY if a point cannot be allocated, otherwise CG_SUCCESS
+ */
+CGError_t point_set_from_coords(const CGCoord_t* coords, size_t num_coords, CGPointSet_t* point_set){
+    if(point_set == NULL || (coords == NULL && num_coords > 0))
+        return CG_INVALID_INPUT;
+    CGError_t status = CG_SUCCESS;
+    size_t i;
+    for(i = 0; status == CG_SUCCESS && i < num_coords; i++)
+        status = add_coords_to_set(point_set, coords[i].xcoord, coords[i].ycoord);
+    return status;
+}
+
+
 //----------------------------------------------------------------
 // Functions - Reading from and writing to files
 //----------------------------------------------------------------
@@ -179,7 +235,7 @@ CGError_t point_set_from_csv_file(CGPointSet_t* point_set, FILE* file){
             CSplitList_t* list = csplit_init_list();
             char* temp = csplit_strip(buffer);
             CSplitError_t err = csplit(list, temp, ",");
-            free(temp);
+            cg_free(temp);
             if(err == CSPLIT_SUCCESS && list->num_elems == 2){
                 double xcoord = atof(list->head->text);
                 double ycoord = atof(list->tail->text);
@@ -192,25 +248,6 @@ CGError_t point_set_from_csv_file(CGPointSet_t* point_set, FILE* file){
 }
 
 
-/**
- * Function for writing a point set to a .csv file
- * @ingroup file
- * @param point_set Point set to write into the file
- * @param file_pointer File pointer of file to write into.
- * @return INVALID_INPUT if either is null or can't write to file, otherwise success.
- */
-CGError_t csv_file_from_point_set(CGPointSet_t* point_set, FILE* file_pointer){
-    if(point_set == NULL || file_pointer == NULL)
-        return CG_INVALID_INPUT;
-    CGPointNode_t* current_node = point_set->head;
-    while(current_node != NULL){
-        fprintf(file_pointer, "%lf,%lf\n", current_node->point->xcoord, current_node->point->ycoord);
-        current_node = current_node->next;
-    }
-    return CG_SUCCESS;
-}
-
-
 //----------------------------------------------------------------
 // Math Operations and relationships for points
 //----------------------------------------------------------------
@@ -224,7 +261,8 @@ CGError_t csv_file_from_point_set(CGPointSet_t* point_set, FILE* file_pointer){
  * @param point_C The last point out of the three.
  * @return Inline if points are colinear, otherwise left or right
  */
-CGTurn_t find_turn_type(CGPoint_t* point_A, CGPoint_t* point_B, CGPoint_t* point_C){
+CGTurn_t find_turn_type(const CGPoint_t* point_A, const CGPoint_t* point_B, const CGPoint_t* point_C){
+    CG_COUNT(orientation_tests, 1);
     int value = (point_B->ycoord - point_A->ycoord)*(point_C->xcoord - point_B->xcoord) -
                 (point_B->xcoord - point_A->xcoord)*(point_C->ycoord - point_B->ycoord);
     if(value == 0) return CG_TURN_INLINE;
@@ -238,7 +276,7 @@ CGTurn_t find_turn_type(CGPoint_t* point_A, CGPoint_t* point_B, CGPoint_t* point
  * @param point_set Point Set to search through
  * @return NULL if point set is NULL or empty, otherwise lowest point by y-coordinate
  */
-CGPoint_t* find_lowest_point_in_set(CGPointSet_t* point_set){
+CGPoint_t* find_lowest_point_in_set(const CGPointSet_t* point_set){
     if(point_set == NULL)
         return NULL;
     else if(point_set->num_points == 0)
@@ -266,7 +304,7 @@ CGPoint_t* find_lowest_point_in_set(CGPointSet_t* point_set){
  * @param point_B Second point.
  * @return Straight line distance between point_A and point_B, negative if invalid.
  */
-double distance_between(CGPoint_t* point_A, CGPoint_t* point_B){
+double distance_between(const CGPoint_t* point_A, const CGPoint_t* point_B){
     if(point_A == NULL || point_B == NULL){
         return -1;
     }
@@ -284,7 +322,7 @@ double distance_between(CGPoint_t* point_A, CGPoint_t* point_B){
  * @param end_point The ending point for the angle ray
  * @return -1 if invalid, otherwise angle made by ray between two points and horizontal line.
  */
-double angle_between(CGPoint_t* initial_point, CGPoint_t* end_point){
+double angle_between(const CGPoint_t* initial_point, const CGPoint_t* end_point){
     if(initial_point->ycoord > end_point->ycoord) return -1;
     else if(initial_point->ycoord == end_point->ycoord && initial_point->xcoord > end_point->xcoord)
         return -1;
@@ -304,28 +342,48 @@ double angle_between(CGPoint_t* initial_point, CGPoint_t* end_point){
 
 /**
  * Function that sorts point set based on the values in each point's sort_val.
+ * Threads sharing a set should use sort_point_set_into, which takes the set as const.
+ * @ingroup setops
  * @param point_set Point Set to be sorted
  * @param output_point_set Point Set into which the sorted set is placed. If this is NULL or equal to point_set, then point_set overwritten by output
  * @return CG_INVALID_INPUT if point_set is null or empty, otherwise success.
  */
 CGError_t sort_point_set(CGPointSet_t* point_set, CGPointSet_t* output_point_set){
+    if(output_point_set != NULL && output_point_set != point_set)
+        return sort_point_set_into(point_set, output_point_set);
     CGError_t status = CG_SUCCESS;
     if(point_set == NULL) return CG_INVALID_INPUT;
     else if(point_set->head == NULL) return CG_INVALID_INPUT;
     else{
-        if(output_point_set == NULL){
-            status = sort_points(&(point_set->head));
-        }
-        else{
-            status = copy_point_set(point_set, output_point_set);
-            if(status == CG_SUCCESS)
-                status = sort_points(&(output_point_set->head));
-        }
+        CG_PHASE_START(timer);
+        status = sort_points(&(point_set->head));
+        CG_PHASE_LAP(timer, CG_PHASE_SORT);
         return status;
     }
 }
 
 
+/**
+ * Function that appends the points of a set to another set and sorts it by each point's sort_val.
+ * point_set is only read, so threads may sort one shared set into sets of their own.
+ * @ingroup setops
+ * @param point_set Point Set to be sorted
+ * @param output_point_set Point Set other than point_set into which the sorted points are placed
+ * @return CG_INVALID_INPUT if either set is NULL, point_set is empty or both are the same set,
+ *      CG_NO_MEMORY if the points cannot be copied, otherwise success.
+ */
+CGError_t sort_point_set_into(const CGPointSet_t* point_set, CGPointSet_t* output_point_set){
+    if(point_set == NULL || output_point_set == NULL || output_point_set == point_set) return CG_INVALID_INPUT;
+    else if(point_set->head == NULL) return CG_INVALID_INPUT;
+    CG_PHASE_START(timer);
+    CGError_t status = copy_point_set(point_set, output_point_set);
+    if(status == CG_SUCCESS)
+        status = sort_points(&(output_point_set->head));
+    CG_PHASE_LAP(timer, CG_PHASE_SORT);
+    return status;
+}
+
+
 /**
  * Helper function that sorts array of points.
  * @ingroup setops
@@ -390,6 +448,7 @@ CGPointNode_t* merge_halves(CGPointNode_t* left_list, CGPointNode_t* right_list)
     if(left_list == NULL) return right_list;
     else if(right_list == NULL) return left_list;
 
+    CG_COUNT(comparisons, 1);
     if(left_list->point->sort_val <= right_list->point->sort_val) {
         result_head = left_list;
         result_head->next = merge_halves(left_list->next, right_list);
@@ -400,3 +459,69 @@ CGPointNode_t* merge_halves(CGPointNode_t* left_list, CGPointNode_t* right_list)
     }
     return result_head;
 }
+
+
+/**
+ * Function that sorts compact coordinates by a key per coordinate, moving the keys along.
+ * Keys are kept in their own array so the coordinates stay 16 bytes each. The sort is a stable
+ * bottom-up merge sort, so equal keys keep their order just like sort_point_set.
+ * @ingroup setops
+ * @param coords Coordinates to sort
+ * @param keys Sort key of each coordinate, sorted ascending alongside
+ * @param num_coords Number of coordinates
+ * @return CG_INVALID_INPUT if an array is NULL, CG_NO_MEMORY if scratch space cannot be allocated, otherwise CG_SUCCESS
+ */
+CGError_t sort_coords_by_keys(CGCoord_t* coords, double* keys, size_t num_coords){
+    if(num_coords < 2)
+        return CG_SUCCESS;
+    else if(coords == NULL || keys == NULL)
+        return CG_INVALID_INPUT;
+    CGCoord_t* coords_scratch = (CGCoord_t*) cg_malloc(num_coords * sizeof(CGCoord_t));
+    double* keys_scratch = (double*) cg_malloc(num_coords * sizeof(double));
+    if(coords_scratch == NULL || keys_scratch == NULL){
+        cg_free(coords_scratch);
+        cg_free(keys_scratch);
+        return CG_NO_MEMORY;
+    }
+
+    CGCoord_t* coords_in = coords;
+    double* keys_in = keys;
+    CGCoord_t* coords_out = coords_scratch;
+    double* keys_out = keys_scratch;
+    size_t width;
+    for(width = 1; width < num_coords; width *= 2){
+        size_t left;
+        for(left = 0; left < num_coords; left += 2 * width){
+            size_t middle = (left + width < num_coords) ? left + width : num_coords;
+            size_t right = (middle + width < num_coords) ? middle + width : num_coords;
+            size_t i = left, j = middle, k = left;
+            while(i < middle && j < right){
+                CG_COUNT(comparisons, 1);
+                size_t from = (keys_in[i] <= keys_in[j]) ? i++ : j++;
+                coords_out[k] = coords_in[from];
+                keys_out[k++] = keys_in[from];
+            }
+            for(; i < middle; i++, k++){
+                coords_out[k] = coords_in[i];
+                keys_out[k] = keys_in[i];
+            }
+            for(; j < right; j++, k++){
+                coords_out[k] = coords_in[j];
+                keys_out[k] = keys_in[j];
+            }
+        }
+        CGCoord_t* coords_temp = coords_in;
+        coords_in = coords_out;
+        coords_out = coords_temp;
+        double* keys_temp = keys_in;
+        keys_in = keys_out;
+        keys_out = keys_temp;
+    }
+    if(coords_in != coords){
+        memcpy(coords, coords_in, num_coords * sizeof(CGCoord_t));
+        memcpy(keys, keys_in, num_coords * sizeof(double));
+    }
+    cg_free(coords_scratch);
+    cg_free(keys_scratch);
+    return CG_SUCCESS;
+}
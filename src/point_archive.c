@@ -0,0 +1,525 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing the encoder and decoder for compressed point archives.
+ *
+ * Coordinates are quantized to multiples of a user given precision relative to the minimum corner
+ * of the bounding box, optionally reordered along a Morton curve, and then stored as zigzag encoded
+ * deltas between consecutive points using little-endian base 128 varints. Spatially coherent
+ * inputs need one or two bytes per coordinate.
+ *
+ * All multi-byte fields are little-endian. A 64 byte header
+ *
+ *  offset  size  field
+ *  0       8     magic "CGEOARC\0"
+ *  8       4     format version, currently 1
+ *  12      4     flags, bit 0 is set if the points were Morton ordered
+ *  16      4     maximum points per block
+ *  20      4     reserved, zero
+ *  24      8     number of points
+ *  32      8     precision
+ *  40      8     origin x
+ *  48      8     origin y
+ *  56      8     reserved, zero
+ *
+ * is followed by blocks made of a 4 byte point count, a 4 byte payload size and the payload. Every
+ * block restarts its deltas at the origin, so blocks can be decoded one at a time or independently.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+#define ARCHIVE_MAGIC           "CGEOARC"
+#define ARCHIVE_VERSION         1
+#define ARCHIVE_HEADER_SIZE     64
+#define ARCHIVE_BLOCK_HEADER    8
+#define ARCHIVE_FLAG_MORTON     1u
+#define ARCHIVE_DEFAULT_BLOCK   (1 << 16)
+
+// Largest quantized coordinate. Keeping it below 2^62 lets deltas be formed without overflow.
+#define ARCHIVE_MAX_QUANTIZED   4.0e18
+
+// Longest varint encoding of a 64 bit value.
+#define VARINT_MAX_BYTES        10
+
+
+//----------------------------------------------------------------
+// Functions - Byte level helpers
+//----------------------------------------------------------------
+
+
+/** @internal Stores a 32 bit value in little-endian order */
+static inline void store_le32(uint8_t* out, uint32_t value){
+    int i;
+    for(i = 0; i < 4; i++)
+        out[i] = (uint8_t) (value >> (8 * i));
+}
+
+
+/** @internal Stores a 64 bit value in little-endian order */
+static inline void store_le64(uint8_t* out, uint64_t value){
+    int i;
+    for(i = 0; i < 8; i++)
+        out[i] = (uint8_t) (value >> (8 * i));
+}
+
+
+/** @internal Loads a 32 bit little-endian value */
+static inline uint32_t load_le32(const uint8_t* in){
+    return (uint32_t) in[0] | ((uint32_t) in[1] << 8) | ((uint32_t) in[2] << 16) | ((uint32_t) in[3] << 24);
+}
+
+
+/** @internal Loads a 64 bit little-endian value */
+static inline uint64_t load_le64(const uint8_t* in){
+    return (uint64_t) load_le32(in) | ((uint64_t) load_le32(in + 4) << 32);
+}
+
+
+/** @internal Stores a double in little-endian order */
+static inline void store_le_double(uint8_t* out, double value){
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    store_le64(out, bits);
+}
+
+
+/** @internal Loads a little-endian double */
+static inline double load_le_double(const uint8_t* in){
+    uint64_t bits = load_le64(in);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+/** @internal Maps a signed delta, held in two's complement, onto an unsigned value with small magnitudes first */
+static inline uint64_t zigzag_encode(uint64_t delta){
+    return (delta << 1) ^ (0 - (delta >> 63));
+}
+
+
+/** @internal Inverse of zigzag_encode */
+static inline uint64_t zigzag_decode(uint64_t value){
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+
+/** @internal Writes a varint, returns the position after it */
+static inline uint8_t* write_varint(uint8_t* out, uint64_t value){
+    while(value >= 0x80){
+        *out++ = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t) value;
+    return out;
+}
+
+
+/**
+ * Reads a varint without checking for the end of the buffer, the caller guarantees that
+ * VARINT_MAX_BYTES bytes are readable. Varints of up to eight bytes are decoded from a single
+ * 64 bit load by locating the terminating byte and compacting the 7 bit groups.
+ * @internal
+ * @return Position after the varint, or NULL if it is longer than VARINT_MAX_BYTES.
+ */
+static inline const uint8_t* read_varint_unchecked(const uint8_t* in, uint64_t* value){
+    if(*in < 0x80){
+        *value = *in;
+        return in + 1;
+    }
+    uint64_t word;
+    memcpy(&word, in, sizeof(word));
+#ifndef CG_LITTLE_ENDIAN
+    word = cg_byteswap64(word);
+#endif
+    uint64_t terminators = ~word & 0x8080808080808080ull;
+    if(terminators != 0){
+        unsigned length = (unsigned) (cg_ctz64(terminators) + 1) / 8;
+        if(length < 8)
+            word &= (1ull << (8 * length)) - 1;
+        word &= 0x7f7f7f7f7f7f7f7full;
+        word = (word & 0x007f007f007f007full) | ((word & 0x7f007f007f007f00ull) >> 1);
+        word = (word & 0x00003fff00003fffull) | ((word & 0x3fff00003fff0000ull) >> 2);
+        word = (word & 0x000000000fffffffull) | ((word & 0x0fffffff00000000ull) >> 4);
+        *value = word;
+        return in + length;
+    }
+    uint64_t result = 0;
+    unsigned shift;
+    for(shift = 0; shift < 7 * VARINT_MAX_BYTES; shift += 7){
+        uint64_t byte = *in++;
+        result |= (byte & 0x7f) << shift;
+        if(byte < 0x80){
+            *value = result;
+            return in;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * Reads a varint that may run up to end.
+ * @internal
+ * @return Position after the varint, or NULL if it is truncated or too long.
+ */
+static inline const uint8_t* read_varint(const uint8_t* in, const uint8_t* end, uint64_t* value){
+    uint64_t result = 0;
+    unsigned shift;
+    for(shift = 0; shift < 7 * VARINT_MAX_BYTES && in < end; shift += 7){
+        uint64_t byte = *in++;
+        result |= (byte & 0x7f) << shift;
+        if(byte < 0x80){
+            *value = result;
+            return in;
+        }
+    }
+    return NULL;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Encoding
+//----------------------------------------------------------------
+
+
+/** @internal Quantized coordinates of a point and its position along the Morton curve */
+typedef struct CG_QuantizedPoint {
+    uint64_t morton_code;       /**< Interleaved bits of the quantized coordinates */
+    uint64_t xcoord;            /**< Quantized x-coordinate */
+    uint64_t ycoord;            /**< Quantized y-coordinate */
+} CGQuantizedPoint_t;
+
+
+/** @internal qsort comparator ordering quantized points by Morton code */
+static int compare_morton_codes(const void* first, const void* second){
+    uint64_t code_a = ((const CGQuantizedPoint_t*) first)->morton_code;
+    uint64_t code_b = ((const CGQuantizedPoint_t*) second)->morton_code;
+    return (code_a > code_b) - (code_a < code_b);
+}
+
+
+/**
+ * Helper that quantizes all points of an array relative to the bounding box minimum.
+ * @internal
+ * @return INVALID_INPUT if a coordinate is not finite or the precision is too fine for the extent
+ *      of the points, NO_MEMORY if allocation fails, otherwise SUCCESS.
+ */
+static CGError_t quantize_points(const CGPointArray_t* point_array, const CGArchiveOptions_t* options,
+                                 CGArchiveHeader_t* header, CGQuantizedPoint_t** quantized){
+    *quantized = NULL;
+    header->origin_x = 0;
+    header->origin_y = 0;
+    if(point_array->num_points == 0)
+        return CG_SUCCESS;
+
+    CGBoundingBox_t bounding_box;
+    compute_bounding_box(point_array, &bounding_box);
+    if(!isfinite(bounding_box.min_x) || !isfinite(bounding_box.max_x) ||
+       !isfinite(bounding_box.min_y) || !isfinite(bounding_box.max_y))
+        return CG_INVALID_INPUT;
+    if((bounding_box.max_x - bounding_box.min_x) / header->precision > ARCHIVE_MAX_QUANTIZED ||
+       (bounding_box.max_y - bounding_box.min_y) / header->precision > ARCHIVE_MAX_QUANTIZED)
+        return CG_INVALID_INPUT;
+    header->origin_x = bounding_box.min_x;
+    header->origin_y = bounding_box.min_y;
+
+    CGQuantizedPoint_t* points = (CGQuantizedPoint_t*) cg_malloc(point_array->num_points * sizeof(CGQuantizedPoint_t));
+    if(points == NULL)
+        return CG_NO_MEMORY;
+    uint64_t max_quantized = 0;
+    size_t i;
+    for(i = 0; i < point_array->num_points; i++){
+        points[i].xcoord = (uint64_t) llround((point_array->xcoords[i] - header->origin_x) / header->precision);
+        points[i].ycoord = (uint64_t) llround((point_array->ycoords[i] - header->origin_y) / header->precision);
+        max_quantized |= points[i].xcoord | points[i].ycoord;
+    }
+
+    if(options->morton_order){
+        // the curve only needs 32 bits per axis, coarser bits are enough to order wider ranges
+        unsigned shift = 0;
+        while((max_quantized >> shift) > 0xffffffffull)
+            shift++;
+        for(i = 0; i < point_array->num_points; i++)
+            points[i].morton_code = cg_spread_bits(points[i].xcoord >> shift) | (cg_spread_bits(points[i].ycoord >> shift) << 1);
+        qsort(points, point_array->num_points, sizeof(CGQuantizedPoint_t), compare_morton_codes);
+    }
+    *quantized = points;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function for writing a point array to a compressed point archive.
+ * @ingroup file
+ * @param point_array Point array to write into the archive
+ * @param file_path Path of the file to create or overwrite
+ * @param options Encoding settings, the precision must be positive
+ * @return INVALID_INPUT if the points cannot be quantized to the precision or writing fails,
+ *      NO_FILE if the file cannot be opened, NO_MEMORY if allocation fails, otherwise SUCCESS.
+ */
+CGError_t archive_file_from_point_array(const CGPointArray_t* point_array, const char* file_path, const CGArchiveOptions_t* options){
+    if(point_array == NULL || file_path == NULL || options == NULL)
+        return CG_INVALID_INPUT;
+    if(!(options->precision > 0) || !isfinite(options->precision) || options->block_size > UINT32_MAX / (2 * VARINT_MAX_BYTES))
+        return CG_INVALID_INPUT;
+
+    CGArchiveHeader_t header;
+    header.num_points = point_array->num_points;
+    header.flags = options->morton_order ? ARCHIVE_FLAG_MORTON : 0;
+    header.block_size = options->block_size ? (uint32_t) options->block_size : ARCHIVE_DEFAULT_BLOCK;
+    header.precision = options->precision;
+    CGQuantizedPoint_t* quantized;
+    CGError_t status = quantize_points(point_array, options, &header, &quantized);
+    if(status != CG_SUCCESS)
+        return status;
+
+    uint8_t* block = (uint8_t*) cg_malloc(ARCHIVE_BLOCK_HEADER + (size_t) header.block_size * 2 * VARINT_MAX_BYTES);
+    FILE* file_pointer = block ? fopen(file_path, "wb") : NULL;
+    if(file_pointer == NULL){
+        cg_free(block);
+        cg_free(quantized);
+        return block ? CG_NO_FILE : CG_NO_MEMORY;
+    }
+
+    uint8_t raw_header[ARCHIVE_HEADER_SIZE] = {0};
+    memcpy(raw_header, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    store_le32(raw_header + 8, ARCHIVE_VERSION);
+    store_le32(raw_header + 12, header.flags);
+    store_le32(raw_header + 16, header.block_size);
+    store_le64(raw_header + 24, header.num_points);
+    store_le_double(raw_header + 32, header.precision);
+    store_le_double(raw_header + 40, header.origin_x);
+    store_le_double(raw_header + 48, header.origin_y);
+    int ok = fwrite(raw_header, 1, ARCHIVE_HEADER_SIZE, file_pointer) == ARCHIVE_HEADER_SIZE;
+
+    size_t block_start;
+    for(block_start = 0; ok && block_start < point_array->num_points; block_start += header.block_size){
+        size_t block_end = block_start + header.block_size;
+        if(block_end > point_array->num_points)
+            block_end = point_array->num_points;
+        uint8_t* out = block + ARCHIVE_BLOCK_HEADER;
+        uint64_t previous_x = 0, previous_y = 0;
+        size_t i;
+        for(i = block_start; i < block_end; i++){
+            out = write_varint(out, zigzag_encode(quantized[i].xcoord - previous_x));
+            out = write_varint(out, zigzag_encode(quantized[i].ycoord - previous_y));
+            previous_x = quantized[i].xcoord;
+            previous_y = quantized[i].ycoord;
+        }
+        size_t payload_size = (size_t) (out - block) - ARCHIVE_BLOCK_HEADER;
+        store_le32(block, (uint32_t) (block_end - block_start));
+        store_le32(block + 4, (uint32_t) payload_size);
+        ok = fwrite(block, 1, ARCHIVE_BLOCK_HEADER + payload_size, file_pointer) == ARCHIVE_BLOCK_HEADER + payload_size;
+    }
+    ok = (fclose(file_pointer) == 0) && ok;
+    cg_free(block);
+    cg_free(quantized);
+    return ok ? CG_SUCCESS : CG_INVALID_INPUT;
+}
+
+
+/**
+ * Function for writing a point set to a compressed point archive.
+ * @ingroup file
+ * @param point_set Point set to write into the archive
+ * @param file_path Path of the file to create or overwrite
+ * @param options Encoding settings, the precision must be positive
+ * @return Status of archive_file_from_point_array, or NO_MEMORY if allocation fails.
+ */
+CGError_t archive_file_from_point_set(const CGPointSet_t* point_set, const char* file_path, const CGArchiveOptions_t* options){
+    if(point_set == NULL || file_path == NULL || options == NULL)
+        return CG_INVALID_INPUT;
+    CGPointArray_t* point_array = init_point_array(point_set->num_points);
+    if(point_array == NULL)
+        return CG_NO_MEMORY;
+    CGError_t status = point_array_from_point_set(point_set, point_array);
+    if(status == CG_SUCCESS)
+        status = archive_file_from_point_array(point_array, file_path, options);
+    free_point_array(point_array);
+    return status;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Decoding
+//----------------------------------------------------------------
+
+
+/**
+ * Function that checks and decodes the header of a compressed point archive.
+ * @internal
+ * @param data Start of the archive contents
+ * @param size Size of the archive in bytes
+ * @param header Output decoded header
+ * @param first_block Receives the position of the first block
+ * @return INVALID_FILE if the header is not valid, otherwise SUCCESS.
+ */
+CGError_t cg_read_archive_header(const char* data, size_t size, CGArchiveHeader_t* header, const char** first_block){
+    const uint8_t* raw_header = (const uint8_t*) data;
+    if(data == NULL || size < ARCHIVE_HEADER_SIZE || memcmp(raw_header, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0)
+        return CG_INVALID_FILE;
+    if(load_le32(raw_header + 8) != ARCHIVE_VERSION)
+        return CG_INVALID_FILE;
+    header->flags = load_le32(raw_header + 12);
+    header->block_size = load_le32(raw_header + 16);
+    header->num_points = load_le64(raw_header + 24);
+    header->precision = load_le_double(raw_header + 32);
+    header->origin_x = load_le_double(raw_header + 40);
+    header->origin_y = load_le_double(raw_header + 48);
+    // every point takes at least two bytes, which bounds the count by the file size
+    if(header->block_size == 0 || header->num_points > size / 2)
+        return CG_INVALID_FILE;
+    *first_block = data + ARCHIVE_HEADER_SIZE;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that decodes one block of a compressed point archive, appending its points to an array.
+ * @internal
+ * @param begin Start of the block
+ * @param end End of the archive
+ * @param header Decoded archive header
+ * @param point_array Array the points are appended to
+ * @param next_block Receives the position of the following block
+ * @return INVALID_FILE if the block is corrupt, NO_MEMORY if the array cannot be grown, otherwise SUCCESS.
+ */
+CGError_t cg_decode_archive_block(const char* begin, const char* end, const CGArchiveHeader_t* header,
+                                  CGPointArray_t* point_array, const char** next_block){
+    if(end - begin < ARCHIVE_BLOCK_HEADER)
+        return CG_INVALID_FILE;
+    const uint8_t* in = (const uint8_t*) begin;
+    uint32_t num_points = load_le32(in);
+    uint32_t payload_size = load_le32(in + 4);
+    in += ARCHIVE_BLOCK_HEADER;
+    if(num_points > header->block_size || (size_t) (end - (const char*) in) < payload_size)
+        return CG_INVALID_FILE;
+    const uint8_t* payload_end = in + payload_size;
+
+    CGError_t status = reserve_point_array(point_array, point_array->num_points + num_points);
+    if(status != CG_SUCCESS)
+        return status;
+    double* xcoords = point_array->xcoords + point_array->num_points;
+    double* ycoords = point_array->ycoords + point_array->num_points;
+    const double precision = header->precision;
+    const double origin_x = header->origin_x;
+    const double origin_y = header->origin_y;
+    uint64_t quantized_x = 0, quantized_y = 0;
+    uint32_t i = 0;
+
+    // bounds are only checked once per point while two full varints are guaranteed to be readable
+    while(i < num_points && payload_end - in >= 2 * VARINT_MAX_BYTES){
+        uint64_t delta_x, delta_y;
+        in = read_varint_unchecked(in, &delta_x);
+        if(in == NULL)
+            return CG_INVALID_FILE;
+        in = read_varint_unchecked(in, &delta_y);
+        if(in == NULL)
+            return CG_INVALID_FILE;
+        quantized_x += zigzag_decode(delta_x);
+        quantized_y += zigzag_decode(delta_y);
+        xcoords[i] = origin_x + (double) (int64_t) quantized_x * precision;
+        ycoords[i] = origin_y + (double) (int64_t) quantized_y * precision;
+        i++;
+    }
+    while(i < num_points){
+        uint64_t delta_x, delta_y;
+        in = read_varint(in, payload_end, &delta_x);
+        if(in == NULL)
+            return CG_INVALID_FILE;
+        in = read_varint(in, payload_end, &delta_y);
+        if(in == NULL)
+            return CG_INVALID_FILE;
+        quantized_x += zigzag_decode(delta_x);
+        quantized_y += zigzag_decode(delta_y);
+        xcoords[i] = origin_x + (double) (int64_t) quantized_x * precision;
+        ycoords[i] = origin_y + (double) (int64_t) quantized_y * precision;
+        i++;
+    }
+    if(in != payload_end)
+        return CG_INVALID_FILE;
+    point_array->num_points += num_points;
+    *next_block = (const char*) payload_end;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that reads a compressed point archive, appending its points to a point array.
+ * Points come back in the order they were stored, which is Morton order if the archive was
+ * written with that option.
+ * @ingroup file
+ * @param point_array Initialized point array
+ * @param file_path Path to the archive
+ * @return NO_FILE if the file cannot be mapped, INVALID_FILE if it is not a valid archive,
+ *      NO_MEMORY if the array cannot be grown, otherwise SUCCESS.
+ */
+CGError_t point_array_from_archive_file(CGPointArray_t* point_array, const char* file_path){
+    if(point_array == NULL || file_path == NULL)
+        return CG_INVALID_INPUT;
+    CGFileMap_t file_map;
+    CGError_t status = cg_map_file(file_path, &file_map);
+    if(status != CG_SUCCESS)
+        return status;
+
+    CGArchiveHeader_t header;
+    const char* block;
+    const char* end = file_map.data + file_map.size;
+    size_t initial_points = point_array->num_points;
+    status = cg_read_archive_header(file_map.data, file_map.size, &header, &block);
+    if(status == CG_SUCCESS)
+        status = reserve_point_array(point_array, initial_points + (size_t) header.num_points);
+    while(status == CG_SUCCESS && block < end)
+        status = cg_decode_archive_block(block, end, &header, point_array, &block);
+    if(status == CG_SUCCESS && point_array->num_points - initial_points != header.num_points)
+        status = CG_INVALID_FILE;
+    if(status != CG_SUCCESS)
+        point_array->num_points = initial_points;
+    cg_unmap_file(&file_map);
+    return status;
+}
+
+
+/**
+ * Function that reads a compressed point archive into a point set.
+ * @ingroup file
+ * @param point_set Initialized point set to which the points are appended
+ * @param file_path Path to the archive
+ * @return Status of point_array_from_archive_file or of adding the points.
+ */
+CGError_t point_set_from_archive_file(CGPointSet_t* point_set, const char* file_path){
+    if(point_set == NULL || file_path == NULL)
+        return CG_INVALID_INPUT;
+    CGPointArray_t* point_array = init_point_array(0);
+    if(point_array == NULL)
+        return CG_NO_MEMORY;
+    CGError_t status = point_array_from_archive_file(point_array, file_path);
+    if(status == CG_SUCCESS)
+        status = point_set_from_point_array(point_array, point_set);
+    free_point_array(point_array);
+    return status;
+}
@@ -0,0 +1,383 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * @defgroup ptarray Point Arrays
+ * @brief Contiguous point storage used by the bulk loaders and array based algorithms.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+// Capacity used when growing an array that has no storage yet
+#define INITIAL_ARRAY_CAPACITY 16
+
+
+//----------------------------------------------------------------
+// Functions - Init and free point arrays
+//----------------------------------------------------------------
+
+
+/**
+ * Function that initializes an empty point array with room for a given number of points.
+ * @ingroup ptarray
+ * @param capacity Number of points to preallocate storage for. May be 0.
+ * @return pointer to allocated point array, or NULL if allocation fails.
+ */
+CGPointArray_t* init_point_array(size_t capacity){
+    CGPointArray_t* point_array = (CGPointArray_t*) cg_calloc(1, sizeof(CGPointArray_t));
+    if(point_array == NULL)
+        return NULL;
+    if(capacity > 0 && reserve_point_array(point_array, capacity) != CG_SUCCESS){
+        cg_free(point_array);
+        return NULL;
+    }
+    return point_array;
+}
+
+
+/**
+ * Helper that gives an array sharing its coordinates heap storage of its own. Heap coordinates
+ * it no longer shares with anyone are taken over, all others are copied.
+ * @internal
+ */
+static CGError_t detach_point_array(CGPointArray_t* point_array, size_t capacity){
+    CGSharedStorage_t* storage = (CGSharedStorage_t*) point_array->storage;
+    if(storage->file_map.data == NULL && cg_atomic_load(&storage->ref_count) == 1){
+        point_array->capacity = storage->capacity;
+        cg_free(storage);
+        point_array->storage = NULL;
+        return CG_SUCCESS;
+    }
+
+    if(capacity < point_array->num_points)
+        capacity = point_array->num_points;
+    if(capacity == 0)
+        capacity = INITIAL_ARRAY_CAPACITY;
+    double* xcoords = (double*) cg_malloc(capacity * sizeof(double));
+    double* ycoords = (double*) cg_malloc(capacity * sizeof(double));
+    if(xcoords == NULL || ycoords == NULL){
+        cg_free(xcoords);
+        cg_free(ycoords);
+        return CG_NO_MEMORY;
+    }
+    memcpy(xcoords, point_array->xcoords, point_array->num_points * sizeof(double));
+    memcpy(ycoords, point_array->ycoords, point_array->num_points * sizeof(double));
+    cg_release_point_array_storage(point_array);
+    point_array->xcoords = xcoords;
+    point_array->ycoords = ycoords;
+    point_array->capacity = capacity;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that drops a point array's reference to shared storage, releasing the coordinates
+ * if it was the last user.
+ * @internal
+ * @param point_array Point array whose storage pointer is cleared
+ */
+void cg_release_point_array_storage(CGPointArray_t* point_array){
+    CGSharedStorage_t* storage = (CGSharedStorage_t*) point_array->storage;
+    if(storage == NULL)
+        return;
+    point_array->storage = NULL;
+    if(cg_atomic_decrement(&storage->ref_count) > 0)
+        return;
+    if(storage->file_map.data != NULL)
+        cg_unmap_file(&storage->file_map);
+    cg_free(storage->xcoords);
+    cg_free(storage->ycoords);
+    cg_free(storage);
+}
+
+
+/**
+ * Function that creates a second point array sharing the coordinates of another, without copying
+ * them. Both arrays become read-only views of the coordinates; the first one to be grown or made
+ * writable copies them, so changes are never visible through the other array. Arrays that already
+ * share their coordinates may be shared again from several threads at once.
+ * @ingroup ptarray
+ * @param point_array Point array to share
+ * @return New point array to be freed with free_point_array, or NULL if allocation fails.
+ */
+CGPointArray_t* share_point_array(CGPointArray_t* point_array){
+    if(point_array == NULL)
+        return NULL;
+    CGPointArray_t* shared = (CGPointArray_t*) cg_malloc(sizeof(CGPointArray_t));
+    if(shared == NULL)
+        return NULL;
+    if(point_array->storage == NULL){
+        CGSharedStorage_t* storage = (CGSharedStorage_t*) cg_calloc(1, sizeof(CGSharedStorage_t));
+        if(storage == NULL){
+            cg_free(shared);
+            return NULL;
+        }
+        storage->ref_count = 1;
+        storage->xcoords = point_array->xcoords;
+        storage->ycoords = point_array->ycoords;
+        storage->capacity = point_array->capacity;
+        point_array->storage = storage;
+        point_array->capacity = 0;
+    }
+    cg_atomic_increment(&((CGSharedStorage_t*) point_array->storage)->ref_count);
+    *shared = *point_array;
+    return shared;
+}
+
+
+/**
+ * Function that makes sure the coordinates of a point array may be written in place, copying
+ * them if they are shared with other arrays or mapped from a file.
+ * @ingroup ptarray
+ * @param point_array Point array about to be modified
+ * @return INVALID_INPUT if point_array is NULL, NO_MEMORY if the copy fails, otherwise SUCCESS.
+ */
+CGError_t make_point_array_writable(CGPointArray_t* point_array){
+    if(point_array == NULL)
+        return CG_INVALID_INPUT;
+    else if(point_array->storage == NULL)
+        return CG_SUCCESS;
+    return detach_point_array(point_array, point_array->num_points);
+}
+
+
+/**
+ * Function that makes sure a point array can hold at least capacity points without reallocating.
+ * Arrays sharing their coordinates get heap storage of their own first.
+ * @ingroup ptarray
+ * @param point_array Initialized point array.
+ * @param capacity Minimum number of points the array should be able to hold.
+ * @return INVALID_INPUT if array is NULL, NO_MEMORY if growing fails, otherwise SUCCESS.
+ */
+CGError_t reserve_point_array(CGPointArray_t* point_array, size_t capacity){
+    if(point_array == NULL)
+        return CG_INVALID_INPUT;
+    else if(capacity <= point_array->capacity)
+        return CG_SUCCESS;
+    else if(point_array->storage != NULL){
+        CGError_t status = detach_point_array(point_array, capacity);
+        if(status != CG_SUCCESS || capacity <= point_array->capacity)
+            return status;
+    }
+
+    double* xcoords = (double*) cg_realloc(point_array->xcoords, capacity * sizeof(double));
+    if(xcoords == NULL)
+        return CG_NO_MEMORY;
+    point_array->xcoords = xcoords;
+
+    double* ycoords = (double*) cg_realloc(point_array->ycoords, capacity * sizeof(double));
+    if(ycoords == NULL)
+        return CG_NO_MEMORY;
+    point_array->ycoords = ycoords;
+
+    point_array->capacity = capacity;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that appends a point to the end of a point array, growing it if needed.
+ * @ingroup ptarray
+ * @param point_array Initialized point array.
+ * @param xCoord x-coordinate of the new point
+ * @param yCoord y-coordinate of the new point
+ * @return INVALID_INPUT if array is NULL, NO_MEMORY if growing fails, otherwise SUCCESS.
+ */
+CGError_t add_coords_to_array(CGPointArray_t* point_array, double xCoord, double yCoord){
+    if(point_array == NULL)
+        return CG_INVALID_INPUT;
+    if(point_array->num_points >= point_array->capacity){
+        // mapped arrays report no capacity, so growth starts from the points they hold
+        size_t new_capacity = (point_array->num_points > point_array->capacity ? point_array->num_points : point_array->capacity) * 2;
+        if(new_capacity < INITIAL_ARRAY_CAPACITY)
+            new_capacity = INITIAL_ARRAY_CAPACITY;
+        CGError_t status = reserve_point_array(point_array, new_capacity);
+        if(status != CG_SUCCESS)
+            return status;
+    }
+    point_array->xcoords[point_array->num_points] = xCoord;
+    point_array->ycoords[point_array->num_points] = yCoord;
+    point_array->num_points++;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that frees memory allocated by init_point_array.
+ * @ingroup ptarray
+ * @param point_array Point array to free.
+ * @return INVALID INPUT error if array isnt allocated, otherwise SUCCESS.
+ */
+CGError_t free_point_array(CGPointArray_t* point_array){
+    if(point_array == NULL)
+        return CG_INVALID_INPUT;
+    if(point_array->storage != NULL){
+        cg_release_point_array_storage(point_array);
+    }
+    else{
+        cg_free(point_array->xcoords);
+        cg_free(point_array->ycoords);
+    }
+    cg_free(point_array);
+    return CG_SUCCESS;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Converting between point sets and point arrays
+//----------------------------------------------------------------
+
+
+/**
+ * Function that appends all points of a linked list point set to a point array.
+ * @ingroup ptarray
+ * @param point_set Input point set
+ * @param point_array Initialized point array that receives the coordinates
+ * @return INVALID_INPUT if either param is NULL, NO_MEMORY if growing fails, otherwise SUCCESS.
+ */
+CGError_t point_array_from_point_set(const CGPointSet_t* point_set, CGPointArray_t* point_array){
+    if(point_set == NULL || point_array == NULL)
+        return CG_INVALID_INPUT;
+    CGError_t status = reserve_point_array(point_array, point_array->num_points + point_set->num_points);
+    if(status != CG_SUCCESS)
+        return status;
+    CGPointNode_t* current_node = point_set->head;
+    while(current_node != NULL){
+        point_array->xcoords[point_array->num_points] = current_node->point->xcoord;
+        point_array->ycoords[point_array->num_points] = current_node->point->ycoord;
+        point_array->num_points++;
+        current_node = current_node->next;
+    }
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that appends all points of a point array to a linked list point set.
+ * @ingroup ptarray
+ * @param point_array Input point array
+ * @param point_set Initialized point set that receives the points
+ * @return INVALID_INPUT if either param is NULL, otherwise SUCCESS.
+ */
+CGError_t point_set_from_point_array(const CGPointArray_t* point_array, CGPointSet_t* point_set){
+    if(point_array == NULL || point_set == NULL)
+        return CG_INVALID_INPUT;
+    size_t i;
+    for(i = 0; i < point_array->num_points; i++){
+        CGError_t status = add_coords_to_set(point_set, point_array->xcoords[i], point_array->ycoords[i]);
+        if(status != CG_SUCCESS)
+            return status;
+    }
+    return CG_SUCCESS;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Point array calculations
+//----------------------------------------------------------------
+
+
+/**
+ * Function that finds the axis aligned bounding box of a point array.
+ * @ingroup ptarray
+ * @param point_array Input point array
+ * @param bounding_box Output bounding box
+ * @return INVALID_INPUT if either param is NULL, POINTS_TOO_FEW if the array is empty, otherwise SUCCESS.
+ */
+CGError_t compute_bounding_box(const CGPointArray_t* point_array, CGBoundingBox_t* bounding_box){
+    if(point_array == NULL || bounding_box == NULL)
+        return CG_INVALID_INPUT;
+    else if(point_array->num_points == 0)
+        return CG_POINTS_TOO_FEW;
+    cg_kernels()->bounding_box(point_array->xcoords, point_array->ycoords, point_array->num_points, bounding_box);
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Struct describing the slice of the input bounded by one task of compute_bounding_box_ctx.
+ * @internal
+ */
+typedef struct CG_BoundsChunk {
+    CGPointArray_t slice;               /**< Points of the slice, viewing the input */
+    CGBoundingBox_t bounding_box;       /**< Bounding box of the slice */
+} CGBoundsChunk_t;
+
+
+/** @internal Task that bounds one slice of the points */
+static void bounds_chunk_task(void* argument, size_t task_index, CGArena_t* arena){
+    (void) arena;
+    CGBoundsChunk_t* chunk = (CGBoundsChunk_t*) argument + task_index;
+    compute_bounding_box(&chunk->slice, &chunk->bounding_box);
+}
+
+
+/**
+ * Function that computes the bounding box of a point array on the worker pool of a context.
+ * Above the context's threshold slices of the array are bounded in parallel and combined.
+ * @ingroup ptarray
+ * @param context Context providing the worker pool
+ * @param point_array Point array to bound
+ * @param bounding_box Output bounding box
+ * @return INVALID_INPUT if a param is NULL, POINTS_TOO_FEW if the array is empty,
+ *      NO_MEMORY if scratch space cannot be allocated, otherwise SUCCESS.
+ */
+CGError_t compute_bounding_box_ctx(CGContext_t* context, const CGPointArray_t* point_array, CGBoundingBox_t* bounding_box){
+    if(context == NULL || point_array == NULL || bounding_box == NULL)
+        return CG_INVALID_INPUT;
+    size_t num_chunks = cg_context_point_tasks(context, point_array->num_points, 1);
+    if(num_chunks == 1)
+        return compute_bounding_box(point_array, bounding_box);
+
+    CGArena_t* arena = cg_context_acquire_arena(context);
+    CGBoundsChunk_t* chunks = (CGBoundsChunk_t*) cg_arena_alloc(arena, num_chunks * sizeof(CGBoundsChunk_t));
+    if(chunks == NULL){
+        cg_context_release_arena(context, arena);
+        return CG_NO_MEMORY;
+    }
+    size_t num_points = point_array->num_points;
+    size_t i;
+    for(i = 0; i < num_chunks; i++){
+        size_t begin = num_points / num_chunks * i;
+        size_t end = (i == num_chunks - 1) ? num_points : num_points / num_chunks * (i + 1);
+        chunks[i].slice.xcoords = point_array->xcoords + begin;
+        chunks[i].slice.ycoords = point_array->ycoords + begin;
+        chunks[i].slice.num_points = end - begin;
+        chunks[i].slice.capacity = 0;
+        chunks[i].slice.storage = NULL;
+    }
+    cg_context_parallel_for(context, num_chunks, bounds_chunk_task, chunks);
+
+    *bounding_box = chunks[0].bounding_box;
+    for(i = 1; i < num_chunks; i++){
+        const CGBoundingBox_t* chunk_box = &chunks[i].bounding_box;
+        bounding_box->min_x = chunk_box->min_x < bounding_box->min_x ? chunk_box->min_x : bounding_box->min_x;
+        bounding_box->min_y = chunk_box->min_y < bounding_box->min_y ? chunk_box->min_y : bounding_box->min_y;
+        bounding_box->max_x = chunk_box->max_x > bounding_box->max_x ? chunk_box->max_x : bounding_box->max_x;
+        bounding_box->max_y = chunk_box->max_y > bounding_box->max_y ? chunk_box->max_y : bounding_box->max_y;
+    }
+    cg_context_release_arena(context, arena);
+    return CG_SUCCESS;
+}
@@ -0,0 +1,285 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing seeded generators of point arrays in the distributions used to test and
+ * benchmark the library. Every point is derived from the seed and its own index alone, so the output
+ * for a given seed is the same from any thread and however the work is split. The integer streams are
+ * portable, but the disk, circle and cluster distributions go through the C library's cos, sin and log,
+ * so their coordinates may differ in the last bits between C libraries.
+ *
+ * @defgroup generate Point Generation
+ * @brief Reproducible inputs, from well behaved to adversarial, for tests and benchmarks.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+// Number of cluster centers of CG_GAUSSIAN_CLUSTERS, and the standard deviation around each
+#define NUM_CLUSTERS        16
+#define CLUSTER_SIGMA       0.02
+
+// Average number of copies of each distinct point of CG_DUPLICATES
+#define DUPLICATE_COPIES    64
+
+// Center and half-width of the square sampled by CG_LARGE_MAGNITUDE
+#define LARGE_CENTER        1e12
+#define LARGE_HALF_WIDTH    1e3
+
+#define GENERATOR_PI        3.14159265358979323846
+
+
+//----------------------------------------------------------------
+// Functions - Random numbers
+//----------------------------------------------------------------
+
+
+/**
+ * Struct holding the state of the random stream of one point.
+ * @internal
+ */
+typedef struct CG_RandomStream {
+    uint64_t state;     /**< splitmix64 state */
+} CGRandomStream_t;
+
+
+/** @internal splitmix64 step, also used to hash the seed and index into a stream */
+static uint64_t next_random(CGRandomStream_t* stream){
+    uint64_t z = (stream->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+
+/** @internal Starts the stream of the element at index of the sequence picked by seed and salt */
+static void init_random_stream(CGRandomStream_t* stream, uint64_t seed, uint64_t salt, uint64_t index){
+    stream->state = seed ^ (salt * 0xD1B54A32D192ED03ULL);
+    stream->state = next_random(stream) ^ index;
+    stream->state = next_random(stream);
+}
+
+
+/** @internal Uniform double in [0, 1) */
+static double next_uniform(CGRandomStream_t* stream){
+    return (double) (next_random(stream) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+/** @internal Standard normal double, from the Box-Muller transform */
+static double next_gaussian(CGRandomStream_t* stream){
+    double u = 1.0 - next_uniform(stream);
+    double v = next_uniform(stream);
+    return sqrt(-2.0 * log(u)) * cos(2.0 * GENERATOR_PI * v);
+}
+
+
+//----------------------------------------------------------------
+// Functions - Distributions
+//----------------------------------------------------------------
+
+
+/**
+ * Struct holding the parameters shared by every point of one generated array.
+ * @internal
+ */
+typedef struct CG_Generator {
+    CGDistribution_t distribution;  /**< Distribution to sample */
+    uint64_t seed;                  /**< Seed picking the sequence */
+    size_t num_points;              /**< Number of points generated */
+    double* xcoords;                /**< Output x-coordinates, indexed by point */
+    double* ycoords;                /**< Output y-coordinates, indexed by point */
+} CGGenerator_t;
+
+
+/** @internal Uniform point of the square [-1, 1) x [-1, 1), the one at index of the sequence picked by salt */
+static void square_point(uint64_t seed, uint64_t salt, uint64_t index, double* xcoord, double* ycoord){
+    CGRandomStream_t stream;
+    init_random_stream(&stream, seed, salt, index);
+    *xcoord = 2.0 * next_uniform(&stream) - 1.0;
+    *ycoord = 2.0 * next_uniform(&stream) - 1.0;
+}
+
+
+/** @internal Computes the point at index of the array described by generator */
+static void generate_point(const CGGenerator_t* generator, size_t index, double* xcoord, double* ycoord){
+    CGRandomStream_t stream;
+    init_random_stream(&stream, generator->seed, 0, index);
+    switch(generator->distribution){
+        case CG_UNIFORM_DISK: {
+            double radius = sqrt(next_uniform(&stream));
+            double angle = 2.0 * GENERATOR_PI * next_uniform(&stream);
+            *xcoord = radius * cos(angle);
+            *ycoord = radius * sin(angle);
+            break;
+        }
+        case CG_GAUSSIAN_CLUSTERS: {
+            double center_x, center_y;
+            square_point(generator->seed, 1, next_random(&stream) % NUM_CLUSTERS, &center_x, &center_y);
+            *xcoord = center_x + CLUSTER_SIGMA * next_gaussian(&stream);
+            *ycoord = center_y + CLUSTER_SIGMA * next_gaussian(&stream);
+            break;
+        }
+        case CG_CIRCLE: {
+            double angle = 2.0 * GENERATOR_PI * next_uniform(&stream);
+            *xcoord = cos(angle);
+            *ycoord = sin(angle);
+            break;
+        }
+        case CG_COLLINEAR: {
+            // Multiples of 2^-20 on y = x / 2, so that every orientation test is exactly zero
+            *xcoord = (double) (next_random(&stream) & ((1 << 21) - 1)) / (double) (1 << 20) - 1.0;
+            *ycoord = *xcoord * 0.5;
+            break;
+        }
+        case CG_DUPLICATES: {
+            uint64_t num_distinct = generator->num_points / DUPLICATE_COPIES + 1;
+            square_point(generator->seed, 2, next_random(&stream) % num_distinct, xcoord, ycoord);
+            break;
+        }
+        case CG_LARGE_MAGNITUDE:
+            *xcoord = LARGE_CENTER + LARGE_HALF_WIDTH * (2.0 * next_uniform(&stream) - 1.0);
+            *ycoord = -LARGE_CENTER + LARGE_HALF_WIDTH * (2.0 * next_uniform(&stream) - 1.0);
+            break;
+        default:
+            *xcoord = 2.0 * next_uniform(&stream) - 1.0;
+            *ycoord = 2.0 * next_uniform(&stream) - 1.0;
+            break;
+    }
+}
+
+
+/**
+ * Struct describing the range of points filled by one task of generate_point_array_ctx.
+ * @internal
+ */
+typedef struct CG_GeneratorChunk {
+    const CGGenerator_t* generator;     /**< Array being generated */
+    size_t begin;                       /**< First point of the range */
+    size_t end;                         /**< One past the last point of the range */
+} CGGeneratorChunk_t;
+
+
+/** @internal Fills the points of one range */
+static void generate_range(const CGGenerator_t* generator, size_t begin, size_t end){
+    size_t i;
+    for(i = begin; i < end; i++)
+        generate_point(generator, i, &generator->xcoords[i], &generator->ycoords[i]);
+}
+
+
+/** @internal Task that fills one range of the points */
+static void generator_chunk_task(void* argument, size_t task_index, CGArena_t* arena){
+    (void) arena;
+    CGGeneratorChunk_t* chunk = (CGGeneratorChunk_t*) argument + task_index;
+    generate_range(chunk->generator, chunk->begin, chunk->end);
+}
+
+
+/** @internal Checks the arguments and makes room for num_points more points in point_array */
+static CGError_t init_generator(CGGenerator_t* generator, CGPointArray_t* point_array, size_t num_points,
+                                CGDistribution_t distribution, unsigned long long seed){
+    if(point_array == NULL || (int) distribution < (int) CG_UNIFORM_SQUARE || (int) distribution > (int) CG_LARGE_MAGNITUDE)
+        return CG_INVALID_INPUT;
+    CGError_t status = reserve_point_array(point_array, point_array->num_points + num_points);
+    if(status != CG_SUCCESS)
+        return status;
+    generator->distribution = distribution;
+    generator->seed = (uint64_t) seed;
+    generator->num_points = num_points;
+    generator->xcoords = point_array->xcoords + point_array->num_points;
+    generator->ycoords = point_array->ycoords + point_array->num_points;
+    return CG_SUCCESS;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Generating point arrays
+//----------------------------------------------------------------
+
+
+/**
+ * Function that appends points drawn from a distribution to a point array.
+ * The same seed, count and distribution always give the same points, and the function keeps no
+ * state of its own, so threads may generate into arrays of their own concurrently.
+ * @ingroup generate
+ * @param point_array Initialized point array the points are appended to
+ * @param num_points Number of points to generate
+ * @param distribution Distribution to draw the points from
+ * @param seed Seed picking the sequence of points
+ * @return INVALID_INPUT if point_array is NULL or distribution is unknown, NO_MEMORY if the array cannot grow, otherwise SUCCESS.
+ */
+CGError_t generate_point_array(CGPointArray_t* point_array, size_t num_points, CGDistribution_t distribution, unsigned long long seed){
+    CGGenerator_t generator;
+    CGError_t status = init_generator(&generator, point_array, num_points, distribution, seed);
+    if(status != CG_SUCCESS)
+        return status;
+    generate_range(&generator, 0, num_points);
+    point_array->num_points += num_points;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that appends points drawn from a distribution to a point array on the worker pool of a context.
+ * Points are identical to those of generate_point_array for the same arguments, whatever the number of threads.
+ * @ingroup generate
+ * @param context Context providing the worker pool
+ * @param point_array Initialized point array the points are appended to
+ * @param num_points Number of points to generate
+ * @param distribution Distribution to draw the points from
+ * @param seed Seed picking the sequence of points
+ * @return INVALID_INPUT if context or point_array is NULL or distribution is unknown,
+ *      NO_MEMORY if the array cannot grow or scratch space cannot be allocated, otherwise SUCCESS.
+ */
+CGError_t generate_point_array_ctx(CGContext_t* context, CGPointArray_t* point_array, size_t num_points,
+                                   CGDistribution_t distribution, unsigned long long seed){
+    if(context == NULL)
+        return CG_INVALID_INPUT;
+    size_t num_chunks = cg_context_point_tasks(context, num_points, 1);
+    if(num_chunks == 1)
+        return generate_point_array(point_array, num_points, distribution, seed);
+
+    CGGenerator_t generator;
+    CGError_t status = init_generator(&generator, point_array, num_points, distribution, seed);
+    if(status != CG_SUCCESS)
+        return status;
+    CGArena_t* arena = cg_context_acquire_arena(context);
+    CGGeneratorChunk_t* chunks = (CGGeneratorChunk_t*) cg_arena_alloc(arena, num_chunks * sizeof(CGGeneratorChunk_t));
+    if(chunks == NULL){
+        cg_context_release_arena(context, arena);
+        return CG_NO_MEMORY;
+    }
+    size_t i;
+    for(i = 0; i < num_chunks; i++){
+        chunks[i].generator = &generator;
+        chunks[i].begin = num_points / num_chunks * i;
+        chunks[i].end = (i == num_chunks - 1) ? num_points : num_points / num_chunks * (i + 1);
+    }
+    status = cg_context_parallel_for(context, num_chunks, generator_chunk_task, chunks);
+    cg_context_release_arena(context, arena);
+    if(status == CG_SUCCESS)
+        point_array->num_points += num_points;
+    return status;
+}
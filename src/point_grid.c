@@ -0,0 +1,535 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing a uniform grid over a point array for fixed radius neighbour queries.
+ * Points are bucketed by hashing their grid cell, and a counting sort lays the buckets out one after
+ * the other in compressed rows, so building takes linear time and the points of a bucket are read
+ * contiguously. Each point remembers its cell, so points of other cells hashed to the same bucket are
+ * skipped and no neighbour is reported twice. Cells as wide as the usual query radius work best.
+ *
+ * @defgroup grid Point Grids
+ * @brief Hashed uniform grids for fixed radius neighbour and close pair queries.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+// Cells along each side of the tiles whose cells get consecutive buckets
+#define GRID_TILE_CELLS 4
+
+// Pairs or positions a result buffer starts out with
+#define GRID_INITIAL_RESULTS 64
+
+// Points a pair search costs about as much as visiting, to decide when it is worth splitting
+#define GRID_PAIR_COST 16
+
+// Fraction of a cell by which a radius may fall short of a whole number of cells and still be searched as one more
+#define GRID_MARGIN 1e-6
+
+
+/**
+ * Struct for a hashed uniform grid.
+ * @internal
+ */
+struct CG_PointGrid {
+    CGPointArray_t* points;     /**< Share of the indexed array, positions in results refer to it */
+    double cell_size;           /**< Width and height of a cell */
+    size_t num_points;          /**< Number of points indexed */
+    size_t num_buckets;         /**< Number of buckets, a power of two */
+    size_t* offsets;            /**< Start of each bucket's points, num_buckets + 1 entries */
+    double* xcoords;            /**< x-coordinates in bucket order */
+    double* ycoords;            /**< y-coordinates in bucket order */
+    double* cell_x;             /**< Cell column of each point in bucket order */
+    double* cell_y;             /**< Cell row of each point in bucket order */
+    size_t* indices;            /**< Position in points of each point in bucket order */
+    size_t* sorted_positions;   /**< Position in bucket order of each point of points */
+};
+
+
+/**
+ * Struct for a growing list of positions or position pairs found by a query.
+ * @internal
+ */
+typedef struct CG_GridResults {
+    size_t* data;               /**< Positions found */
+    size_t count;               /**< Number of positions stored */
+    size_t capacity;            /**< Positions that fit in data */
+    int failed;                 /**< Set if growing the buffer failed */
+    CGContext_t* context;       /**< Context whose allocator grows the buffer, NULL for the global allocator */
+} CGGridResults_t;
+
+
+//----------------------------------------------------------------
+// Functions - Building grids
+//----------------------------------------------------------------
+
+
+/**
+ * Function that finds the bucket of a cell. Tiles of cells are hashed rather than single cells, and the
+ * cells of a tile get consecutive buckets, so the neighbours of a cell are mostly stored next to it.
+ * @internal
+ * @param grid Grid the cell belongs to
+ * @param cell_x Cell column
+ * @param cell_y Cell row
+ * @return Bucket of the cell's points
+ */
+static inline size_t bucket_of(const CGPointGrid_t* grid, double cell_x, double cell_y){
+    double tile_x = floor(cell_x / GRID_TILE_CELLS), tile_y = floor(cell_y / GRID_TILE_CELLS);
+    size_t local = (size_t) (cell_y - tile_y * GRID_TILE_CELLS) * GRID_TILE_CELLS + (size_t) (cell_x - tile_x * GRID_TILE_CELLS);
+    return (cg_hash_cell(tile_x, tile_y) * GRID_TILE_CELLS * GRID_TILE_CELLS + local) & (grid->num_buckets - 1);
+}
+
+
+/** @internal Cell column or row of a coordinate; adding zero keeps -0.0 from becoming a cell of its own */
+static inline double cell_of(const CGPointGrid_t* grid, double coord){
+    return floor(coord / grid->cell_size) + 0.0;
+}
+
+
+/**
+ * Function that allocates the arrays of a grid for a number of points, freeing any it had.
+ * @internal
+ * @param grid Grid to allocate for
+ * @param num_points Number of points to index
+ * @return NO_MEMORY if allocation fails, otherwise SUCCESS.
+ */
+static CGError_t allocate_grid(CGPointGrid_t* grid, size_t num_points){
+    cg_free(grid->offsets);
+    cg_free(grid->xcoords);
+    cg_free(grid->ycoords);
+    cg_free(grid->cell_x);
+    cg_free(grid->cell_y);
+    cg_free(grid->indices);
+    cg_free(grid->sorted_positions);
+    size_t num_buckets = 16;
+    while(num_buckets < num_points)
+        num_buckets *= 2;
+    size_t allocated = num_points ? num_points : 1;
+    grid->num_points = num_points;
+    grid->num_buckets = num_buckets;
+    grid->offsets = (size_t*) cg_malloc((num_buckets + 1) * sizeof(size_t));
+    grid->xcoords = (double*) cg_malloc(allocated * sizeof(double));
+    grid->ycoords = (double*) cg_malloc(allocated * sizeof(double));
+    grid->cell_x = (double*) cg_malloc(allocated * sizeof(double));
+    grid->cell_y = (double*) cg_malloc(allocated * sizeof(double));
+    grid->indices = (size_t*) cg_malloc(allocated * sizeof(size_t));
+    grid->sorted_positions = (size_t*) cg_malloc(allocated * sizeof(size_t));
+    if(grid->offsets == NULL || grid->xcoords == NULL || grid->ycoords == NULL || grid->cell_x == NULL ||
+       grid->cell_y == NULL || grid->indices == NULL || grid->sorted_positions == NULL)
+        return CG_NO_MEMORY;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that buckets the points of an array with a counting sort, into a grid allocated for them.
+ * @internal
+ * @param grid Grid to fill
+ * @param point_array Points to index, as many as the grid was allocated for
+ */
+static void fill_grid(CGPointGrid_t* grid, const CGPointArray_t* point_array){
+    size_t num_points = grid->num_points, num_buckets = grid->num_buckets;
+    size_t i;
+    memset(grid->offsets, 0, (num_buckets + 1) * sizeof(size_t));
+    // sorted_positions holds each point's bucket until the point is placed
+    for(i = 0; i < num_points; i++){
+        double xcoord = point_array->xcoords[i], ycoord = point_array->ycoords[i];
+        size_t bucket = bucket_of(grid, cell_of(grid, xcoord), cell_of(grid, ycoord));
+        grid->sorted_positions[i] = bucket;
+        grid->offsets[bucket + 1]++;
+    }
+    for(i = 0; i < num_buckets; i++)
+        grid->offsets[i + 1] += grid->offsets[i];
+    for(i = 0; i < num_points; i++){
+        size_t position = grid->offsets[grid->sorted_positions[i]]++;
+        double xcoord = point_array->xcoords[i], ycoord = point_array->ycoords[i];
+        grid->xcoords[position] = xcoord;
+        grid->ycoords[position] = ycoord;
+        grid->cell_x[position] = cell_of(grid, xcoord);
+        grid->cell_y[position] = cell_of(grid, ycoord);
+        grid->indices[position] = i;
+        grid->sorted_positions[i] = position;
+    }
+    // placing the points moved every start to the start of the next bucket
+    memmove(grid->offsets + 1, grid->offsets, num_buckets * sizeof(size_t));
+    grid->offsets[0] = 0;
+}
+
+
+/**
+ * Function that builds a grid over the points of a point array in linear time.
+ * The grid shares the array's coordinates like a view does, and keeps a bucketed copy of them.
+ * @ingroup grid
+ * @param point_array Point array to index
+ * @param cell_size Width and height of the grid cells, best close to the radius of the usual query
+ * @return Allocated grid to be freed with free_point_grid, or NULL if point_array is NULL, the cell size
+ *      is not positive or allocation fails.
+ */
+CGPointGrid_t* init_point_grid(CGPointArray_t* point_array, double cell_size){
+    if(point_array == NULL || !(cell_size > 0))
+        return NULL;
+    CGPointGrid_t* grid = (CGPointGrid_t*) cg_calloc(1, sizeof(CGPointGrid_t));
+    if(grid == NULL)
+        return NULL;
+    grid->cell_size = cell_size;
+    grid->points = share_point_array(point_array);
+    if(grid->points == NULL || allocate_grid(grid, point_array->num_points) != CG_SUCCESS){
+        free_point_grid(grid);
+        return NULL;
+    }
+    fill_grid(grid, point_array);
+    return grid;
+}
+
+
+/**
+ * Function that moves the points of a grid to new locations, for points that move between time steps.
+ * Position i of the new array is taken to be the same point as position i of the indexed one. Points
+ * that stay in their bucket are updated in place; if any point changes bucket, or the number of points
+ * changes, the buckets are sorted again in linear time, reusing the grid's memory where possible.
+ * @ingroup grid
+ * @param grid Grid to update
+ * @param point_array New locations of the points, shared by the grid from now on
+ * @return INVALID_INPUT if a param is NULL, NO_MEMORY if allocation fails, otherwise SUCCESS.
+ */
+CGError_t update_point_grid(CGPointGrid_t* grid, CGPointArray_t* point_array){
+    if(grid == NULL || point_array == NULL)
+        return CG_INVALID_INPUT;
+    CGPointArray_t* points = share_point_array(point_array);
+    if(points == NULL)
+        return CG_NO_MEMORY;
+    free_point_array(grid->points);
+    grid->points = points;
+
+    size_t num_points = point_array->num_points;
+    if(num_points != grid->num_points){
+        CGError_t status = allocate_grid(grid, num_points);
+        if(status != CG_SUCCESS){
+            grid->num_points = 0;
+            return status;
+        }
+        fill_grid(grid, point_array);
+        return CG_SUCCESS;
+    }
+
+    size_t i;
+    for(i = 0; i < num_points; i++){
+        double xcoord = point_array->xcoords[i], ycoord = point_array->ycoords[i];
+        double cell_x = cell_of(grid, xcoord), cell_y = cell_of(grid, ycoord);
+        size_t position = grid->sorted_positions[i];
+        int same_cell = cell_x == grid->cell_x[position] && cell_y == grid->cell_y[position];
+        if(!same_cell && bucket_of(grid, cell_x, cell_y) != bucket_of(grid, grid->cell_x[position], grid->cell_y[position])){
+            fill_grid(grid, point_array);
+            return CG_SUCCESS;
+        }
+        grid->xcoords[position] = xcoord;
+        grid->ycoords[position] = ycoord;
+        grid->cell_x[position] = cell_x;
+        grid->cell_y[position] = cell_y;
+    }
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that frees a grid, releasing the shared coordinates if it was their last user.
+ * @ingroup grid
+ * @param grid Grid to free
+ * @return INVALID_INPUT if grid is NULL, otherwise SUCCESS.
+ */
+CGError_t free_point_grid(CGPointGrid_t* grid){
+    if(grid == NULL)
+        return CG_INVALID_INPUT;
+    if(grid->points != NULL)
+        free_point_array(grid->points);
+    cg_free(grid->offsets);
+    cg_free(grid->xcoords);
+    cg_free(grid->ycoords);
+    cg_free(grid->cell_x);
+    cg_free(grid->cell_y);
+    cg_free(grid->indices);
+    cg_free(grid->sorted_positions);
+    cg_free(grid);
+    return CG_SUCCESS;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Searching grids
+//----------------------------------------------------------------
+
+
+/** @internal Appends a position to a result buffer, growing it as needed */
+static void append_result(CGGridResults_t* results, size_t value){
+    if(results->count == results->capacity){
+        size_t capacity = results->capacity ? 2 * results->capacity : GRID_INITIAL_RESULTS;
+        size_t* data = (size_t*) cg_context_realloc(results->context, results->data, capacity * sizeof(size_t));
+        if(data == NULL){
+            results->failed = 1;
+            return;
+        }
+        results->data = data;
+        results->capacity = capacity;
+    }
+    results->data[results->count++] = value;
+}
+
+
+/**
+ * Number of cells either side of a point's own cell that a radius can reach into. Cells come from
+ * rounded divisions, so two points a radius apart can land one cell further apart than the radius
+ * spans, and a radius whose division rounds just below a whole number of cells may span that number.
+ * One cell of slack and a margin cover both.
+ * @internal
+ */
+static inline double cells_reached(const CGPointGrid_t* grid, double radius){
+    return floor(radius / grid->cell_size + GRID_MARGIN) + 1;
+}
+
+
+/**
+ * Function that finds every indexed point within a radius of a location, the boundary included.
+ * @ingroup grid
+ * @param grid Grid to search
+ * @param xcoord x-coordinate of the location
+ * @param ycoord y-coordinate of the location
+ * @param radius Largest distance of a point found
+ * @param output_view View of the indexed array, the positions of the points found are appended to it
+ *      in no particular order
+ * @return INVALID_INPUT if a pointer is NULL, the radius is negative or the view is of another array,
+ *      NO_MEMORY if the view cannot be grown, otherwise SUCCESS.
+ */
+CGError_t point_grid_radius(const CGPointGrid_t* grid, double xcoord, double ycoord, double radius, CGPointView_t* output_view){
+    if(grid == NULL || output_view == NULL || !(radius >= 0) || output_view->points->xcoords != grid->points->xcoords)
+        return CG_INVALID_INPUT;
+    CGGridResults_t results = {NULL, 0, 0, 0, NULL};
+    double squared_radius = radius * radius;
+    double reach = cells_reached(grid, radius);
+    double cell_x = cell_of(grid, xcoord), cell_y = cell_of(grid, ycoord);
+    size_t i;
+    if((2 * reach + 1) * (2 * reach + 1) >= (double) grid->num_points){
+        // a radius spanning more cells than there are points is cheaper to check point by point
+        for(i = 0; i < grid->num_points; i++){
+            double delta_x = grid->xcoords[i] - xcoord, delta_y = grid->ycoords[i] - ycoord;
+            if(delta_x * delta_x + delta_y * delta_y <= squared_radius)
+                append_result(&results, grid->indices[i]);
+        }
+    }
+    else{
+        double offset_x, offset_y;
+        for(offset_x = -reach; offset_x <= reach; offset_x++){
+            for(offset_y = -reach; offset_y <= reach; offset_y++){
+                double neighbor_x = cell_x + offset_x, neighbor_y = cell_y + offset_y;
+                size_t bucket = bucket_of(grid, neighbor_x, neighbor_y);
+                for(i = grid->offsets[bucket]; i < grid->offsets[bucket + 1]; i++){
+                    if(grid->cell_x[i] != neighbor_x || grid->cell_y[i] != neighbor_y)
+                        continue;
+                    double delta_x = grid->xcoords[i] - xcoord, delta_y = grid->ycoords[i] - ycoord;
+                    if(delta_x * delta_x + delta_y * delta_y <= squared_radius)
+                        append_result(&results, grid->indices[i]);
+                }
+            }
+        }
+    }
+
+    CGError_t status = results.failed ? CG_NO_MEMORY : CG_SUCCESS;
+    if(status == CG_SUCCESS && results.count > 0){
+        size_t* indices = (size_t*) cg_realloc(output_view->indices, (output_view->num_indices + results.count) * sizeof(size_t));
+        if(indices == NULL)
+            status = CG_NO_MEMORY;
+        else{
+            output_view->indices = indices;
+            memcpy(indices + output_view->num_indices, results.data, results.count * sizeof(size_t));
+            output_view->num_indices += results.count;
+        }
+    }
+    cg_free(results.data);
+    return status;
+}
+
+
+/**
+ * Function that finds the pairs within a radius that include a range of points in bucket order.
+ * Each pair is found from one of its points only: the earlier one in bucket order if both share a
+ * cell, otherwise the one whose cell comes first, scanning half of the neighbouring cells. Consecutive
+ * points of one cell are handled together, so each neighbouring bucket is looked up once per run.
+ * @internal
+ * @param grid Grid to search
+ * @param begin First point of the range, in bucket order
+ * @param end One past the last point of the range
+ * @param radius Largest distance between the points of a pair
+ * @param pairs Buffer the pairs are appended to, smaller position first
+ */
+static void pairs_in_range(const CGPointGrid_t* grid, size_t begin, size_t end, double radius, CGGridResults_t* pairs){
+    double squared_radius = radius * radius;
+    double reach = cells_reached(grid, radius);
+    size_t run_begin, run_end, i, j;
+    for(run_begin = begin; run_begin < end && !pairs->failed; run_begin = run_end){
+        double cell_x = grid->cell_x[run_begin], cell_y = grid->cell_y[run_begin];
+        for(run_end = run_begin + 1; run_end < end; run_end++)
+            if(grid->cell_x[run_end] != cell_x || grid->cell_y[run_end] != cell_y)
+                break;
+        double offset_x, offset_y;
+        for(offset_x = 0; offset_x <= reach; offset_x++){
+            for(offset_y = offset_x == 0 ? 0 : -reach; offset_y <= reach; offset_y++){
+                double neighbor_x = cell_x + offset_x, neighbor_y = cell_y + offset_y;
+                size_t bucket = bucket_of(grid, neighbor_x, neighbor_y);
+                size_t bucket_begin = grid->offsets[bucket], bucket_end = grid->offsets[bucket + 1];
+                int own_cell = offset_x == 0 && offset_y == 0;
+                for(i = run_begin; i < run_end; i++){
+                    double xcoord = grid->xcoords[i], ycoord = grid->ycoords[i];
+                    size_t index = grid->indices[i];
+                    // in its own cell a point pairs with the rest of its run and later points of the bucket
+                    for(j = own_cell ? i + 1 : bucket_begin; j < bucket_end; j++){
+                        if(grid->cell_x[j] != neighbor_x || grid->cell_y[j] != neighbor_y)
+                            continue;
+                        double delta_x = grid->xcoords[j] - xcoord, delta_y = grid->ycoords[j] - ycoord;
+                        if(delta_x * delta_x + delta_y * delta_y <= squared_radius){
+                            size_t other = grid->indices[j];
+                            append_result(pairs, index < other ? index : other);
+                            append_result(pairs, index < other ? other : index);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * Function that finds every pair of indexed points within a radius of each other, the boundary included.
+ * The radius should be no more than a few cells, as every cell it reaches is searched for each point.
+ * @ingroup grid
+ * @param grid Grid to search
+ * @param radius Largest distance between the points of a pair
+ * @param pairs Output positions of the pairs, two per pair with the smaller first, in no particular order;
+ *      allocated by the library and released with free_buffer
+ * @param num_pairs Output number of pairs
+ * @return INVALID_INPUT if a param is NULL or the radius is negative, NO_MEMORY if allocation fails, otherwise SUCCESS.
+ */
+CGError_t point_grid_pairs_within(const CGPointGrid_t* grid, double radius, size_t** pairs, size_t* num_pairs){
+    if(grid == NULL || pairs == NULL || num_pairs == NULL || !(radius >= 0))
+        return CG_INVALID_INPUT;
+    CGGridResults_t results = {NULL, 0, 0, 0, NULL};
+    pairs_in_range(grid, 0, grid->num_points, radius, &results);
+    if(results.failed || (results.data == NULL && (results.data = (size_t*) cg_malloc(sizeof(size_t))) == NULL)){
+        cg_free(results.data);
+        *pairs = NULL;
+        *num_pairs = 0;
+        return CG_NO_MEMORY;
+    }
+    *pairs = results.data;
+    *num_pairs = results.count / 2;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Struct describing the range of points whose pairs one task of point_grid_pairs_within_ctx finds.
+ * @internal
+ */
+typedef struct CG_PairChunk {
+    const CGPointGrid_t* grid;          /**< Grid to search */
+    size_t begin;                       /**< First point of the range, in bucket order */
+    size_t end;                         /**< One past the last point of the range */
+    double radius;                      /**< Largest distance between the points of a pair */
+    CGGridResults_t pairs;              /**< Pairs found from the range */
+} CGPairChunk_t;
+
+
+/** @internal Task finding the pairs of one range of points */
+static void pair_chunk_task(void* argument, size_t task_index, CGArena_t* arena){
+    (void) arena;
+    CGPairChunk_t* chunk = (CGPairChunk_t*) argument + task_index;
+    pairs_in_range(chunk->grid, chunk->begin, chunk->end, chunk->radius, &chunk->pairs);
+}
+
+
+/**
+ * Function that finds the pairs of point_grid_pairs_within on the worker pool of a context.
+ * @ingroup grid
+ * @param context Context providing the worker pool
+ * @param grid Grid to search
+ * @param radius Largest distance between the points of a pair
+ * @param pairs Output positions of the pairs, as point_grid_pairs_within returns them, released with free_buffer
+ * @param num_pairs Output number of pairs
+ * @return INVALID_INPUT if a param is NULL or the radius is negative, NO_MEMORY if allocation fails, otherwise SUCCESS.
+ */
+CGError_t point_grid_pairs_within_ctx(CGContext_t* context, const CGPointGrid_t* grid, double radius, size_t** pairs, size_t* num_pairs){
+    if(context == NULL || grid == NULL || pairs == NULL || num_pairs == NULL || !(radius >= 0))
+        return CG_INVALID_INPUT;
+    size_t num_chunks = cg_context_point_tasks(context, grid->num_points * GRID_PAIR_COST, 4);
+    if(num_chunks == 1)
+        return point_grid_pairs_within(grid, radius, pairs, num_pairs);
+
+    CGArena_t* arena = cg_context_acquire_arena(context);
+    CGPairChunk_t* chunks = (CGPairChunk_t*) cg_arena_alloc(arena, num_chunks * sizeof(CGPairChunk_t));
+    if(chunks == NULL){
+        cg_context_release_arena(context, arena);
+        return CG_NO_MEMORY;
+    }
+    memset(chunks, 0, num_chunks * sizeof(CGPairChunk_t));
+    size_t num_points = grid->num_points;
+    size_t i;
+    for(i = 0; i < num_chunks; i++){
+        chunks[i].grid = grid;
+        chunks[i].begin = num_points / num_chunks * i;
+        chunks[i].end = (i == num_chunks - 1) ? num_points : num_points / num_chunks * (i + 1);
+        chunks[i].radius = radius;
+        chunks[i].pairs.context = context;
+    }
+    cg_context_parallel_for(context, num_chunks, pair_chunk_task, chunks);
+
+    // each range found its pairs in a buffer of its own, which are joined in range order
+    CGError_t status = CG_SUCCESS;
+    size_t total = 0;
+    for(i = 0; i < num_chunks; i++){
+        if(chunks[i].pairs.failed)
+            status = CG_NO_MEMORY;
+        total += chunks[i].pairs.count;
+    }
+    *pairs = NULL;
+    *num_pairs = 0;
+    if(status == CG_SUCCESS){
+        *pairs = (size_t*) cg_malloc((total ? total : 1) * sizeof(size_t));
+        if(*pairs == NULL)
+            status = CG_NO_MEMORY;
+    }
+    if(status == CG_SUCCESS){
+        size_t copied = 0;
+        for(i = 0; i < num_chunks; i++){
+            if(chunks[i].pairs.count == 0)
+                continue;
+            memcpy(*pairs + copied, chunks[i].pairs.data, chunks[i].pairs.count * sizeof(size_t));
+            copied += chunks[i].pairs.count;
+        }
+        *num_pairs = total / 2;
+    }
+    for(i = 0; i < num_chunks; i++)
+        cg_context_free(context, chunks[i].pairs.data);
+    cg_context_release_arena(context, arena);
+    return status;
+}
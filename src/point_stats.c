@@ -0,0 +1,298 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing the summary statistics of point sets: bounds, extreme points, centroid and
+ * covariance, gathered together in one pass over the coordinates. Slices are summarized by the vector
+ * kernel of the active instruction set and combined with the pairwise update of Chan et al., which
+ * also lets the context variant split the work between threads.
+ *
+ * @defgroup stats Summary Statistics
+ * @brief One pass bounds, extreme points, centroid and covariance of point sets.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+// Points of a point set copied out of its list at a time, to be summarized by the vector kernel
+#define SET_STATS_BLOCK 512
+
+
+//----------------------------------------------------------------
+// Functions - Summaries of slices
+//----------------------------------------------------------------
+
+
+/** @internal Whether point a at position index_a is lower than point b at index_b */
+static int is_lower(double x_a, double y_a, size_t index_a, double x_b, double y_b, size_t index_b){
+    if(y_a != y_b)
+        return y_a < y_b;
+    else if(x_a != x_b)
+        return x_a < x_b;
+    return index_a < index_b;
+}
+
+
+/** @internal Whether point a at position index_a is higher than point b at index_b */
+static int is_higher(double x_a, double y_a, size_t index_a, double x_b, double y_b, size_t index_b){
+    if(y_a != y_b)
+        return y_a > y_b;
+    else if(x_a != x_b)
+        return x_a > x_b;
+    return index_a < index_b;
+}
+
+
+/**
+ * Function that summarizes a non-empty slice of coordinates with the kernel of the active instruction set.
+ * @internal
+ * @param xcoords x-coordinates of the slice
+ * @param ycoords y-coordinates of the slice
+ * @param num_points Number of points in the slice, at least 1
+ * @param first_index Position of the first point of the slice in the whole input
+ * @param stats Output statistics of the slice
+ */
+static void summarize_slice(const double* xcoords, const double* ycoords, size_t num_points, size_t first_index,
+                            CGPointStats_t* stats){
+    // sums are taken around the first point, so large offsets do not cancel out the spread
+    CGCoord_t shift = {xcoords[0], ycoords[0]};
+    CGSummaryLanes_t lanes;
+    cg_kernels()->summarize(xcoords, ycoords, num_points, &shift, &lanes);
+
+    stats->num_points = num_points;
+    stats->bounding_box.min_x = HUGE_VAL;
+    stats->bounding_box.max_x = -HUGE_VAL;
+    stats->lowest_index = stats->highest_index = 0;
+    stats->lowest = stats->highest = shift;
+    double sum_x = 0, sum_y = 0, sum_xx = 0, sum_yy = 0, sum_xy = 0;
+    int lane;
+    for(lane = 0; lane < CG_SUMMARY_LANES; lane++){
+        stats->bounding_box.min_x = lanes.min_x[lane] < stats->bounding_box.min_x ? lanes.min_x[lane] : stats->bounding_box.min_x;
+        stats->bounding_box.max_x = lanes.max_x[lane] > stats->bounding_box.max_x ? lanes.max_x[lane] : stats->bounding_box.max_x;
+        if(lanes.low_index[lane] >= 0){
+            size_t index = (size_t) lanes.low_index[lane];
+            if(is_lower(lanes.low_x[lane], lanes.low_y[lane], index, stats->lowest.xcoord, stats->lowest.ycoord, stats->lowest_index)){
+                stats->lowest.xcoord = lanes.low_x[lane];
+                stats->lowest.ycoord = lanes.low_y[lane];
+                stats->lowest_index = index;
+            }
+        }
+        if(lanes.high_index[lane] >= 0){
+            size_t index = (size_t) lanes.high_index[lane];
+            if(is_higher(lanes.high_x[lane], lanes.high_y[lane], index, stats->highest.xcoord, stats->highest.ycoord, stats->highest_index)){
+                stats->highest.xcoord = lanes.high_x[lane];
+                stats->highest.ycoord = lanes.high_y[lane];
+                stats->highest_index = index;
+            }
+        }
+        sum_x += lanes.sum_x[lane];
+        sum_y += lanes.sum_y[lane];
+        sum_xx += lanes.sum_xx[lane];
+        sum_yy += lanes.sum_yy[lane];
+        sum_xy += lanes.sum_xy[lane];
+    }
+    stats->bounding_box.min_y = stats->lowest.ycoord;
+    stats->bounding_box.max_y = stats->highest.ycoord;
+    stats->lowest_index += first_index;
+    stats->highest_index += first_index;
+
+    double count = (double) num_points;
+    stats->mean.xcoord = shift.xcoord + sum_x / count;
+    stats->mean.ycoord = shift.ycoord + sum_y / count;
+    double variance_x = (sum_xx - sum_x * sum_x / count) / count;
+    double variance_y = (sum_yy - sum_y * sum_y / count) / count;
+    stats->covariance[0][0] = variance_x > 0 ? variance_x : 0;
+    stats->covariance[1][1] = variance_y > 0 ? variance_y : 0;
+    stats->covariance[0][1] = stats->covariance[1][0] = (sum_xy - sum_x * sum_y / count) / count;
+}
+
+
+/**
+ * Function that merges the statistics of a later slice into those of the points before it.
+ * @internal
+ * @param total Statistics of the earlier points, updated to cover both
+ * @param part Statistics of the later slice
+ */
+static void combine_stats(CGPointStats_t* total, const CGPointStats_t* part){
+    if(part->num_points == 0)
+        return;
+    else if(total->num_points == 0){
+        *total = *part;
+        return;
+    }
+    CGBoundingBox_t* box = &total->bounding_box;
+    box->min_x = part->bounding_box.min_x < box->min_x ? part->bounding_box.min_x : box->min_x;
+    box->max_x = part->bounding_box.max_x > box->max_x ? part->bounding_box.max_x : box->max_x;
+    if(is_lower(part->lowest.xcoord, part->lowest.ycoord, part->lowest_index, total->lowest.xcoord, total->lowest.ycoord, total->lowest_index)){
+        total->lowest = part->lowest;
+        total->lowest_index = part->lowest_index;
+    }
+    if(is_higher(part->highest.xcoord, part->highest.ycoord, part->highest_index, total->highest.xcoord, total->highest.ycoord, total->highest_index)){
+        total->highest = part->highest;
+        total->highest_index = part->highest_index;
+    }
+    box->min_y = total->lowest.ycoord;
+    box->max_y = total->highest.ycoord;
+
+    // pairwise update of the co-moments, which are the covariances scaled by the counts
+    double count_A = (double) total->num_points, count_B = (double) part->num_points;
+    double count = count_A + count_B;
+    double delta_x = part->mean.xcoord - total->mean.xcoord;
+    double delta_y = part->mean.ycoord - total->mean.ycoord;
+    double weight = count_A * count_B / count;
+    int row, column;
+    double delta[2] = {delta_x, delta_y};
+    for(row = 0; row < 2; row++)
+        for(column = 0; column < 2; column++)
+            total->covariance[row][column] = (total->covariance[row][column] * count_A + part->covariance[row][column] * count_B +
+                                              delta[row] * delta[column] * weight) / count;
+    total->mean.xcoord += delta_x * count_B / count;
+    total->mean.ycoord += delta_y * count_B / count;
+    total->num_points += part->num_points;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Point arrays
+//----------------------------------------------------------------
+
+
+/**
+ * Function that computes the bounds, lowest and highest points, centroid and covariance of a point array
+ * in a single pass over its coordinates.
+ * @ingroup stats
+ * @param point_array Point array to summarize
+ * @param stats Output statistics
+ * @return INVALID_INPUT if a param is NULL, POINTS_TOO_FEW if the array is empty, otherwise SUCCESS.
+ */
+CGError_t compute_point_stats(const CGPointArray_t* point_array, CGPointStats_t* stats){
+    if(point_array == NULL || stats == NULL)
+        return CG_INVALID_INPUT;
+    else if(point_array->num_points == 0)
+        return CG_POINTS_TOO_FEW;
+    summarize_slice(point_array->xcoords, point_array->ycoords, point_array->num_points, 0, stats);
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Struct describing the slice of the input summarized by one task of compute_point_stats_ctx.
+ * @internal
+ */
+typedef struct CG_StatsChunk {
+    const CGPointArray_t* input_array;  /**< Array being summarized */
+    size_t begin;                       /**< First point of the slice */
+    size_t end;                         /**< One past the last point of the slice */
+    CGPointStats_t stats;               /**< Statistics of the slice */
+} CGStatsChunk_t;
+
+
+/** @internal Task that summarizes one slice of the points */
+static void stats_chunk_task(void* argument, size_t task_index, CGArena_t* arena){
+    (void) arena;
+    CGStatsChunk_t* chunk = (CGStatsChunk_t*) argument + task_index;
+    summarize_slice(chunk->input_array->xcoords + chunk->begin, chunk->input_array->ycoords + chunk->begin,
+                    chunk->end - chunk->begin, chunk->begin, &chunk->stats);
+}
+
+
+/**
+ * Function that computes the statistics of compute_point_stats on the worker pool of a context.
+ * Above the context's threshold slices of the array are summarized in parallel and combined, so the
+ * centroid and covariance may differ from the serial ones by rounding; the other fields are identical.
+ * @ingroup stats
+ * @param context Context providing the worker pool
+ * @param point_array Point array to summarize
+ * @param stats Output statistics
+ * @return INVALID_INPUT if a param is NULL, POINTS_TOO_FEW if the array is empty,
+ *      NO_MEMORY if scratch space cannot be allocated, otherwise SUCCESS.
+ */
+CGError_t compute_point_stats_ctx(CGContext_t* context, const CGPointArray_t* point_array, CGPointStats_t* stats){
+    if(context == NULL || point_array == NULL || stats == NULL)
+        return CG_INVALID_INPUT;
+    size_t num_chunks = cg_context_point_tasks(context, point_array->num_points, 1);
+    if(num_chunks == 1)
+        return compute_point_stats(point_array, stats);
+
+    CGArena_t* arena = cg_context_acquire_arena(context);
+    CGStatsChunk_t* chunks = (CGStatsChunk_t*) cg_arena_alloc(arena, num_chunks * sizeof(CGStatsChunk_t));
+    if(chunks == NULL){
+        cg_context_release_arena(context, arena);
+        return CG_NO_MEMORY;
+    }
+    size_t num_points = point_array->num_points;
+    size_t i;
+    for(i = 0; i < num_chunks; i++){
+        chunks[i].input_array = point_array;
+        chunks[i].begin = num_points / num_chunks * i;
+        chunks[i].end = (i == num_chunks - 1) ? num_points : num_points / num_chunks * (i + 1);
+    }
+    cg_context_parallel_for(context, num_chunks, stats_chunk_task, chunks);
+
+    *stats = chunks[0].stats;
+    for(i = 1; i < num_chunks; i++)
+        combine_stats(stats, &chunks[i].stats);
+    cg_context_release_arena(context, arena);
+    return CG_SUCCESS;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Point sets
+//----------------------------------------------------------------
+
+
+/**
+ * Function that computes the statistics of compute_point_stats for a point set. Points are copied out
+ * of the list in blocks, so the summaries still run on contiguous coordinates.
+ * @ingroup stats
+ * @param point_set Point set to summarize
+ * @param stats Output statistics, with positions counted from the head of the list
+ * @return INVALID_INPUT if a param is NULL, POINTS_TOO_FEW if the set is empty, otherwise SUCCESS.
+ */
+CGError_t compute_point_set_stats(const CGPointSet_t* point_set, CGPointStats_t* stats){
+    if(point_set == NULL || stats == NULL)
+        return CG_INVALID_INPUT;
+    else if(point_set->num_points == 0 || point_set->head == NULL)
+        return CG_POINTS_TOO_FEW;
+
+    double xcoords[SET_STATS_BLOCK], ycoords[SET_STATS_BLOCK];
+    CGPointStats_t block_stats;
+    stats->num_points = 0;
+    size_t first_index = 0;
+    CGPointNode_t* current_node = point_set->head;
+    while(current_node != NULL){
+        size_t num_block = 0;
+        while(current_node != NULL && num_block < SET_STATS_BLOCK){
+            xcoords[num_block] = current_node->point->xcoord;
+            ycoords[num_block] = current_node->point->ycoord;
+            num_block++;
+            current_node = current_node->next;
+        }
+        summarize_slice(xcoords, ycoords, num_block, first_index, &block_stats);
+        combine_stats(stats, &block_stats);
+        first_index += num_block;
+    }
+    return CG_SUCCESS;
+}
@@ -0,0 +1,333 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing the streaming .csv and point archive readers. Files are read through a
+ * fixed size buffer, or decoded one block at a time, and handed out in batches of points, so inputs
+ * larger than memory can be processed with bounded memory use.
+ *
+ * @defgroup stream Point Streams
+ * @brief Batched reading of point files and algorithms that consume them.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+// Size of the read buffer of a stream. Lines longer than this are skipped.
+#define STREAM_BUFFER_SIZE (1 << 20)
+
+
+/**
+ * Struct holding the state of a batched .csv or point archive reader.
+ * @ingroup stream
+ */
+struct CG_PointStream {
+    FILE* file;                 /**< File being read */
+    char* buffer;               /**< Read buffer of STREAM_BUFFER_SIZE bytes */
+    const char* parse_begin;    /**< First unparsed byte in the buffer */
+    const char* parse_end;      /**< End of the complete lines in the buffer */
+    const char* data_end;       /**< End of the bytes read into the buffer */
+    size_t batch_size;          /**< Maximum number of points per batch */
+    int end_of_file;            /**< Set once the whole file has been read */
+    int skipping_line;          /**< Set while discarding a line longer than the buffer */
+    CGFileMap_t* archive;       /**< Mapped point archive, NULL for .csv streams */
+    CGArchiveHeader_t archive_header; /**< Decoded header of the archive */
+    const char* next_block;     /**< Next archive block to decode */
+};
+
+
+//----------------------------------------------------------------
+// Functions - Opening and closing streams
+//----------------------------------------------------------------
+
+
+/**
+ * Function that opens a .csv file for reading in batches.
+ * @ingroup stream
+ * @param file_path Path to the .csv file
+ * @param batch_size Maximum number of points handed out per batch, must be positive
+ * @return Allocated stream, or NULL if the file cannot be opened or allocation fails.
+ */
+CGPointStream_t* open_csv_point_stream(const char* file_path, size_t batch_size){
+    if(file_path == NULL || batch_size == 0)
+        return NULL;
+    CGPointStream_t* stream = (CGPointStream_t*) cg_calloc(1, sizeof(CGPointStream_t));
+    if(stream == NULL)
+        return NULL;
+    stream->buffer = (char*) cg_malloc(STREAM_BUFFER_SIZE);
+    stream->file = fopen(file_path, "rb");
+    if(stream->buffer == NULL || stream->file == NULL){
+        close_point_stream(stream);
+        return NULL;
+    }
+    stream->parse_begin = stream->buffer;
+    stream->parse_end = stream->buffer;
+    stream->data_end = stream->buffer;
+    stream->batch_size = batch_size;
+    return stream;
+}
+
+
+/**
+ * Function that opens a compressed point archive for reading one block at a time.
+ * Each batch holds the points of one block of the archive.
+ * @ingroup stream
+ * @param file_path Path to the archive
+ * @return Allocated stream, or NULL if the file cannot be mapped, is not a valid archive or allocation fails.
+ */
+CGPointStream_t* open_archive_point_stream(const char* file_path){
+    if(file_path == NULL)
+        return NULL;
+    CGPointStream_t* stream = (CGPointStream_t*) cg_calloc(1, sizeof(CGPointStream_t));
+    if(stream == NULL)
+        return NULL;
+    stream->archive = (CGFileMap_t*) cg_calloc(1, sizeof(CGFileMap_t));
+    if(stream->archive == NULL || cg_map_file(file_path, stream->archive) != CG_SUCCESS){
+        cg_free(stream->archive);
+        cg_free(stream);
+        return NULL;
+    }
+    if(cg_read_archive_header(stream->archive->data, stream->archive->size, &stream->archive_header,
+                              &stream->next_block) != CG_SUCCESS){
+        close_point_stream(stream);
+        return NULL;
+    }
+    stream->batch_size = stream->archive_header.block_size;
+    return stream;
+}
+
+
+/**
+ * Function that closes a stream opened by open_csv_point_stream or open_archive_point_stream and frees its memory.
+ * @ingroup stream
+ * @param stream Stream to close
+ * @return INVALID_INPUT if stream is NULL, otherwise SUCCESS.
+ */
+CGError_t close_point_stream(CGPointStream_t* stream){
+    if(stream == NULL)
+        return CG_INVALID_INPUT;
+    if(stream->file != NULL)
+        fclose(stream->file);
+    if(stream->archive != NULL){
+        cg_unmap_file(stream->archive);
+        cg_free(stream->archive);
+    }
+    cg_free(stream->buffer);
+    cg_free(stream);
+    return CG_SUCCESS;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Reading batches
+//----------------------------------------------------------------
+
+
+/**
+ * Helper that moves the unparsed tail of the buffer to the front and reads more of the file.
+ * Afterwards [parse_begin, parse_end) holds only complete lines.
+ * @internal
+ */
+static void refill_stream(CGPointStream_t* stream){
+    size_t leftover = (size_t) (stream->data_end - stream->parse_end);
+    memmove(stream->buffer, stream->parse_end, leftover);
+    size_t num_read = fread(stream->buffer + leftover, 1, STREAM_BUFFER_SIZE - leftover, stream->file);
+    const char* data_begin = stream->buffer;
+    stream->data_end = stream->buffer + leftover + num_read;
+    if(num_read == 0)
+        stream->end_of_file = 1;
+
+    // drop the rest of a line that did not fit into the buffer
+    if(stream->skipping_line){
+        const char* newline = (const char*) memchr(data_begin, '\n', (size_t) (stream->data_end - data_begin));
+        if(newline == NULL){
+            stream->parse_begin = stream->parse_end = stream->data_end;
+            return;
+        }
+        data_begin = newline + 1;
+        stream->skipping_line = 0;
+    }
+    stream->parse_begin = data_begin;
+
+    // a trailing line without newline is only complete at the end of the file
+    const char* complete_end = stream->data_end;
+    if(!stream->end_of_file){
+        while(complete_end > data_begin && complete_end[-1] != '\n')
+            complete_end--;
+        if(complete_end == data_begin && stream->data_end - stream->buffer == STREAM_BUFFER_SIZE){
+            complete_end = stream->data_end;
+            stream->data_end = complete_end;
+            stream->skipping_line = 1;
+            stream->parse_begin = complete_end;
+        }
+    }
+    stream->parse_end = complete_end;
+}
+
+
+/**
+ * Function that reads the next batch of points from a stream. The batch array is emptied
+ * and then filled with up to the stream's batch size points.
+ * @ingroup stream
+ * @param stream Open point stream
+ * @param batch Initialized point array that receives the batch
+ * @return INVALID_INPUT if either param is NULL, NO_MEMORY if the batch cannot be grown,
+ *      INVALID_FILE if an archive block is corrupt, otherwise SUCCESS. The end of the stream is
+ *      reached when a batch with no points is returned.
+ */
+CGError_t next_point_batch(CGPointStream_t* stream, CGPointArray_t* batch){
+    if(stream == NULL || batch == NULL)
+        return CG_INVALID_INPUT;
+    batch->num_points = 0;
+    if(stream->archive != NULL){
+        const char* end = stream->archive->data + stream->archive->size;
+        if(stream->next_block == end)
+            return CG_SUCCESS;
+        return cg_decode_archive_block(stream->next_block, end, &stream->archive_header, batch, &stream->next_block);
+    }
+    CGError_t status = reserve_point_array(batch, stream->batch_size);
+    CG_PHASE_START(timer);
+    while(status == CG_SUCCESS && batch->num_points < stream->batch_size){
+        if(stream->parse_begin == stream->parse_end){
+            if(stream->end_of_file)
+                break;
+            refill_stream(stream);
+            continue;
+        }
+        status = cg_parse_csv_lines(stream->parse_begin, stream->parse_end, batch, stream->batch_size,
+                                    &stream->parse_begin);
+    }
+    CG_PHASE_LAP(timer, CG_PHASE_PARSE);
+    return status;
+}
+
+
+/**
+ * Function that reads a stream to the end, passing every batch to a callback.
+ * @ingroup stream
+ * @param stream Open point stream
+ * @param callback Function called with each non-empty batch
+ * @param user_data Pointer passed through to the callback
+ * @return The first error returned by reading or by the callback, otherwise SUCCESS.
+ */
+CGError_t for_each_point_batch(CGPointStream_t* stream, CGBatchCallback_t callback, void* user_data){
+    if(stream == NULL || callback == NULL)
+        return CG_INVALID_INPUT;
+    CGPointArray_t* batch = init_point_array(stream->batch_size);
+    if(batch == NULL)
+        return CG_NO_MEMORY;
+    CGError_t status;
+    while((status = next_point_batch(stream, batch)) == CG_SUCCESS && batch->num_points > 0){
+        status = callback(batch, user_data);
+        if(status != CG_SUCCESS)
+            break;
+    }
+    free_point_array(batch);
+    return status;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Algorithms over streams
+//----------------------------------------------------------------
+
+
+/** @internal Batch callback that grows a bounding box */
+static CGError_t bounding_box_batch(CGPointArray_t* batch, void* user_data){
+    CGBoundingBox_t* bounding_box = (CGBoundingBox_t*) user_data;
+    CGBoundingBox_t batch_box;
+    CGError_t status = compute_bounding_box(batch, &batch_box);
+    if(status != CG_SUCCESS)
+        return status;
+    if(batch_box.min_x < bounding_box->min_x) bounding_box->min_x = batch_box.min_x;
+    if(batch_box.min_y < bounding_box->min_y) bounding_box->min_y = batch_box.min_y;
+    if(batch_box.max_x > bounding_box->max_x) bounding_box->max_x = batch_box.max_x;
+    if(batch_box.max_y > bounding_box->max_y) bounding_box->max_y = batch_box.max_y;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that finds the bounding box of all remaining points in a stream.
+ * @ingroup stream
+ * @param stream Open point stream
+ * @param bounding_box Output bounding box
+ * @return POINTS_TOO_FEW if the stream has no points, otherwise the status of reading the stream.
+ */
+CGError_t compute_bounding_box_stream(CGPointStream_t* stream, CGBoundingBox_t* bounding_box){
+    if(stream == NULL || bounding_box == NULL)
+        return CG_INVALID_INPUT;
+    bounding_box->min_x = bounding_box->min_y = HUGE_VAL;
+    bounding_box->max_x = bounding_box->max_y = -HUGE_VAL;
+    CGError_t status = for_each_point_batch(stream, bounding_box_batch, bounding_box);
+    if(status == CG_SUCCESS && bounding_box->min_x > bounding_box->max_x)
+        status = CG_POINTS_TOO_FEW;
+    return status;
+}
+
+
+/** @internal State of the incremental hull over a stream */
+typedef struct CG_StreamHull {
+    CGPointArray_t* hull;       /**< Hull of all batches so far */
+    CGPointArray_t* scratch;    /**< Hull being computed for the current batch */
+    CGCompute_t compute_type;   /**< Degeneracy handling passed to the hull algorithm */
+    size_t num_points;          /**< Points of all batches so far */
+} CGStreamHull_t;
+
+
+/** @internal Batch callback that merges a batch into the running hull */
+static CGError_t hull_batch(CGPointArray_t* batch, void* user_data){
+    CGStreamHull_t* state = (CGStreamHull_t*) user_data;
+    state->num_points += batch->num_points;
+    return cg_merge_hull_batch(batch, &state->hull, &state->scratch, state->compute_type);
+}
+
+
+/**
+ * Function that computes the convex hull of all remaining points in a stream. Each batch is merged
+ * with the hull of the previous batches, so memory use is bounded by the batch size plus the hull size.
+ * @ingroup stream
+ * @param stream Open point stream
+ * @param output_array Initialized point array the hull is appended to
+ * @param compute_type Flag to toggle between handling degeneracies or not.
+ * @return POINTS_TOO_FEW if the stream has less than 3 points, otherwise the status of reading the stream.
+ */
+CGError_t compute_convex_hull_stream(CGPointStream_t* stream, CGPointArray_t* output_array, CGCompute_t compute_type){
+    if(stream == NULL || output_array == NULL)
+        return CG_INVALID_INPUT;
+    CGStreamHull_t state;
+    state.hull = init_point_array(0);
+    state.scratch = init_point_array(0);
+    state.compute_type = compute_type;
+    state.num_points = 0;
+    CGError_t status = CG_NO_MEMORY;
+    if(state.hull != NULL && state.scratch != NULL)
+        status = for_each_point_batch(stream, hull_batch, &state);
+    // the running hull is recomputed once more, so small hulls come out in compute_monotone_chain's order
+    if(status == CG_SUCCESS)
+        status = cg_finish_merged_hull(state.hull, state.num_points, output_array, compute_type);
+    free_point_array(state.hull);
+    free_point_array(state.scratch);
+    return status;
+}
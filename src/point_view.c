@@ -0,0 +1,223 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing index views of shared point arrays. A view refers to the coordinates of
+ * an array through a reference counted share and keeps only a list of indices, so derived point
+ * sets such as sorted orders, filtered subsets and hulls cost one index per point instead of a
+ * copy of the coordinates.
+ *
+ * @defgroup ptview Point Views
+ * @brief Sorted, filtered and hull subsets of point arrays that share their coordinates.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+
+//----------------------------------------------------------------
+// Functions - Init and free point views
+//----------------------------------------------------------------
+
+
+/**
+ * Function that creates a view of every point of a point array, in array order.
+ * The array's coordinates are shared rather than copied, see share_point_array.
+ * @ingroup ptview
+ * @param point_array Point array to view
+ * @return Allocated view to be freed with free_point_view, or NULL if allocation fails.
+ */
+CGPointView_t* init_point_view(CGPointArray_t* point_array){
+    if(point_array == NULL)
+        return NULL;
+    CGPointView_t* point_view = (CGPointView_t*) cg_calloc(1, sizeof(CGPointView_t));
+    if(point_view == NULL)
+        return NULL;
+    size_t num_points = point_array->num_points;
+    point_view->points = share_point_array(point_array);
+    point_view->indices = (size_t*) cg_malloc((num_points ? num_points : 1) * sizeof(size_t));
+    if(point_view->points == NULL || point_view->indices == NULL){
+        free_point_view(point_view);
+        return NULL;
+    }
+    size_t i;
+    for(i = 0; i < num_points; i++)
+        point_view->indices[i] = i;
+    point_view->num_indices = num_points;
+    return point_view;
+}
+
+
+/**
+ * Function that creates a copy of a view. The indices are copied, the coordinates stay shared.
+ * Views may be copied from several threads at once.
+ * @ingroup ptview
+ * @param point_view View to copy
+ * @return Allocated view to be freed with free_point_view, or NULL if allocation fails.
+ */
+CGPointView_t* copy_point_view(const CGPointView_t* point_view){
+    if(point_view == NULL)
+        return NULL;
+    CGPointView_t* copy = (CGPointView_t*) cg_calloc(1, sizeof(CGPointView_t));
+    if(copy == NULL)
+        return NULL;
+    size_t num_indices = point_view->num_indices;
+    copy->points = share_point_array(point_view->points);
+    copy->indices = (size_t*) cg_malloc((num_indices ? num_indices : 1) * sizeof(size_t));
+    if(copy->points == NULL || copy->indices == NULL){
+        free_point_view(copy);
+        return NULL;
+    }
+    memcpy(copy->indices, point_view->indices, num_indices * sizeof(size_t));
+    copy->num_indices = num_indices;
+    return copy;
+}
+
+
+/**
+ * Function that frees a view, releasing the coordinates if it was their last user.
+ * @ingroup ptview
+ * @param point_view View to free
+ * @return INVALID_INPUT if point_view is NULL, otherwise SUCCESS.
+ */
+CGError_t free_point_view(CGPointView_t* point_view){
+    if(point_view == NULL)
+        return CG_INVALID_INPUT;
+    if(point_view->points != NULL)
+        free_point_array(point_view->points);
+    cg_free(point_view->indices);
+    cg_free(point_view);
+    return CG_SUCCESS;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Deriving views
+//----------------------------------------------------------------
+
+
+/** @internal Returns non-zero if the point at index_A sorts before or together with the one at index_B */
+static inline int index_precedes(const CGPointArray_t* points, const double* keys, size_t index_A, size_t index_B){
+    CG_COUNT(comparisons, 1);
+    if(keys != NULL)
+        return keys[index_A] <= keys[index_B];
+    if(points->xcoords[index_A] != points->xcoords[index_B])
+        return points->xcoords[index_A] < points->xcoords[index_B];
+    return points->ycoords[index_A] <= points->ycoords[index_B];
+}
+
+
+/**
+ * Function that reorders a view by a key per point. The sort is a stable bottom-up merge sort
+ * over the indices, the coordinates are not touched.
+ * @ingroup ptview
+ * @param point_view View to sort
+ * @param keys Key of every point of the viewed array, indexed like the array. If NULL, points are
+ *      ordered by x-coordinate, then y-coordinate.
+ * @return INVALID_INPUT if point_view is NULL, NO_MEMORY if scratch space cannot be allocated, otherwise SUCCESS.
+ */
+CGError_t sort_point_view(CGPointView_t* point_view, const double* keys){
+    if(point_view == NULL)
+        return CG_INVALID_INPUT;
+    size_t num_indices = point_view->num_indices;
+    if(num_indices < 2)
+        return CG_SUCCESS;
+    size_t* scratch = (size_t*) cg_malloc(num_indices * sizeof(size_t));
+    if(scratch == NULL)
+        return CG_NO_MEMORY;
+
+    const CGPointArray_t* points = point_view->points;
+    size_t* indices_in = point_view->indices;
+    size_t* indices_out = scratch;
+    size_t width;
+    for(width = 1; width < num_indices; width *= 2){
+        size_t left;
+        for(left = 0; left < num_indices; left += 2 * width){
+            size_t middle = (left + width < num_indices) ? left + width : num_indices;
+            size_t right = (middle + width < num_indices) ? middle + width : num_indices;
+            size_t i = left, j = middle, k = left;
+            while(i < middle && j < right)
+                indices_out[k++] = index_precedes(points, keys, indices_in[i], indices_in[j]) ? indices_in[i++] : indices_in[j++];
+            while(i < middle)
+                indices_out[k++] = indices_in[i++];
+            while(j < right)
+                indices_out[k++] = indices_in[j++];
+        }
+        size_t* temp = indices_in;
+        indices_in = indices_out;
+        indices_out = temp;
+    }
+    if(indices_in != point_view->indices)
+        memcpy(point_view->indices, indices_in, num_indices * sizeof(size_t));
+    cg_free(scratch);
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that removes the points a filter rejects from a view, keeping the order of the rest.
+ * @ingroup ptview
+ * @param point_view View to filter
+ * @param filter Callback returning non-zero for points to keep
+ * @param user_data Pointer passed through to the callback
+ * @return INVALID_INPUT if point_view or filter is NULL, otherwise SUCCESS.
+ */
+CGError_t filter_point_view(CGPointView_t* point_view, CGPointFilter_t filter, void* user_data){
+    if(point_view == NULL || filter == NULL)
+        return CG_INVALID_INPUT;
+    const CGPointArray_t* points = point_view->points;
+    size_t i, num_kept = 0;
+    for(i = 0; i < point_view->num_indices; i++){
+        size_t index = point_view->indices[i];
+        if(filter(points->xcoords[index], points->ycoords[index], user_data))
+            point_view->indices[num_kept++] = index;
+    }
+    point_view->num_indices = num_kept;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that copies the points of a view, in view order, to the end of a point array.
+ * @ingroup ptview
+ * @param point_view View to copy from
+ * @param point_array Initialized point array
+ * @return INVALID_INPUT if either param is NULL, NO_MEMORY if the array cannot be grown, otherwise SUCCESS.
+ */
+CGError_t point_array_from_point_view(const CGPointView_t* point_view, CGPointArray_t* point_array){
+    if(point_view == NULL || point_array == NULL)
+        return CG_INVALID_INPUT;
+    CGError_t status = reserve_point_array(point_array, point_array->num_points + point_view->num_indices);
+    if(status != CG_SUCCESS)
+        return status;
+    const CGPointArray_t* points = point_view->points;
+    size_t i;
+    for(i = 0; i < point_view->num_indices; i++){
+        size_t index = point_view->indices[i];
+        point_array->xcoords[point_array->num_points + i] = points->xcoords[index];
+        point_array->ycoords[point_array->num_points + i] = points->ycoords[index];
+    }
+    point_array->num_points += point_view->num_indices;
+    return CG_SUCCESS;
+}
@@ -0,0 +1,645 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing a static R-tree over bounding boxes for window queries. The tree is bulk
+ * loaded with Sort-Tile-Recursive packing: the entries of a level are cut into vertical slices by the
+ * x-coordinate of their centres, each slice is cut into runs of one node's worth by the y-coordinate,
+ * and each run gets a parent on the next level, until one root remains. Entries of every level are
+ * stored one level after the other in flat arrays, items first and the root last, and a node refers
+ * to its children by their range in those arrays. Items are indexed by their bounding box, so points
+ * and any shape with a box can be indexed, and results are the items' positions in their input.
+ *
+ * @defgroup rtree R-Trees
+ * @brief Packed, bulk loaded R-trees for window queries over points and boxes.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+// Children of each node, the last node of a level may have fewer
+#define RTREE_NODE_SIZE 16
+
+// Nodes a search can have waiting, enough for trees of up to 32 levels
+#define RTREE_STACK_SIZE (RTREE_NODE_SIZE * 32)
+
+// Windows a query costs about as much as visiting, to decide when batches are worth splitting
+#define RTREE_QUERY_COST 64
+
+// Windows of a batch per cell of the grid they are ordered on, and the most bits of each cell coordinate
+#define RTREE_WINDOWS_PER_CELL 4
+#define RTREE_ORDER_MAX_BITS 10
+
+// Items a result buffer starts out with
+#define RTREE_INITIAL_RESULTS 64
+
+
+/**
+ * Struct for a packed R-tree.
+ * @internal
+ */
+struct CG_RTree {
+    size_t num_items;           /**< Number of items indexed, the first entries */
+    size_t num_entries;         /**< Number of items and nodes, the root last */
+    CGBoundingBox_t* boxes;     /**< Bounding box of each entry, a node's children read in one run */
+    size_t* children;           /**< Position in the input of each item, then first child of each node */
+    size_t* child_ends;         /**< One past the last child of each node, indexed from the first node */
+};
+
+
+/**
+ * Struct for an entry of a level while the tree is packed.
+ * @internal
+ */
+typedef struct CG_RTreeEntry {
+    double center[2];           /**< Centre of the box, x then y, that entries are sorted by */
+    CGBoundingBox_t box;        /**< Bounding box of the entry */
+    size_t first;               /**< Position of an item in the input, or first child of a node */
+    size_t end;                 /**< One past the last child of a node */
+} CGRTreeEntry_t;
+
+
+/**
+ * Struct for a growing list of items found by window queries.
+ * @internal
+ */
+typedef struct CG_RTreeResults {
+    size_t* data;               /**< Items found */
+    size_t count;               /**< Number of items stored */
+    size_t capacity;            /**< Items that fit in data */
+    int failed;                 /**< Set if growing the buffer failed */
+    CGContext_t* context;       /**< Context whose allocator grows the buffer, NULL for the global allocator */
+} CGRTreeResults_t;
+
+
+//----------------------------------------------------------------
+// Functions - Building R-trees
+//----------------------------------------------------------------
+
+
+/** @internal Swaps two entries being packed */
+static inline void swap_entries(CGRTreeEntry_t* entries, size_t i, size_t j){
+    CGRTreeEntry_t temp = entries[i];
+    entries[i] = entries[j];
+    entries[j] = temp;
+}
+
+
+/**
+ * Function that moves the entry of rank k along an axis to position k, with no greater centre before
+ * it and no smaller one after it, using Wirth's selection in expected linear time.
+ * @internal
+ * @param entries Entries being packed
+ * @param begin First entry of the range
+ * @param end One past the last entry of the range
+ * @param k Position to fill, within the range
+ * @param axis 0 to select on x, 1 on y
+ */
+static void select_entry(CGRTreeEntry_t* entries, size_t begin, size_t end, size_t k, int axis){
+    size_t left = begin, right = end - 1;
+    while(left < right){
+        // median of three guards against sorted and reverse sorted ranges
+        size_t middle = left + (right - left) / 2;
+        if(entries[middle].center[axis] < entries[left].center[axis]) swap_entries(entries, middle, left);
+        if(entries[right].center[axis] < entries[left].center[axis]) swap_entries(entries, right, left);
+        if(entries[right].center[axis] < entries[middle].center[axis]) swap_entries(entries, right, middle);
+        double pivot = entries[middle].center[axis];
+        size_t i = left, j = right;
+        // stopping on equal keys splits runs of duplicates evenly
+        while(i <= j){
+            while(entries[i].center[axis] < pivot) i++;
+            while(pivot < entries[j].center[axis]) j--;
+            if(i <= j){
+                swap_entries(entries, i, j);
+                i++;
+                if(j == 0) break;
+                j--;
+            }
+        }
+        if(j < k) left = i;
+        if(k < i) right = j;
+    }
+}
+
+
+/**
+ * Function that orders a range of entries into groups of a fixed size along an axis, every group's
+ * centres at most those of the groups after it. Entries within a group are left in any order, which
+ * is all packing needs, so this costs less than sorting the range.
+ * @internal
+ * @param entries Entries being packed
+ * @param begin First entry of the range
+ * @param end One past the last entry of the range
+ * @param group_size Entries per group, the last group of the range may have fewer
+ * @param axis 0 to group on x, 1 on y
+ */
+static void group_entries(CGRTreeEntry_t* entries, size_t begin, size_t end, size_t group_size, int axis){
+    while(end - begin > group_size){
+        size_t num_groups = (end - begin + group_size - 1) / group_size;
+        size_t middle = begin + num_groups / 2 * group_size;
+        select_entry(entries, begin, end, middle, axis);
+        group_entries(entries, begin, middle, group_size, axis);
+        begin = middle;
+    }
+}
+
+
+/** @internal Sets the centre of an entry from its box */
+static inline void center_entry(CGRTreeEntry_t* entry){
+    entry->center[0] = entry->box.min_x / 2 + entry->box.max_x / 2;
+    entry->center[1] = entry->box.min_y / 2 + entry->box.max_y / 2;
+}
+
+
+/** @internal Returns non-zero if a box has no NaN coordinate and its minimums are at most its maximums */
+static inline int box_is_valid(const CGBoundingBox_t* box){
+    return box->min_x <= box->max_x && box->min_y <= box->max_y;
+}
+
+
+/**
+ * Function that packs the entries of a tree's items with Sort-Tile-Recursive, level by level.
+ * @internal
+ * @param entries Entry of every item, with its box and input position set; used as scratch and freed
+ * @param num_items Number of items
+ * @return Allocated tree, NULL if allocation fails.
+ */
+static CGRTree_t* pack_rtree(CGRTreeEntry_t* entries, size_t num_items){
+    CGRTree_t* tree = (CGRTree_t*) cg_calloc(1, sizeof(CGRTree_t));
+    if(tree == NULL){
+        cg_free(entries);
+        return NULL;
+    }
+    size_t num_entries = 0, count = num_items;
+    if(num_items > 0){
+        num_entries = num_items;
+        do{
+            count = (count + RTREE_NODE_SIZE - 1) / RTREE_NODE_SIZE;
+            num_entries += count;
+        } while(count > 1);
+    }
+    size_t allocated = num_entries ? num_entries : 1;
+    tree->num_items = num_items;
+    tree->num_entries = num_entries;
+    tree->boxes = (CGBoundingBox_t*) cg_malloc(allocated * sizeof(CGBoundingBox_t));
+    tree->children = (size_t*) cg_malloc(allocated * sizeof(size_t));
+    tree->child_ends = (size_t*) cg_malloc((num_entries > num_items ? num_entries - num_items : 1) * sizeof(size_t));
+    if(tree->boxes == NULL || tree->children == NULL || tree->child_ends == NULL){
+        cg_free(entries);
+        free_rtree(tree);
+        return NULL;
+    }
+    if(num_items == 0){
+        cg_free(entries);
+        return tree;
+    }
+
+    size_t level_begin = 0, i;
+    count = num_items;
+    do{
+        // cut the level into about as many slices as each slice has nodes
+        size_t num_nodes = (count + RTREE_NODE_SIZE - 1) / RTREE_NODE_SIZE;
+        size_t num_slices = (size_t) ceil(sqrt((double) num_nodes));
+        size_t slice_size = (num_nodes + num_slices - 1) / num_slices * RTREE_NODE_SIZE;
+        size_t slice;
+        group_entries(entries, 0, count, slice_size, 0);
+        for(slice = 0; slice < count; slice += slice_size)
+            group_entries(entries, slice, slice + slice_size < count ? slice + slice_size : count, RTREE_NODE_SIZE, 1);
+
+        for(i = 0; i < count; i++){
+            size_t entry = level_begin + i;
+            tree->boxes[entry] = entries[i].box;
+            tree->children[entry] = entries[i].first;
+            if(entry >= num_items)
+                tree->child_ends[entry - num_items] = entries[i].end;
+        }
+        // a parent only overwrites entries of groups already read
+        for(i = 0; i < num_nodes; i++){
+            size_t begin = i * RTREE_NODE_SIZE, end = begin + RTREE_NODE_SIZE < count ? begin + RTREE_NODE_SIZE : count;
+            CGBoundingBox_t box = entries[begin].box;
+            size_t j;
+            for(j = begin + 1; j < end; j++){
+                if(entries[j].box.min_x < box.min_x) box.min_x = entries[j].box.min_x;
+                if(entries[j].box.min_y < box.min_y) box.min_y = entries[j].box.min_y;
+                if(entries[j].box.max_x > box.max_x) box.max_x = entries[j].box.max_x;
+                if(entries[j].box.max_y > box.max_y) box.max_y = entries[j].box.max_y;
+            }
+            entries[i].box = box;
+            entries[i].first = level_begin + begin;
+            entries[i].end = level_begin + end;
+            center_entry(entries + i);
+        }
+        level_begin += count;
+        count = num_nodes;
+    } while(count > 1);
+
+    size_t root = level_begin;
+    tree->boxes[root] = entries[0].box;
+    tree->children[root] = entries[0].first;
+    tree->child_ends[root - num_items] = entries[0].end;
+    cg_free(entries);
+    return tree;
+}
+
+
+/**
+ * Function that bulk loads an R-tree over bounding boxes, such as those of polygons or segments.
+ * Results of queries are positions in the array of boxes. The boxes are copied, the array may be
+ * freed once the tree is built.
+ * @ingroup rtree
+ * @param boxes Bounding box of every item, may be NULL if there are none
+ * @param num_boxes Number of items
+ * @return Allocated tree to be freed with free_rtree, or NULL if boxes is NULL while num_boxes is not
+ *      zero, a box has a NaN coordinate or a minimum above its maximum, or allocation fails.
+ */
+CGRTree_t* init_rtree(const CGBoundingBox_t* boxes, size_t num_boxes){
+    if(boxes == NULL && num_boxes > 0)
+        return NULL;
+    CGRTreeEntry_t* entries = (CGRTreeEntry_t*) cg_malloc((num_boxes ? num_boxes : 1) * sizeof(CGRTreeEntry_t));
+    if(entries == NULL)
+        return NULL;
+    size_t i;
+    for(i = 0; i < num_boxes; i++){
+        if(!box_is_valid(boxes + i)){
+            cg_free(entries);
+            return NULL;
+        }
+        entries[i].box = boxes[i];
+        entries[i].first = i;
+        center_entry(entries + i);
+    }
+    return pack_rtree(entries, num_boxes);
+}
+
+
+/**
+ * Function that bulk loads an R-tree over the points of a point array. Results of queries are
+ * positions in the array, which may be freed once the tree is built.
+ * @ingroup rtree
+ * @param point_array Point array to index
+ * @return Allocated tree to be freed with free_rtree, or NULL if point_array is NULL, a coordinate is
+ *      NaN or allocation fails.
+ */
+CGRTree_t* init_point_array_rtree(const CGPointArray_t* point_array){
+    if(point_array == NULL)
+        return NULL;
+    size_t num_points = point_array->num_points;
+    CGRTreeEntry_t* entries = (CGRTreeEntry_t*) cg_malloc((num_points ? num_points : 1) * sizeof(CGRTreeEntry_t));
+    if(entries == NULL)
+        return NULL;
+    size_t i;
+    for(i = 0; i < num_points; i++){
+        double xcoord = point_array->xcoords[i], ycoord = point_array->ycoords[i];
+        if(xcoord != xcoord || ycoord != ycoord){
+            cg_free(entries);
+            return NULL;
+        }
+        entries[i].box.min_x = entries[i].box.max_x = entries[i].center[0] = xcoord;
+        entries[i].box.min_y = entries[i].box.max_y = entries[i].center[1] = ycoord;
+        entries[i].first = i;
+    }
+    return pack_rtree(entries, num_points);
+}
+
+
+/**
+ * Function that bulk loads an R-tree over the points of a point set. Results of queries are
+ * positions in the set's list, head first, and the set may be freed once the tree is built.
+ * @ingroup rtree
+ * @param point_set Point set to index
+ * @return Allocated tree to be freed with free_rtree, or NULL if point_set is NULL, a coordinate is
+ *      NaN or allocation fails.
+ */
+CGRTree_t* init_point_set_rtree(const CGPointSet_t* point_set){
+    if(point_set == NULL)
+        return NULL;
+    size_t num_points = point_set->num_points > 0 ? (size_t) point_set->num_points : 0;
+    CGRTreeEntry_t* entries = (CGRTreeEntry_t*) cg_malloc((num_points ? num_points : 1) * sizeof(CGRTreeEntry_t));
+    if(entries == NULL)
+        return NULL;
+    size_t i = 0;
+    CGPointNode_t* current_node = point_set->head;
+    while(current_node != NULL && i < num_points){
+        double xcoord = current_node->point->xcoord, ycoord = current_node->point->ycoord;
+        if(xcoord != xcoord || ycoord != ycoord){
+            cg_free(entries);
+            return NULL;
+        }
+        entries[i].box.min_x = entries[i].box.max_x = entries[i].center[0] = xcoord;
+        entries[i].box.min_y = entries[i].box.max_y = entries[i].center[1] = ycoord;
+        entries[i].first = i;
+        i++;
+        current_node = current_node->next;
+    }
+    return pack_rtree(entries, i);
+}
+
+
+/**
+ * Function that frees an R-tree.
+ * @ingroup rtree
+ * @param tree Tree to free
+ * @return INVALID_INPUT if tree is NULL, otherwise SUCCESS.
+ */
+CGError_t free_rtree(CGRTree_t* tree){
+    if(tree == NULL)
+        return CG_INVALID_INPUT;
+    cg_free(tree->boxes);
+    cg_free(tree->children);
+    cg_free(tree->child_ends);
+    cg_free(tree);
+    return CG_SUCCESS;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Searching R-trees
+//----------------------------------------------------------------
+
+
+/**
+ * Function that checks whether the box of an entry and a window share at least one point. The four
+ * comparisons are combined without branching, as whether a child overlaps is hard to predict.
+ * @internal
+ * @param tree Tree the entry belongs to
+ * @param entry Entry to check
+ * @param window Window searched
+ * @return Non-zero if they overlap, otherwise zero.
+ */
+static inline int entry_overlaps(const CGRTree_t* tree, size_t entry, const CGBoundingBox_t* window){
+    const CGBoundingBox_t* box = tree->boxes + entry;
+    return (box->min_x <= window->max_x) & (window->min_x <= box->max_x) &
+           (box->min_y <= window->max_y) & (window->min_y <= box->max_y);
+}
+
+
+/** @internal Returns non-zero if the box of an entry lies within a window */
+static inline int entry_inside(const CGRTree_t* tree, size_t entry, const CGBoundingBox_t* window){
+    const CGBoundingBox_t* box = tree->boxes + entry;
+    return (window->min_x <= box->min_x) & (box->max_x <= window->max_x) &
+           (window->min_y <= box->min_y) & (box->max_y <= window->max_y);
+}
+
+
+/**
+ * Function that visits the items of a tree whose boxes overlap a window. Once a node lies within the
+ * window, the items below it are visited without testing their boxes.
+ * @internal
+ * @param tree Tree to search
+ * @param window Valid window to search
+ * @param visitor Callback run for every item found, returning non-zero to end the search
+ * @param user_data Pointer passed through to the visitor
+ */
+static void search_rtree(const CGRTree_t* tree, const CGBoundingBox_t* window, CGRTreeVisitor_t visitor, void* user_data){
+    if(tree->num_entries == 0)
+        return;
+    size_t num_items = tree->num_items;
+    size_t stack[RTREE_STACK_SIZE];
+    unsigned char stack_inside[RTREE_STACK_SIZE];
+    size_t depth = 0;
+    size_t root = tree->num_entries - 1;
+    if(!entry_overlaps(tree, root, window))
+        return;
+    stack[depth] = root;
+    stack_inside[depth++] = (unsigned char) entry_inside(tree, root, window);
+    while(depth > 0){
+        depth--;
+        size_t node = stack[depth];
+        int inside = stack_inside[depth];
+        size_t begin = tree->children[node], end = tree->child_ends[node - num_items];
+        size_t child;
+        if(begin < num_items){
+            // items found are written out unconditionally and kept by advancing past them
+            size_t found[RTREE_NODE_SIZE];
+            size_t num_found = 0, i;
+            for(child = begin; child < end; child++){
+                found[num_found] = tree->children[child];
+                num_found += inside | entry_overlaps(tree, child, window);
+            }
+            for(i = 0; i < num_found; i++)
+                if(visitor(found[i], user_data))
+                    return;
+        }
+        else{
+            for(child = begin; child < end; child++){
+                stack[depth] = child;
+                stack_inside[depth] = (unsigned char) (inside | entry_inside(tree, child, window));
+                depth += inside | entry_overlaps(tree, child, window);
+            }
+        }
+    }
+}
+
+
+/**
+ * Function that finds the items of a tree whose boxes overlap a window, boundaries included, and
+ * passes each to a visitor as it is found, in no particular order.
+ * @ingroup rtree
+ * @param tree Tree to search
+ * @param window Window to search, with its minimums at most its maximums
+ * @param visitor Callback run with the position of every item found, returning non-zero to end the search
+ * @param user_data Pointer passed through to the visitor
+ * @return INVALID_INPUT if a pointer other than user_data is NULL or the window has a NaN coordinate or
+ *      a minimum above its maximum, otherwise SUCCESS.
+ */
+CGError_t rtree_query(const CGRTree_t* tree, const CGBoundingBox_t* window, CGRTreeVisitor_t visitor, void* user_data){
+    if(tree == NULL || window == NULL || visitor == NULL || !box_is_valid(window))
+        return CG_INVALID_INPUT;
+    search_rtree(tree, window, visitor, user_data);
+    return CG_SUCCESS;
+}
+
+
+/** @internal Visitor appending an item to a result buffer, growing it as needed */
+static int append_item(size_t item, void* user_data){
+    CGRTreeResults_t* results = (CGRTreeResults_t*) user_data;
+    if(results->count == results->capacity){
+        size_t capacity = results->capacity ? 2 * results->capacity : RTREE_INITIAL_RESULTS;
+        size_t* data = (size_t*) cg_context_realloc(results->context, results->data, capacity * sizeof(size_t));
+        if(data == NULL){
+            results->failed = 1;
+            return 1;
+        }
+        results->data = data;
+        results->capacity = capacity;
+    }
+    results->data[results->count++] = item;
+    return 0;
+}
+
+
+/**
+ * Function that orders the windows of a batch along a Morton curve over a grid laid on the tree's box,
+ * with a counting sort, so windows searched one after the other mostly read the same nodes.
+ * @internal
+ * @param arena Arena the scratch space is allocated from
+ * @param tree Tree to search, not empty
+ * @param windows Windows of the batch
+ * @param num_windows Number of windows
+ * @param order Output positions of the windows in the order to search them
+ * @return NO_MEMORY if scratch space cannot be allocated, otherwise SUCCESS.
+ */
+static CGError_t order_windows(CGArena_t* arena, const CGRTree_t* tree, const CGBoundingBox_t* windows, size_t num_windows, size_t* order){
+    unsigned bits = 0;
+    while(bits < RTREE_ORDER_MAX_BITS && ((size_t) 1 << (2 * bits)) * RTREE_WINDOWS_PER_CELL < num_windows)
+        bits++;
+    size_t side = (size_t) 1 << bits, num_cells = side * side;
+    size_t* cell_starts = (size_t*) cg_arena_alloc(arena, (num_cells + 1) * sizeof(size_t));
+    uint32_t* codes = (uint32_t*) cg_arena_alloc(arena, num_windows * sizeof(uint32_t));
+    if(cell_starts == NULL || codes == NULL)
+        return CG_NO_MEMORY;
+    memset(cell_starts, 0, (num_cells + 1) * sizeof(size_t));
+    const CGBoundingBox_t* root = tree->boxes + tree->num_entries - 1;
+    double width = root->max_x - root->min_x, height = root->max_y - root->min_y;
+    double scale_x = width > 0 ? (double) side / width : 0, scale_y = height > 0 ? (double) side / height : 0;
+    size_t i;
+    for(i = 0; i < num_windows; i++){
+        // centres outside the tree, or NaN for unbounded windows, go to the nearest edge cell
+        double cell_x = (windows[i].min_x / 2 + windows[i].max_x / 2 - root->min_x) * scale_x;
+        double cell_y = (windows[i].min_y / 2 + windows[i].max_y / 2 - root->min_y) * scale_y;
+        uint64_t column = cell_x >= 0 ? (cell_x < (double) side ? (uint64_t) cell_x : side - 1) : 0;
+        uint64_t row = cell_y >= 0 ? (cell_y < (double) side ? (uint64_t) cell_y : side - 1) : 0;
+        codes[i] = (uint32_t) (cg_spread_bits(column) | (cg_spread_bits(row) << 1));
+        cell_starts[codes[i] + 1]++;
+    }
+    for(i = 0; i < num_cells; i++)
+        cell_starts[i + 1] += cell_starts[i];
+    for(i = 0; i < num_windows; i++)
+        order[cell_starts[codes[i]]++] = i;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Struct describing the windows one task of rtree_query_batch_ctx searches.
+ * @internal
+ */
+typedef struct CG_RTreeQueryChunk {
+    const CGRTree_t* tree;              /**< Tree to search */
+    const CGBoundingBox_t* windows;     /**< Windows to search */
+    const size_t* order;                /**< Positions of the windows in search order */
+    size_t begin;                       /**< First window of the slice, in search order */
+    size_t end;                         /**< One past the last window of the slice */
+    size_t* starts;                     /**< Output start of each window's items in the buffer of its slice */
+    size_t* counts;                     /**< Output number of items found in each window */
+    CGRTreeResults_t found;             /**< Items found in the slice's windows */
+} CGRTreeQueryChunk_t;
+
+
+/** @internal Task searching one slice of windows */
+static void query_chunk_task(void* argument, size_t task_index, CGArena_t* arena){
+    (void) arena;
+    CGRTreeQueryChunk_t* chunk = (CGRTreeQueryChunk_t*) argument + task_index;
+    size_t i;
+    for(i = chunk->begin; i < chunk->end && !chunk->found.failed; i++){
+        size_t window = chunk->order[i];
+        chunk->starts[window] = chunk->found.count;
+        search_rtree(chunk->tree, chunk->windows + window, append_item, &chunk->found);
+        chunk->counts[window] = chunk->found.count - chunk->starts[window];
+    }
+}
+
+
+/**
+ * Function that finds the items of a tree overlapping every window of a batch, on the worker pool of a
+ * context. Windows are searched in an order that keeps nearby windows together, which matters once the
+ * tree no longer fits in cache, and each slice of that order goes to one task. Results are returned in
+ * compressed rows: the items found in window i are (*items)[offsets[i]] up to (*items)[offsets[i + 1]],
+ * in no particular order.
+ * @ingroup rtree
+ * @param context Context providing the worker pool
+ * @param tree Tree to search
+ * @param windows Windows to search, each with its minimums at most its maximums
+ * @param num_windows Number of windows
+ * @param items Output positions of the items found, allocated by the library and released with free_buffer
+ * @param offsets Output start of each window's items in items, with room for one more entry than there are windows
+ * @return INVALID_INPUT if a param is NULL or a window is invalid, NO_MEMORY if allocation fails, otherwise SUCCESS.
+ */
+CGError_t rtree_query_batch_ctx(CGContext_t* context, const CGRTree_t* tree, const CGBoundingBox_t* windows, size_t num_windows,
+                                size_t** items, size_t* offsets){
+    if(context == NULL || tree == NULL || (windows == NULL && num_windows > 0) || items == NULL || offsets == NULL)
+        return CG_INVALID_INPUT;
+    size_t i, k;
+    for(i = 0; i < num_windows; i++)
+        if(!box_is_valid(windows + i))
+            return CG_INVALID_INPUT;
+    *items = NULL;
+    if(tree->num_items == 0 || num_windows == 0){
+        for(i = 0; i <= num_windows; i++)
+            offsets[i] = 0;
+        return CG_SUCCESS;
+    }
+
+    CGArena_t* arena = cg_context_acquire_arena(context);
+    size_t num_chunks = cg_context_point_tasks(context, num_windows * RTREE_QUERY_COST, 4);
+    size_t* order = (size_t*) cg_arena_alloc(arena, num_windows * sizeof(size_t));
+    size_t* starts = (size_t*) cg_arena_alloc(arena, num_windows * sizeof(size_t));
+    CGRTreeQueryChunk_t* chunks = (CGRTreeQueryChunk_t*) cg_arena_alloc(arena, num_chunks * sizeof(CGRTreeQueryChunk_t));
+    if(order == NULL || starts == NULL || chunks == NULL || order_windows(arena, tree, windows, num_windows, order) != CG_SUCCESS){
+        cg_context_release_arena(context, arena);
+        return CG_NO_MEMORY;
+    }
+    memset(chunks, 0, num_chunks * sizeof(CGRTreeQueryChunk_t));
+    for(i = 0; i < num_chunks; i++){
+        chunks[i].tree = tree;
+        chunks[i].windows = windows;
+        chunks[i].order = order;
+        chunks[i].begin = num_windows / num_chunks * i;
+        chunks[i].end = (i == num_chunks - 1) ? num_windows : num_windows / num_chunks * (i + 1);
+        chunks[i].starts = starts;
+        chunks[i].counts = offsets + 1;
+        chunks[i].found.context = context;
+    }
+    cg_context_parallel_for(context, num_chunks, query_chunk_task, chunks);
+
+    // each slice found its items in a buffer of its own, which are moved to their windows' rows
+    CGError_t status = CG_SUCCESS;
+    size_t total = 0;
+    for(i = 0; i < num_chunks; i++){
+        if(chunks[i].found.failed)
+            status = CG_NO_MEMORY;
+        total += chunks[i].found.count;
+    }
+    if(status == CG_SUCCESS){
+        *items = (size_t*) cg_malloc((total ? total : 1) * sizeof(size_t));
+        if(*items == NULL)
+            status = CG_NO_MEMORY;
+    }
+    if(status == CG_SUCCESS){
+        offsets[0] = 0;
+        for(i = 0; i < num_windows; i++)
+            offsets[i + 1] += offsets[i];
+        for(i = 0; i < num_chunks; i++){
+            for(k = chunks[i].begin; k < chunks[i].end; k++){
+                size_t window = order[k], count = offsets[window + 1] - offsets[window];
+                if(count > 0)
+                    memcpy(*items + offsets[window], chunks[i].found.data + starts[window], count * sizeof(size_t));
+            }
+        }
+    }
+    for(i = 0; i < num_chunks; i++)
+        cg_context_free(context, chunks[i].found.data);
+    cg_context_release_arena(context, arena);
+    return status;
+}
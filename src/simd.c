@@ -0,0 +1,727 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing the numeric kernels of the library in one variant per instruction set,
+ * and the dispatch choosing between them. Each variant is compiled for its own target, so one
+ * binary carries them all; the best one the processor supports is picked when the library is
+ * loaded, and set_simd_level switches to another, for instance to compare them in benchmarks.
+ * Every variant gives the same results as the scalar one.
+ *
+ * @defgroup simd SIMD Dispatch
+ * @brief Selection of the instruction set used by the numeric kernels.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CG_X86 1
+#include <immintrin.h>
+#endif
+
+// GCC and Clang compile intrinsics only in functions targeting their instruction set, MSVC always does
+#if defined(CG_X86) && defined(__GNUC__)
+#define CG_TARGET_SSE2      __attribute__((target("sse2")))
+#define CG_TARGET_AVX2      __attribute__((target("avx2")))
+#define CG_TARGET_AVX512    __attribute__((target("avx512f,avx512bw")))
+#else
+#define CG_TARGET_SSE2
+#define CG_TARGET_AVX2
+#define CG_TARGET_AVX512
+#endif
+
+// Relative error bound of an orientation computed in doubles, (3 + 16 eps) eps as in Shewchuk's orient2d
+#define ORIENTATION_ERROR_BOUND 3.3306690738754716e-16
+
+// Value of the level state before the processor has been checked
+#define LEVEL_UNKNOWN ((size_t) -1)
+
+
+//----------------------------------------------------------------
+// Kernels - Scalar
+//----------------------------------------------------------------
+
+
+/** @internal Classifies 64 bytes into newline and comma bitmaps */
+static void find_structurals_scalar(const char* block, uint64_t* newlines, uint64_t* commas){
+    uint64_t newline_mask = 0, comma_mask = 0;
+    int i;
+    for(i = 0; i < 64; i++){
+        newline_mask |= (uint64_t) (block[i] == '\n') << i;
+        comma_mask |= (uint64_t) (block[i] == ',') << i;
+    }
+    *newlines = newline_mask;
+    *commas = comma_mask;
+}
+
+
+/** @internal Extends a bounding box over points, with the comparisons of compute_bounding_box */
+static void extend_bounds_scalar(const double* xcoords, const double* ycoords, size_t num_points, CGBoundingBox_t* bounding_box){
+    double min_x = bounding_box->min_x, max_x = bounding_box->max_x;
+    double min_y = bounding_box->min_y, max_y = bounding_box->max_y;
+    size_t i;
+    for(i = 0; i < num_points; i++){
+        double xcoord = xcoords[i];
+        double ycoord = ycoords[i];
+        min_x = xcoord < min_x ? xcoord : min_x;
+        max_x = xcoord > max_x ? xcoord : max_x;
+        min_y = ycoord < min_y ? ycoord : min_y;
+        max_y = ycoord > max_y ? ycoord : max_y;
+    }
+    bounding_box->min_x = min_x;
+    bounding_box->max_x = max_x;
+    bounding_box->min_y = min_y;
+    bounding_box->max_y = max_y;
+}
+
+
+/** @internal Bounding box of a non-empty set of points */
+static void bounding_box_scalar(const double* xcoords, const double* ycoords, size_t num_points, CGBoundingBox_t* bounding_box){
+    bounding_box->min_x = bounding_box->max_x = xcoords[0];
+    bounding_box->min_y = bounding_box->max_y = ycoords[0];
+    extend_bounds_scalar(xcoords + 1, ycoords + 1, num_points - 1, bounding_box);
+}
+
+
+/** @internal Squared distances of coordinates from an origin */
+static void squared_distances_scalar(const CGCoord_t* coords, size_t num_coords, const CGCoord_t* origin, double* distances){
+    size_t i;
+    for(i = 0; i < num_coords; i++){
+        double delta_x = coords[i].xcoord - origin->xcoord, delta_y = coords[i].ycoord - origin->ycoord;
+        distances[i] = delta_x * delta_x + delta_y * delta_y;
+    }
+}
+
+
+/** @internal Orientations of points against the line a, b, zero where the sign is not certain */
+static void orientations_scalar(const double* xcoords, const double* ycoords, size_t num_points,
+                                const CGCoord_t* a, const CGCoord_t* b, double* orientations){
+    double edge_x = b->xcoord - a->xcoord, edge_y = b->ycoord - a->ycoord;
+    size_t i;
+    for(i = 0; i < num_points; i++){
+        double left = edge_x * (ycoords[i] - a->ycoord);
+        double right = edge_y * (xcoords[i] - a->xcoord);
+        double orientation = left - right;
+        orientations[i] = fabs(orientation) > ORIENTATION_ERROR_BOUND * (fabs(left) + fabs(right)) ? orientation : 0.0;
+    }
+}
+
+
+/** @internal Empties the lanes of a summary */
+static void init_summary_lanes(CGSummaryLanes_t* lanes){
+    int lane;
+    for(lane = 0; lane < CG_SUMMARY_LANES; lane++){
+        lanes->min_x[lane] = lanes->low_x[lane] = lanes->low_y[lane] = HUGE_VAL;
+        lanes->max_x[lane] = lanes->high_x[lane] = lanes->high_y[lane] = -HUGE_VAL;
+        lanes->low_index[lane] = lanes->high_index[lane] = -1.0;
+        lanes->sum_x[lane] = lanes->sum_y[lane] = 0.0;
+        lanes->sum_xx[lane] = lanes->sum_yy[lane] = lanes->sum_xy[lane] = 0.0;
+    }
+}
+
+
+/** @internal Adds points begin to end of a slice to their lanes, one at a time */
+static void summarize_range(const double* xcoords, const double* ycoords, size_t begin, size_t end,
+                            const CGCoord_t* shift, CGSummaryLanes_t* lanes){
+    size_t i;
+    for(i = begin; i < end; i++){
+        int lane = (int) (i % CG_SUMMARY_LANES);
+        double xcoord = xcoords[i], ycoord = ycoords[i];
+        lanes->min_x[lane] = xcoord < lanes->min_x[lane] ? xcoord : lanes->min_x[lane];
+        lanes->max_x[lane] = xcoord > lanes->max_x[lane] ? xcoord : lanes->max_x[lane];
+        if(ycoord < lanes->low_y[lane] || (ycoord == lanes->low_y[lane] && xcoord < lanes->low_x[lane])){
+            lanes->low_x[lane] = xcoord;
+            lanes->low_y[lane] = ycoord;
+            lanes->low_index[lane] = (double) i;
+        }
+        if(ycoord > lanes->high_y[lane] || (ycoord == lanes->high_y[lane] && xcoord > lanes->high_x[lane])){
+            lanes->high_x[lane] = xcoord;
+            lanes->high_y[lane] = ycoord;
+            lanes->high_index[lane] = (double) i;
+        }
+        double delta_x = xcoord - shift->xcoord, delta_y = ycoord - shift->ycoord;
+        lanes->sum_x[lane] += delta_x;
+        lanes->sum_y[lane] += delta_y;
+        lanes->sum_xx[lane] += delta_x * delta_x;
+        lanes->sum_yy[lane] += delta_y * delta_y;
+        lanes->sum_xy[lane] += delta_x * delta_y;
+    }
+}
+
+
+/** @internal Summary of points in lanes */
+static void summarize_scalar(const double* xcoords, const double* ycoords, size_t num_points, const CGCoord_t* shift,
+                             CGSummaryLanes_t* lanes){
+    init_summary_lanes(lanes);
+    summarize_range(xcoords, ycoords, 0, num_points, shift, lanes);
+}
+
+
+#ifdef CG_X86
+
+//----------------------------------------------------------------
+// Kernels - SSE2
+//----------------------------------------------------------------
+
+
+CG_TARGET_SSE2
+static void find_structurals_sse2(const char* block, uint64_t* newlines, uint64_t* commas){
+    const __m128i newline_vec = _mm_set1_epi8('\n');
+    const __m128i comma_vec = _mm_set1_epi8(',');
+    uint64_t newline_mask = 0, comma_mask = 0;
+    int i;
+    for(i = 0; i < 4; i++){
+        __m128i chunk = _mm_loadu_si128((const __m128i*) (block + 16 * i));
+        newline_mask |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline_vec)) << (16 * i);
+        comma_mask |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, comma_vec)) << (16 * i);
+    }
+    *newlines = newline_mask;
+    *commas = comma_mask;
+}
+
+
+CG_TARGET_SSE2
+static void bounding_box_sse2(const double* xcoords, const double* ycoords, size_t num_points, CGBoundingBox_t* bounding_box){
+    __m128d min_x = _mm_set1_pd(xcoords[0]), max_x = min_x;
+    __m128d min_y = _mm_set1_pd(ycoords[0]), max_y = min_y;
+    size_t i;
+    for(i = 0; i + 2 <= num_points; i += 2){
+        __m128d xcoord = _mm_loadu_pd(xcoords + i);
+        __m128d ycoord = _mm_loadu_pd(ycoords + i);
+        min_x = _mm_min_pd(xcoord, min_x);
+        max_x = _mm_max_pd(xcoord, max_x);
+        min_y = _mm_min_pd(ycoord, min_y);
+        max_y = _mm_max_pd(ycoord, max_y);
+    }
+    double lanes[4][2];
+    _mm_storeu_pd(lanes[0], min_x);
+    _mm_storeu_pd(lanes[1], max_x);
+    _mm_storeu_pd(lanes[2], min_y);
+    _mm_storeu_pd(lanes[3], max_y);
+    bounding_box->min_x = lanes[0][0];
+    bounding_box->max_x = lanes[1][0];
+    bounding_box->min_y = lanes[2][0];
+    bounding_box->max_y = lanes[3][0];
+    double lane_x[2] = {lanes[0][1], lanes[1][1]};
+    double lane_y[2] = {lanes[2][1], lanes[3][1]};
+    extend_bounds_scalar(lane_x, lane_y, 2, bounding_box);
+    extend_bounds_scalar(xcoords + i, ycoords + i, num_points - i, bounding_box);
+}
+
+
+CG_TARGET_SSE2
+static void squared_distances_sse2(const CGCoord_t* coords, size_t num_coords, const CGCoord_t* origin, double* distances){
+    const __m128d origin_vec = _mm_loadu_pd(&origin->xcoord);
+    size_t i;
+    for(i = 0; i < num_coords; i++){
+        __m128d delta = _mm_sub_pd(_mm_loadu_pd(&coords[i].xcoord), origin_vec);
+        __m128d square = _mm_mul_pd(delta, delta);
+        _mm_store_sd(distances + i, _mm_add_sd(square, _mm_unpackhi_pd(square, square)));
+    }
+}
+
+
+CG_TARGET_SSE2
+static void orientations_sse2(const double* xcoords, const double* ycoords, size_t num_points,
+                              const CGCoord_t* a, const CGCoord_t* b, double* orientations){
+    const __m128d edge_x = _mm_set1_pd(b->xcoord - a->xcoord), edge_y = _mm_set1_pd(b->ycoord - a->ycoord);
+    const __m128d a_x = _mm_set1_pd(a->xcoord), a_y = _mm_set1_pd(a->ycoord);
+    const __m128d sign = _mm_set1_pd(-0.0), bound = _mm_set1_pd(ORIENTATION_ERROR_BOUND);
+    size_t i;
+    for(i = 0; i + 2 <= num_points; i += 2){
+        __m128d left = _mm_mul_pd(edge_x, _mm_sub_pd(_mm_loadu_pd(ycoords + i), a_y));
+        __m128d right = _mm_mul_pd(edge_y, _mm_sub_pd(_mm_loadu_pd(xcoords + i), a_x));
+        __m128d orientation = _mm_sub_pd(left, right);
+        __m128d error = _mm_mul_pd(bound, _mm_add_pd(_mm_andnot_pd(sign, left), _mm_andnot_pd(sign, right)));
+        __m128d certain = _mm_cmpgt_pd(_mm_andnot_pd(sign, orientation), error);
+        _mm_storeu_pd(orientations + i, _mm_and_pd(orientation, certain));
+    }
+    orientations_scalar(xcoords + i, ycoords + i, num_points - i, a, b, orientations + i);
+}
+
+
+CG_TARGET_SSE2
+static void summarize_sse2(const double* xcoords, const double* ycoords, size_t num_points, const CGCoord_t* shift,
+                           CGSummaryLanes_t* lanes){
+    init_summary_lanes(lanes);
+    const __m128d shift_x = _mm_set1_pd(shift->xcoord), shift_y = _mm_set1_pd(shift->ycoord);
+    const __m128d step = _mm_set1_pd((double) CG_SUMMARY_LANES);
+    // four registers of two lanes each cover the eight lanes
+    __m128d min_x[4], max_x[4], low_x[4], low_y[4], low_index[4], high_x[4], high_y[4], high_index[4];
+    __m128d sum_x[4], sum_y[4], sum_xx[4], sum_yy[4], sum_xy[4], index[4];
+    int r;
+    for(r = 0; r < 4; r++){
+        min_x[r] = low_x[r] = low_y[r] = _mm_set1_pd(HUGE_VAL);
+        max_x[r] = high_x[r] = high_y[r] = _mm_set1_pd(-HUGE_VAL);
+        low_index[r] = high_index[r] = _mm_set1_pd(-1.0);
+        sum_x[r] = sum_y[r] = sum_xx[r] = sum_yy[r] = sum_xy[r] = _mm_setzero_pd();
+        index[r] = _mm_setr_pd(2.0 * r, 2.0 * r + 1.0);
+    }
+    size_t i;
+    for(i = 0; i + CG_SUMMARY_LANES <= num_points; i += CG_SUMMARY_LANES){
+        for(r = 0; r < 4; r++){
+            __m128d xcoord = _mm_loadu_pd(xcoords + i + 2 * r);
+            __m128d ycoord = _mm_loadu_pd(ycoords + i + 2 * r);
+            min_x[r] = _mm_min_pd(xcoord, min_x[r]);
+            max_x[r] = _mm_max_pd(xcoord, max_x[r]);
+            __m128d lower = _mm_or_pd(_mm_cmplt_pd(ycoord, low_y[r]),
+                                      _mm_and_pd(_mm_cmpeq_pd(ycoord, low_y[r]), _mm_cmplt_pd(xcoord, low_x[r])));
+            low_x[r] = _mm_or_pd(_mm_and_pd(lower, xcoord), _mm_andnot_pd(lower, low_x[r]));
+            low_y[r] = _mm_or_pd(_mm_and_pd(lower, ycoord), _mm_andnot_pd(lower, low_y[r]));
+            low_index[r] = _mm_or_pd(_mm_and_pd(lower, index[r]), _mm_andnot_pd(lower, low_index[r]));
+            __m128d higher = _mm_or_pd(_mm_cmpgt_pd(ycoord, high_y[r]),
+                                       _mm_and_pd(_mm_cmpeq_pd(ycoord, high_y[r]), _mm_cmpgt_pd(xcoord, high_x[r])));
+            high_x[r] = _mm_or_pd(_mm_and_pd(higher, xcoord), _mm_andnot_pd(higher, high_x[r]));
+            high_y[r] = _mm_or_pd(_mm_and_pd(higher, ycoord), _mm_andnot_pd(higher, high_y[r]));
+            high_index[r] = _mm_or_pd(_mm_and_pd(higher, index[r]), _mm_andnot_pd(higher, high_index[r]));
+            __m128d delta_x = _mm_sub_pd(xcoord, shift_x), delta_y = _mm_sub_pd(ycoord, shift_y);
+            sum_x[r] = _mm_add_pd(sum_x[r], delta_x);
+            sum_y[r] = _mm_add_pd(sum_y[r], delta_y);
+            sum_xx[r] = _mm_add_pd(sum_xx[r], _mm_mul_pd(delta_x, delta_x));
+            sum_yy[r] = _mm_add_pd(sum_yy[r], _mm_mul_pd(delta_y, delta_y));
+            sum_xy[r] = _mm_add_pd(sum_xy[r], _mm_mul_pd(delta_x, delta_y));
+            index[r] = _mm_add_pd(index[r], step);
+        }
+    }
+    for(r = 0; r < 4; r++){
+        _mm_storeu_pd(lanes->min_x + 2 * r, min_x[r]);
+        _mm_storeu_pd(lanes->max_x + 2 * r, max_x[r]);
+        _mm_storeu_pd(lanes->low_x + 2 * r, low_x[r]);
+        _mm_storeu_pd(lanes->low_y + 2 * r, low_y[r]);
+        _mm_storeu_pd(lanes->low_index + 2 * r, low_index[r]);
+        _mm_storeu_pd(lanes->high_x + 2 * r, high_x[r]);
+        _mm_storeu_pd(lanes->high_y + 2 * r, high_y[r]);
+        _mm_storeu_pd(lanes->high_index + 2 * r, high_index[r]);
+        _mm_storeu_pd(lanes->sum_x + 2 * r, sum_x[r]);
+        _mm_storeu_pd(lanes->sum_y + 2 * r, sum_y[r]);
+        _mm_storeu_pd(lanes->sum_xx + 2 * r, sum_xx[r]);
+        _mm_storeu_pd(lanes->sum_yy + 2 * r, sum_yy[r]);
+        _mm_storeu_pd(lanes->sum_xy + 2 * r, sum_xy[r]);
+    }
+    summarize_range(xcoords, ycoords, i, num_points, shift, lanes);
+}
+
+
+//----------------------------------------------------------------
+// Kernels - AVX2
+//----------------------------------------------------------------
+
+
+CG_TARGET_AVX2
+static void find_structurals_avx2(const char* block, uint64_t* newlines, uint64_t* commas){
+    const __m256i newline_vec = _mm256_set1_epi8('\n');
+    const __m256i comma_vec = _mm256_set1_epi8(',');
+    __m256i lo = _mm256_loadu_si256((const __m256i*) block);
+    __m256i hi = _mm256_loadu_si256((const __m256i*) (block + 32));
+    *newlines = (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline_vec)) |
+                ((uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline_vec)) << 32);
+    *commas = (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, comma_vec)) |
+              ((uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, comma_vec)) << 32);
+}
+
+
+CG_TARGET_AVX2
+static void bounding_box_avx2(const double* xcoords, const double* ycoords, size_t num_points, CGBoundingBox_t* bounding_box){
+    __m256d min_x = _mm256_set1_pd(xcoords[0]), max_x = min_x;
+    __m256d min_y = _mm256_set1_pd(ycoords[0]), max_y = min_y;
+    size_t i;
+    for(i = 0; i + 4 <= num_points; i += 4){
+        __m256d xcoord = _mm256_loadu_pd(xcoords + i);
+        __m256d ycoord = _mm256_loadu_pd(ycoords + i);
+        min_x = _mm256_min_pd(xcoord, min_x);
+        max_x = _mm256_max_pd(xcoord, max_x);
+        min_y = _mm256_min_pd(ycoord, min_y);
+        max_y = _mm256_max_pd(ycoord, max_y);
+    }
+    double lanes[4][4];
+    _mm256_storeu_pd(lanes[0], min_x);
+    _mm256_storeu_pd(lanes[1], max_x);
+    _mm256_storeu_pd(lanes[2], min_y);
+    _mm256_storeu_pd(lanes[3], max_y);
+    bounding_box->min_x = lanes[0][0];
+    bounding_box->max_x = lanes[1][0];
+    bounding_box->min_y = lanes[2][0];
+    bounding_box->max_y = lanes[3][0];
+    int lane;
+    for(lane = 1; lane < 4; lane++){
+        double lane_x[2] = {lanes[0][lane], lanes[1][lane]};
+        double lane_y[2] = {lanes[2][lane], lanes[3][lane]};
+        extend_bounds_scalar(lane_x, lane_y, 2, bounding_box);
+    }
+    extend_bounds_scalar(xcoords + i, ycoords + i, num_points - i, bounding_box);
+}
+
+
+CG_TARGET_AVX2
+static void squared_distances_avx2(const CGCoord_t* coords, size_t num_coords, const CGCoord_t* origin, double* distances){
+    const __m256d origin_vec = _mm256_setr_pd(origin->xcoord, origin->ycoord, origin->xcoord, origin->ycoord);
+    size_t i;
+    for(i = 0; i + 4 <= num_coords; i += 4){
+        __m256d delta_A = _mm256_sub_pd(_mm256_loadu_pd(&coords[i].xcoord), origin_vec);
+        __m256d delta_B = _mm256_sub_pd(_mm256_loadu_pd(&coords[i + 2].xcoord), origin_vec);
+        // pairwise sums come out as points 0, 2, 1, 3
+        __m256d sums = _mm256_hadd_pd(_mm256_mul_pd(delta_A, delta_A), _mm256_mul_pd(delta_B, delta_B));
+        _mm256_storeu_pd(distances + i, _mm256_permute4x64_pd(sums, 0xD8));
+    }
+    squared_distances_scalar(coords + i, num_coords - i, origin, distances + i);
+}
+
+
+CG_TARGET_AVX2
+static void orientations_avx2(const double* xcoords, const double* ycoords, size_t num_points,
+                              const CGCoord_t* a, const CGCoord_t* b, double* orientations){
+    const __m256d edge_x = _mm256_set1_pd(b->xcoord - a->xcoord), edge_y = _mm256_set1_pd(b->ycoord - a->ycoord);
+    const __m256d a_x = _mm256_set1_pd(a->xcoord), a_y = _mm256_set1_pd(a->ycoord);
+    const __m256d sign = _mm256_set1_pd(-0.0), bound = _mm256_set1_pd(ORIENTATION_ERROR_BOUND);
+    size_t i;
+    for(i = 0; i + 4 <= num_points; i += 4){
+        __m256d left = _mm256_mul_pd(edge_x, _mm256_sub_pd(_mm256_loadu_pd(ycoords + i), a_y));
+        __m256d right = _mm256_mul_pd(edge_y, _mm256_sub_pd(_mm256_loadu_pd(xcoords + i), a_x));
+        __m256d orientation = _mm256_sub_pd(left, right);
+        __m256d error = _mm256_mul_pd(bound, _mm256_add_pd(_mm256_andnot_pd(sign, left), _mm256_andnot_pd(sign, right)));
+        __m256d certain = _mm256_cmp_pd(_mm256_andnot_pd(sign, orientation), error, _CMP_GT_OQ);
+        _mm256_storeu_pd(orientations + i, _mm256_and_pd(orientation, certain));
+    }
+    orientations_scalar(xcoords + i, ycoords + i, num_points - i, a, b, orientations + i);
+}
+
+
+CG_TARGET_AVX2
+static void summarize_avx2(const double* xcoords, const double* ycoords, size_t num_points, const CGCoord_t* shift,
+                           CGSummaryLanes_t* lanes){
+    init_summary_lanes(lanes);
+    const __m256d shift_x = _mm256_set1_pd(shift->xcoord), shift_y = _mm256_set1_pd(shift->ycoord);
+    const __m256d step = _mm256_set1_pd((double) CG_SUMMARY_LANES);
+    // two registers of four lanes each cover the eight lanes
+    __m256d min_x[2], max_x[2], low_x[2], low_y[2], low_index[2], high_x[2], high_y[2], high_index[2];
+    __m256d sum_x[2], sum_y[2], sum_xx[2], sum_yy[2], sum_xy[2], index[2];
+    int r;
+    for(r = 0; r < 2; r++){
+        min_x[r] = low_x[r] = low_y[r] = _mm256_set1_pd(HUGE_VAL);
+        max_x[r] = high_x[r] = high_y[r] = _mm256_set1_pd(-HUGE_VAL);
+        low_index[r] = high_index[r] = _mm256_set1_pd(-1.0);
+        sum_x[r] = sum_y[r] = sum_xx[r] = sum_yy[r] = sum_xy[r] = _mm256_setzero_pd();
+        index[r] = _mm256_setr_pd(4.0 * r, 4.0 * r + 1.0, 4.0 * r + 2.0, 4.0 * r + 3.0);
+    }
+    size_t i;
+    for(i = 0; i + CG_SUMMARY_LANES <= num_points; i += CG_SUMMARY_LANES){
+        for(r = 0; r < 2; r++){
+            __m256d xcoord = _mm256_loadu_pd(xcoords + i + 4 * r);
+            __m256d ycoord = _mm256_loadu_pd(ycoords + i + 4 * r);
+            min_x[r] = _mm256_min_pd(xcoord, min_x[r]);
+            max_x[r] = _mm256_max_pd(xcoord, max_x[r]);
+            __m256d lower = _mm256_or_pd(_mm256_cmp_pd(ycoord, low_y[r], _CMP_LT_OQ),
+                                         _mm256_and_pd(_mm256_cmp_pd(ycoord, low_y[r], _CMP_EQ_OQ),
+                                                       _mm256_cmp_pd(xcoord, low_x[r], _CMP_LT_OQ)));
+            low_x[r] = _mm256_blendv_pd(low_x[r], xcoord, lower);
+            low_y[r] = _mm256_blendv_pd(low_y[r], ycoord, lower);
+            low_index[r] = _mm256_blendv_pd(low_index[r], index[r], lower);
+            __m256d higher = _mm256_or_pd(_mm256_cmp_pd(ycoord, high_y[r], _CMP_GT_OQ),
+                                          _mm256_and_pd(_mm256_cmp_pd(ycoord, high_y[r], _CMP_EQ_OQ),
+                                                        _mm256_cmp_pd(xcoord, high_x[r], _CMP_GT_OQ)));
+            high_x[r] = _mm256_blendv_pd(high_x[r], xcoord, higher);
+            high_y[r] = _mm256_blendv_pd(high_y[r], ycoord, higher);
+            high_index[r] = _mm256_blendv_pd(high_index[r], index[r], higher);
+            __m256d delta_x = _mm256_sub_pd(xcoord, shift_x), delta_y = _mm256_sub_pd(ycoord, shift_y);
+            sum_x[r] = _mm256_add_pd(sum_x[r], delta_x);
+            sum_y[r] = _mm256_add_pd(sum_y[r], delta_y);
+            sum_xx[r] = _mm256_add_pd(sum_xx[r], _mm256_mul_pd(delta_x, delta_x));
+            sum_yy[r] = _mm256_add_pd(sum_yy[r], _mm256_mul_pd(delta_y, delta_y));
+            sum_xy[r] = _mm256_add_pd(sum_xy[r], _mm256_mul_pd(delta_x, delta_y));
+            index[r] = _mm256_add_pd(index[r], step);
+        }
+    }
+    for(r = 0; r < 2; r++){
+        _mm256_storeu_pd(lanes->min_x + 4 * r, min_x[r]);
+        _mm256_storeu_pd(lanes->max_x + 4 * r, max_x[r]);
+        _mm256_storeu_pd(lanes->low_x + 4 * r, low_x[r]);
+        _mm256_storeu_pd(lanes->low_y + 4 * r, low_y[r]);
+        _mm256_storeu_pd(lanes->low_index + 4 * r, low_index[r]);
+        _mm256_storeu_pd(lanes->high_x + 4 * r, high_x[r]);
+        _mm256_storeu_pd(lanes->high_y + 4 * r, high_y[r]);
+        _mm256_storeu_pd(lanes->high_index + 4 * r, high_index[r]);
+        _mm256_storeu_pd(lanes->sum_x + 4 * r, sum_x[r]);
+        _mm256_storeu_pd(lanes->sum_y + 4 * r, sum_y[r]);
+        _mm256_storeu_pd(lanes->sum_xx + 4 * r, sum_xx[r]);
+        _mm256_storeu_pd(lanes->sum_yy + 4 * r, sum_yy[r]);
+        _mm256_storeu_pd(lanes->sum_xy + 4 * r, sum_xy[r]);
+    }
+    summarize_range(xcoords, ycoords, i, num_points, shift, lanes);
+}
+
+
+//----------------------------------------------------------------
+// Kernels - AVX-512
+//----------------------------------------------------------------
+
+
+CG_TARGET_AVX512
+static void find_structurals_avx512(const char* block, uint64_t* newlines, uint64_t* commas){
+    __m512i chunk = _mm512_loadu_si512((const void*) block);
+    *newlines = (uint64_t) _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('\n'));
+    *commas = (uint64_t) _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8(','));
+}
+
+
+CG_TARGET_AVX512
+static void bounding_box_avx512(const double* xcoords, const double* ycoords, size_t num_points, CGBoundingBox_t* bounding_box){
+    __m512d min_x = _mm512_set1_pd(xcoords[0]), max_x = min_x;
+    __m512d min_y = _mm512_set1_pd(ycoords[0]), max_y = min_y;
+    size_t i;
+    for(i = 0; i + 8 <= num_points; i += 8){
+        __m512d xcoord = _mm512_loadu_pd(xcoords + i);
+        __m512d ycoord = _mm512_loadu_pd(ycoords + i);
+        min_x = _mm512_min_pd(xcoord, min_x);
+        max_x = _mm512_max_pd(xcoord, max_x);
+        min_y = _mm512_min_pd(ycoord, min_y);
+        max_y = _mm512_max_pd(ycoord, max_y);
+    }
+    double lanes[4][8];
+    _mm512_storeu_pd(lanes[0], min_x);
+    _mm512_storeu_pd(lanes[1], max_x);
+    _mm512_storeu_pd(lanes[2], min_y);
+    _mm512_storeu_pd(lanes[3], max_y);
+    bounding_box->min_x = lanes[0][0];
+    bounding_box->max_x = lanes[1][0];
+    bounding_box->min_y = lanes[2][0];
+    bounding_box->max_y = lanes[3][0];
+    int lane;
+    for(lane = 1; lane < 8; lane++){
+        double lane_x[2] = {lanes[0][lane], lanes[1][lane]};
+        double lane_y[2] = {lanes[2][lane], lanes[3][lane]};
+        extend_bounds_scalar(lane_x, lane_y, 2, bounding_box);
+    }
+    extend_bounds_scalar(xcoords + i, ycoords + i, num_points - i, bounding_box);
+}
+
+
+CG_TARGET_AVX512
+static void squared_distances_avx512(const CGCoord_t* coords, size_t num_coords, const CGCoord_t* origin, double* distances){
+    const __m512d origin_vec = _mm512_setr_pd(origin->xcoord, origin->ycoord, origin->xcoord, origin->ycoord,
+                                              origin->xcoord, origin->ycoord, origin->xcoord, origin->ycoord);
+    const __m512i even_lanes = _mm512_setr_epi64(0, 2, 4, 6, 8, 10, 12, 14);
+    size_t i;
+    for(i = 0; i + 8 <= num_coords; i += 8){
+        __m512d delta_A = _mm512_sub_pd(_mm512_loadu_pd(&coords[i].xcoord), origin_vec);
+        __m512d delta_B = _mm512_sub_pd(_mm512_loadu_pd(&coords[i + 4].xcoord), origin_vec);
+        __m512d square_A = _mm512_mul_pd(delta_A, delta_A);
+        __m512d square_B = _mm512_mul_pd(delta_B, delta_B);
+        // adding each lane to its neighbour leaves the sums in the even lanes
+        __m512d sums_A = _mm512_add_pd(square_A, _mm512_permute_pd(square_A, 0x55));
+        __m512d sums_B = _mm512_add_pd(square_B, _mm512_permute_pd(square_B, 0x55));
+        _mm512_storeu_pd(distances + i, _mm512_permutex2var_pd(sums_A, even_lanes, sums_B));
+    }
+    squared_distances_scalar(coords + i, num_coords - i, origin, distances + i);
+}
+
+
+CG_TARGET_AVX512
+static void orientations_avx512(const double* xcoords, const double* ycoords, size_t num_points,
+                                const CGCoord_t* a, const CGCoord_t* b, double* orientations){
+    const __m512d edge_x = _mm512_set1_pd(b->xcoord - a->xcoord), edge_y = _mm512_set1_pd(b->ycoord - a->ycoord);
+    const __m512d a_x = _mm512_set1_pd(a->xcoord), a_y = _mm512_set1_pd(a->ycoord);
+    const __m512d bound = _mm512_set1_pd(ORIENTATION_ERROR_BOUND);
+    size_t i;
+    for(i = 0; i + 8 <= num_points; i += 8){
+        __m512d left = _mm512_mul_pd(edge_x, _mm512_sub_pd(_mm512_loadu_pd(ycoords + i), a_y));
+        __m512d right = _mm512_mul_pd(edge_y, _mm512_sub_pd(_mm512_loadu_pd(xcoords + i), a_x));
+        __m512d orientation = _mm512_sub_pd(left, right);
+        __m512d error = _mm512_mul_pd(bound, _mm512_add_pd(_mm512_abs_pd(left), _mm512_abs_pd(right)));
+        __mmask8 certain = _mm512_cmp_pd_mask(_mm512_abs_pd(orientation), error, _CMP_GT_OQ);
+        _mm512_storeu_pd(orientations + i, _mm512_maskz_mov_pd(certain, orientation));
+    }
+    orientations_scalar(xcoords + i, ycoords + i, num_points - i, a, b, orientations + i);
+}
+
+
+CG_TARGET_AVX512
+static void summarize_avx512(const double* xcoords, const double* ycoords, size_t num_points, const CGCoord_t* shift,
+                             CGSummaryLanes_t* lanes){
+    init_summary_lanes(lanes);
+    const __m512d shift_x = _mm512_set1_pd(shift->xcoord), shift_y = _mm512_set1_pd(shift->ycoord);
+    const __m512d step = _mm512_set1_pd((double) CG_SUMMARY_LANES);
+    __m512d min_x = _mm512_set1_pd(HUGE_VAL), low_x = min_x, low_y = min_x;
+    __m512d max_x = _mm512_set1_pd(-HUGE_VAL), high_x = max_x, high_y = max_x;
+    __m512d low_index = _mm512_set1_pd(-1.0), high_index = low_index;
+    __m512d sum_x = _mm512_setzero_pd(), sum_y = sum_x, sum_xx = sum_x, sum_yy = sum_x, sum_xy = sum_x;
+    __m512d index = _mm512_setr_pd(0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0);
+    size_t i;
+    for(i = 0; i + CG_SUMMARY_LANES <= num_points; i += CG_SUMMARY_LANES){
+        __m512d xcoord = _mm512_loadu_pd(xcoords + i);
+        __m512d ycoord = _mm512_loadu_pd(ycoords + i);
+        min_x = _mm512_min_pd(xcoord, min_x);
+        max_x = _mm512_max_pd(xcoord, max_x);
+        __mmask8 lower = _mm512_cmp_pd_mask(ycoord, low_y, _CMP_LT_OQ) |
+                         (_mm512_cmp_pd_mask(ycoord, low_y, _CMP_EQ_OQ) & _mm512_cmp_pd_mask(xcoord, low_x, _CMP_LT_OQ));
+        low_x = _mm512_mask_mov_pd(low_x, lower, xcoord);
+        low_y = _mm512_mask_mov_pd(low_y, lower, ycoord);
+        low_index = _mm512_mask_mov_pd(low_index, lower, index);
+        __mmask8 higher = _mm512_cmp_pd_mask(ycoord, high_y, _CMP_GT_OQ) |
+                          (_mm512_cmp_pd_mask(ycoord, high_y, _CMP_EQ_OQ) & _mm512_cmp_pd_mask(xcoord, high_x, _CMP_GT_OQ));
+        high_x = _mm512_mask_mov_pd(high_x, higher, xcoord);
+        high_y = _mm512_mask_mov_pd(high_y, higher, ycoord);
+        high_index = _mm512_mask_mov_pd(high_index, higher, index);
+        __m512d delta_x = _mm512_sub_pd(xcoord, shift_x), delta_y = _mm512_sub_pd(ycoord, shift_y);
+        sum_x = _mm512_add_pd(sum_x, delta_x);
+        sum_y = _mm512_add_pd(sum_y, delta_y);
+        sum_xx = _mm512_add_pd(sum_xx, _mm512_mul_pd(delta_x, delta_x));
+        sum_yy = _mm512_add_pd(sum_yy, _mm512_mul_pd(delta_y, delta_y));
+        sum_xy = _mm512_add_pd(sum_xy, _mm512_mul_pd(delta_x, delta_y));
+        index = _mm512_add_pd(index, step);
+    }
+    _mm512_storeu_pd(lanes->min_x, min_x);
+    _mm512_storeu_pd(lanes->max_x, max_x);
+    _mm512_storeu_pd(lanes->low_x, low_x);
+    _mm512_storeu_pd(lanes->low_y, low_y);
+    _mm512_storeu_pd(lanes->low_index, low_index);
+    _mm512_storeu_pd(lanes->high_x, high_x);
+    _mm512_storeu_pd(lanes->high_y, high_y);
+    _mm512_storeu_pd(lanes->high_index, high_index);
+    _mm512_storeu_pd(lanes->sum_x, sum_x);
+    _mm512_storeu_pd(lanes->sum_y, sum_y);
+    _mm512_storeu_pd(lanes->sum_xx, sum_xx);
+    _mm512_storeu_pd(lanes->sum_yy, sum_yy);
+    _mm512_storeu_pd(lanes->sum_xy, sum_xy);
+    summarize_range(xcoords, ycoords, i, num_points, shift, lanes);
+}
+
+#endif
+
+
+//----------------------------------------------------------------
+// Functions - Dispatch
+//----------------------------------------------------------------
+
+
+/** @internal Kernel tables, indexed by CGSimdLevel_t */
+static const CGKernels_t kernel_tables[] = {
+    {find_structurals_scalar, bounding_box_scalar, squared_distances_scalar, orientations_scalar, summarize_scalar},
+#ifdef CG_X86
+    {find_structurals_sse2, bounding_box_sse2, squared_distances_sse2, orientations_sse2, summarize_sse2},
+    {find_structurals_avx2, bounding_box_avx2, squared_distances_avx2, orientations_avx2, summarize_avx2},
+    {find_structurals_avx512, bounding_box_avx512, squared_distances_avx512, orientations_avx512, summarize_avx512},
+#endif
+};
+
+#define NUM_KERNEL_TABLES (sizeof(kernel_tables) / sizeof(kernel_tables[0]))
+
+
+/** @internal Level in use, LEVEL_UNKNOWN until the processor has been checked */
+static volatile size_t active_level = LEVEL_UNKNOWN;
+
+
+/** @internal Finds the highest level the processor and operating system support */
+static CGSimdLevel_t detect_simd_level(void){
+#if defined(CG_X86) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        return CG_SIMD_AVX512;
+    else if(__builtin_cpu_supports("avx2"))
+        return CG_SIMD_AVX2;
+    else if(__builtin_cpu_supports("sse2"))
+        return CG_SIMD_SSE2;
+#elif defined(CG_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+    __cpuid(info, 1);
+    int has_sse2 = (info[3] >> 26) & 1;
+    int has_xsave = (info[2] >> 27) & 1;
+    unsigned long long enabled_state = has_xsave ? _xgetbv(0) : 0;
+    int has_avx2 = 0, has_avx512 = 0;
+    if(max_leaf >= 7){
+        __cpuidex(info, 7, 0);
+        // the operating system has to save the upper vector registers as well
+        has_avx2 = ((info[1] >> 5) & 1) && (enabled_state & 0x6) == 0x6;
+        has_avx512 = ((info[1] >> 16) & 1) && ((info[1] >> 30) & 1) && (enabled_state & 0xE6) == 0xE6;
+    }
+    if(has_avx512)
+        return CG_SIMD_AVX512;
+    else if(has_avx2)
+        return CG_SIMD_AVX2;
+    else if(has_sse2)
+        return CG_SIMD_SSE2;
+#endif
+    return CG_SIMD_SCALAR;
+}
+
+
+/**
+ * Function that returns the kernels of the active level, checking the processor on first use.
+ * @internal
+ * @return Kernel table, valid for the lifetime of the library.
+ */
+const CGKernels_t* cg_kernels(void){
+    size_t level = cg_atomic_load(&active_level);
+    if(level == LEVEL_UNKNOWN){
+        level = (size_t) detect_simd_level();
+        cg_atomic_store(&active_level, level);
+    }
+    return &kernel_tables[level];
+}
+
+
+#if defined(__GNUC__)
+/** @internal Picks the level when the library is loaded, so the first call does not pay for it */
+__attribute__((constructor)) static void init_simd_level(void){
+    cg_kernels();
+}
+#endif
+
+
+/**
+ * Function that returns the instruction set the numeric kernels currently use.
+ * @ingroup simd
+ * @return Active level, the highest supported one unless set_simd_level picked another.
+ */
+CGSimdLevel_t get_simd_level(void){
+    cg_kernels();
+    return (CGSimdLevel_t) cg_atomic_load(&active_level);
+}
+
+
+/**
+ * Function that returns the highest instruction set the build and the processor both support.
+ * @ingroup simd
+ * @return Highest supported level.
+ */
+CGSimdLevel_t get_supported_simd_level(void){
+    return detect_simd_level();
+}
+
+
+/**
+ * Function that selects the instruction set of the numeric kernels for the whole process.
+ * Calls already running finish with the kernels they started with.
+ * @ingroup simd
+ * @param level Level to use, at most get_supported_simd_level()
+ * @return INVALID_INPUT if the level is not supported, otherwise SUCCESS.
+ */
+CGError_t set_simd_level(CGSimdLevel_t level){
+    if((int) level < (int) CG_SIMD_SCALAR || (int) level > (int) get_supported_simd_level())
+        return CG_INVALID_INPUT;
+    cg_atomic_store(&active_level, (size_t) level);
+    return CG_SUCCESS;
+}
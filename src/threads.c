@@ -0,0 +1,305 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing the thin platform wrappers around native threads used by the
+ * parallel code paths.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#endif
+
+
+/**
+ * Function that finds the number of processors available to the process.
+ * @internal
+ * @return Number of online processors, at least 1
+ */
+int cg_num_cpus(void){
+#ifdef _WIN32
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    return system_info.dwNumberOfProcessors > 0 ? (int) system_info.dwNumberOfProcessors : 1;
+#else
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return num_cpus > 0 ? (int) num_cpus : 1;
+#endif
+}
+
+
+#ifdef _WIN32
+/** @internal Adapts the pthread style entry point to the Windows thread signature */
+static DWORD WINAPI thread_trampoline(LPVOID argument){
+    CGThread_t* thread = (CGThread_t*) argument;
+    thread->function(thread->argument);
+    return 0;
+}
+#endif
+
+
+/**
+ * Function that starts a new thread running function(argument).
+ * @internal
+ * @param thread Thread struct to fill. Must stay valid until cg_thread_join returns.
+ * @param function Entry point of the thread
+ * @param argument Argument passed to the entry point
+ * @return NO_MEMORY if the thread could not be created, otherwise SUCCESS.
+ */
+CGError_t cg_thread_create(CGThread_t* thread, void* (*function)(void*), void* argument){
+    if(thread == NULL || function == NULL)
+        return CG_INVALID_INPUT;
+    thread->function = function;
+    thread->argument = argument;
+#ifdef _WIN32
+    thread->handle = CreateThread(NULL, 0, thread_trampoline, thread, 0, NULL);
+    if(thread->handle == NULL)
+        return CG_NO_MEMORY;
+#else
+    pthread_t* handle = (pthread_t*) cg_malloc(sizeof(pthread_t));
+    if(handle == NULL)
+        return CG_NO_MEMORY;
+    if(pthread_create(handle, NULL, function, argument) != 0){
+        cg_free(handle);
+        return CG_NO_MEMORY;
+    }
+    thread->handle = handle;
+#endif
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that waits for a thread started by cg_thread_create to finish.
+ * @internal
+ * @param thread Thread to join
+ */
+void cg_thread_join(CGThread_t* thread){
+    if(thread == NULL || thread->handle == NULL)
+        return;
+#ifdef _WIN32
+    WaitForSingleObject((HANDLE) thread->handle, INFINITE);
+    CloseHandle((HANDLE) thread->handle);
+#else
+    pthread_join(*((pthread_t*) thread->handle), NULL);
+    cg_free(thread->handle);
+#endif
+    thread->handle = NULL;
+}
+
+
+/**
+ * Function that creates a mutex.
+ * @internal
+ * @param mutex Mutex struct to initialize
+ * @return NO_MEMORY if the mutex could not be created, otherwise SUCCESS.
+ */
+CGError_t cg_mutex_init(CGMutex_t* mutex){
+    if(mutex == NULL)
+        return CG_INVALID_INPUT;
+#ifdef _WIN32
+    CRITICAL_SECTION* handle = (CRITICAL_SECTION*) cg_malloc(sizeof(CRITICAL_SECTION));
+    if(handle == NULL)
+        return CG_NO_MEMORY;
+    InitializeCriticalSection(handle);
+#else
+    pthread_mutex_t* handle = (pthread_mutex_t*) cg_malloc(sizeof(pthread_mutex_t));
+    if(handle == NULL)
+        return CG_NO_MEMORY;
+    if(pthread_mutex_init(handle, NULL) != 0){
+        cg_free(handle);
+        return CG_NO_MEMORY;
+    }
+#endif
+    mutex->handle = handle;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that destroys a mutex created by cg_mutex_init.
+ * @internal
+ * @param mutex Unlocked mutex to destroy
+ */
+void cg_mutex_destroy(CGMutex_t* mutex){
+    if(mutex == NULL || mutex->handle == NULL)
+        return;
+#ifdef _WIN32
+    DeleteCriticalSection((CRITICAL_SECTION*) mutex->handle);
+#else
+    pthread_mutex_destroy((pthread_mutex_t*) mutex->handle);
+#endif
+    cg_free(mutex->handle);
+    mutex->handle = NULL;
+}
+
+
+/** @internal Locks a mutex, blocking until it is available */
+void cg_mutex_lock(CGMutex_t* mutex){
+#ifdef _WIN32
+    EnterCriticalSection((CRITICAL_SECTION*) mutex->handle);
+#else
+    pthread_mutex_lock((pthread_mutex_t*) mutex->handle);
+#endif
+}
+
+
+/** @internal Unlocks a mutex held by the calling thread */
+void cg_mutex_unlock(CGMutex_t* mutex){
+#ifdef _WIN32
+    LeaveCriticalSection((CRITICAL_SECTION*) mutex->handle);
+#else
+    pthread_mutex_unlock((pthread_mutex_t*) mutex->handle);
+#endif
+}
+
+
+/**
+ * Function that creates a condition variable.
+ * @internal
+ * @param condition Condition struct to initialize
+ * @return NO_MEMORY if the condition variable could not be created, otherwise SUCCESS.
+ */
+CGError_t cg_condition_init(CGCondition_t* condition){
+    if(condition == NULL)
+        return CG_INVALID_INPUT;
+#ifdef _WIN32
+    CONDITION_VARIABLE* handle = (CONDITION_VARIABLE*) cg_malloc(sizeof(CONDITION_VARIABLE));
+    if(handle == NULL)
+        return CG_NO_MEMORY;
+    InitializeConditionVariable(handle);
+#else
+    pthread_cond_t* handle = (pthread_cond_t*) cg_malloc(sizeof(pthread_cond_t));
+    if(handle == NULL)
+        return CG_NO_MEMORY;
+    if(pthread_cond_init(handle, NULL) != 0){
+        cg_free(handle);
+        return CG_NO_MEMORY;
+    }
+#endif
+    condition->handle = handle;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that destroys a condition variable created by cg_condition_init.
+ * @internal
+ * @param condition Condition variable no thread is waiting on
+ */
+void cg_condition_destroy(CGCondition_t* condition){
+    if(condition == NULL || condition->handle == NULL)
+        return;
+#ifndef _WIN32
+    pthread_cond_destroy((pthread_cond_t*) condition->handle);
+#endif
+    cg_free(condition->handle);
+    condition->handle = NULL;
+}
+
+
+/** @internal Atomically unlocks mutex and waits until the condition is signalled, then relocks mutex */
+void cg_condition_wait(CGCondition_t* condition, CGMutex_t* mutex){
+#ifdef _WIN32
+    SleepConditionVariableCS((CONDITION_VARIABLE*) condition->handle, (CRITICAL_SECTION*) mutex->handle, INFINITE);
+#else
+    pthread_cond_wait((pthread_cond_t*) condition->handle, (pthread_mutex_t*) mutex->handle);
+#endif
+}
+
+
+/**
+ * Function that waits on a condition like cg_condition_wait, giving up after a timeout.
+ * @internal
+ * @param condition Condition to wait on
+ * @param mutex Mutex held by the caller, unlocked while waiting
+ * @param timeout_seconds Longest time to wait
+ * @return Non-zero if the wait timed out, 0 if it was woken (possibly spuriously).
+ */
+int cg_condition_timed_wait(CGCondition_t* condition, CGMutex_t* mutex, double timeout_seconds){
+    if(timeout_seconds < 0)
+        timeout_seconds = 0;
+#ifdef _WIN32
+    DWORD milliseconds = (DWORD) (timeout_seconds * 1000.0);
+    if(!SleepConditionVariableCS((CONDITION_VARIABLE*) condition->handle, (CRITICAL_SECTION*) mutex->handle, milliseconds))
+        return GetLastError() == ERROR_TIMEOUT;
+    return 0;
+#else
+    // pthread deadlines are absolute times on the realtime clock
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    time_t whole_seconds = (time_t) timeout_seconds;
+    long nanoseconds = deadline.tv_nsec + (long) ((timeout_seconds - (double) whole_seconds) * 1e9);
+    deadline.tv_sec += whole_seconds + nanoseconds / 1000000000L;
+    deadline.tv_nsec = nanoseconds % 1000000000L;
+    return pthread_cond_timedwait((pthread_cond_t*) condition->handle, (pthread_mutex_t*) mutex->handle, &deadline) == ETIMEDOUT;
+#endif
+}
+
+
+/**
+ * Function that reads a monotonic clock, for measuring intervals.
+ * @internal
+ * @return Seconds since an unspecified starting point.
+ */
+double cg_time_seconds(void){
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+#endif
+}
+
+
+/** @internal Wakes one thread waiting on the condition */
+void cg_condition_signal(CGCondition_t* condition){
+#ifdef _WIN32
+    WakeConditionVariable((CONDITION_VARIABLE*) condition->handle);
+#else
+    pthread_cond_signal((pthread_cond_t*) condition->handle);
+#endif
+}
+
+
+/** @internal Wakes all threads waiting on the condition */
+void cg_condition_broadcast(CGCondition_t* condition){
+#ifdef _WIN32
+    WakeAllConditionVariable((CONDITION_VARIABLE*) condition->handle);
+#else
+    pthread_cond_broadcast((pthread_cond_t*) condition->handle);
+#endif
+}
@@ -0,0 +1,432 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Source file containing the Well-Known Binary readers and writers. Geometries are decoded
+ * directly from the byte buffer into point containers in a single pass, without any text
+ * conversion. Both byte orders are supported, as is the SRID prefix of PostGIS extended WKB.
+ */
+
+
+#include "libCGeo/libCGeo_internal.h"
+
+// Flags set on the type code by PostGIS extended WKB
+#define EWKB_Z_FLAG         0x80000000u
+#define EWKB_M_FLAG         0x40000000u
+#define EWKB_SRID_FLAG      0x20000000u
+
+// Sizes of the encoded parts
+#define WKB_HEADER_SIZE     5
+#define WKB_POINT_SIZE      21
+#define WKB_COORD_SIZE      16
+
+#ifdef CG_LITTLE_ENDIAN
+#define WKB_NATIVE_ORDER    CG_WKB_LITTLE_ENDIAN
+#else
+#define WKB_NATIVE_ORDER    CG_WKB_BIG_ENDIAN
+#endif
+
+
+/**
+ * Struct holding the position of the WKB reader in the input buffer.
+ * @internal
+ */
+typedef struct CG_WkbReader {
+    const unsigned char* position;  /**< Next byte to read */
+    const unsigned char* end;       /**< End of the input buffer */
+    int swap;                       /**< Set if the current geometry is not in native byte order */
+} CGWkbReader_t;
+
+
+//----------------------------------------------------------------
+// Functions - Reading WKB
+//----------------------------------------------------------------
+
+
+/** @internal Number of bytes left to read */
+static inline size_t remaining_bytes(CGWkbReader_t* reader){
+    return (size_t) (reader->end - reader->position);
+}
+
+
+/** @internal Reads a 32 bit integer, the caller checks that 4 bytes are available */
+static inline uint32_t read_uint32(CGWkbReader_t* reader){
+    uint32_t value;
+    memcpy(&value, reader->position, sizeof(value));
+    reader->position += sizeof(value);
+    return reader->swap ? cg_byteswap32(value) : value;
+}
+
+
+/** @internal Reads a double, the caller checks that 8 bytes are available */
+static inline double read_double(CGWkbReader_t* reader){
+    uint64_t bits;
+    memcpy(&bits, reader->position, sizeof(bits));
+    reader->position += sizeof(bits);
+    if(reader->swap)
+        bits = cg_byteswap64(bits);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+/**
+ * Helper that reads the byte order and type code that start every geometry.
+ * @internal
+ * @return INVALID_FILE if the buffer is too short or malformed, INVALID_TYPE for geometry types or
+ *      dimensions that are not supported, otherwise SUCCESS.
+ */
+static CGError_t read_geometry_header(CGWkbReader_t* reader, CGWkbType_t* type){
+    if(remaining_bytes(reader) < WKB_HEADER_SIZE)
+        return CG_INVALID_FILE;
+    unsigned char byte_order = *reader->position++;
+    if(byte_order != CG_WKB_BIG_ENDIAN && byte_order != CG_WKB_LITTLE_ENDIAN)
+        return CG_INVALID_FILE;
+    reader->swap = byte_order != WKB_NATIVE_ORDER;
+    uint32_t type_code = read_uint32(reader);
+    if(type_code & EWKB_SRID_FLAG){
+        if(remaining_bytes(reader) < 4)
+            return CG_INVALID_FILE;
+        reader->position += 4;
+        type_code &= ~EWKB_SRID_FLAG;
+    }
+    // only two dimensional geometries, both EWKB flags and ISO type offsets mark Z and M
+    if((type_code & (EWKB_Z_FLAG | EWKB_M_FLAG)) || type_code < CG_WKB_POINT || type_code > CG_WKB_MULTIPOINT)
+        return CG_INVALID_TYPE;
+    *type = (CGWkbType_t) type_code;
+    return CG_SUCCESS;
+}
+
+
+/** @internal Reads an element count, which must fit in the rest of the buffer at min_size bytes per element */
+static CGError_t read_count(CGWkbReader_t* reader, size_t min_size, size_t* count){
+    if(remaining_bytes(reader) < 4)
+        return CG_INVALID_FILE;
+    *count = read_uint32(reader);
+    if(*count > remaining_bytes(reader) / min_size)
+        return CG_INVALID_FILE;
+    return CG_SUCCESS;
+}
+
+
+/** @internal Appends count coordinate pairs, already checked to be in the buffer */
+static CGError_t read_coords(CGWkbReader_t* reader, size_t count, CGPointArray_t* point_array){
+    CGError_t status = reserve_point_array(point_array, point_array->num_points + count);
+    if(status != CG_SUCCESS)
+        return status;
+    double* xcoords = point_array->xcoords + point_array->num_points;
+    double* ycoords = point_array->ycoords + point_array->num_points;
+    size_t i;
+    if(!reader->swap){
+        const unsigned char* position = reader->position;
+        for(i = 0; i < count; i++, position += WKB_COORD_SIZE){
+            memcpy(&xcoords[i], position, sizeof(double));
+            memcpy(&ycoords[i], position + sizeof(double), sizeof(double));
+        }
+        reader->position = position;
+    }
+    else{
+        for(i = 0; i < count; i++){
+            xcoords[i] = read_double(reader);
+            ycoords[i] = read_double(reader);
+        }
+    }
+    point_array->num_points += count;
+    return CG_SUCCESS;
+}
+
+
+/** @internal Reads the rings of a polygon, dropping the closing point of each */
+static CGError_t read_polygon(CGWkbReader_t* reader, CGPointArray_t* point_array, CGWkbInfo_t* info){
+    size_t num_rings;
+    CGError_t status = read_count(reader, 4, &num_rings);
+    if(status != CG_SUCCESS || num_rings == 0)
+        return status;
+    info->ring_sizes = (size_t*) cg_malloc(num_rings * sizeof(size_t));
+    if(info->ring_sizes == NULL)
+        return CG_NO_MEMORY;
+    size_t ring;
+    for(ring = 0; ring < num_rings; ring++){
+        size_t num_points;
+        status = read_count(reader, WKB_COORD_SIZE, &num_points);
+        if(status != CG_SUCCESS)
+            return status;
+        size_t ring_start = point_array->num_points;
+        status = read_coords(reader, num_points, point_array);
+        if(status != CG_SUCCESS)
+            return status;
+        size_t ring_end = point_array->num_points - 1;
+        if(num_points > 1 && point_array->xcoords[ring_start] == point_array->xcoords[ring_end] &&
+           point_array->ycoords[ring_start] == point_array->ycoords[ring_end])
+            point_array->num_points--;
+        info->ring_sizes[ring] = point_array->num_points - ring_start;
+        info->num_rings++;
+    }
+    return CG_SUCCESS;
+}
+
+
+/** @internal Reads the points of a multipoint, each of which carries its own header */
+static CGError_t read_multipoint(CGWkbReader_t* reader, CGPointArray_t* point_array){
+    size_t num_points;
+    CGError_t status = read_count(reader, WKB_POINT_SIZE, &num_points);
+    if(status == CG_SUCCESS)
+        status = reserve_point_array(point_array, point_array->num_points + num_points);
+    size_t i;
+    for(i = 0; status == CG_SUCCESS && i < num_points; i++){
+        CGWkbType_t type;
+        status = read_geometry_header(reader, &type);
+        if(status != CG_SUCCESS)
+            break;
+        if(type != CG_WKB_POINT || remaining_bytes(reader) < WKB_COORD_SIZE)
+            return CG_INVALID_FILE;
+        double xcoord = read_double(reader);
+        double ycoord = read_double(reader);
+        point_array->xcoords[point_array->num_points] = xcoord;
+        point_array->ycoords[point_array->num_points] = ycoord;
+        point_array->num_points++;
+    }
+    return status;
+}
+
+
+/**
+ * Function that decodes a Well-Known Binary geometry, appending its points to a point array.
+ * Points, line strings, polygons and multipoints in two dimensions are supported, in either byte
+ * order and with or without a PostGIS SRID. An empty point adds nothing.
+ * @ingroup file
+ * @param data Buffer holding the encoded geometry
+ * @param size Size of the buffer, which may extend past the end of the geometry
+ * @param point_array Initialized point array
+ * @param info If not NULL, receives the type, encoded size and polygon rings of the geometry
+ * @return INVALID_FILE if the encoding is malformed or truncated, INVALID_TYPE for unsupported
+ *      geometries, NO_MEMORY if allocation fails, otherwise SUCCESS. Nothing is appended on failure.
+ */
+CGError_t point_array_from_wkb(const unsigned char* data, size_t size, CGPointArray_t* point_array, CGWkbInfo_t* info){
+    if(data == NULL || point_array == NULL)
+        return CG_INVALID_INPUT;
+    CGWkbInfo_t geometry = {CG_WKB_POINT, 0, 0, NULL};
+    CGWkbReader_t reader = {data, data + size, 0};
+    size_t initial_points = point_array->num_points;
+
+    CGError_t status = read_geometry_header(&reader, &geometry.type);
+    if(status == CG_SUCCESS){
+        size_t num_points;
+        switch(geometry.type){
+            case CG_WKB_POINT:
+                if(remaining_bytes(&reader) < WKB_COORD_SIZE){
+                    status = CG_INVALID_FILE;
+                    break;
+                }
+                status = read_coords(&reader, 1, point_array);
+                if(status == CG_SUCCESS && isnan(point_array->xcoords[initial_points]) && isnan(point_array->ycoords[initial_points]))
+                    point_array->num_points = initial_points;
+                break;
+            case CG_WKB_LINESTRING:
+                status = read_count(&reader, WKB_COORD_SIZE, &num_points);
+                if(status == CG_SUCCESS)
+                    status = read_coords(&reader, num_points, point_array);
+                break;
+            case CG_WKB_POLYGON:
+                status = read_polygon(&reader, point_array, &geometry);
+                break;
+            case CG_WKB_MULTIPOINT:
+                status = read_multipoint(&reader, point_array);
+                break;
+        }
+    }
+
+    if(status != CG_SUCCESS){
+        point_array->num_points = initial_points;
+        cg_free(geometry.ring_sizes);
+        return status;
+    }
+    geometry.num_bytes = (size_t) (reader.position - data);
+    if(info != NULL)
+        *info = geometry;
+    else
+        cg_free(geometry.ring_sizes);
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that decodes a Well-Known Binary geometry, appending its points to a point set.
+ * @ingroup file
+ * @param data Buffer holding the encoded geometry
+ * @param size Size of the buffer
+ * @param point_set Initialized point set
+ * @param info If not NULL, receives the type, encoded size and polygon rings of the geometry
+ * @return Status of point_array_from_wkb or of adding the points.
+ */
+CGError_t point_set_from_wkb(const unsigned char* data, size_t size, CGPointSet_t* point_set, CGWkbInfo_t* info){
+    if(data == NULL || point_set == NULL)
+        return CG_INVALID_INPUT;
+    CGPointArray_t* point_array = init_point_array(0);
+    if(point_array == NULL)
+        return CG_NO_MEMORY;
+    CGError_t status = point_array_from_wkb(data, size, point_array, info);
+    if(status == CG_SUCCESS)
+        status = point_set_from_point_array(point_array, point_set);
+    free_point_array(point_array);
+    return status;
+}
+
+
+//----------------------------------------------------------------
+// Functions - Writing WKB
+//----------------------------------------------------------------
+
+
+/** @internal Writes a 32 bit integer in the requested byte order */
+static inline unsigned char* write_uint32(unsigned char* out, uint32_t value, int swap){
+    if(swap)
+        value = cg_byteswap32(value);
+    memcpy(out, &value, sizeof(value));
+    return out + sizeof(value);
+}
+
+
+/** @internal Writes a coordinate pair in the requested byte order */
+static inline unsigned char* write_coords(unsigned char* out, double xcoord, double ycoord, int swap){
+    uint64_t bits[2];
+    memcpy(&bits[0], &xcoord, sizeof(double));
+    memcpy(&bits[1], &ycoord, sizeof(double));
+    if(swap){
+        bits[0] = cg_byteswap64(bits[0]);
+        bits[1] = cg_byteswap64(bits[1]);
+    }
+    memcpy(out, bits, sizeof(bits));
+    return out + sizeof(bits);
+}
+
+
+/** @internal Writes the byte order and type code of a geometry */
+static inline unsigned char* write_geometry_header(unsigned char* out, CGWkbType_t type, CGWkbByteOrder_t byte_order){
+    *out++ = (unsigned char) byte_order;
+    return write_uint32(out, (uint32_t) type, byte_order != WKB_NATIVE_ORDER);
+}
+
+
+/**
+ * Function that encodes a point array as a Well-Known Binary geometry. A point array with no
+ * points is written as an empty geometry. Polygons get a single ring, which is closed by repeating
+ * the first point if needed.
+ * @ingroup file
+ * @param point_array Point array to encode, holding at most one point for CG_WKB_POINT
+ * @param type Geometry type to write
+ * @param byte_order Byte order of the encoding
+ * @param data Receives a buffer holding the encoding, to be released with free_buffer
+ * @param size Receives the size of the encoding
+ * @return INVALID_INPUT if the points do not fit the type, NO_MEMORY if allocation fails, otherwise SUCCESS.
+ */
+CGError_t wkb_from_point_array(const CGPointArray_t* point_array, CGWkbType_t type, CGWkbByteOrder_t byte_order,
+                               unsigned char** data, size_t* size){
+    if(point_array == NULL || data == NULL || size == NULL)
+        return CG_INVALID_INPUT;
+    if(byte_order != CG_WKB_BIG_ENDIAN && byte_order != CG_WKB_LITTLE_ENDIAN)
+        return CG_INVALID_INPUT;
+    size_t num_points = point_array->num_points;
+    if(num_points > UINT32_MAX || (type == CG_WKB_POINT && num_points > 1))
+        return CG_INVALID_INPUT;
+
+    int closed = 1;
+    if(type == CG_WKB_POLYGON && num_points > 0)
+        closed = point_array->xcoords[0] == point_array->xcoords[num_points - 1] &&
+                 point_array->ycoords[0] == point_array->ycoords[num_points - 1];
+    size_t encoded_size;
+    switch(type){
+        case CG_WKB_POINT:      encoded_size = WKB_POINT_SIZE; break;
+        case CG_WKB_LINESTRING: encoded_size = WKB_HEADER_SIZE + 4 + num_points * WKB_COORD_SIZE; break;
+        case CG_WKB_POLYGON:    encoded_size = WKB_HEADER_SIZE + 4 + (num_points ? 4 + (num_points + !closed) * WKB_COORD_SIZE : 0); break;
+        case CG_WKB_MULTIPOINT: encoded_size = WKB_HEADER_SIZE + 4 + num_points * WKB_POINT_SIZE; break;
+        default:                return CG_INVALID_TYPE;
+    }
+    unsigned char* buffer = (unsigned char*) cg_malloc(encoded_size);
+    if(buffer == NULL)
+        return CG_NO_MEMORY;
+
+    int swap = byte_order != WKB_NATIVE_ORDER;
+    unsigned char* out = write_geometry_header(buffer, type, byte_order);
+    size_t i;
+    switch(type){
+        case CG_WKB_POINT:
+            if(num_points == 1)
+                out = write_coords(out, point_array->xcoords[0], point_array->ycoords[0], swap);
+            else
+                out = write_coords(out, NAN, NAN, swap);
+            break;
+        case CG_WKB_POLYGON:
+            out = write_uint32(out, num_points ? 1 : 0, swap);
+            if(num_points == 0)
+                break;
+            out = write_uint32(out, (uint32_t) (num_points + !closed), swap);
+            for(i = 0; i < num_points; i++)
+                out = write_coords(out, point_array->xcoords[i], point_array->ycoords[i], swap);
+            if(!closed)
+                out = write_coords(out, point_array->xcoords[0], point_array->ycoords[0], swap);
+            break;
+        case CG_WKB_LINESTRING:
+            out = write_uint32(out, (uint32_t) num_points, swap);
+            for(i = 0; i < num_points; i++)
+                out = write_coords(out, point_array->xcoords[i], point_array->ycoords[i], swap);
+            break;
+        case CG_WKB_MULTIPOINT:
+            out = write_uint32(out, (uint32_t) num_points, swap);
+            for(i = 0; i < num_points; i++){
+                out = write_geometry_header(out, CG_WKB_POINT, byte_order);
+                out = write_coords(out, point_array->xcoords[i], point_array->ycoords[i], swap);
+            }
+            break;
+    }
+    *data = buffer;
+    *size = encoded_size;
+    return CG_SUCCESS;
+}
+
+
+/**
+ * Function that encodes a point set as a Well-Known Binary geometry.
+ * @ingroup file
+ * @param point_set Point set to encode
+ * @param type Geometry type to write
+ * @param byte_order Byte order of the encoding
+ * @param data Receives a buffer holding the encoding, to be released with free_buffer
+ * @param size Receives the size of the encoding
+ * @return Status of wkb_from_point_array, or NO_MEMORY if allocation fails.
+ */
+CGError_t wkb_from_point_set(const CGPointSet_t* point_set, CGWkbType_t type, CGWkbByteOrder_t byte_order,
+                             unsigned char** data, size_t* size){
+    if(point_set == NULL || data == NULL || size == NULL)
+        return CG_INVALID_INPUT;
+    CGPointArray_t* point_array = init_point_array(point_set->num_points);
+    if(point_array == NULL)
+        return CG_NO_MEMORY;
+    CGError_t status = point_array_from_point_set(point_set, point_array);
+    if(status == CG_SUCCESS)
+        status = wkb_from_point_array(point_array, type, byte_order, data, size);
+    free_point_array(point_array);
+    return status;
+}
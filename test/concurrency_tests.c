@@ -0,0 +1,474 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Unit tests checking that threads can share read-only inputs for libCGeo
+ */
+
+#include "libCGeo/libCGeo.h"
+#include <criterion/criterion.h>
+#include <criterion/assert.h>
+#include <pthread.h>
+#include <time.h>
+
+#define NUM_THREADS 4
+#define NUM_ROUNDS  20
+#define NUM_POINTS  2000
+
+
+CGPointSet_t* shared_set;
+CGPointArray_t* shared_array;
+
+
+/**
+ * Struct holding the results one thread computes from the shared inputs.
+ */
+typedef struct Results {
+    CGPointSet_t* graham_hull;
+    CGPointSet_t* monotone_hull;
+    CGPointSet_t* sorted;
+    CGPointArray_t* array_hull;
+    CGBoundingBox_t bounding_box;
+    CGPoint_t* lowest_point;
+    int failed;
+} Results_t;
+
+
+/* Setup function that fills the shared set and array with the same points, sorted by x */
+void setup_shared(void){
+    shared_set = init_point_set();
+    shared_array = init_point_array(NUM_POINTS);
+    unsigned int state = 12345;
+    int i;
+    for(i = 0; i < NUM_POINTS; i++){
+        state = state * 1103515245u + 12345u;
+        double xcoord = (double) ((state >> 8) % 10000) - 5000.0;
+        state = state * 1103515245u + 12345u;
+        double ycoord = (double) ((state >> 8) % 10000) - 5000.0;
+        add_coords_to_set(shared_set, xcoord, ycoord);
+        add_coords_to_array(shared_array, xcoord, ycoord);
+    }
+    CGPointNode_t* current_node = shared_set->head;
+    while(current_node != NULL){
+        current_node->point->sort_val = current_node->point->xcoord;
+        current_node->point->sort_val_desc = "x-coord";
+        current_node = current_node->next;
+    }
+}
+
+
+/* Function that performs memory cleanup after every test */
+void teardown_shared(void){
+    free_point_set(shared_set);
+    free_point_array(shared_array);
+}
+
+
+/* Runs every read-only operation on the shared inputs into fresh outputs */
+static void compute_results(Results_t* results){
+    results->graham_hull = init_point_set();
+    results->monotone_hull = init_point_set();
+    results->sorted = init_point_set();
+    results->array_hull = init_point_array(0);
+    results->failed |= compute_convex_hull(shared_set, results->graham_hull, CG_GRAHAM_SCAN, CG_W_DEGENERACY) != CG_SUCCESS;
+    results->failed |= compute_convex_hull(shared_set, results->monotone_hull, CG_MONOTONE_CHAIN, CG_W_DEGENERACY) != CG_SUCCESS;
+    results->failed |= sort_point_set_into(shared_set, results->sorted) != CG_SUCCESS;
+    results->failed |= compute_monotone_chain(shared_array, results->array_hull, CG_NO_DEGENERACY) != CG_SUCCESS;
+    results->failed |= compute_bounding_box(shared_array, &results->bounding_box) != CG_SUCCESS;
+    results->lowest_point = find_lowest_point_in_set(shared_set);
+}
+
+
+/* Frees the outputs of compute_results */
+static void free_results(Results_t* results){
+    free_point_set(results->graham_hull);
+    free_point_set(results->monotone_hull);
+    free_point_set(results->sorted);
+    free_point_array(results->array_hull);
+}
+
+
+/* Checks two sets of results for equality */
+static int compare_results(Results_t* results_A, Results_t* results_B){
+    if(results_A->failed || results_B->failed)
+        return -1;
+    if(compare_point_sets(results_A->graham_hull, results_B->graham_hull) != 0 ||
+       compare_point_sets(results_A->monotone_hull, results_B->monotone_hull) != 0 ||
+       compare_point_sets(results_A->sorted, results_B->sorted) != 0)
+        return -1;
+    if(results_A->array_hull->num_points != results_B->array_hull->num_points ||
+       memcmp(results_A->array_hull->xcoords, results_B->array_hull->xcoords, results_A->array_hull->num_points * sizeof(double)) != 0 ||
+       memcmp(&results_A->bounding_box, &results_B->bounding_box, sizeof(CGBoundingBox_t)) != 0 ||
+       results_A->lowest_point != results_B->lowest_point)
+        return -1;
+    return 0;
+}
+
+
+Results_t reference;
+
+
+/* Thread entry point that repeatedly recomputes the results and compares them to the reference */
+static void* worker(void* argument){
+    Results_t* mismatches = (Results_t*) argument;
+    int round;
+    for(round = 0; round < NUM_ROUNDS; round++){
+        Results_t results;
+        memset(&results, 0, sizeof(results));
+        compute_results(&results);
+        if(compare_results(&reference, &results) != 0)
+            mismatches->failed++;
+        free_results(&results);
+    }
+    return NULL;
+}
+
+
+/* Test that hulls, sorts and queries on one shared set agree across threads without locking */
+Test(asserts, shared_inputs_across_threads, .init = setup_shared, .fini = teardown_shared){
+    memset(&reference, 0, sizeof(reference));
+    compute_results(&reference);
+    cr_assert(reference.failed == 0, "Reference computation failed");
+    cr_assert(compare_point_sets(reference.graham_hull, reference.monotone_hull) == 0, "Hull methods disagree");
+
+    pthread_t threads[NUM_THREADS];
+    Results_t mismatches[NUM_THREADS];
+    int i;
+    memset(mismatches, 0, sizeof(mismatches));
+    for(i = 0; i < NUM_THREADS; i++)
+        pthread_create(&threads[i], NULL, worker, &mismatches[i]);
+    for(i = 0; i < NUM_THREADS; i++){
+        pthread_join(threads[i], NULL);
+        cr_assert(mismatches[i].failed == 0, "Thread saw results that differ from the reference");
+    }
+
+    // the shared points were only read
+    CGPointNode_t* current_node = shared_set->head;
+    while(current_node != NULL){
+        cr_assert(current_node->point->sort_val == current_node->point->xcoord, "Shared sort value was overwritten");
+        current_node = current_node->next;
+    }
+    cr_assert(sort_point_set_into(shared_set, NULL) == CG_INVALID_INPUT, "Missing output set accepted");
+    cr_assert(sort_point_set_into(shared_set, shared_set) == CG_INVALID_INPUT, "Sorting a set into itself accepted");
+    free_results(&reference);
+}
+
+
+/* Allocator counting the live allocations of a context, which are made from several threads */
+static volatile long num_context_live;
+
+static void* context_alloc(size_t size, void* user_data){
+    (void) user_data;
+    __sync_fetch_and_add(&num_context_live, 1);
+    return malloc(size);
+}
+
+static void* context_realloc(void* pointer, size_t size, void* user_data){
+    (void) user_data;
+    return realloc(pointer, size);
+}
+
+static void context_free(void* pointer, void* user_data){
+    (void) user_data;
+    __sync_fetch_and_sub(&num_context_live, 1);
+    free(pointer);
+}
+
+
+/* Arguments of a thread sharing one context with others */
+typedef struct ContextWorker {
+    CGContext_t* context;
+    CGPointArray_t* expected;
+    int failed;
+} ContextWorker_t;
+
+
+/* Thread entry point that repeatedly computes a hull through the shared context */
+static void* context_worker(void* argument){
+    ContextWorker_t* worker_args = (ContextWorker_t*) argument;
+    int round;
+    for(round = 0; round < NUM_ROUNDS; round++){
+        CGPointArray_t* hull = init_point_array(0);
+        if(compute_monotone_chain_ctx(worker_args->context, shared_array, hull, CG_W_DEGENERACY) != CG_SUCCESS ||
+           hull->num_points != worker_args->expected->num_points ||
+           memcmp(hull->xcoords, worker_args->expected->xcoords, hull->num_points * sizeof(double)) != 0)
+            worker_args->failed++;
+        free_point_array(hull);
+    }
+    return NULL;
+}
+
+
+/* Test that the parallel paths of a context match the serial functions, also when threads share the context */
+Test(asserts, context_paths_match_serial, .init = setup_shared, .fini = teardown_shared){
+    CGAllocator_t allocator = {context_alloc, context_realloc, context_free, NULL};
+    CGContextOptions_t options;
+    memset(&options, 0, sizeof(options));
+    options.num_threads = NUM_THREADS;
+    options.parallel_min_points = NUM_POINTS / 8;
+    options.parallel_min_bytes = 1024;
+    options.scratch_size = 4096;
+    options.allocator = &allocator;
+    CGContext_t* context = init_context(&options);
+    cr_assert(context != NULL && get_context_num_threads(context) == NUM_THREADS, "Context not created");
+
+    CGCompute_t compute_types[] = {CG_NO_DEGENERACY, CG_W_DEGENERACY};
+    CGPointArray_t* expected = init_point_array(0);
+    CGPointArray_t* hull = init_point_array(0);
+    int i;
+    for(i = 0; i < 2; i++){
+        expected->num_points = 0;
+        hull->num_points = 0;
+        compute_monotone_chain(shared_array, expected, compute_types[i]);
+        cr_assert(compute_monotone_chain_ctx(context, shared_array, hull, compute_types[i]) == CG_SUCCESS, "Context hull failed");
+        cr_assert(hull->num_points == expected->num_points &&
+                  memcmp(hull->xcoords, expected->xcoords, hull->num_points * sizeof(double)) == 0 &&
+                  memcmp(hull->ycoords, expected->ycoords, hull->num_points * sizeof(double)) == 0, "Context hull differs");
+    }
+
+    CGPointSet_t* expected_set = init_point_set();
+    CGPointSet_t* hull_set = init_point_set();
+    compute_convex_hull(shared_set, expected_set, CG_MONOTONE_CHAIN, CG_W_DEGENERACY);
+    cr_assert(compute_convex_hull_ctx(context, shared_set, hull_set, CG_MONOTONE_CHAIN, CG_W_DEGENERACY) == CG_SUCCESS, "Context set hull failed");
+    cr_assert(hull_set->num_points == expected_set->num_points, "Context set hull differs");
+    CGPointNode_t* expected_node = expected_set->head;
+    CGPointNode_t* hull_node = hull_set->head;
+    for(; hull_node != NULL; hull_node = hull_node->next, expected_node = expected_node->next)
+        cr_assert(hull_node->point->xcoord == expected_node->point->xcoord && hull_node->point->ycoord == expected_node->point->ycoord,
+                  "Context set hull differs");
+    free_point_set(hull_set);
+    free_point_set(expected_set);
+
+    CGBoundingBox_t box_A, box_B;
+    compute_bounding_box(shared_array, &box_A);
+    compute_bounding_box_ctx(context, shared_array, &box_B);
+    cr_assert(memcmp(&box_A, &box_B, sizeof(CGBoundingBox_t)) == 0, "Context bounding box differs");
+
+    CGPointStats_t stats_A, stats_B;
+    compute_point_stats(shared_array, &stats_A);
+    cr_assert(compute_point_stats_ctx(context, shared_array, &stats_B) == CG_SUCCESS, "Context stats failed");
+    cr_assert(stats_A.num_points == stats_B.num_points && stats_A.lowest_index == stats_B.lowest_index &&
+              stats_A.highest_index == stats_B.highest_index &&
+              memcmp(&stats_A.bounding_box, &stats_B.bounding_box, sizeof(CGBoundingBox_t)) == 0, "Context extremes differ");
+    double spread = stats_A.covariance[0][0] + stats_A.covariance[1][1];
+    cr_assert(fabs(stats_A.mean.xcoord - stats_B.mean.xcoord) <= 1e-9 * (fabs(stats_A.mean.xcoord) + spread) &&
+              fabs(stats_A.covariance[0][1] - stats_B.covariance[0][1]) <= 1e-9 * spread, "Context moments differ");
+
+    // invalid lines leave gaps between the chunks that have to be closed
+    const char* path = "libCGeo_concurrency_test.csv";
+    FILE* fp = fopen(path, "w");
+    size_t j;
+    for(j = 0; j < shared_array->num_points; j++){
+        if(j % 97 == 0)
+            fprintf(fp, "not,a point\n");
+        fprintf(fp, "%.17g,%.17g\n", shared_array->xcoords[j], shared_array->ycoords[j]);
+    }
+    fclose(fp);
+    CGPointArray_t* loaded = init_point_array(0);
+    cr_assert(point_array_from_csv_path_ctx(context, loaded, path) == CG_SUCCESS, "Context csv load failed");
+    remove(path);
+    cr_assert(loaded->num_points == shared_array->num_points &&
+              memcmp(loaded->xcoords, shared_array->xcoords, loaded->num_points * sizeof(double)) == 0 &&
+              memcmp(loaded->ycoords, shared_array->ycoords, loaded->num_points * sizeof(double)) == 0, "Context csv load differs");
+
+    pthread_t threads[NUM_THREADS];
+    ContextWorker_t workers[NUM_THREADS];
+    for(i = 0; i < NUM_THREADS; i++){
+        workers[i].context = context;
+        workers[i].expected = expected;
+        workers[i].failed = 0;
+        pthread_create(&threads[i], NULL, context_worker, &workers[i]);
+    }
+    for(i = 0; i < NUM_THREADS; i++){
+        pthread_join(threads[i], NULL);
+        cr_assert(workers[i].failed == 0, "Thread sharing the context saw a different hull");
+    }
+
+    free_point_array(loaded);
+    free_point_array(hull);
+    free_point_array(expected);
+    cr_assert(num_context_live > 0, "Context did not use its allocator");
+    free_context(context);
+    cr_assert(num_context_live == 0, "Context memory not released");
+}
+
+
+/* State shared with the callbacks of asynchronous tasks */
+typedef struct AsyncState {
+    pthread_mutex_t lock;
+    pthread_cond_t released;
+    int blocking;
+    int num_callbacks;
+    CGError_t last_status;
+} AsyncState_t;
+
+
+/* Callback that records the status, and holds its worker while blocking is set */
+static void async_callback(CGTask_t* task, CGError_t status, void* user_data){
+    (void) task;
+    AsyncState_t* state = (AsyncState_t*) user_data;
+    pthread_mutex_lock(&state->lock);
+    state->num_callbacks++;
+    state->last_status = status;
+    while(state->blocking)
+        pthread_cond_wait(&state->released, &state->lock);
+    pthread_mutex_unlock(&state->lock);
+}
+
+
+/* Test that asynchronous hulls finish with the serial result, time out while queued and can be cancelled */
+Test(asserts, async_tasks_complete_and_cancel, .init = setup_shared, .fini = teardown_shared){
+    AsyncState_t state;
+    memset(&state, 0, sizeof(state));
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.released, NULL);
+
+    // one thread means a single worker, so tasks queue up behind each other
+    CGContextOptions_t options;
+    memset(&options, 0, sizeof(options));
+    options.num_threads = 1;
+    options.parallel_min_points = NUM_POINTS / 16;
+    CGContext_t* context = init_context(&options);
+
+    CGPointArray_t* expected = init_point_array(0);
+    compute_monotone_chain(shared_array, expected, CG_W_DEGENERACY);
+    CGPointArray_t* hull = init_point_array(0);
+    CGTask_t* task = compute_monotone_chain_async(context, shared_array, hull, CG_W_DEGENERACY, async_callback, &state);
+    cr_assert(task != NULL, "Task not started");
+    cr_assert(wait_task(task, -1) == CG_SUCCESS && poll_task(task) && get_task_progress(task) == 1.0, "Task did not complete");
+    cr_assert(state.num_callbacks == 1 && state.last_status == CG_SUCCESS, "Callback not run once");
+    cr_assert(hull->num_points == expected->num_points &&
+              memcmp(hull->xcoords, expected->xcoords, hull->num_points * sizeof(double)) == 0, "Asynchronous hull differs");
+    free_task(task);
+
+    // hold the worker in a callback so the next task stays queued
+    state.blocking = 1;
+    CGPointSet_t* hull_set = init_point_set();
+    CGTask_t* blocker = compute_convex_hull_async(context, shared_set, hull_set, CG_GRAHAM_SCAN, CG_W_DEGENERACY, async_callback, &state);
+    CGPointArray_t* cancelled_hull = init_point_array(0);
+    CGTask_t* cancelled = compute_monotone_chain_async(context, shared_array, cancelled_hull, CG_W_DEGENERACY, async_callback, &state);
+    cr_assert(blocker != NULL && cancelled != NULL, "Tasks not started");
+    cr_assert(wait_task(cancelled, 0.05) == CG_TIMEOUT && !poll_task(cancelled), "Queued task reported as done");
+    cancel_task(cancelled);
+    pthread_mutex_lock(&state.lock);
+    state.blocking = 0;
+    pthread_cond_broadcast(&state.released);
+    pthread_mutex_unlock(&state.lock);
+    cr_assert(wait_task(blocker, -1) == CG_SUCCESS && hull_set->num_points > 0, "Blocking task failed");
+    cr_assert(wait_task(cancelled, -1) == CG_CANCELLED, "Task not cancelled");
+    cr_assert(cancelled_hull->num_points == 0, "Cancelled task wrote its output");
+    free_task(blocker);
+    free_task(cancelled);
+
+    // freeing a handle early waits for its worker, so the output can be freed right after
+    task = compute_monotone_chain_async(context, shared_array, hull, CG_W_DEGENERACY, async_callback, &state);
+    free_task(task);
+    cr_assert(state.num_callbacks == 4, "Callback of a freed task not run");
+
+    // a running Graham scan cannot be cancelled, freeing it must still wait before its output is released
+    CGPointArray_t* large_array = init_point_array(0);
+    generate_point_array(large_array, 200000, CG_UNIFORM_DISK, 21);
+    CGPointSet_t* large_set = init_point_set();
+    point_set_from_point_array(large_array, large_set);
+    CGPointSet_t* running_hull = init_point_set();
+    task = compute_convex_hull_async(context, large_set, running_hull, CG_GRAHAM_SCAN, CG_W_DEGENERACY, async_callback, &state);
+    cr_assert(task != NULL, "Task not started");
+    struct timespec pause = {0, 10000000};
+    nanosleep(&pause, NULL);
+    free_task(task);
+    cr_assert(state.num_callbacks == 5, "Task freed while its worker was running");
+    free_point_set(running_hull);
+    free_point_set(large_set);
+    free_point_array(large_array);
+    free_context(context);
+
+    free_point_array(cancelled_hull);
+    free_point_set(hull_set);
+    free_point_array(hull);
+    free_point_array(expected);
+    pthread_cond_destroy(&state.released);
+    pthread_mutex_destroy(&state.lock);
+}
+
+
+/* Test checking that generated points depend only on the seed, not on how the work is split */
+Test(asserts, generators_reproducible_across_threads){
+    CGContextOptions_t options;
+    memset(&options, 0, sizeof(options));
+    options.num_threads = NUM_THREADS;
+    options.parallel_min_points = NUM_POINTS / 8;
+    CGContext_t* context = init_context(&options);
+    cr_assert(context != NULL, "Context not created");
+
+    size_t num_points = NUM_POINTS * 4;
+    int distribution;
+    for(distribution = CG_UNIFORM_SQUARE; distribution <= CG_LARGE_MAGNITUDE; distribution++){
+        CGPointArray_t* serial = init_point_array(0);
+        CGPointArray_t* parallel = init_point_array(0);
+        CGPointArray_t* reseeded = init_point_array(0);
+        add_coords_to_array(parallel, 5.0, 5.0);
+        cr_assert(generate_point_array(serial, num_points, distribution, 1234) == CG_SUCCESS, "Generation failed");
+        cr_assert(generate_point_array_ctx(context, parallel, num_points, distribution, 1234) == CG_SUCCESS, "Parallel generation failed");
+        generate_point_array(reseeded, num_points, distribution, 1235);
+        cr_assert(serial->num_points == num_points && parallel->num_points == num_points + 1, "Wrong number of points");
+        cr_assert(parallel->xcoords[0] == 5.0 && parallel->ycoords[0] == 5.0, "Existing point overwritten");
+        cr_assert(memcmp(serial->xcoords, parallel->xcoords + 1, num_points * sizeof(double)) == 0 &&
+                  memcmp(serial->ycoords, parallel->ycoords + 1, num_points * sizeof(double)) == 0, "Parallel points differ");
+        cr_assert(memcmp(serial->xcoords, reseeded->xcoords, num_points * sizeof(double)) != 0, "Seed ignored");
+
+        size_t i;
+        for(i = 0; i < num_points; i++){
+            double x = serial->xcoords[i], y = serial->ycoords[i];
+            if(distribution == CG_COLLINEAR)
+                cr_assert(y == x * 0.5, "Point off the line");
+            else if(distribution == CG_CIRCLE)
+                cr_assert(fabs(x * x + y * y - 1.0) < 1e-12, "Point off the circle");
+            else if(distribution == CG_LARGE_MAGNITUDE)
+                cr_assert(fabs(x - 1e12) <= 1e3 && fabs(y + 1e12) <= 1e3, "Point outside the far square");
+            else if(distribution != CG_GAUSSIAN_CLUSTERS)
+                cr_assert(fabs(x) <= 1.0 && fabs(y) <= 1.0, "Point outside the square");
+        }
+        free_point_array(serial);
+        free_point_array(parallel);
+        free_point_array(reseeded);
+    }
+
+    // a duplicate-heavy set has few distinct points
+    CGPointArray_t* duplicates = init_point_array(0);
+    generate_point_array(duplicates, num_points, CG_DUPLICATES, 99);
+    CGPointView_t* view = init_point_view(duplicates);
+    sort_point_view(view, NULL);
+    size_t num_distinct = 1, i;
+    for(i = 1; i < view->num_indices; i++){
+        size_t a = view->indices[i - 1], b = view->indices[i];
+        if(duplicates->xcoords[a] != duplicates->xcoords[b] || duplicates->ycoords[a] != duplicates->ycoords[b])
+            num_distinct++;
+    }
+    cr_assert(num_distinct <= num_points / 64 + 1, "Too many distinct points");
+    free_point_view(view);
+    free_point_array(duplicates);
+
+    cr_assert(generate_point_array(NULL, 10, CG_CIRCLE, 1) == CG_INVALID_INPUT, "NULL array accepted");
+    free_context(context);
+}
@@ -65,3 +65,275 @@ Test(asserts, graham_scan_test_12pt, .init = setup_convex_hull_test, .fini = tea
     cr_assert(compare == 0, "Graham Scan not computed correctly");
 }
 
+
+
+/* Helper that fills an array from a list of coordinate pairs */
+static CGPointArray_t* array_from_coords(const double* coords, int num_points){
+    CGPointArray_t* point_array = init_point_array(num_points);
+    int i;
+    for(i = 0; i < num_points; i++)
+        add_coords_to_array(point_array, coords[2 * i], coords[2 * i + 1]);
+    return point_array;
+}
+
+
+Test(asserts, monotone_chain_square_with_degeneracies){
+    // square with interior, duplicate and edge points
+    const double coords[] = {2, 2, 0, 0, 4, 0, 4, 4, 0, 4, 2, 0, 1, 3, 4, 4, 0, 2};
+    const double expected_no_degeneracy[] = {0, 0, 2, 0, 4, 0, 4, 4, 0, 4, 0, 2};
+    const double expected_w_degeneracy[] = {0, 0, 4, 0, 4, 4, 0, 4};
+    CGPointArray_t* input = array_from_coords(coords, 9);
+    CGPointArray_t* output = init_point_array(0);
+
+    CGError_t status = compute_monotone_chain(input, output, CG_NO_DEGENERACY);
+    cr_assert(status == CG_SUCCESS, "Monotone chain failed");
+    cr_assert(output->num_points == 6, "Colinear hull points not kept");
+    size_t i;
+    for(i = 0; i < output->num_points; i++)
+        cr_assert(output->xcoords[i] == expected_no_degeneracy[2 * i] && output->ycoords[i] == expected_no_degeneracy[2 * i + 1], "Hull not computed correctly");
+
+    output->num_points = 0;
+    status = compute_monotone_chain(input, output, CG_W_DEGENERACY);
+    cr_assert(status == CG_SUCCESS, "Monotone chain failed");
+    cr_assert(output->num_points == 4, "Colinear hull points not removed");
+    for(i = 0; i < output->num_points; i++)
+        cr_assert(output->xcoords[i] == expected_w_degeneracy[2 * i] && output->ycoords[i] == expected_w_degeneracy[2 * i + 1], "Hull not computed correctly");
+
+    free_point_array(input);
+    free_point_array(output);
+}
+
+
+Test(asserts, monotone_chain_colinear_input){
+    const double coords[] = {3, 3, 1, 1, 2, 2, 0, 0};
+    CGPointArray_t* input = array_from_coords(coords, 4);
+    CGPointArray_t* output = init_point_array(0);
+    compute_monotone_chain(input, output, CG_NO_DEGENERACY);
+    cr_assert(output->num_points == 4, "Colinear input should keep every point once");
+    output->num_points = 0;
+    compute_monotone_chain(input, output, CG_W_DEGENERACY);
+    cr_assert(output->num_points == 2, "Colinear input should reduce to its endpoints");
+    cr_assert(output->xcoords[0] == 0 && output->xcoords[1] == 3, "Endpoints not found");
+    free_point_array(input);
+    free_point_array(output);
+}
+
+
+Test(asserts, graham_scan_matches_monotone_chain){
+    // same square as above, the input points must come back untouched
+    const double coords[] = {2, 2, 0, 0, 4, 0, 4, 4, 0, 4, 2, 0, 1, 3, 4, 4, 0, 2};
+    const double expected_no_degeneracy[] = {0, 0, 2, 0, 4, 0, 4, 4, 0, 4, 0, 2};
+    const double expected_w_degeneracy[] = {0, 0, 4, 0, 4, 4, 0, 4};
+    CGPointSet_t* input = init_point_set();
+    int i;
+    for(i = 0; i < 9; i++)
+        add_coords_to_set(input, coords[2 * i], coords[2 * i + 1]);
+
+    CGPointSet_t* output = init_point_set();
+    CGError_t status = compute_graham_scan(input, output, CG_NO_DEGENERACY);
+    cr_assert(status == CG_SUCCESS && output->num_points == 6, "Graham scan failed");
+    for(i = 0; i < output->num_points; i++){
+        CGPoint_t* point = get_point_at_index(output, i);
+        cr_assert(point->xcoord == expected_no_degeneracy[2 * i] && point->ycoord == expected_no_degeneracy[2 * i + 1], "Hull not computed correctly");
+    }
+    free_point_set(output);
+
+    output = init_point_set();
+    status = compute_graham_scan(input, output, CG_W_DEGENERACY);
+    cr_assert(status == CG_SUCCESS && output->num_points == 4, "Graham scan failed");
+    for(i = 0; i < output->num_points; i++){
+        CGPoint_t* point = get_point_at_index(output, i);
+        cr_assert(point->xcoord == expected_w_degeneracy[2 * i] && point->ycoord == expected_w_degeneracy[2 * i + 1], "Hull not computed correctly");
+    }
+    CGPointNode_t* current_node = input->head;
+    while(current_node != NULL){
+        cr_assert(current_node->point->sort_val_desc == NULL, "Input points were modified");
+        current_node = current_node->next;
+    }
+    free_point_set(output);
+    free_point_set(input);
+}
+
+
+Test(asserts, monotone_chain_view_matches_array){
+    const double coords[] = {2, 2, 0, 0, 4, 0, 4, 4, 0, 4, 2, 0, 1, 3, 4, 4, 0, 2};
+    CGPointArray_t* input = array_from_coords(coords, 9);
+    CGPointView_t* input_view = init_point_view(input);
+    CGPointView_t* hull_view = init_point_view(input);
+    hull_view->num_indices = 0;
+    CGPointArray_t* expected = init_point_array(0);
+    CGPointArray_t* gathered = init_point_array(0);
+
+    CGCompute_t compute_types[] = {CG_NO_DEGENERACY, CG_W_DEGENERACY};
+    size_t i, j;
+    for(j = 0; j < 2; j++){
+        expected->num_points = 0;
+        gathered->num_points = 0;
+        hull_view->num_indices = 0;
+        compute_monotone_chain(input, expected, compute_types[j]);
+        CGError_t status = compute_monotone_chain_view(input_view, hull_view, compute_types[j]);
+        cr_assert(status == CG_SUCCESS, "Monotone chain view failed");
+        point_array_from_point_view(hull_view, gathered);
+        cr_assert(gathered->num_points == expected->num_points, "View hull has the wrong size");
+        for(i = 0; i < expected->num_points; i++)
+            cr_assert(gathered->xcoords[i] == expected->xcoords[i] && gathered->ycoords[i] == expected->ycoords[i], "View hull differs");
+    }
+    cr_assert(hull_view->points->xcoords == input->xcoords, "Hull view copied the coordinates");
+
+    CGPointView_t* other_view = init_point_view(expected);
+    cr_assert(compute_monotone_chain_view(input_view, other_view, CG_NO_DEGENERACY) == CG_INVALID_INPUT, "Views of different arrays accepted");
+
+    free_point_view(other_view);
+    free_point_view(input_view);
+    free_point_view(hull_view);
+    free_point_array(input);
+    free_point_array(expected);
+    free_point_array(gathered);
+}
+
+
+Test(asserts, hull_cache_follows_appends){
+    const double coords[] = {2, 2, 0, 0, 4, 0, 4, 4, 0, 4, 2, 0, 1, 3};
+    CGPointSet_t* cached = init_point_set();
+    CGPointSet_t* plain = init_point_set();
+    size_t i;
+    for(i = 0; i < 7; i++){
+        add_coords_to_set(cached, coords[2 * i], coords[2 * i + 1]);
+        add_coords_to_set(plain, coords[2 * i], coords[2 * i + 1]);
+    }
+    cr_assert(enable_hull_cache(cached) == CG_SUCCESS, "Hull cache not enabled");
+
+    // interior points, an exterior point, and a point on an edge are appended in turn
+    const double appended[] = {3, 1, 6, 2, 5, 3};
+    CGConvexHull_t methods[] = {CG_MONOTONE_CHAIN, CG_GRAHAM_SCAN};
+    CGCompute_t compute_types[] = {CG_NO_DEGENERACY, CG_W_DEGENERACY};
+    size_t round, j;
+    for(round = 0; round <= 3; round++){
+        if(round > 0){
+            add_coords_to_set(cached, appended[2 * (round - 1)], appended[2 * (round - 1) + 1]);
+            add_coords_to_set(plain, appended[2 * (round - 1)], appended[2 * (round - 1) + 1]);
+        }
+        for(j = 0; j < 4; j++){
+            CGPointSet_t* expected = init_point_set();
+            CGPointSet_t* hull = init_point_set();
+            compute_convex_hull(plain, expected, methods[j / 2], compute_types[j % 2]);
+            cr_assert(compute_convex_hull(cached, hull, methods[j / 2], compute_types[j % 2]) == CG_SUCCESS, "Cached hull failed");
+            cr_assert(compare_point_sets(expected, hull) == 0, "Cached hull differs from a fresh one");
+            free_point_set(expected);
+            free_point_set(hull);
+        }
+    }
+
+    // points changed in place are only seen after invalidating the cache
+    CGPointSet_t* hull = init_point_set();
+    compute_convex_hull(cached, hull, CG_MONOTONE_CHAIN, CG_W_DEGENERACY);
+    int num_points = hull->num_points;
+    cached->head->point->xcoord = -10;
+    free_point_set(hull);
+    hull = init_point_set();
+    compute_convex_hull(cached, hull, CG_MONOTONE_CHAIN, CG_W_DEGENERACY);
+    cr_assert(hull->num_points == num_points, "Unchanged set did not return the cached hull");
+    invalidate_hull_cache(cached);
+    free_point_set(hull);
+    hull = init_point_set();
+    compute_convex_hull(cached, hull, CG_MONOTONE_CHAIN, CG_W_DEGENERACY);
+    cr_assert(hull->num_points == num_points + 1, "Invalidated cache not recomputed");
+
+    free_point_set(hull);
+    free_point_set(cached);
+    free_point_set(plain);
+}
+
+
+/* Test checking the instrumentation counts work on the calling thread, or is reported as compiled out */
+Test(asserts, instrumentation_counts_graham_scan){
+    CGStats_t stats;
+    if(reset_thread_stats() == CG_UNIMPLEMENTED){
+        cr_assert(get_thread_stats(&stats) == CG_UNIMPLEMENTED && stats.orientation_tests == 0, "Disabled stats not zeroed");
+        return;
+    }
+    CGPointArray_t* points = init_point_array(0);
+    generate_point_array(points, 1000, CG_UNIFORM_DISK, 3);
+    CGPointSet_t* input = init_point_set();
+    CGPointSet_t* hull = init_point_set();
+    point_set_from_point_array(points, input);
+    reset_thread_stats();
+    cr_assert(compute_graham_scan(input, hull, CG_W_DEGENERACY) == CG_SUCCESS, "Graham scan failed");
+    cr_assert(get_thread_stats(&stats) == CG_SUCCESS, "Stats not available");
+    cr_assert(stats.orientation_tests >= 1000 && stats.comparisons >= 1000, "Operations not counted");
+    cr_assert(stats.allocations > 0 && stats.allocated_bytes >= 1000 * 2 * sizeof(double), "Allocations not counted");
+    cr_assert(stats.phase_calls[CG_PHASE_ANGLES] == 2 && stats.phase_calls[CG_PHASE_SORT] == 2 &&
+              stats.phase_calls[CG_PHASE_SCAN] == 1 && stats.phase_calls[CG_PHASE_DEGENERACY] == 2, "Phases not timed");
+    cr_assert(stats.phase_seconds[CG_PHASE_SORT] > 0, "Sort phase not timed");
+
+    reset_thread_stats();
+    get_thread_stats(&stats);
+    cr_assert(stats.orientation_tests == 0 && stats.phase_calls[CG_PHASE_SORT] == 0, "Stats not reset");
+    free_point_set(hull);
+    free_point_set(input);
+    free_point_array(points);
+}
+
+
+/* Test checking that every supported instruction set gives the hulls and bounds of the scalar kernels */
+Test(asserts, simd_levels_agree){
+    CGSimdLevel_t initial = get_simd_level();
+    CGSimdLevel_t supported = get_supported_simd_level();
+    cr_assert(initial == supported, "Best level not picked");
+    cr_assert(set_simd_level((CGSimdLevel_t) (supported + 1)) == CG_INVALID_INPUT, "Unsupported level accepted");
+
+    CGDistribution_t distributions[] = {CG_UNIFORM_SQUARE, CG_CIRCLE, CG_COLLINEAR, CG_DUPLICATES, CG_LARGE_MAGNITUDE};
+    CGCompute_t compute_types[] = {CG_NO_DEGENERACY, CG_W_DEGENERACY};
+    size_t d, c;
+    for(d = 0; d < sizeof(distributions) / sizeof(distributions[0]); d++){
+        CGPointArray_t* points = init_point_array(0);
+        generate_point_array(points, 1003, distributions[d], d);
+        CGPointSet_t* set = init_point_set();
+        point_set_from_point_array(points, set);
+        for(c = 0; c < 2; c++){
+            set_simd_level(CG_SIMD_SCALAR);
+            CGPointArray_t* expected = init_point_array(0);
+            CGPointSet_t* expected_graham = init_point_set();
+            CGBoundingBox_t expected_box;
+            compute_monotone_chain(points, expected, compute_types[c]);
+            compute_graham_scan(set, expected_graham, compute_types[c]);
+            compute_bounding_box(points, &expected_box);
+
+            // the view path hulls every point, without filtering interior ones
+            CGPointView_t* view = init_point_view(points);
+            CGPointView_t* view_hull = init_point_view(points);
+            view_hull->num_indices = 0;
+            compute_monotone_chain_view(view, view_hull, compute_types[c]);
+            cr_assert(view_hull->num_indices == expected->num_points, "Filtered hull differs in size");
+            size_t i;
+            for(i = 0; i < expected->num_points; i++)
+                cr_assert(points->xcoords[view_hull->indices[i]] == expected->xcoords[i] &&
+                          points->ycoords[view_hull->indices[i]] == expected->ycoords[i], "Filtered hull differs");
+            free_point_view(view);
+            free_point_view(view_hull);
+
+            int level;
+            for(level = CG_SIMD_SSE2; level <= (int) supported; level++){
+                cr_assert(set_simd_level((CGSimdLevel_t) level) == CG_SUCCESS && get_simd_level() == (CGSimdLevel_t) level, "Level not set");
+                CGPointArray_t* hull = init_point_array(0);
+                CGPointSet_t* graham = init_point_set();
+                CGBoundingBox_t box;
+                compute_monotone_chain(points, hull, compute_types[c]);
+                compute_graham_scan(set, graham, compute_types[c]);
+                compute_bounding_box(points, &box);
+                cr_assert(hull->num_points == expected->num_points &&
+                          memcmp(hull->xcoords, expected->xcoords, hull->num_points * sizeof(double)) == 0 &&
+                          memcmp(hull->ycoords, expected->ycoords, hull->num_points * sizeof(double)) == 0, "Hull differs between levels");
+                cr_assert(compare_point_sets(graham, expected_graham) == 0, "Graham scan differs between levels");
+                cr_assert(memcmp(&box, &expected_box, sizeof(CGBoundingBox_t)) == 0, "Bounding box differs between levels");
+                free_point_array(hull);
+                free_point_set(graham);
+            }
+            free_point_array(expected);
+            free_point_set(expected_graham);
+        }
+        free_point_set(set);
+        free_point_array(points);
+    }
+    set_simd_level(initial);
+}
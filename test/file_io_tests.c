@@ -0,0 +1,728 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Unit tests for the bulk file loaders and writers for libCGeo
+ */
+
+#include "libCGeo/libCGeo.h"
+#include <criterion/criterion.h>
+#include <criterion/assert.h>
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+CGPointSet_t* point_set_A;
+CGPointArray_t* point_array_A;
+CGPointArray_t* point_array_B;
+
+FILE* input_test_file;
+
+
+/* Setup function that opens the 3 point input and initializes a set and two arrays */
+void setup_file_io(void){
+    input_test_file = fopen(CGEO_TEST_DIR "/test_inputs/test1.csv", "r");
+    point_set_A = init_point_set();
+    point_array_A = init_point_array(0);
+    point_array_B = init_point_array(0);
+}
+
+
+/* Function that performs memory cleanup after every test */
+void teardown_file_io(void){
+    free_point_set(point_set_A);
+    free_point_array(point_array_A);
+    free_point_array(point_array_B);
+    if(input_test_file != NULL) fclose(input_test_file);
+}
+
+
+/* Helper that writes a string into a temporary file and returns its path */
+static const char* write_temp_csv(const char* contents){
+    static char path[] = "libCGeo_file_io_test.csv";
+    FILE* fp = fopen(path, "w");
+    fputs(contents, fp);
+    fclose(fp);
+    return path;
+}
+
+
+/* Helper comparing two point arrays exactly */
+static int compare_point_arrays(CGPointArray_t* point_array_A, CGPointArray_t* point_array_B){
+    if(point_array_A->num_points != point_array_B->num_points)
+        return -1;
+    size_t i;
+    for(i = 0; i < point_array_A->num_points; i++){
+        if(point_array_A->xcoords[i] != point_array_B->xcoords[i] || point_array_A->ycoords[i] != point_array_B->ycoords[i])
+            return -1;
+    }
+    return 0;
+}
+
+
+/* Test that the mapped loader reads the same points as the FILE* reader */
+Test(asserts, csv_path_matches_file_reader, .init = setup_file_io, .fini = teardown_file_io){
+    CGError_t status = point_set_from_csv_file(point_set_A, input_test_file);
+    cr_assert(status == CG_SUCCESS, "Error in parsing csv file");
+    status = point_array_from_point_set(point_set_A, point_array_A);
+    cr_assert(status == CG_SUCCESS, "Error in converting point set");
+    status = point_array_from_csv_path(point_array_B, CGEO_TEST_DIR "/test_inputs/test1.csv");
+    cr_assert(status == CG_SUCCESS, "Error in mapping csv file");
+    cr_assert(point_array_B->num_points == 3, "Not all points parsed");
+    cr_assert(compare_point_arrays(point_array_A, point_array_B) == 0, "Mapped point array not as expected");
+}
+
+
+/* Allocator that fills new memory and some slack after it with digits, so reads past the end of a field show up */
+static void* dirty_alloc(size_t size, void* user_data){
+    (void) user_data;
+    void* memory = malloc(size + 16);
+    if(memory != NULL)
+        memset(memory, '7', size + 16);
+    return memory;
+}
+
+static void* dirty_realloc(void* pointer, size_t size, void* user_data){
+    (void) user_data;
+    return realloc(pointer, size);
+}
+
+static void dirty_free(void* pointer, void* user_data){
+    (void) user_data;
+    free(pointer);
+}
+
+
+/* Test that the FILE* reader terminates every field it splits off, whatever the allocator hands back */
+Test(asserts, csv_file_reader_terminates_fields){
+    CGAllocator_t allocator = {dirty_alloc, dirty_realloc, dirty_free, NULL};
+    cr_assert(set_allocator(&allocator) == CG_SUCCESS, "Allocator not accepted");
+    CGPointSet_t* point_set = init_point_set();
+    CGPointArray_t* point_array = init_point_array(0);
+    FILE* fp = fopen(CGEO_TEST_DIR "/test_inputs/test1.csv", "r");
+    CGError_t status = point_set_from_csv_file(point_set, fp);
+    fclose(fp);
+    point_array_from_point_set(point_set, point_array);
+    const double expected[] = {-3, 7, 5, 9, 4, 3};
+    cr_assert(status == CG_SUCCESS && point_array->num_points == 3, "Not all points parsed");
+    size_t i;
+    for(i = 0; i < 3; i++)
+        cr_assert(point_array->xcoords[i] == expected[2 * i] && point_array->ycoords[i] == expected[2 * i + 1], "Field read past its end");
+    free_point_array(point_array);
+    free_point_set(point_set);
+    set_allocator(NULL);
+}
+
+
+/* Test that malformed lines are skipped and a missing final newline is handled */
+Test(asserts, csv_path_skips_invalid_lines, .init = setup_file_io, .fini = teardown_file_io){
+    const char* path = write_temp_csv("x,y\n  1.5 , -2\r\n\n3,4,5\nabc,1\n-1e2,.25");
+    CGError_t status = point_array_from_csv_path(point_array_A, path);
+    remove(path);
+    cr_assert(status == CG_SUCCESS, "Error in mapping csv file");
+    cr_assert(point_array_A->num_points == 2, "Invalid lines not skipped");
+    cr_assert(point_array_A->xcoords[0] == 1.5 && point_array_A->ycoords[0] == -2, "First point not parsed");
+    cr_assert(point_array_A->xcoords[1] == -100 && point_array_A->ycoords[1] == 0.25, "Last point not parsed");
+}
+
+
+/* Test that missing files are reported */
+Test(asserts, csv_path_missing_file, .init = setup_file_io, .fini = teardown_file_io){
+    CGError_t status = point_array_from_csv_path(point_array_A, CGEO_TEST_DIR "/test_inputs/does_not_exist.csv");
+    cr_assert(status == CG_NO_FILE, "Missing file not reported");
+}
+
+
+/* Test that parsed coordinates are bit-identical to strtod, including hard rounding cases */
+Test(asserts, csv_path_matches_strtod, .init = setup_file_io, .fini = teardown_file_io){
+    const char* values[] = {
+        "0.1", "-0", "1e23", "9007199254740993", "2.2250738585072011e-308", "4.9406564584124654e-324",
+        "2.4703282292062328e-324", "1.7976931348623157e308", "1e400", "7.2057594037927933e16",
+        "123456789012345678901234567890", "0.000000000000000000000000000001", "-1234.567890", "3.",
+    };
+    size_t num_values = sizeof(values) / sizeof(values[0]);
+    char contents[2048] = "";
+    size_t i;
+    for(i = 0; i < num_values; i++){
+        strcat(contents, values[i]);
+        strcat(contents, ",");
+        strcat(contents, values[num_values - 1 - i]);
+        strcat(contents, "\n");
+    }
+    const char* path = write_temp_csv(contents);
+    CGError_t status = point_array_from_csv_path(point_array_A, path);
+    remove(path);
+    cr_assert(status == CG_SUCCESS, "Error in mapping csv file");
+    cr_assert(point_array_A->num_points == num_values, "Not all points parsed");
+    for(i = 0; i < num_values; i++){
+        double xcoord = strtod(values[i], NULL);
+        double ycoord = strtod(values[num_values - 1 - i], NULL);
+        cr_assert(memcmp(&xcoord, &point_array_A->xcoords[i], sizeof(double)) == 0, "x-coordinate differs from strtod");
+        cr_assert(memcmp(&ycoord, &point_array_A->ycoords[i], sizeof(double)) == 0, "y-coordinate differs from strtod");
+    }
+}
+
+
+/* Test that numbers longer than any fixed buffer parse like strtod, also under a comma decimal locale */
+Test(asserts, csv_path_long_numbers_match_strtod, .init = setup_file_io, .fini = teardown_file_io){
+    char values[4][160];
+    strcpy(values[0], "1.");
+    memset(values[0] + 2, '0', 70);
+    strcpy(values[0] + 72, "1");
+    // just above the halfway point between two doubles, only the last digit decides the rounding
+    strcpy(values[1], "9007199254740993");
+    memset(values[1] + 16, '0', 80);
+    strcpy(values[1] + 96, "1");
+    strcpy(values[2], "-0.");
+    memset(values[2] + 3, '0', 90);
+    strcpy(values[2] + 93, "123456789012345678901234567890e100");
+    memset(values[3], '7', 120);
+    strcpy(values[3] + 120, ".5");
+    char contents[1024] = "";
+    size_t i;
+    for(i = 0; i < 4; i++){
+        strcat(contents, values[i]);
+        strcat(contents, ",2\n");
+    }
+    strcat(contents, "3,4\n");
+    const char* path = write_temp_csv(contents);
+
+    int locale_index;
+    const char* locales[] = {NULL, "de_DE.UTF-8", "fr_FR.UTF-8"};
+    for(locale_index = 0; locale_index < 3; locale_index++){
+        if(locales[locale_index] != NULL && setlocale(LC_NUMERIC, locales[locale_index]) == NULL)
+            continue;
+        point_array_A->num_points = 0;
+        CGError_t status = point_array_from_csv_path(point_array_A, path);
+        FILE* fp = fopen(path, "r");
+        CGPointSet_t* point_set = init_point_set();
+        CGError_t set_status = point_set_from_csv_file(point_set, fp);
+        fclose(fp);
+        setlocale(LC_NUMERIC, "C");
+        cr_assert(status == CG_SUCCESS && set_status == CG_SUCCESS, "Error in reading csv file");
+        cr_assert(point_array_A->num_points == 5 && point_set->num_points == 5, "Lines with long numbers dropped");
+        for(i = 0; i < 4; i++){
+            double expected = strtod(values[i], NULL);
+            cr_assert(memcmp(&expected, &point_array_A->xcoords[i], sizeof(double)) == 0, "Long number differs from strtod");
+        }
+        cr_assert(point_array_A->xcoords[4] == 3 && point_array_A->ycoords[4] == 4, "Line after long numbers not parsed");
+        free_point_set(point_set);
+    }
+    remove(path);
+}
+
+
+/* Test that lines straddling the scanner's internal windows are parsed */
+Test(asserts, csv_path_long_input, .init = setup_file_io, .fini = teardown_file_io){
+    const char* path = "libCGeo_file_io_long.csv";
+    FILE* fp = fopen(path, "w");
+    int i;
+    for(i = 0; i < 5000; i++)
+        fprintf(fp, "%d.%d,  %d\n", i, i % 7, -i);
+    fclose(fp);
+    CGError_t status = point_array_from_csv_path(point_array_A, path);
+    remove(path);
+    cr_assert(status == CG_SUCCESS, "Error in mapping csv file");
+    cr_assert(point_array_A->num_points == 5000, "Not all points parsed");
+    for(i = 0; i < 5000; i++){
+        char xcoord[32];
+        snprintf(xcoord, sizeof(xcoord), "%d.%d", i, i % 7);
+        cr_assert(point_array_A->xcoords[i] == strtod(xcoord, NULL), "x-coordinate not parsed");
+        cr_assert(point_array_A->ycoords[i] == -i, "y-coordinate not parsed");
+    }
+}
+
+
+/* Test that the structural scanner of every supported instruction set parses the same points */
+Test(asserts, csv_path_same_on_every_simd_level, .init = setup_file_io, .fini = teardown_file_io){
+    const char* path = "libCGeo_file_io_simd.csv";
+    FILE* fp = fopen(path, "w");
+    int i;
+    for(i = 0; i < 3000; i++){
+        if(i % 11 == 0)
+            fprintf(fp, "bad line %d\n", i);
+        fprintf(fp, "%*d.5,%d\n", i % 70, i, i * 3);
+    }
+    fclose(fp);
+    CGSimdLevel_t initial = get_simd_level();
+    set_simd_level(CG_SIMD_SCALAR);
+    cr_assert(point_array_from_csv_path(point_array_A, path) == CG_SUCCESS && point_array_A->num_points == 3000, "Scalar parse failed");
+    int level;
+    for(level = CG_SIMD_SSE2; level <= (int) get_supported_simd_level(); level++){
+        set_simd_level((CGSimdLevel_t) level);
+        point_array_B->num_points = 0;
+        cr_assert(point_array_from_csv_path(point_array_B, path) == CG_SUCCESS, "Parse failed");
+        cr_assert(compare_point_arrays(point_array_A, point_array_B) == 0, "Levels parse different points");
+    }
+    set_simd_level(initial);
+    remove(path);
+}
+
+
+/* Test that the parallel loader returns the points in the same order as the sequential one */
+Test(asserts, csv_path_parallel_matches_sequential, .init = setup_file_io, .fini = teardown_file_io){
+    const char* path = "libCGeo_file_io_parallel.csv";
+    FILE* fp = fopen(path, "w");
+    int i;
+    for(i = 0; i < 40000; i++){
+        if(i % 1000 == 0)
+            fprintf(fp, "not,a,point\n");
+        fprintf(fp, "%d.%03d,%d\n", i, i % 1000, (i * 7919) % 10007);
+    }
+    fclose(fp);
+    CGError_t status = point_array_from_csv_path(point_array_A, path);
+    cr_assert(status == CG_SUCCESS, "Error in mapping csv file");
+    int num_threads;
+    for(num_threads = 0; num_threads <= 5; num_threads++){
+        CGPointArray_t* point_array = init_point_array(0);
+        status = point_array_from_csv_path_parallel(point_array, path, num_threads);
+        cr_assert(status == CG_SUCCESS, "Error in parallel parsing");
+        cr_assert(compare_point_arrays(point_array_A, point_array) == 0, "Parallel parse differs from sequential");
+        free_point_array(point_array);
+    }
+    remove(path);
+}
+
+
+/* Helper that writes a file of n points on a parabola, with a header line */
+static const char* write_parabola_csv(int num_points){
+    static char path[] = "libCGeo_file_io_stream.csv";
+    FILE* fp = fopen(path, "w");
+    fprintf(fp, "x,y\n");
+    int i;
+    for(i = 0; i < num_points; i++){
+        long long xcoord = i - num_points / 2;
+        fprintf(fp, "%lld,%lld\n", xcoord, xcoord * xcoord);
+    }
+    fclose(fp);
+    return path;
+}
+
+
+/* Test that streaming in batches yields the same points as the bulk loader */
+Test(asserts, stream_batches_match_bulk_load, .init = setup_file_io, .fini = teardown_file_io){
+    const char* path = write_parabola_csv(2500);
+    point_array_from_csv_path(point_array_A, path);
+    CGPointStream_t* stream = open_csv_point_stream(path, 333);
+    cr_assert(stream != NULL, "Stream not opened");
+    CGPointArray_t* batch = init_point_array(0);
+    size_t num_batches = 0;
+    while(next_point_batch(stream, batch) == CG_SUCCESS && batch->num_points > 0){
+        cr_assert(batch->num_points <= 333, "Batch larger than requested");
+        size_t i;
+        for(i = 0; i < batch->num_points; i++)
+            add_coords_to_array(point_array_B, batch->xcoords[i], batch->ycoords[i]);
+        num_batches++;
+    }
+    cr_assert(num_batches == 8, "Unexpected number of batches");
+    cr_assert(compare_point_arrays(point_array_A, point_array_B) == 0, "Streamed points differ from bulk load");
+    free_point_array(batch);
+    close_point_stream(stream);
+    remove(path);
+}
+
+
+/* Test the bounding box and hull computed directly from a stream */
+Test(asserts, stream_bounding_box_and_hull, .init = setup_file_io, .fini = teardown_file_io){
+    const char* path = write_parabola_csv(1001);
+    CGBoundingBox_t bounding_box;
+    CGPointStream_t* stream = open_csv_point_stream(path, 100);
+    CGError_t status = compute_bounding_box_stream(stream, &bounding_box);
+    close_point_stream(stream);
+    cr_assert(status == CG_SUCCESS, "Stream bounding box failed");
+    cr_assert(bounding_box.min_x == -500 && bounding_box.max_x == 500, "Bounding box x range wrong");
+    cr_assert(bounding_box.min_y == 0 && bounding_box.max_y == 250000, "Bounding box y range wrong");
+
+    point_array_from_csv_path(point_array_A, path);
+    compute_monotone_chain(point_array_A, point_array_B, CG_W_DEGENERACY);
+    CGPointArray_t* stream_hull = init_point_array(0);
+    stream = open_csv_point_stream(path, 64);
+    status = compute_convex_hull_stream(stream, stream_hull, CG_W_DEGENERACY);
+    close_point_stream(stream);
+    cr_assert(status == CG_SUCCESS, "Stream hull failed");
+    cr_assert(stream_hull->num_points == 1001, "Every parabola point should be on the hull");
+    cr_assert(compare_point_arrays(point_array_B, stream_hull) == 0, "Stream hull differs from in-memory hull");
+    free_point_array(stream_hull);
+    remove(path);
+}
+
+
+/* Helper that fills an array with values that are hard to format */
+static void fill_formatting_cases(CGPointArray_t* point_array){
+    const double values[] = {
+        0.0, -0.0, 0.1, -1234.5678, 0.0078125, 1e-7, -5e-324, 1.7976931348623157e308, 1e21,
+        123456789.123456789, 2.5e-6, 1.5e-6, 9007199254740993.0, 0.3, 100.0, -2.675
+    };
+    size_t num_values = sizeof(values) / sizeof(values[0]);
+    size_t i;
+    for(i = 0; i < num_values; i++)
+        add_coords_to_array(point_array, values[i], values[num_values - 1 - i]);
+}
+
+
+/* Test that fixed output is byte for byte identical to printing with %lf */
+Test(asserts, csv_writer_fixed_matches_printf, .init = setup_file_io, .fini = teardown_file_io){
+    fill_formatting_cases(point_array_A);
+    char expected[8192] = "";
+    size_t i;
+    for(i = 0; i < point_array_A->num_points; i++){
+        char line[1024];
+        snprintf(line, sizeof(line), "%lf,%lf\n", point_array_A->xcoords[i], point_array_A->ycoords[i]);
+        strcat(expected, line);
+    }
+    const char* path = "libCGeo_file_io_fixed.csv";
+    CGError_t status = csv_path_from_point_array(point_array_A, path, CG_CSV_FIXED_6);
+    cr_assert(status == CG_SUCCESS, "Error in writing csv file");
+    char written[8192] = "";
+    FILE* fp = fopen(path, "rb");
+    size_t num_read = fread(written, 1, sizeof(written) - 1, fp);
+    written[num_read] = '\0';
+    fclose(fp);
+    remove(path);
+    cr_assert(strcmp(expected, written) == 0, "Fixed output differs from printf");
+}
+
+
+/* Test that shortest output reads back to exactly the same coordinates */
+Test(asserts, csv_writer_shortest_round_trips, .init = setup_file_io, .fini = teardown_file_io){
+    fill_formatting_cases(point_array_A);
+    const char* path = "libCGeo_file_io_shortest.csv";
+    CGError_t status = csv_path_from_point_array(point_array_A, path, CG_CSV_SHORTEST);
+    cr_assert(status == CG_SUCCESS, "Error in writing csv file");
+    status = point_array_from_csv_path(point_array_B, path);
+    cr_assert(status == CG_SUCCESS, "Error in mapping csv file");
+    FILE* fp = fopen(path, "rb");
+    char line[64];
+    cr_assert(fgets(line, sizeof(line), fp) != NULL && strcmp(line, "0,-2.675\n") == 0, "Output is not shortest");
+    fclose(fp);
+    remove(path);
+    size_t i;
+    cr_assert(point_array_B->num_points == point_array_A->num_points, "Not all points written");
+    for(i = 0; i < point_array_A->num_points; i++){
+        cr_assert(memcmp(&point_array_A->xcoords[i], &point_array_B->xcoords[i], sizeof(double)) == 0, "x-coordinate does not round trip");
+        cr_assert(memcmp(&point_array_A->ycoords[i], &point_array_B->ycoords[i], sizeof(double)) == 0, "y-coordinate does not round trip");
+    }
+}
+
+
+/* Test that a binary file maps back to the same coordinates and bounding box, and can be grown */
+Test(asserts, binary_file_round_trips, .init = setup_file_io, .fini = teardown_file_io){
+    fill_formatting_cases(point_array_A);
+    const char* path = "libCGeo_file_io_points.bin";
+    CGError_t status = binary_file_from_point_array(point_array_A, path);
+    cr_assert(status == CG_SUCCESS, "Error in writing binary file");
+    CGPointArray_t* mapped = NULL;
+    CGBoundingBox_t bounding_box, expected_box;
+    status = map_point_array_from_binary_file(path, &mapped, &bounding_box);
+    cr_assert(status == CG_SUCCESS, "Error in mapping binary file");
+    cr_assert(mapped->storage != NULL, "Native byte order file was copied");
+    cr_assert(compare_point_arrays(point_array_A, mapped) == 0, "Mapped points differ");
+    compute_bounding_box(point_array_A, &expected_box);
+    cr_assert(memcmp(&bounding_box, &expected_box, sizeof(CGBoundingBox_t)) == 0, "Bounding box differs");
+    status = add_coords_to_array(mapped, 1.0, 2.0);
+    cr_assert(status == CG_SUCCESS && mapped->storage == NULL, "Mapped array not detached on growth");
+    cr_assert(mapped->num_points == point_array_A->num_points + 1 && mapped->ycoords[mapped->num_points - 1] == 2.0, "Point not appended");
+    free_point_array(mapped);
+    remove(path);
+}
+
+
+/* Test that appending to mapped and shared arrays larger than the initial capacity keeps every point */
+Test(asserts, append_to_mapped_and_shared_arrays, .init = setup_file_io, .fini = teardown_file_io){
+    size_t i;
+    for(i = 0; i < 40; i++)
+        add_coords_to_array(point_array_A, (double) i, -0.5 * (double) i);
+    const char* path = "libCGeo_file_io_append.bin";
+    cr_assert(binary_file_from_point_array(point_array_A, path) == CG_SUCCESS, "Error in writing binary file");
+    CGPointArray_t* mapped = NULL;
+    cr_assert(map_point_array_from_binary_file(path, &mapped, NULL) == CG_SUCCESS, "Error in mapping binary file");
+    CGPointArray_t* shared = share_point_array(point_array_A);
+    cr_assert(shared != NULL, "Error in sharing point array");
+
+    CGPointArray_t* grown[] = {mapped, shared};
+    size_t g;
+    for(g = 0; g < 2; g++){
+        for(i = 0; i < 3; i++){
+            cr_assert(add_coords_to_array(grown[g], 100.0 + (double) i, 200.0) == CG_SUCCESS, "Error in appending point");
+            cr_assert(grown[g]->storage == NULL && grown[g]->num_points <= grown[g]->capacity, "Point appended past the end of the coordinates");
+        }
+        cr_assert(grown[g]->num_points == 43, "Points not appended");
+        for(i = 0; i < 40; i++)
+            cr_assert(grown[g]->xcoords[i] == (double) i && grown[g]->ycoords[i] == -0.5 * (double) i, "Existing point changed by append");
+        for(i = 0; i < 3; i++)
+            cr_assert(grown[g]->xcoords[40 + i] == 100.0 + (double) i && grown[g]->ycoords[40 + i] == 200.0, "Appended point differs");
+    }
+    cr_assert(point_array_A->num_points == 40 && point_array_A->xcoords[39] == 39.0, "Append visible through the original array");
+
+    free_point_array(shared);
+    free_point_array(mapped);
+    remove(path);
+}
+
+
+/* Test that truncated or foreign files are rejected */
+Test(asserts, binary_file_rejects_invalid, .init = setup_file_io, .fini = teardown_file_io){
+    const char* path = write_temp_csv("0,1\n2,3\n");
+    CGPointArray_t* mapped = NULL;
+    cr_assert(map_point_array_from_binary_file(path, &mapped, NULL) == CG_INVALID_FILE, "CSV file accepted as binary");
+    cr_assert(mapped == NULL, "Output set on failure");
+
+    const char* bin_path = "libCGeo_file_io_truncated.bin";
+    fill_formatting_cases(point_array_A);
+    binary_file_from_point_array(point_array_A, bin_path);
+    FILE* fp = fopen(bin_path, "rb");
+    char buffer[4096];
+    size_t num_read = fread(buffer, 1, sizeof(buffer), fp);
+    fclose(fp);
+    fp = fopen(bin_path, "wb");
+    fwrite(buffer, 1, num_read - 8, fp);
+    fclose(fp);
+    cr_assert(map_point_array_from_binary_file(bin_path, &mapped, NULL) == CG_INVALID_FILE, "Truncated file accepted");
+    remove(bin_path);
+    cr_assert(map_point_array_from_binary_file("libCGeo_missing.bin", &mapped, NULL) == CG_NO_FILE, "Missing file not reported");
+}
+
+
+/* Helper that fills an array with a random walk, resembling a recorded trace */
+static void fill_random_walk(CGPointArray_t* point_array, int num_points){
+    double xcoord = 1000.0, ycoord = -250.0;
+    srand(7);
+    int i;
+    for(i = 0; i < num_points; i++){
+        xcoord += (rand() / (double) RAND_MAX - 0.5) * 0.1;
+        ycoord += (rand() / (double) RAND_MAX - 0.5) * 0.1;
+        add_coords_to_array(point_array, xcoord, ycoord);
+    }
+}
+
+
+/* Test that an archive restores every coordinate to within half the precision, in order */
+Test(asserts, archive_round_trips_within_precision, .init = setup_file_io, .fini = teardown_file_io){
+    fill_random_walk(point_array_A, 10000);
+    CGArchiveOptions_t options = {0.001, 0, 1000};
+    const char* path = "libCGeo_file_io_points.cga";
+    CGError_t status = archive_file_from_point_array(point_array_A, path, &options);
+    cr_assert(status == CG_SUCCESS, "Error in writing archive");
+    FILE* fp = fopen(path, "rb");
+    fseek(fp, 0, SEEK_END);
+    long archive_size = ftell(fp);
+    fclose(fp);
+    cr_assert(archive_size < 10000 * 5, "Archive is not compressed");
+    status = point_array_from_archive_file(point_array_B, path);
+    cr_assert(status == CG_SUCCESS, "Error in reading archive");
+    cr_assert(point_array_B->num_points == point_array_A->num_points, "Not all points restored");
+    size_t i;
+    for(i = 0; i < point_array_A->num_points; i++){
+        cr_assert(fabs(point_array_A->xcoords[i] - point_array_B->xcoords[i]) <= 0.0005 + 1e-9, "x-coordinate not within precision");
+        cr_assert(fabs(point_array_A->ycoords[i] - point_array_B->ycoords[i]) <= 0.0005 + 1e-9, "y-coordinate not within precision");
+    }
+
+    // streaming yields one block per batch
+    CGPointStream_t* stream = open_archive_point_stream(path);
+    cr_assert(stream != NULL, "Error in opening archive stream");
+    CGPointArray_t* batch = init_point_array(0);
+    size_t num_streamed = 0, num_batches = 0;
+    while(next_point_batch(stream, batch) == CG_SUCCESS && batch->num_points > 0){
+        for(i = 0; i < batch->num_points; i++)
+            cr_assert(batch->xcoords[i] == point_array_B->xcoords[num_streamed + i], "Streamed point differs");
+        num_streamed += batch->num_points;
+        num_batches++;
+    }
+    cr_assert(num_streamed == 10000 && num_batches == 10, "Stream did not cover all blocks");
+    free_point_array(batch);
+    close_point_stream(stream);
+    remove(path);
+}
+
+
+/* Test that Morton ordering keeps the same points and that corrupt archives are rejected */
+Test(asserts, archive_morton_order_and_corruption, .init = setup_file_io, .fini = teardown_file_io){
+    int i;
+    for(i = 0; i < 64; i++)
+        add_coords_to_array(point_array_A, i % 8, i / 8);
+    CGArchiveOptions_t options = {1.0, 1, 0};
+    const char* path = "libCGeo_file_io_morton.cga";
+    CGError_t status = archive_file_from_point_array(point_array_A, path, &options);
+    cr_assert(status == CG_SUCCESS, "Error in writing archive");
+    status = point_array_from_archive_file(point_array_B, path);
+    cr_assert(status == CG_SUCCESS && point_array_B->num_points == 64, "Error in reading archive");
+    // the first quadrant of the curve comes first
+    for(i = 0; i < 16; i++)
+        cr_assert(point_array_B->xcoords[i] < 4 && point_array_B->ycoords[i] < 4, "Points not in Morton order");
+    double x_sum = 0, y_sum = 0;
+    for(i = 0; i < 64; i++){
+        x_sum += point_array_B->xcoords[i];
+        y_sum += point_array_B->ycoords[i];
+    }
+    cr_assert(x_sum == 224 && y_sum == 224, "Morton order changed the points");
+
+    options.precision = 1e-300;
+    cr_assert(archive_file_from_point_array(point_array_A, path, &options) == CG_INVALID_INPUT, "Unrepresentable precision accepted");
+
+    options.precision = 1.0;
+    archive_file_from_point_array(point_array_A, path, &options);
+    FILE* fp = fopen(path, "rb");
+    char buffer[1024];
+    size_t num_read = fread(buffer, 1, sizeof(buffer), fp);
+    fclose(fp);
+    fp = fopen(path, "wb");
+    fwrite(buffer, 1, num_read - 1, fp);
+    fclose(fp);
+    point_array_B->num_points = 0;
+    cr_assert(point_array_from_archive_file(point_array_B, path) == CG_INVALID_FILE, "Truncated archive accepted");
+    cr_assert(point_array_B->num_points == 0, "Points kept from corrupt archive");
+    remove(path);
+}
+
+
+/* Test that every WKB type round trips through both byte orders */
+Test(asserts, wkb_round_trips_both_byte_orders, .init = setup_file_io, .fini = teardown_file_io){
+    fill_formatting_cases(point_array_A);
+    const CGWkbType_t types[] = {CG_WKB_LINESTRING, CG_WKB_POLYGON, CG_WKB_MULTIPOINT};
+    const CGWkbByteOrder_t orders[] = {CG_WKB_BIG_ENDIAN, CG_WKB_LITTLE_ENDIAN};
+    int i, j;
+    for(i = 0; i < 3; i++){
+        for(j = 0; j < 2; j++){
+            unsigned char* data;
+            size_t size;
+            CGError_t status = wkb_from_point_array(point_array_A, types[i], orders[j], &data, &size);
+            cr_assert(status == CG_SUCCESS, "Error in writing WKB");
+            cr_assert(data[0] == orders[j], "Wrong byte order flag");
+            CGWkbInfo_t info;
+            point_array_B->num_points = 0;
+            status = point_array_from_wkb(data, size, point_array_B, &info);
+            cr_assert(status == CG_SUCCESS, "Error in reading WKB");
+            cr_assert(info.type == types[i] && info.num_bytes == size, "Wrong geometry info");
+            cr_assert(compare_point_arrays(point_array_A, point_array_B) == 0, "Points differ after round trip");
+            if(types[i] == CG_WKB_POLYGON)
+                cr_assert(info.num_rings == 1 && info.ring_sizes[0] == point_array_A->num_points, "Wrong ring sizes");
+            free_buffer(info.ring_sizes);
+            free_buffer(data);
+        }
+    }
+}
+
+
+/* Test decoding hand encoded geometries, including an EWKB point and a polygon with a hole */
+Test(asserts, wkb_reads_reference_encodings, .init = setup_file_io, .fini = teardown_file_io){
+    // SRID=4326;POINT(1 2), little-endian
+    const unsigned char ewkb_point[] = {
+        0x01, 0x01, 0x00, 0x00, 0x20, 0xE6, 0x10, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40
+    };
+    CGError_t status = point_array_from_wkb(ewkb_point, sizeof(ewkb_point), point_array_B, NULL);
+    cr_assert(status == CG_SUCCESS && point_array_B->num_points == 1, "Error in reading EWKB point");
+    cr_assert(point_array_B->xcoords[0] == 1.0 && point_array_B->ycoords[0] == 2.0, "Wrong EWKB point");
+
+    // POLYGON((0 0,4 0,4 4,0 0),(1 1,2 1,1 2,1 1)), big-endian
+    unsigned char polygon[9 + 2 * (4 + 4 * 16)] = {0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x02};
+    const double rings[16] = {0, 0, 4, 0, 4, 4, 0, 0, 1, 1, 2, 1, 1, 2, 1, 1};
+    unsigned char* out = polygon + 9;
+    int i, k;
+    for(i = 0; i < 16; i++){
+        if(i % 8 == 0){
+            const unsigned char count[4] = {0x00, 0x00, 0x00, 0x04};
+            memcpy(out, count, 4);
+            out += 4;
+        }
+        unsigned char bytes[8];
+        memcpy(bytes, &rings[i], 8);
+        for(k = 0; k < 8; k++)
+            *out++ = bytes[7 - k];
+    }
+    CGWkbInfo_t info;
+    point_array_B->num_points = 0;
+    status = point_array_from_wkb(polygon, sizeof(polygon), point_array_B, &info);
+    cr_assert(status == CG_SUCCESS && info.type == CG_WKB_POLYGON, "Error in reading polygon");
+    cr_assert(info.num_rings == 2 && info.ring_sizes[0] == 3 && info.ring_sizes[1] == 3, "Wrong rings");
+    cr_assert(point_array_B->num_points == 6 && point_array_B->xcoords[4] == 2.0, "Wrong polygon points");
+    free_buffer(info.ring_sizes);
+
+    // truncation and unsupported dimensions are rejected without adding points
+    cr_assert(point_array_from_wkb(polygon, sizeof(polygon) - 1, point_array_B, NULL) == CG_INVALID_FILE, "Truncated WKB accepted");
+    polygon[1] = 0x80;
+    cr_assert(point_array_from_wkb(polygon, sizeof(polygon), point_array_B, NULL) == CG_INVALID_TYPE, "Z geometry accepted");
+    cr_assert(point_array_B->num_points == 6, "Points added on failure");
+}
+
+
+/* Test that the pipelined hull matches the in-memory hull for any number of workers */
+Test(asserts, pipelined_hull_matches_in_memory, .init = setup_file_io, .fini = teardown_file_io){
+    // about 19 MB, split into five blocks of 4 MiB
+    const char* path = write_parabola_csv(1000001);
+    point_array_from_csv_path(point_array_A, path);
+    compute_monotone_chain(point_array_A, point_array_B, CG_W_DEGENERACY);
+    int num_threads;
+    for(num_threads = 0; num_threads <= 4; num_threads++){
+        CGPointArray_t* hull = init_point_array(0);
+        CGError_t status = compute_convex_hull_csv_path(path, hull, CG_W_DEGENERACY, num_threads);
+        cr_assert(status == CG_SUCCESS, "Pipelined hull failed");
+        cr_assert(compare_point_arrays(point_array_B, hull) == 0, "Pipelined hull differs from in-memory hull");
+        free_point_array(hull);
+    }
+    remove(path);
+    cr_assert(compute_convex_hull_csv_path(path, point_array_B, CG_W_DEGENERACY, 2) == CG_NO_FILE, "Missing file not reported");
+}
+
+
+/* Test that the pipelined and streamed hulls of collinear, identical and too few points match the in-memory hull */
+Test(asserts, block_hulls_of_degenerate_files, .init = setup_file_io, .fini = teardown_file_io){
+    char collinear[4096] = "";
+    int i;
+    for(i = 0; i < 200; i++)
+        sprintf(collinear + strlen(collinear), "%d,%d\n", (i * 37) % 200, 2 * ((i * 37) % 200));
+    const char* contents[] = {"0,0\n1,1\n2,2\n3,3\n", collinear, "5,1\n5,1\n5,1\n5,1\n5,1\n", "5,1\n5,1\n5,1\n7,2\n", "0,0\n1,1\n"};
+    CGCompute_t compute_types[] = {CG_W_DEGENERACY, CG_NO_DEGENERACY};
+    size_t c, t;
+    for(c = 0; c < sizeof(contents) / sizeof(contents[0]); c++){
+        const char* path = write_temp_csv(contents[c]);
+        for(t = 0; t < 2; t++){
+            point_array_A->num_points = 0;
+            point_array_B->num_points = 0;
+            point_array_from_csv_path(point_array_A, path);
+            CGError_t expected_status = compute_monotone_chain(point_array_A, point_array_B, compute_types[t]);
+            int num_threads;
+            for(num_threads = 1; num_threads <= 3; num_threads++){
+                CGPointArray_t* hull = init_point_array(0);
+                CGError_t status = compute_convex_hull_csv_path(path, hull, compute_types[t], num_threads);
+                cr_assert(status == expected_status, "Pipelined hull status differs from in-memory hull");
+                cr_assert(compare_point_arrays(point_array_B, hull) == 0, "Pipelined hull differs from in-memory hull");
+                free_point_array(hull);
+            }
+            size_t batch_sizes[] = {1, 2, 64};
+            size_t b;
+            for(b = 0; b < 3; b++){
+                CGPointArray_t* hull = init_point_array(0);
+                CGPointStream_t* stream = open_csv_point_stream(path, batch_sizes[b]);
+                CGError_t status = compute_convex_hull_stream(stream, hull, compute_types[t]);
+                close_point_stream(stream);
+                cr_assert(status == expected_status, "Stream hull status differs from in-memory hull");
+                cr_assert(compare_point_arrays(point_array_B, hull) == 0, "Stream hull differs from in-memory hull");
+                free_point_array(hull);
+            }
+        }
+        remove(path);
+    }
+}
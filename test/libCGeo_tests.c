@@ -148,3 +148,302 @@ Test(asserts, sort_coord_dist, .init = setup_12_points, .fini = teardown_general
     int compare = compare_point_sets(point_set_A, point_set_B);
     cr_assert(compare == 0, "Points not sorted correctly");
 }
+
+
+/* Test that sorting compact coordinates is stable and moves the keys along */
+Test(asserts, sort_coords_by_keys_stable){
+    CGCoord_t coords[6] = {{0, 5}, {1, 3}, {2, 5}, {3, 1}, {4, 3}, {5, 0}};
+    double keys[6];
+    int i;
+    for(i = 0; i < 6; i++)
+        keys[i] = coords[i].ycoord;
+    CGError_t status = sort_coords_by_keys(coords, keys, 6);
+    cr_assert(status == CG_SUCCESS, "Error in sorting coordinates");
+    const double expected_x[6] = {5, 3, 1, 4, 0, 2};
+    for(i = 0; i < 6; i++){
+        cr_assert(coords[i].xcoord == expected_x[i], "Coordinates not sorted stably");
+        cr_assert(keys[i] == coords[i].ycoord, "Keys not moved with their coordinates");
+    }
+
+    CGPointSet_t* point_set = init_point_set();
+    point_set_from_coords(coords, 6, point_set);
+    CGCoord_t copied[6];
+    coords_from_point_set(point_set, copied);
+    cr_assert(point_set->num_points == 6 && memcmp(coords, copied, sizeof(copied)) == 0, "Coordinates not converted");
+    free_point_set(point_set);
+}
+
+
+/* Test that shared arrays copy their coordinates on write and hand them back when no longer shared */
+Test(asserts, shared_point_array_copy_on_write){
+    CGPointArray_t* point_array = init_point_array(4);
+    add_coords_to_array(point_array, 1.0, 2.0);
+    add_coords_to_array(point_array, 3.0, 4.0);
+    CGPointArray_t* shared = share_point_array(point_array);
+    cr_assert(shared != NULL && shared->xcoords == point_array->xcoords, "Coordinates were copied when shared");
+
+    CGError_t status = add_coords_to_array(shared, 5.0, 6.0);
+    cr_assert(status == CG_SUCCESS && shared->xcoords != point_array->xcoords, "Shared array written in place");
+    cr_assert(shared->num_points == 3 && point_array->num_points == 2, "Append visible through the other array");
+    cr_assert(shared->xcoords[1] == 3.0 && shared->ycoords[2] == 6.0, "Coordinates not copied");
+
+    // the original is now the only user, becoming writable must not copy
+    double* xcoords = point_array->xcoords;
+    status = make_point_array_writable(point_array);
+    cr_assert(status == CG_SUCCESS && point_array->storage == NULL && point_array->xcoords == xcoords, "Unshared coordinates were copied");
+    point_array->xcoords[0] = 7.0;
+    cr_assert(shared->xcoords[0] == 1.0, "Write visible through the other array");
+
+    free_point_array(shared);
+    free_point_array(point_array);
+}
+
+
+/* Test deriving views by filtering and sorting without touching the coordinates */
+static int keep_upper_half(double xcoord, double ycoord, void* user_data){
+    (void) xcoord;
+    return ycoord >= *(const double*) user_data;
+}
+
+Test(asserts, point_view_filter_and_sort){
+    CGPointArray_t* point_array = init_point_array(0);
+    const double coords[] = {4, 1, 0, 5, 2, 3, 1, 5, 3, 0};
+    size_t i;
+    for(i = 0; i < 5; i++)
+        add_coords_to_array(point_array, coords[2 * i], coords[2 * i + 1]);
+    CGPointView_t* point_view = init_point_view(point_array);
+    cr_assert(point_view != NULL && point_view->num_indices == 5, "View not initialized");
+    cr_assert(point_view->points->xcoords == point_array->xcoords, "View copied the coordinates");
+
+    double threshold = 1.0;
+    filter_point_view(point_view, keep_upper_half, &threshold);
+    cr_assert(point_view->num_indices == 4, "Filter kept the wrong points");
+
+    // equal keys keep their order
+    CGPointView_t* by_y = copy_point_view(point_view);
+    sort_point_view(by_y, point_array->ycoords);
+    const size_t expected_y[] = {0, 2, 1, 3};
+    for(i = 0; i < 4; i++)
+        cr_assert(by_y->indices[i] == expected_y[i], "View not sorted stably by key");
+    sort_point_view(point_view, NULL);
+    const size_t expected_xy[] = {1, 3, 2, 0};
+    for(i = 0; i < 4; i++)
+        cr_assert(point_view->indices[i] == expected_xy[i], "View not sorted by coordinates");
+
+    CGPointArray_t* gathered = init_point_array(0);
+    point_array_from_point_view(by_y, gathered);
+    cr_assert(gathered->num_points == 4 && gathered->ycoords[0] == 1 && gathered->xcoords[3] == 1, "View not gathered in order");
+
+    free_point_array(gathered);
+    free_point_view(by_y);
+    free_point_view(point_view);
+    free_point_array(point_array);
+}
+
+
+/* Allocator that counts live allocations, to check every allocation goes through it */
+typedef struct {
+    size_t num_allocs;
+    size_t num_live;
+} CountingState_t;
+
+static void* counting_alloc(size_t size, void* user_data){
+    CountingState_t* state = (CountingState_t*) user_data;
+    state->num_allocs++;
+    state->num_live++;
+    return malloc(size);
+}
+
+static void* counting_realloc(void* pointer, size_t size, void* user_data){
+    (void) user_data;
+    return realloc(pointer, size);
+}
+
+static void counting_free(void* pointer, void* user_data){
+    ((CountingState_t*) user_data)->num_live--;
+    free(pointer);
+}
+
+Test(asserts, custom_allocator_sees_every_allocation){
+    CountingState_t state = {0, 0};
+    CGAllocator_t allocator = {counting_alloc, counting_realloc, counting_free, &state};
+    cr_assert(set_allocator(&allocator) == CG_SUCCESS, "Allocator not accepted");
+
+    CGPointSet_t* point_set = init_point_set();
+    CGPointSet_t* hull_set = init_point_set();
+    const double coords[] = {0, 0, 4, 0, 2, 1, 4, 4, 0, 4, 2, 3};
+    size_t i;
+    for(i = 0; i < 6; i++)
+        add_coords_to_set(point_set, coords[2 * i], coords[2 * i + 1]);
+    compute_convex_hull(point_set, hull_set, CG_GRAHAM_SCAN, CG_W_DEGENERACY);
+    cr_assert(hull_set->num_points == 4, "Hull not computed with custom allocator");
+
+    CGPointArray_t* point_array = init_point_array(0);
+    point_array_from_point_set(point_set, point_array);
+    unsigned char* data = NULL;
+    size_t size = 0;
+    wkb_from_point_array(point_array, CG_WKB_MULTIPOINT, CG_WKB_LITTLE_ENDIAN, &data, &size);
+    cr_assert(data != NULL, "Encoding not allocated");
+    free_buffer(data);
+    free_point_array(point_array);
+    free_point_set(hull_set);
+    free_point_set(point_set);
+
+    cr_assert(state.num_allocs > 0 && state.num_live == 0, "Allocations bypassed the allocator");
+    cr_assert(set_allocator(NULL) == CG_SUCCESS, "Default allocator not restored");
+    allocator.free = NULL;
+    cr_assert(set_allocator(&allocator) == CG_INVALID_INPUT, "Incomplete allocator accepted");
+}
+
+
+/* Test checking the one pass summary statistics against direct computations, on every instruction set */
+Test(asserts, point_stats_match_direct_computation){
+    CGDistribution_t distributions[] = {CG_UNIFORM_DISK, CG_DUPLICATES, CG_LARGE_MAGNITUDE};
+    size_t d;
+    for(d = 0; d < 3; d++){
+        CGPointArray_t* points = init_point_array(0);
+        generate_point_array(points, 1237, distributions[d], 7);
+        CGPointSet_t* set = init_point_set();
+        point_set_from_point_array(points, set);
+
+        size_t i, n = points->num_points, lowest = 0, highest = 0;
+        double mean_x = 0, mean_y = 0;
+        for(i = 0; i < n; i++){
+            mean_x += points->xcoords[i];
+            mean_y += points->ycoords[i];
+            if(points->ycoords[i] < points->ycoords[lowest] ||
+               (points->ycoords[i] == points->ycoords[lowest] && points->xcoords[i] < points->xcoords[lowest]))
+                lowest = i;
+            if(points->ycoords[i] > points->ycoords[highest] ||
+               (points->ycoords[i] == points->ycoords[highest] && points->xcoords[i] > points->xcoords[highest]))
+                highest = i;
+        }
+        mean_x /= n;
+        mean_y /= n;
+        double cov_xx = 0, cov_yy = 0, cov_xy = 0;
+        for(i = 0; i < n; i++){
+            cov_xx += (points->xcoords[i] - mean_x) * (points->xcoords[i] - mean_x);
+            cov_yy += (points->ycoords[i] - mean_y) * (points->ycoords[i] - mean_y);
+            cov_xy += (points->xcoords[i] - mean_x) * (points->ycoords[i] - mean_y);
+        }
+        cov_xx /= n;
+        cov_yy /= n;
+        cov_xy /= n;
+
+        CGPointStats_t stats;
+        CGBoundingBox_t box;
+        cr_assert(compute_point_stats(points, &stats) == CG_SUCCESS && stats.num_points == n, "Stats failed");
+        compute_bounding_box(points, &box);
+        cr_assert(memcmp(&box, &stats.bounding_box, sizeof(CGBoundingBox_t)) == 0, "Bounds differ");
+        cr_assert(stats.lowest_index == lowest && stats.highest_index == highest, "Extreme points differ");
+        CGPoint_t* lowest_point = find_lowest_point_in_set(set);
+        cr_assert(stats.lowest.xcoord == lowest_point->xcoord && stats.lowest.ycoord == lowest_point->ycoord, "Lowest point differs");
+        double scale = fabs(mean_x) + fabs(mean_y);
+        double spread = cov_xx + cov_yy;
+        cr_assert(fabs(stats.mean.xcoord - mean_x) <= 1e-12 * scale && fabs(stats.mean.ycoord - mean_y) <= 1e-12 * scale, "Mean differs");
+        cr_assert(fabs(stats.covariance[0][0] - cov_xx) <= 1e-9 * spread && fabs(stats.covariance[1][1] - cov_yy) <= 1e-9 * spread &&
+                  fabs(stats.covariance[0][1] - cov_xy) <= 1e-9 * spread && stats.covariance[0][1] == stats.covariance[1][0],
+                  "Covariance differs");
+
+        CGPointStats_t set_stats;
+        cr_assert(compute_point_set_stats(set, &set_stats) == CG_SUCCESS, "Set stats failed");
+        cr_assert(set_stats.num_points == n && set_stats.lowest_index == lowest && set_stats.highest_index == highest &&
+                  memcmp(&box, &set_stats.bounding_box, sizeof(CGBoundingBox_t)) == 0, "Set stats differ");
+        cr_assert(fabs(set_stats.mean.xcoord - mean_x) <= 1e-12 * scale && fabs(set_stats.covariance[1][1] - cov_yy) <= 1e-9 * spread,
+                  "Set moments differ");
+
+        CGSimdLevel_t initial = get_simd_level();
+        int level;
+        for(level = CG_SIMD_SCALAR; level <= (int) get_supported_simd_level(); level++){
+            CGPointStats_t level_stats;
+            set_simd_level((CGSimdLevel_t) level);
+            compute_point_stats(points, &level_stats);
+            cr_assert(memcmp(&level_stats, &stats, sizeof(CGPointStats_t)) == 0, "Stats differ between levels");
+        }
+        set_simd_level(initial);
+        free_point_set(set);
+        free_point_array(points);
+    }
+
+    CGPointArray_t* empty = init_point_array(0);
+    CGPointStats_t stats;
+    cr_assert(compute_point_stats(empty, &stats) == CG_POINTS_TOO_FEW, "Empty array accepted");
+    cr_assert(compute_point_stats(NULL, &stats) == CG_INVALID_INPUT, "NULL array accepted");
+    add_coords_to_array(empty, 3, -2);
+    cr_assert(compute_point_stats(empty, &stats) == CG_SUCCESS && stats.mean.xcoord == 3 && stats.covariance[0][0] == 0 &&
+              stats.lowest_index == 0 && stats.highest_index == 0, "Single point stats wrong");
+    free_point_array(empty);
+}
+
+
+/* Keeps the first point of every group of duplicates by comparing each point with every kept one */
+static size_t brute_force_dedup(const CGPointArray_t* points, double tolerance, size_t* kept){
+    size_t i, j, num_kept = 0;
+    for(i = 0; i < points->num_points; i++){
+        for(j = 0; j < num_kept; j++)
+            if(fabs(points->xcoords[kept[j]] - points->xcoords[i]) <= tolerance &&
+               fabs(points->ycoords[kept[j]] - points->ycoords[i]) <= tolerance)
+                break;
+        if(j == num_kept)
+            kept[num_kept++] = i;
+    }
+    return num_kept;
+}
+
+
+/* Test checking hash based duplicate removal against pairwise comparisons, and as a stage before the hull */
+Test(asserts, dedup_matches_pairwise_comparison){
+    CGPointArray_t* points = init_point_array(0);
+    generate_point_array(points, 3000, CG_DUPLICATES, 3);
+    generate_point_array(points, 2000, CG_UNIFORM_SQUARE, 4);
+    size_t n = points->num_points;
+    size_t* expected = (size_t*) malloc(n * sizeof(size_t));
+    size_t* kept = (size_t*) malloc(n * sizeof(size_t));
+    double tolerances[] = {0.0, 1e-3, 0.05};
+    int t;
+    for(t = 0; t < 3; t++){
+        size_t num_expected = brute_force_dedup(points, tolerances[t], expected);
+        CGPointArray_t* output = init_point_array(0);
+        cr_assert(dedup_point_array(points, output, tolerances[t], kept) == CG_SUCCESS, "Dedup failed");
+        cr_assert(output->num_points == num_expected && num_expected < n, "Wrong number of points kept");
+        size_t i;
+        for(i = 0; i < num_expected; i++){
+            cr_assert(kept[i] == expected[i], "Different points kept");
+            cr_assert(output->xcoords[i] == points->xcoords[kept[i]] && output->ycoords[i] == points->ycoords[kept[i]], "Kept point not copied");
+        }
+        free_point_array(output);
+    }
+
+    // removing exact duplicates before the hull leaves the hull unchanged
+    CGPointView_t* view = init_point_view(points);
+    CGPointView_t* hull_view = init_point_view(points);
+    hull_view->num_indices = 0;
+    cr_assert(dedup_point_view(view, 0.0) == CG_SUCCESS, "View dedup failed");
+    size_t num_expected = brute_force_dedup(points, 0.0, expected);
+    cr_assert(view->num_indices == num_expected && memcmp(view->indices, expected, num_expected * sizeof(size_t)) == 0, "View kept different points");
+    CGPointArray_t* hull = init_point_array(0);
+    compute_monotone_chain(points, hull, CG_W_DEGENERACY);
+    compute_monotone_chain_view(view, hull_view, CG_W_DEGENERACY);
+    CGPointArray_t* hull_from_view = init_point_array(0);
+    point_array_from_point_view(hull_view, hull_from_view);
+    cr_assert(hull->num_points == hull_from_view->num_points &&
+              memcmp(hull->xcoords, hull_from_view->xcoords, hull->num_points * sizeof(double)) == 0, "Hull changed by dedup");
+
+    CGPointArray_t* zeros = init_point_array(0);
+    add_coords_to_array(zeros, 0.0, 1.0);
+    add_coords_to_array(zeros, -0.0, 1.0);
+    CGPointArray_t* output = init_point_array(0);
+    cr_assert(dedup_point_array(zeros, output, 0.0, NULL) == CG_SUCCESS && output->num_points == 1, "Signed zeros not merged");
+    cr_assert(dedup_point_array(zeros, output, -1.0, NULL) == CG_INVALID_INPUT, "Negative tolerance accepted");
+    cr_assert(dedup_point_array(zeros, output, NAN, NULL) == CG_INVALID_INPUT, "NaN tolerance accepted");
+
+    free_point_array(zeros);
+    free_point_array(output);
+    free_point_array(hull);
+    free_point_array(hull_from_view);
+    free_point_view(view);
+    free_point_view(hull_view);
+    free(expected);
+    free(kept);
+    free_point_array(points);
+}
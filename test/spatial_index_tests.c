@@ -0,0 +1,549 @@
+/********************************************************************************
+ * MIT License
+ * 
+ * Copyright (c) 2019 Jakub Wlodek
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *********************************************************************************/
+
+/**
+ * Unit tests for the spatial indices of libCGeo, checked against brute force searches
+ */
+
+#include "libCGeo/libCGeo.h"
+#include <criterion/criterion.h>
+#include <criterion/assert.h>
+#include <math.h>
+
+#define NUM_POINTS  4000
+#define NUM_QUERIES 300
+
+
+CGPointArray_t* indexed;
+CGPointArray_t* queries;
+CGContext_t* context;
+
+
+/* Setup function that generates clustered points with duplicates, query locations and a context */
+void setup_spatial(void){
+    indexed = init_point_array(0);
+    generate_point_array(indexed, NUM_POINTS / 2, CG_GAUSSIAN_CLUSTERS, 11);
+    generate_point_array(indexed, NUM_POINTS / 4, CG_DUPLICATES, 12);
+    generate_point_array(indexed, NUM_POINTS / 4, CG_COLLINEAR, 13);
+    queries = init_point_array(0);
+    generate_point_array(queries, NUM_QUERIES - 3, CG_UNIFORM_SQUARE, 14);
+    // locations on indexed points, where distances tie
+    add_coords_to_array(queries, indexed->xcoords[0], indexed->ycoords[0]);
+    add_coords_to_array(queries, indexed->xcoords[NUM_POINTS / 2], indexed->ycoords[NUM_POINTS / 2]);
+    add_coords_to_array(queries, indexed->xcoords[NUM_POINTS - 1], indexed->ycoords[NUM_POINTS - 1]);
+    CGContextOptions_t options;
+    memset(&options, 0, sizeof(options));
+    options.num_threads = 4;
+    options.parallel_min_points = 64;
+    context = init_context(&options);
+}
+
+
+/* Function that performs memory cleanup after every test */
+void teardown_spatial(void){
+    free_point_array(indexed);
+    free_point_array(queries);
+    free_context(context);
+}
+
+
+/* Squared distance of an indexed point from a location */
+static double squared_distance_to(size_t index, double xcoord, double ycoord){
+    double delta_x = indexed->xcoords[index] - xcoord, delta_y = indexed->ycoords[index] - ycoord;
+    return delta_x * delta_x + delta_y * delta_y;
+}
+
+
+/* Sorts positions by distance from a location, ties by position, with an insertion sort */
+static void sort_by_distance(size_t* positions, size_t count, double xcoord, double ycoord){
+    size_t i, j;
+    for(i = 1; i < count; i++){
+        size_t position = positions[i];
+        double distance = squared_distance_to(position, xcoord, ycoord);
+        for(j = i; j > 0; j--){
+            double other = squared_distance_to(positions[j - 1], xcoord, ycoord);
+            if(other < distance || (other == distance && positions[j - 1] < position))
+                break;
+            positions[j] = positions[j - 1];
+        }
+        positions[j] = position;
+    }
+}
+
+
+/* Compares positions ascending, for qsort */
+static int compare_positions(const void* a, const void* b){
+    size_t position_A = *(const size_t*) a, position_B = *(const size_t*) b;
+    return (position_A > position_B) - (position_A < position_B);
+}
+
+
+/* Test checking nearest, k nearest and radius queries of a k-d tree against brute force, serially and batched */
+Test(asserts, kd_tree_matches_brute_force, .init = setup_spatial, .fini = teardown_spatial){
+    CGKdTree_t* tree = init_kd_tree(indexed);
+    cr_assert(tree != NULL, "Tree not built");
+    const size_t k = 12;
+    const double radius = 0.05;
+    size_t* order = (size_t*) malloc(NUM_POINTS * sizeof(size_t));
+    size_t* batch_nearest = (size_t*) malloc(NUM_QUERIES * sizeof(size_t));
+    size_t* batch_k = (size_t*) malloc(NUM_QUERIES * k * sizeof(size_t));
+    double* batch_k_distances = (double*) malloc(NUM_QUERIES * k * sizeof(double));
+    size_t* batch_offsets = (size_t*) malloc((NUM_QUERIES + 1) * sizeof(size_t));
+    size_t* batch_found = NULL;
+    cr_assert(kd_tree_nearest_batch_ctx(context, tree, queries, batch_nearest, NULL) == CG_SUCCESS, "Nearest batch failed");
+    cr_assert(kd_tree_k_nearest_batch_ctx(context, tree, queries, k, batch_k, batch_k_distances) == CG_SUCCESS, "k nearest batch failed");
+    cr_assert(kd_tree_radius_batch_ctx(context, tree, queries, radius, &batch_found, batch_offsets) == CG_SUCCESS, "Radius batch failed");
+
+    CGPointView_t* found = init_point_view(indexed);
+    size_t q, i;
+    for(q = 0; q < NUM_QUERIES; q++){
+        double xcoord = queries->xcoords[q], ycoord = queries->ycoords[q];
+        for(i = 0; i < NUM_POINTS; i++)
+            order[i] = i;
+        sort_by_distance(order, NUM_POINTS, xcoord, ycoord);
+
+        size_t nearest;
+        double nearest_distance;
+        cr_assert(kd_tree_nearest(tree, xcoord, ycoord, &nearest, &nearest_distance) == CG_SUCCESS, "Nearest failed");
+        cr_assert(nearest == order[0] && nearest_distance == squared_distance_to(order[0], xcoord, ycoord), "Wrong nearest point");
+        cr_assert(batch_nearest[q] == nearest, "Batched nearest differs");
+
+        size_t neighbors[12];
+        double distances[12];
+        cr_assert(kd_tree_k_nearest(tree, xcoord, ycoord, k, neighbors, distances) == CG_SUCCESS, "k nearest failed");
+        for(i = 0; i < k; i++){
+            cr_assert(neighbors[i] == order[i] && distances[i] == squared_distance_to(order[i], xcoord, ycoord), "Wrong k nearest points");
+            cr_assert(batch_k[q * k + i] == neighbors[i] && batch_k_distances[q * k + i] == distances[i], "Batched k nearest differ");
+        }
+
+        size_t num_within = 0;
+        while(num_within < NUM_POINTS && squared_distance_to(order[num_within], xcoord, ycoord) <= radius * radius)
+            num_within++;
+        qsort(order, num_within, sizeof(size_t), compare_positions);
+        found->num_indices = 0;
+        cr_assert(kd_tree_radius(tree, xcoord, ycoord, radius, found) == CG_SUCCESS, "Radius query failed");
+        cr_assert(found->num_indices == num_within, "Wrong number of points within the radius");
+        qsort(found->indices, found->num_indices, sizeof(size_t), compare_positions);
+        cr_assert(num_within == 0 || memcmp(found->indices, order, num_within * sizeof(size_t)) == 0, "Wrong points within the radius");
+        size_t batch_count = batch_offsets[q + 1] - batch_offsets[q];
+        qsort(batch_found + batch_offsets[q], batch_count, sizeof(size_t), compare_positions);
+        cr_assert(batch_count == num_within && (num_within == 0 || memcmp(batch_found + batch_offsets[q], order, num_within * sizeof(size_t)) == 0),
+                  "Batched radius query differs");
+    }
+
+    size_t index;
+    size_t too_many[NUM_POINTS + 1];
+    double too_many_distances[NUM_POINTS + 1];
+    cr_assert(kd_tree_k_nearest(tree, 0, 0, NUM_POINTS + 1, too_many, too_many_distances) == CG_POINTS_TOO_FEW, "k above size accepted");
+    cr_assert(kd_tree_radius(tree, 0, 0, -1.0, found) == CG_INVALID_INPUT, "Negative radius accepted");
+    CGPointArray_t* empty = init_point_array(0);
+    CGKdTree_t* empty_tree = init_kd_tree(empty);
+    cr_assert(empty_tree != NULL && kd_tree_nearest(empty_tree, 0, 0, &index, NULL) == CG_POINTS_TOO_FEW, "Empty tree not handled");
+
+    free_kd_tree(empty_tree);
+    free_point_array(empty);
+    free_point_view(found);
+    free_buffer(batch_found);
+    free(order);
+    free(batch_nearest);
+    free(batch_k);
+    free(batch_k_distances);
+    free(batch_offsets);
+    free_kd_tree(tree);
+}
+
+
+/* Compares position pairs, smaller position first, for qsort */
+static int compare_pairs(const void* a, const void* b){
+    const size_t* pair_A = (const size_t*) a;
+    const size_t* pair_B = (const size_t*) b;
+    if(pair_A[0] != pair_B[0])
+        return (pair_A[0] > pair_B[0]) - (pair_A[0] < pair_B[0]);
+    return (pair_A[1] > pair_B[1]) - (pair_A[1] < pair_B[1]);
+}
+
+
+/* Checks the radius queries and close pairs of a grid against brute force over its current points */
+static void check_grid(const CGPointGrid_t* grid, double radius){
+    size_t* expected = (size_t*) malloc(NUM_POINTS * sizeof(size_t));
+    CGPointView_t* found = init_point_view(indexed);
+    size_t q, i, j;
+    for(q = 0; q < NUM_QUERIES; q++){
+        double xcoord = queries->xcoords[q], ycoord = queries->ycoords[q];
+        size_t num_within = 0;
+        for(i = 0; i < NUM_POINTS; i++)
+            if(squared_distance_to(i, xcoord, ycoord) <= radius * radius)
+                expected[num_within++] = i;
+        found->num_indices = 0;
+        cr_assert(point_grid_radius(grid, xcoord, ycoord, radius, found) == CG_SUCCESS, "Radius query failed");
+        cr_assert(found->num_indices == num_within, "Wrong number of points within the radius");
+        qsort(found->indices, found->num_indices, sizeof(size_t), compare_positions);
+        cr_assert(num_within == 0 || memcmp(found->indices, expected, num_within * sizeof(size_t)) == 0, "Wrong points within the radius");
+    }
+
+    size_t num_expected = 0, capacity = 1024;
+    size_t* expected_pairs = (size_t*) malloc(2 * capacity * sizeof(size_t));
+    for(i = 0; i < NUM_POINTS; i++){
+        for(j = i + 1; j < NUM_POINTS; j++){
+            if(squared_distance_to(j, indexed->xcoords[i], indexed->ycoords[i]) > radius * radius)
+                continue;
+            if(num_expected == capacity){
+                capacity *= 2;
+                expected_pairs = (size_t*) realloc(expected_pairs, 2 * capacity * sizeof(size_t));
+            }
+            expected_pairs[2 * num_expected] = i;
+            expected_pairs[2 * num_expected + 1] = j;
+            num_expected++;
+        }
+    }
+    size_t* pairs = NULL;
+    size_t* batch_pairs = NULL;
+    size_t num_pairs, num_batch_pairs;
+    cr_assert(point_grid_pairs_within(grid, radius, &pairs, &num_pairs) == CG_SUCCESS, "Close pairs failed");
+    cr_assert(point_grid_pairs_within_ctx(context, grid, radius, &batch_pairs, &num_batch_pairs) == CG_SUCCESS, "Parallel close pairs failed");
+    cr_assert(num_pairs == num_expected && num_batch_pairs == num_expected, "Wrong number of close pairs");
+    qsort(pairs, num_pairs, 2 * sizeof(size_t), compare_pairs);
+    qsort(batch_pairs, num_batch_pairs, 2 * sizeof(size_t), compare_pairs);
+    cr_assert(num_expected == 0 || memcmp(pairs, expected_pairs, 2 * num_expected * sizeof(size_t)) == 0, "Wrong close pairs");
+    cr_assert(num_expected == 0 || memcmp(batch_pairs, expected_pairs, 2 * num_expected * sizeof(size_t)) == 0, "Parallel close pairs differ");
+
+    free_buffer(pairs);
+    free_buffer(batch_pairs);
+    free(expected_pairs);
+    free(expected);
+    free_point_view(found);
+}
+
+
+/* Test checking radius queries and close pairs of a grid against brute force, before and after its points move */
+Test(asserts, point_grid_matches_brute_force, .init = setup_spatial, .fini = teardown_spatial){
+    const double radius = 0.05;
+    CGPointGrid_t* grid = init_point_grid(indexed, radius);
+    cr_assert(grid != NULL, "Grid not built");
+    check_grid(grid, radius);
+    // radii reaching past the neighbouring cells, and into no other point
+    check_grid(grid, 3.5 * radius);
+    check_grid(grid, 0);
+
+    // small moves mostly keep points in their cells, large ones move every point
+    double scales[2] = {1e-9, 0.3};
+    size_t s, i;
+    for(s = 0; s < 2; s++){
+        CGPointArray_t* moved = init_point_array(NUM_POINTS);
+        for(i = 0; i < NUM_POINTS; i++){
+            double step = scales[s] * (double) ((i * 7919) % 13) / 13.0;
+            add_coords_to_array(moved, indexed->xcoords[i] + step, indexed->ycoords[i] - step);
+        }
+        free_point_array(indexed);
+        indexed = moved;
+        cr_assert(update_point_grid(grid, indexed) == CG_SUCCESS, "Grid update failed");
+        check_grid(grid, radius);
+    }
+
+    cr_assert(init_point_grid(indexed, 0) == NULL, "Zero cell size accepted");
+    CGPointView_t* found = init_point_view(indexed);
+    cr_assert(point_grid_radius(grid, 0, 0, -1.0, found) == CG_INVALID_INPUT, "Negative radius accepted");
+    CGPointArray_t* empty = init_point_array(0);
+    cr_assert(update_point_grid(grid, empty) == CG_SUCCESS, "Shrinking the grid failed");
+    size_t* pairs = NULL;
+    size_t num_pairs = 1;
+    cr_assert(point_grid_pairs_within(grid, radius, &pairs, &num_pairs) == CG_SUCCESS && num_pairs == 0, "Empty grid not handled");
+
+    free_buffer(pairs);
+    free_point_array(empty);
+    free_point_view(found);
+    free_point_grid(grid);
+}
+
+
+/* Test that points exactly a radius apart on decimal coordinates are found, however their cells round */
+Test(asserts, point_grid_finds_points_on_the_radius, .init = setup_spatial, .fini = teardown_spatial){
+    CGPointArray_t* points = init_point_array(0);
+    add_coords_to_array(points, -0.30000000000000004, 0);
+    add_coords_to_array(points, 0.1, 0);
+    size_t i, j;
+    for(i = 0; i < 198; i++)
+        add_coords_to_array(points, 1000.0 + (double) i, 1000.0);
+    CGPointGrid_t* grid = init_point_grid(points, 0.1);
+    CGPointView_t* found = init_point_view(points);
+    found->num_indices = 0;
+    cr_assert(point_grid_radius(grid, 0.1, 0, 0.4, found) == CG_SUCCESS && found->num_indices == 2, "Point on the radius missed");
+    size_t* pairs = NULL;
+    size_t num_pairs;
+    cr_assert(point_grid_pairs_within(grid, 0.4, &pairs, &num_pairs) == CG_SUCCESS && num_pairs == 1, "Pair on the radius missed");
+    free_buffer(pairs);
+    free_point_grid(grid);
+    free_point_view(found);
+    free_point_array(points);
+
+    // points on a decimal lattice, with cells and radii of whole numbers of steps
+    const double step = 0.1;
+    points = init_point_array(0);
+    int xstep, ystep;
+    for(xstep = -12; xstep <= 12; xstep++)
+        for(ystep = -4; ystep <= 4; ystep++)
+            add_coords_to_array(points, step * (double) xstep, step * (double) ystep);
+    found = init_point_view(points);
+    size_t num_steps;
+    for(num_steps = 1; num_steps <= 3; num_steps++){
+        grid = init_point_grid(points, step * (double) num_steps);
+        cr_assert(grid != NULL, "Grid not built");
+        size_t radius_steps;
+        for(radius_steps = 1; radius_steps <= 7; radius_steps++){
+            double radius = step * (double) radius_steps;
+            size_t num_expected = 0;
+            for(i = 0; i < points->num_points; i++){
+                size_t num_within = 0;
+                for(j = 0; j < points->num_points; j++){
+                    double delta_x = points->xcoords[j] - points->xcoords[i], delta_y = points->ycoords[j] - points->ycoords[i];
+                    if(delta_x * delta_x + delta_y * delta_y <= radius * radius){
+                        num_within++;
+                        num_expected += j > i;
+                    }
+                }
+                found->num_indices = 0;
+                cr_assert(point_grid_radius(grid, points->xcoords[i], points->ycoords[i], radius, found) == CG_SUCCESS, "Radius query failed");
+                cr_assert(found->num_indices == num_within, "Wrong number of lattice points within the radius");
+            }
+            cr_assert(point_grid_pairs_within(grid, radius, &pairs, &num_pairs) == CG_SUCCESS && num_pairs == num_expected, "Wrong number of lattice pairs");
+            free_buffer(pairs);
+            pairs = NULL;
+        }
+        free_point_grid(grid);
+    }
+
+    free_point_view(found);
+    free_point_array(points);
+}
+
+
+/* Visitor collecting the items of an R-tree query into a view's indices */
+static int collect_item(size_t item, void* user_data){
+    CGPointView_t* found = (CGPointView_t*) user_data;
+    found->indices[found->num_indices++] = item;
+    return 0;
+}
+
+
+/* Visitor ending a query at its first item */
+static int stop_at_first(size_t item, void* user_data){
+    (void) item;
+    (*(size_t*) user_data)++;
+    return 1;
+}
+
+
+/* Returns non-zero if two boxes share at least one point */
+static int boxes_overlap(const CGBoundingBox_t* box_A, const CGBoundingBox_t* box_B){
+    return box_A->min_x <= box_B->max_x && box_B->min_x <= box_A->max_x &&
+           box_A->min_y <= box_B->max_y && box_B->min_y <= box_A->max_y;
+}
+
+
+/* Checks single and batched window queries of a tree against brute force over the boxes it indexes */
+static void check_rtree(const CGRTree_t* tree, const CGBoundingBox_t* boxes, size_t num_boxes,
+                        const CGBoundingBox_t* windows, size_t num_windows){
+    size_t* expected = (size_t*) malloc((num_boxes + 1) * sizeof(size_t));
+    size_t* offsets = (size_t*) malloc((num_windows + 1) * sizeof(size_t));
+    size_t* batch_found = NULL;
+    CGPointView_t* found = init_point_view(indexed);
+    found->indices = (size_t*) realloc(found->indices, (num_boxes + 1) * sizeof(size_t));
+    cr_assert(rtree_query_batch_ctx(context, tree, windows, num_windows, &batch_found, offsets) == CG_SUCCESS, "Batched query failed");
+    size_t w, i;
+    for(w = 0; w < num_windows; w++){
+        size_t num_expected = 0;
+        for(i = 0; i < num_boxes; i++)
+            if(boxes_overlap(boxes + i, windows + w))
+                expected[num_expected++] = i;
+        found->num_indices = 0;
+        cr_assert(rtree_query(tree, windows + w, collect_item, found) == CG_SUCCESS, "Window query failed");
+        cr_assert(found->num_indices == num_expected, "Wrong number of items in the window");
+        qsort(found->indices, found->num_indices, sizeof(size_t), compare_positions);
+        cr_assert(num_expected == 0 || memcmp(found->indices, expected, num_expected * sizeof(size_t)) == 0, "Wrong items in the window");
+        size_t batch_count = offsets[w + 1] - offsets[w];
+        qsort(batch_found + offsets[w], batch_count, sizeof(size_t), compare_positions);
+        cr_assert(batch_count == num_expected && (num_expected == 0 || memcmp(batch_found + offsets[w], expected, num_expected * sizeof(size_t)) == 0),
+                  "Batched window query differs");
+    }
+    free_buffer(batch_found);
+    free_point_view(found);
+    free(expected);
+    free(offsets);
+}
+
+
+/* Test checking window queries of R-trees over points of arrays and sets and over boxes against brute force */
+Test(asserts, rtree_matches_brute_force, .init = setup_spatial, .fini = teardown_spatial){
+    // windows of a range of sizes around the queries, one covering everything and one on an indexed point
+    size_t num_windows = NUM_QUERIES + 2, w, i;
+    CGBoundingBox_t* windows = (CGBoundingBox_t*) malloc(num_windows * sizeof(CGBoundingBox_t));
+    for(w = 0; w < NUM_QUERIES; w++){
+        double half_width = 0.002 * (double) (w % 50), half_height = 0.003 * (double) (w % 7);
+        windows[w].min_x = queries->xcoords[w] - half_width;
+        windows[w].max_x = queries->xcoords[w] + half_width;
+        windows[w].min_y = queries->ycoords[w] - half_height;
+        windows[w].max_y = queries->ycoords[w] + half_height;
+    }
+    windows[NUM_QUERIES].min_x = windows[NUM_QUERIES].min_y = -1e9;
+    windows[NUM_QUERIES].max_x = windows[NUM_QUERIES].max_y = 1e9;
+    windows[NUM_QUERIES + 1].min_x = windows[NUM_QUERIES + 1].max_x = indexed->xcoords[7];
+    windows[NUM_QUERIES + 1].min_y = windows[NUM_QUERIES + 1].max_y = indexed->ycoords[7];
+
+    CGBoundingBox_t* point_boxes = (CGBoundingBox_t*) malloc(NUM_POINTS * sizeof(CGBoundingBox_t));
+    for(i = 0; i < NUM_POINTS; i++){
+        point_boxes[i].min_x = point_boxes[i].max_x = indexed->xcoords[i];
+        point_boxes[i].min_y = point_boxes[i].max_y = indexed->ycoords[i];
+    }
+    CGRTree_t* array_tree = init_point_array_rtree(indexed);
+    cr_assert(array_tree != NULL, "Array tree not built");
+    check_rtree(array_tree, point_boxes, NUM_POINTS, windows, num_windows);
+
+    CGPointSet_t* point_set = init_point_set();
+    cr_assert(point_set_from_point_array(indexed, point_set) == CG_SUCCESS, "Conversion failed");
+    CGRTree_t* set_tree = init_point_set_rtree(point_set);
+    cr_assert(set_tree != NULL, "Set tree not built");
+    check_rtree(set_tree, point_boxes, NUM_POINTS, windows, num_windows);
+
+    // boxes spanning each pair of consecutive points, like the segments of a path
+    CGBoundingBox_t* segment_boxes = (CGBoundingBox_t*) malloc((NUM_POINTS - 1) * sizeof(CGBoundingBox_t));
+    for(i = 0; i + 1 < NUM_POINTS; i++){
+        segment_boxes[i].min_x = fmin(indexed->xcoords[i], indexed->xcoords[i + 1]);
+        segment_boxes[i].max_x = fmax(indexed->xcoords[i], indexed->xcoords[i + 1]);
+        segment_boxes[i].min_y = fmin(indexed->ycoords[i], indexed->ycoords[i + 1]);
+        segment_boxes[i].max_y = fmax(indexed->ycoords[i], indexed->ycoords[i + 1]);
+    }
+    CGRTree_t* box_tree = init_rtree(segment_boxes, NUM_POINTS - 1);
+    cr_assert(box_tree != NULL, "Box tree not built");
+    check_rtree(box_tree, segment_boxes, NUM_POINTS - 1, windows, num_windows);
+    // trees of one leaf under the root and of one item
+    CGRTree_t* small_tree = init_rtree(segment_boxes, 17);
+    CGRTree_t* single_tree = init_rtree(segment_boxes, 1);
+    cr_assert(small_tree != NULL && single_tree != NULL, "Small trees not built");
+    check_rtree(small_tree, segment_boxes, 17, windows, num_windows);
+    check_rtree(single_tree, segment_boxes, 1, windows, num_windows);
+
+    size_t visited = 0;
+    cr_assert(rtree_query(array_tree, windows + NUM_QUERIES, stop_at_first, &visited) == CG_SUCCESS && visited == 1, "Search not ended by the visitor");
+    CGBoundingBox_t inverted = {1, 0, 0, 1};
+    cr_assert(rtree_query(array_tree, &inverted, stop_at_first, &visited) == CG_INVALID_INPUT, "Inverted window accepted");
+    segment_boxes[3].min_x = NAN;
+    cr_assert(init_rtree(segment_boxes, NUM_POINTS - 1) == NULL, "NaN box accepted");
+    CGRTree_t* empty_tree = init_rtree(NULL, 0);
+    cr_assert(empty_tree != NULL && rtree_query(empty_tree, windows, stop_at_first, &visited) == CG_SUCCESS && visited == 1, "Empty tree not handled");
+
+    free_rtree(empty_tree);
+    free_rtree(single_tree);
+    free_rtree(small_tree);
+    free_rtree(box_tree);
+    free_rtree(set_tree);
+    free_rtree(array_tree);
+    free_point_set(point_set);
+    free(segment_boxes);
+    free(point_boxes);
+    free(windows);
+}
+
+
+/* Allocator that counts its allocations, to see which calls go through it */
+static void* counting_alloc(size_t size, void* user_data){
+    (*(size_t*) user_data)++;
+    return malloc(size);
+}
+
+static void* counting_realloc(void* pointer, size_t size, void* user_data){
+    (*(size_t*) user_data)++;
+    return realloc(pointer, size);
+}
+
+static void counting_free(void* pointer, void* user_data){
+    (void) user_data;
+    free(pointer);
+}
+
+
+/* Test that batched queries on a context take their scratch from the context, and only their results from the global allocator */
+Test(asserts, batch_queries_allocate_scratch_from_the_context){
+    size_t num_global = 0, num_context = 0;
+    CGAllocator_t global_allocator = {counting_alloc, counting_realloc, counting_free, &num_global};
+    CGAllocator_t context_allocator = {counting_alloc, counting_realloc, counting_free, &num_context};
+    cr_assert(set_allocator(&global_allocator) == CG_SUCCESS, "Allocator not accepted");
+    CGContextOptions_t options;
+    memset(&options, 0, sizeof(options));
+    options.num_threads = 4;
+    options.parallel_min_points = 64;
+    options.scratch_size = 4096;
+    options.allocator = &context_allocator;
+    CGContext_t* counted_context = init_context(&options);
+    CGPointArray_t* points = init_point_array(0);
+    generate_point_array(points, NUM_POINTS, CG_GAUSSIAN_CLUSTERS, 31);
+    CGKdTree_t* tree = init_kd_tree(points);
+    CGPointGrid_t* grid = init_point_grid(points, 0.05);
+    CGRTree_t* rtree = init_point_array_rtree(points);
+    CGBoundingBox_t* windows = (CGBoundingBox_t*) malloc(NUM_QUERIES * sizeof(CGBoundingBox_t));
+    size_t* offsets = (size_t*) malloc((NUM_POINTS + 1) * sizeof(size_t));
+    size_t i;
+    for(i = 0; i < NUM_QUERIES; i++){
+        windows[i].min_x = points->xcoords[i] - 0.05;
+        windows[i].max_x = points->xcoords[i] + 0.05;
+        windows[i].min_y = points->ycoords[i] - 0.05;
+        windows[i].max_y = points->ycoords[i] + 0.05;
+    }
+
+    // twice each, so the pool is started and the arenas have grown before counting
+    size_t round, num_found;
+    for(round = 0; round < 2; round++){
+        size_t* found = NULL;
+        size_t before = num_global;
+        num_context = 0;
+        cr_assert(kd_tree_radius_batch_ctx(counted_context, tree, points, 0.05, &found, offsets) == CG_SUCCESS, "Radius batch failed");
+        cr_assert(round == 0 || num_global - before == 1, "Radius batch scratch from the global allocator");
+        cr_assert(round == 0 || num_context > 0, "Radius batch results not grown with the context allocator");
+        free_buffer(found);
+
+        found = NULL;
+        before = num_global;
+        num_context = 0;
+        cr_assert(rtree_query_batch_ctx(counted_context, rtree, windows, NUM_QUERIES, &found, offsets) == CG_SUCCESS, "Window batch failed");
+        cr_assert(round == 0 || num_global - before == 1, "Window batch scratch from the global allocator");
+        cr_assert(round == 0 || num_context > 0, "Window batch results not grown with the context allocator");
+        free_buffer(found);
+
+        found = NULL;
+        before = num_global;
+        num_context = 0;
+        cr_assert(point_grid_pairs_within_ctx(counted_context, grid, 0.05, &found, &num_found) == CG_SUCCESS, "Close pairs failed");
+        cr_assert(round == 0 || num_global - before == 1, "Close pair scratch from the global allocator");
+        cr_assert(round == 0 || num_context > 0, "Close pairs not grown with the context allocator");
+        free_buffer(found);
+    }
+
+    free(offsets);
+    free(windows);
+    free_rtree(rtree);
+    free_point_grid(grid);
+    free_kd_tree(tree);
+    free_point_array(points);
+    free_context(counted_context);
+    set_allocator(NULL);
+}